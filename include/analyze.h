@@ -6,7 +6,8 @@
 
 /*
  * Performs analysis on a single layout, calculating statistics for monograms,
- * bigrams, trigrams, quadgrams, and skipgrams. It then delegates to meta_analysis
+ * bigrams, trigrams, quadgrams, skipgrams, and five-grams. It then delegates to
+ * meta_analysis
  * for the calculation of meta-statistics.
  *
  * Parameters:
@@ -16,4 +17,22 @@
  */
 void single_analyze(layout *lt);
 
+/*
+ * Calculates the derived statistics of a layout, each the sum of its
+ * disjoint children, from its already calculated ngram statistics.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout, its walked statistics must be filled in.
+ */
+void derive_stats(layout *lt);
+
+/*
+ * Calculates the meta statistics of a layout from its already calculated
+ * ngram statistics.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout, its ngram statistics must be filled in.
+ */
+void meta_analyze(layout *lt);
+
 #endif
@@ -0,0 +1,61 @@
+#ifndef ANYTIME_H
+#define ANYTIME_H
+
+#include "structs.h"
+
+/* Points of the best score against time curve of every run. */
+#define ANYTIME_CHECKPOINTS 100
+/* Shuffles every configuration starts from, the same for all of them. */
+#define ANYTIME_SEEDS 5
+/* Characters of the synthetic corpus. */
+#define ANYTIME_CORPUS_LENGTH 2000000
+
+/*
+ * Fills the corpus arrays from a synthetic text drawn by a fixed seed Markov
+ * chain over the language, so the benchmark scores the same corpus on every
+ * machine and commit.
+ */
+void synthetic_corpus();
+
+/*
+ * Measures how many moves a single chain of the selected backend makes per
+ * second, used to size the engine schedules to the time budget.
+ *
+ * Parameters:
+ *   lt: The analyzed and scored starting layout.
+ *
+ * Returns:
+ *   The moves per second of one chain.
+ */
+double anytime_rate(layout *lt);
+
+/*
+ * Runs the selected engine and backend on every thread from a layout for
+ * time_budget seconds and samples the best score found so far.
+ *
+ * Parameters:
+ *   lt: The analyzed and scored starting layout.
+ *   rate: The moves per second of one chain, from anytime_rate().
+ *   seed: Seeds the random moves of the threads.
+ *   curve: Receives the best score at each of the ANYTIME_CHECKPOINTS evenly
+ *          spaced points of the budget.
+ *
+ * Returns:
+ *   The number of layouts scored.
+ */
+double anytime_run(layout *lt, double rate, unsigned int seed, float *curve);
+
+/*
+ * Prints the median curve, final best, area under the curve, and time to
+ * target of every configuration. The target is the median final best over
+ * every run of every configuration.
+ *
+ * Parameters:
+ *   names: The name of each configuration.
+ *   count: The number of configurations.
+ *   curves: ANYTIME_SEEDS curves per configuration, in order.
+ *   rates: The layouts per second of each configuration.
+ */
+void report_anytime(char **names, int count, float *curves, double *rates);
+
+#endif
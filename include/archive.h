@@ -0,0 +1,87 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "global.h"
+#include "structs.h"
+
+/*
+ * Entry of the layout archive, one layout found under one configuration.
+ * Kept out of structs.h since the OpenCL kernel has no 64 bit long long.
+ */
+typedef struct archive_entry {
+    unsigned long long layout_hash;
+    unsigned long long config_hash;
+    long long timestamp;
+    float score;
+    char corpus[61];
+    char weights[61];
+    int matrix[row][col];
+} archive_entry;
+
+/*
+ * Hashes the keys of a layout. The hash is taken over the characters rather
+ * than their language indices so it stays valid if the language file changes.
+ *
+ * Parameters:
+ *   matrix: The layout matrix.
+ * Returns: A 64 bit FNV-1a hash of the layout.
+ */
+unsigned long long hash_layout(int matrix[row][col]);
+
+/*
+ * Hashes everything that decides a layout's score: the corpus, the geometry,
+ * and the name and weight of every stat. Layouts archived under the same hash
+ * have directly comparable scores.
+ *
+ * Returns: A 64 bit FNV-1a hash of the current configuration.
+ */
+unsigned long long hash_config();
+
+/*
+ * Reads every entry of the current language's archive, under a shared lock so
+ * a run archiving at the same time is never seen half written.
+ *
+ * Parameters:
+ *   entries: Set to a newly allocated array of entries, to be freed by the
+ *            caller. NULL if the archive is empty or does not exist.
+ * Returns: The number of entries read.
+ */
+int read_archive(archive_entry **entries);
+
+/*
+ * Appends layouts to the current language's archive under the current
+ * configuration. Layouts already archived under the same configuration, and
+ * duplicates within the batch, are skipped. The archive stays locked from the
+ * read of the stored entries to the end of the append, so concurrent runs
+ * neither interleave their lines nor add the same layout twice.
+ *
+ * Parameters:
+ *   lts: The scored layouts to archive.
+ *   count: The number of layouts.
+ * Returns: The number of layouts added.
+ */
+int archive_layouts(layout **lts, int count);
+
+/*
+ * qsort comparator ordering archive entries by configuration, and by
+ * descending score within a configuration.
+ */
+int compare_archive_config(const void *a, const void *b);
+
+/* qsort comparator ordering archive entries by layout hash. */
+int compare_archive_layout(const void *a, const void *b);
+
+/* qsort comparator ordering archive entries by descending score. */
+int compare_archive_score(const void *a, const void *b);
+
+/*
+ * Prints one archive entry on a single line: its score, hash, and keys row
+ * by row.
+ *
+ * Parameters:
+ *   rank: The position to print in front of the entry.
+ *   entry: The entry to print.
+ */
+void print_archive_entry(int rank, archive_entry *entry);
+
+#endif
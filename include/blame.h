@@ -0,0 +1,51 @@
+#ifndef BLAME_H
+#define BLAME_H
+
+#include "structs.h"
+
+/* Moves between refreshes of a thread's blame table. */
+#define BLAME_REFRESH 64
+
+/*
+ * Fills the blame of every key position of a layout: the weighted penalty of
+ * the ngram tuples touching it, less their weighted reward, and never below
+ * zero. Derived stats pass their weight on to the stats they are summed from,
+ * meta and five-gram stats are not sums over tuples and are left out.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   blame: Receives DIM1 values, one per flattened position.
+ */
+void layout_blame(layout *lt, float *blame);
+
+/*
+ * Builds the cumulative table blamed positions are drawn from, leaving the
+ * positions the chain has pinned out.
+ *
+ * Parameters:
+ *   blame: The blame of every position, from layout_blame().
+ *   chain_pins: The pins of the chain, which may differ from the global ones
+ *               in the jobs mode.
+ *   cumulative: Receives DIM1 running sums.
+ *
+ * Returns:
+ *   The total blame, 0 if nothing free is to blame.
+ */
+float blame_table(float *blame, int (*chain_pins)[col], float *cumulative);
+
+/*
+ * Picks a swap endpoint, in proportion to blame for guide_rate percent of the
+ * picks and uniformly otherwise, so every swap stays possible. The caller
+ * still rejects pinned positions, and passes a total of 0 after a few rejected
+ * picks so the draws cannot keep landing on the same few keys.
+ *
+ * Parameters:
+ *   pick_row, pick_col: Receive the position.
+ *   cumulative: The table from blame_table().
+ *   total: The total blame, 0 for a uniform pick.
+ *   seed: The random state of the calling thread, for rand_r().
+ */
+void guided_position(int *pick_row, int *pick_col, float *cumulative, float total,
+    unsigned int *seed);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+/*
+ * Picks the quadgram representation for the memory budget, setting quad_model
+ * and quad_mass, and logs every candidate and the decision. Must run after
+ * normalize_corpus() and before build_quad_model(). Only the footprint after
+ * the model is built is held to the budget, not the start up.
+ */
+void fit_memory_budget();
+
+#endif
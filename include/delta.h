@@ -0,0 +1,30 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include "structs.h"
+
+/* Frequency changes smaller than this, in percentage points, are dropped. */
+#define DELTA_EPSILON 1e-6
+
+/*
+ * Reads and normalizes the second corpus, then keeps only the entries of its
+ * tables that differ from the current corpus. Also builds the lists of stats
+ * walking each position ngram, so a changed entry can be applied to a
+ * layout without walking any stat.
+ */
+void read_delta();
+
+/* Frees the sparse difference and the stat lists. */
+void free_delta();
+
+/*
+ * Moves an analyzed layout from the current corpus to the second one by
+ * applying only the changed entries to its stats, then recalculates its
+ * derived and meta stats and its score.
+ *
+ * Parameters:
+ *   lt: A pointer to a layout analyzed and scored on the current corpus.
+ */
+void delta_analyze(layout *lt);
+
+#endif
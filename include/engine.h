@@ -0,0 +1,64 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+/* Longest history the late acceptance engine keeps. */
+#define ENGINE_HISTORY_MAX 1000
+/* Moves the threshold engine watches before setting its threshold. */
+#define ENGINE_CALIBRATION 100
+
+/*
+ * The state of one search chain. Every engine uses the fields it needs, the
+ * harness only reads 'swaps', the number of swaps to make for the next move.
+ */
+typedef struct engine_state {
+    int iterations;
+    int thread_id;
+    int swaps;
+    int moves;
+    int accepted;
+    /* annealing */
+    float T;
+    float max_T;
+    int reheating_count;
+    int improvement_counter;
+    /* late acceptance */
+    float history[ENGINE_HISTORY_MAX];
+    int history_length;
+    /* threshold accepting */
+    float threshold;
+    float start_threshold;
+    double calibration_sum;
+} engine_state;
+
+/*
+ * A search strategy driven by the optimizer threads. For every move the
+ * harness makes 'swaps' swaps, scores the result, asks accept() whether to
+ * keep it, and calls step() to advance the schedule.
+ */
+typedef struct engine {
+    char code;
+    const char *name;
+    /* Sets up a chain for a run of 'iterations' moves from a scored layout. */
+    void (*init)(engine_state *s, int iterations, float score);
+    /* Decides whether a candidate score replaces the current one. */
+    int (*accept)(engine_state *s, float candidate, float current);
+    /* Advances the schedule after move 'iteration' and sets 'swaps'. */
+    void (*step)(engine_state *s, int iteration);
+    /* Prints a summary of the chain. */
+    void (*report)(engine_state *s);
+} engine;
+
+/* Every engine, in the order the benchmark compares them. */
+extern engine engines[];
+extern int engine_count;
+
+/*
+ * Finds an engine by its code.
+ *
+ * Parameters:
+ *   code: The code of the engine, as returned by check_engine_mode().
+ * Returns: A pointer to the engine.
+ */
+engine *find_engine(char code);
+
+#endif
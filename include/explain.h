@@ -0,0 +1,36 @@
+#ifndef EXPLAIN_H
+#define EXPLAIN_H
+
+#include "structs.h"
+
+/*
+ * Places the characters of the layout on a position tuple.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   ngram: The flattened position tuple.
+ *   order: The number of positions, 1 to 4.
+ *   chars: Receives the language index on each position.
+ *
+ * Returns:
+ *   1 if every position holds a character, 0 otherwise.
+ */
+int place_ngram(layout *lt, int ngram, int order, int *chars);
+
+/*
+ * Returns the corpus frequency of an ngram, summed over skip-1 to skip-9 for
+ * skipgrams, in percent.
+ */
+float ngram_frequency(int *chars, int order, int skipgram);
+
+/*
+ * Prints, for every stat shown by the normal output, the archive_top ngrams
+ * that contribute most to it on the layout. Meta and five-gram stats are not
+ * sums over tuples of the layout and are left out.
+ *
+ * Parameters:
+ *   lt: A layout already analyzed by single_analyze().
+ */
+void explain_layout(layout *lt);
+
+#endif
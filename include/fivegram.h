@@ -0,0 +1,25 @@
+#ifndef FIVEGRAM_H
+#define FIVEGRAM_H
+
+#include "structs.h"
+
+/*
+ * Reads the five-grams of the corpus, from its cache if there is one.
+ * Refuses setups whose analysis does not go through single_analyze(), since
+ * only it fills in the five-gram stats.
+ */
+void read_fivegrams();
+
+/* Frees the compact five-gram arrays. */
+void free_fivegrams();
+
+/*
+ * Calculates the five-gram statistics of a layout by placing every observed
+ * five-gram on it and testing its position sequence against each stat in use.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout to analyze.
+ */
+void five_analyze(layout *lt);
+
+#endif
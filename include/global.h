@@ -2,16 +2,9 @@
 #define GLOBAL_H
 
 #include <wchar.h>
+#include <stdatomic.h>
 #include "structs.h"
 
-/* Defining dimensions for the layout grid. */
-#define row 3
-#define col 12
-#define dim1 row * col
-#define dim2 dim1 * dim1
-#define dim3 dim2 * dim1
-#define dim4 dim3 * dim1
-
 /* Character count in the chosen language. */
 extern int LANG_LENGTH;
 
@@ -32,20 +25,64 @@ extern int WORKERS;
 /* Paths to data files. */
 extern char *lang_name;
 extern char *corpus_name;
+extern char *corpus2_name;
 extern char *layout_name;
 extern char *layout2_name;
 extern char *weight_name;
+extern char *geometry_name;
+extern char *custom_stats_name;
+extern char *format_file;
+extern char *jobs_name;
+/* Comma separated stats the front mode trades off. */
+extern char *objective_list;
+
+/* Text files named after the options, scored by the stream mode. */
+extern char **document_paths;
+extern int document_count;
 
 /* Control flags for program execution. */
 extern char run_mode;
 extern int repetitions;
 extern int threads;
+extern int archive_top;
 extern char output_mode;
 extern char backend_mode;
+extern char format_mode;
+extern char search_engine;
+
+/* Corpus shards for robustness evaluation, and the objective optimized. */
+extern int shard_count;
+extern char shard_objective;
+extern float shard_lambda;
+
+/* Percentage of optimizer moves that trade a key for an unused character. */
+extern int reserve_rate;
+/* Score lost per percentage point of characters left off the layout. */
+extern float reserve_penalty;
+
+/* Quadgram model (exact, markov, hybrid) and the mass the hybrid keeps exact. */
+extern char quad_model;
+extern float quad_mass;
+
+/* Megabytes the data structures should fit in, 0 for no budget. */
+extern float memory_budget;
+
+/* Rows and columns the permutation mode moves: hands, columns, rows, all. */
+extern char subspace;
+
+/* Seconds each run of the anytime benchmark gets. */
+extern float time_budget;
+
+/* Percentage of swap endpoints drawn in proportion to the blame of each key. */
+extern int guide_rate;
 
 extern double layouts_analyzed;
 extern double elapsed_compute_time;
 
+/* Set by the signal handlers, polled by the optimizer threads. */
+extern atomic_int stop_requested;
+extern atomic_int dump_requested;
+
 /* The selected language's character set. */
 extern wchar_t *lang_arr;
 
@@ -55,6 +92,15 @@ extern int *char_table;
 /* Pinned key positions on the layout for improvement. */
 extern int pins[row][col];
 
+/* Key properties of each grid position, read from the geometry file. */
+extern char geo_hand[row][col];
+extern int geo_finger[row][col];
+extern int geo_row[row][col];
+extern int geo_stretch[row][col];
+/* Physical coordinates, read for distance based stats but not used yet. */
+extern float geo_x[row][col];
+extern float geo_y[row][col];
+
 /* Head of the linked list for layout ranking. */
 extern layout_node *head_node;
 
@@ -79,6 +125,7 @@ extern int TRI_LENGTH;
 extern int QUAD_LENGTH;
 extern int SKIP_LENGTH;
 extern int META_LENGTH;
+extern int FIVE_LENGTH;
 
 /* Arrays to hold all statistics after processing. */
 extern mono_stat *stats_mono;
@@ -87,5 +134,6 @@ extern tri_stat *stats_tri;
 extern quad_stat *stats_quad;
 extern skip_stat *stats_skip;
 extern meta_stat *stats_meta;
+extern five_stat *stats_five;
 
 #endif
@@ -0,0 +1,14 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+/*
+ * Counts the ngrams of the corpus text on an OpenCL device, filling the global
+ * corpus arrays as read_corpus() does.
+ *
+ * Returns:
+ *   1 if the corpus was counted, 0 if OpenCL was unavailable or failed, in
+ *   which case the corpus arrays are untouched.
+ */
+int cl_read_corpus();
+
+#endif
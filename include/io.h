@@ -2,13 +2,27 @@
 #define IO_H
 
 #include <wchar.h>
+#include <stdarg.h>
 #include "global.h"
 #include "structs.h"
 
+/*
+ * Formats a message into a newly allocated wide string, growing the buffer
+ * until the whole message fits.
+ *
+ * Parameters:
+ *   format: The format string for the message.
+ *   args:   Variable arguments for the format string.
+ * Returns: The formatted message, to be freed by the caller.
+ */
+wchar_t *format_message(const wchar_t *format, va_list args);
+
 /*
  * Prints a message to the standard output stream, with verbosity control.
  * The message will only be printed if the current output mode meets or
  * exceeds the required verbosity level specified by 'required_level'.
+ * The message is formatted on the calling thread and handed to the logger,
+ * which writes it out asynchronously.
  *
  * Parameters:
  *   required_level: The minimum verbosity level required to print the message.
@@ -33,6 +47,18 @@ void log_print(char required_level, const wchar_t *format, ...);
  */
 void log_print_centered(char required_level, const wchar_t *format, ...);
 
+/*
+ * Prints a progress line, rate limited to the logger's refresh rate so
+ * optimizer threads can report as often as they like without flooding the
+ * output. Updates that arrive too soon after the previous one are dropped.
+ *
+ * Parameters:
+ *   required_level: The minimum verbosity level required to print the message.
+ *   format:         The format string for the message.
+ *   ...:            Variable arguments for the format string.
+ */
+void log_progress(char required_level, const wchar_t *format, ...);
+
 /* Prints a bar of 80 ='s */
 void print_bar(char required_level);
 
@@ -58,12 +84,30 @@ void read_config();
  */
 void read_args(int argc, char **argv);
 
+/*
+ * Returns 1 if the selected run can use approximated quadgrams, 0 if it reads
+ * the dense quadgram table: shards, stream, and delta count quadgrams of their
+ * own, the opencl and lane backends of the optimizing modes read the table
+ * directly, and the anytime benchmark always runs the lane backend.
+ */
+int quads_approximable();
+
 /*
  * Validates the current program settings to ensure they are legal.
  * Terminates the program if an invalid setting is found.
  */
 void check_setup();
 
+/*
+ * Reads the keyboard geometry file and fills the per position key tables used
+ * to build the stats. The file is a series of sections, each a name followed
+ * by a ROW by COL grid: 'hand:' (l, r, or - for no key) and 'finger:' (0-7
+ * from left pinky to right pinky) are required, 'row:' (logical row),
+ * 'stretch:' (1 or 0), 'x:' and 'y:' (physical coordinates) are optional.
+ * Positions without a key are pinned so they are never filled.
+ */
+void read_geometry();
+
 /*
  * Reads and sets the current language's character set from a language file.
  * Sets up the 'char_table' for character code lookups. It performs checks to
@@ -81,6 +125,15 @@ void read_lang();
  */
 int read_corpus_cache();
 
+/*
+ * Counts every ngram ending at the newest character in the global corpus
+ * arrays.
+ *
+ * Parameters:
+ *   mem: The last 11 seen characters as language indices, newest first.
+ */
+void count_ngrams(int *mem);
+
 /*
  * Reads and processes a corpus text file to collect ngram frequency data. Reads
  * the corpus character by character, updating the frequency counts in the
@@ -121,6 +174,15 @@ void read_layout(layout *lt, int which_layout);
  */
 void quiet_print(layout *lt);
 
+/*
+ * Writes a layout to a file in the format read_layout() reads, a blank column
+ * between the hands.
+ * Parameters:
+ *   lt:   A pointer to the layout structure to be written.
+ *   path: The path of the file, replaced if it exists.
+ */
+void write_layout(layout *lt, char *path);
+
 /*
  * Prints the layout along with ngram stats.
  * Parameters:
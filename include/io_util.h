@@ -68,4 +68,54 @@ char check_output_mode(char *optarg);
  */
 char check_backend_mode(char *optarg);
 
+/*
+ * Validates and converts a record format string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the record format.
+ * Returns: The character representing the validated format, or 'h' if
+ *          invalid.
+ */
+char check_format_mode(char *optarg);
+
+/*
+ * Validates and converts a shard objective string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the objective.
+ * Returns: The character representing the validated objective, or 'n' if
+ *          invalid.
+ */
+char check_objective_mode(char *optarg);
+
+/*
+ * Validates and converts a search engine string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the engine.
+ * Returns: The character representing the validated engine, or 'a' if
+ *          invalid.
+ */
+char check_engine_mode(char *optarg);
+
+/*
+ * Validates and converts a quadgram model string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the quadgram model.
+ * Returns: The character representing the validated model, or 'e' if
+ *          invalid.
+ */
+char check_quad_mode(char *optarg);
+
+/*
+ * Validates and converts a permutation subspace string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the subspace.
+ * Returns: The character representing the validated subspace, or 'h' if
+ *          invalid.
+ */
+char check_subspace_mode(char *optarg);
+
 #endif
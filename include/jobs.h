@@ -0,0 +1,44 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "structs.h"
+
+/*
+ * One line of a job file: an improve or generate run with its own starting
+ * layout, weights, pins, and budget. The budget is either a number of
+ * repetitions or, when 'seconds' is above 0, a time the job may take of the
+ * whole worker pool.
+ */
+typedef struct job {
+    char mode;
+    char *layout_name;
+    char *weight_name;
+    int pins[row][col];
+    int repetitions;
+    float seconds;
+} job;
+
+/*
+ * Reads the job file 'jobs_name' from data/jobs/. Each line holds a mode (g
+ * or i), a layout, a weights file, pins, and a budget, separated by spaces.
+ * Pins are ROW*COL characters, '.' for a free key and anything else for a
+ * pinned one, '/' may separate the rows, and '-' keeps the pins of
+ * config.conf. The budget is a number of repetitions, or seconds when it ends
+ * in 's'. Blank lines and lines starting with '#' are skipped.
+ *
+ * Parameters:
+ *   jobs: Set to the allocated array of jobs.
+ * Returns: The number of jobs read.
+ */
+int read_jobs(job **jobs);
+
+/*
+ * Frees an array of jobs.
+ *
+ * Parameters:
+ *   jobs: The array from read_jobs().
+ *   count: The number of jobs in it.
+ */
+void free_jobs(job *jobs, int count);
+
+#endif
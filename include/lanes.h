@@ -0,0 +1,21 @@
+#ifndef LANES_H
+#define LANES_H
+
+#include "structs.h"
+
+/* Number of layouts the lane backend analyzes together, one per SIMD lane. */
+#define LANE_COUNT 8
+
+/*
+ * Analyzes LANE_COUNT layouts in one walk over the stats. Each position
+ * ngram is unflattened once, then the keys of every layout are gathered from
+ * a lane major copy of their matrices and their frequencies summed side by
+ * side, so the inner loop over the lanes can be vectorized. Derived and meta
+ * stats and the scores are then calculated per layout.
+ *
+ * Parameters:
+ *   lts: The LANE_COUNT layouts to analyze and score.
+ */
+void lane_analyze(layout **lts);
+
+#endif
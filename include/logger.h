@@ -0,0 +1,40 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <wchar.h>
+
+/*
+ * Starts the output thread. Until this is called, and after log_stop(),
+ * messages are written directly to stdout.
+ */
+void log_start();
+
+/*
+ * Writes out every queued message, then stops and joins the output thread.
+ */
+void log_stop();
+
+/*
+ * Blocks until every message queued so far has been written and flushed.
+ * Does nothing if the output thread is not running.
+ */
+void log_flush();
+
+/*
+ * Queues a formatted message for the output thread. Safe to call from any
+ * thread without locking; the queue takes ownership of the heap allocated
+ * text and frees it once written.
+ *
+ * Parameters:
+ *   text: A heap allocated, null terminated wide string.
+ */
+void log_write(wchar_t *text);
+
+/*
+ * Rate limits progress updates to a fixed refresh rate. Returns 1 if enough
+ * time has passed since the last update that the caller should print one,
+ * 0 otherwise.
+ */
+int log_progress_due();
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef MODE_H
 #define MODE_H
 
+#include <stddef.h>
+
 /*
  * Performs analysis on a single layout. This involves allocating memory for the
  * layout, reading layout data from a file, analyzing the layout, calculating
@@ -23,21 +25,92 @@ void compare();
  */
 void rank();
 
+/*
+ * Scores every layout in the language directory against each corpus shard
+ * and ranks them by the selected objective, the mean shard score if none is
+ * selected. Prints the full corpus score, the mean, standard deviation, and
+ * worst score over the shards, and the mean minus lambda deviations.
+ */
+void robustness();
+
+/*
+ * Scores the primary layout on each document named after the options, or on
+ * standard input if there are none, by streaming the text once instead of
+ * building a corpus. Prints one line per document, and writes one record per
+ * document with every stat if a record format is selected.
+ */
+void stream();
+
+/*
+ * Shows how every layout in the language directory moves between the current
+ * corpus and the second corpus. Each layout is analyzed once on the current
+ * corpus, then moved to the second one through the sparse difference of the
+ * two corpora. Prints the layouts ordered by how far their rank moved.
+ */
+void delta();
+
+/*
+ * Queries the layout archive of the language. Prints the best stored layouts
+ * of each configuration, then re-scores every distinct archived layout under
+ * the current corpus and weights and prints the best of them.
+ */
+void archive();
+
+/*
+ * Samples random layouts to describe the score distribution of the current
+ * configuration. Every thread scores random shuffles of the primary layout's
+ * keys, leaving the pinned positions alone. Prints score percentiles, the mean
+ * and standard deviation of every stat, and where the primary and secondary
+ * layouts fall in the distribution.
+ */
+void distribution();
+
 /*
  * Initiates the layout generation process without a specific starting layout.
  * Calls improve with shuffle set to 1, effectively starting from a random
  * layout, with no pins. Will still use set of keys from selected layout.
+ *
+ * Returns: The full corpus score of the best layout the search found.
  */
-void generate();
+float generate();
 
 /*
  * Improves an existing layout using multiple threads.
- * Each thread runs a simulated annealing process to find a better layout.
+ * Each thread runs the selected search engine to find a better layout.
  *
  * Parameters:
  *   shuffle: A flag indicating whether to shuffle the layout before starting.
+ * Returns: The full corpus score of the best layout the search found.
+ */
+float improve(int shuffle);
+
+/*
+ * Analyzes the primary layout, prints it, then lists for each stat the
+ * archive_top ngrams of the corpus that contribute most to it.
+ */
+void explain();
+
+/*
+ * Scores every arrangement of the whole rows or columns of the primary layout
+ * selected by the subspace setting, leaving pins alone, and prints the best.
+ */
+void permute();
+
+/*
+ * Searches from the primary layout for the Pareto front of the objectives
+ * named by objective_list, then prints the front, writes it as a bundle of
+ * layout files, and archives it.
+ */
+void pareto();
+
+/*
+ * Runs every job of the job file 'jobs_name' in one process, so the corpus is
+ * read and the stats are built only once. Jobs sharing a weights file run
+ * together on one worker pool, and the weights are folded again between
+ * those groups. The pins, layout, and weights of config.conf are restored
+ * afterwards.
  */
-void improve(int shuffle);
+void jobs();
 
 /* Generates a new layout using OpenCL. */
 void cl_generate();
@@ -57,6 +130,13 @@ void cl_improve(int shuffle);
  */
 void gen_benchmark();
 
+/*
+ * Compares the best score every engine reaches on each cpu backend within
+ * time_budget seconds, over ANYTIME_SEEDS shuffles of the primary layout, on
+ * the synthetic corpus and the anytime weights.
+ */
+void anytime();
+
 /*
  * Performs a benchmark to determine the optimal number of threads for layout
  * generation on opencl. It runs the generation process with different numbers
@@ -64,6 +144,18 @@ void gen_benchmark();
  */
 void cl_gen_benchmark();
 
+/*
+ * Reads the content of a file into a dynamically allocated string.
+ *
+ * Parameters:
+ *   filename: The path to the file.
+ *   length: Pointer to size_t to store the length of the file content.
+ *
+ * Returns:
+ *   A pointer to the string containing the file content, or NULL on failure.
+ */
+char* read_source_file(const char* filename, size_t* length);
+
 /*
  * Prints a help message providing usage instructions for the program's command
  * line arguments.
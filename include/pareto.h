@@ -0,0 +1,70 @@
+#ifndef PARETO_H
+#define PARETO_H
+
+#include "structs.h"
+
+/* Most objectives a front can be built over. */
+#define OBJECTIVE_MAX 4
+/* Most layouts the front keeps, crowded ones are dropped past this. */
+#define FRONT_CAPACITY 128
+
+/*
+ * Parses objective_list into the objectives of the front. Each is a stat name,
+ * compared ignoring case, spaces, dashes, and underscores, or "score". A bare
+ * name maximizes the stat's weighted share of the score, a leading '+' or '-'
+ * maximizes or minimizes its raw value instead.
+ *
+ * Returns:
+ *   The number of objectives.
+ */
+int parse_objectives();
+
+/*
+ * Fills the objective values of an analyzed and scored layout, each oriented
+ * so that higher is better.
+ */
+void objective_values(layout *lt, float *values);
+
+/* Prints the objective values of a layout as they read in its stats. */
+void print_objectives(float *values);
+
+/*
+ * Runs the selected search engine on every thread from a layout, each thread
+ * chasing a random weighting of the objectives at a time, and keeps every
+ * layout no other one beats on all objectives in the shared front.
+ *
+ * Parameters:
+ *   lt: The analyzed and scored starting layout.
+ *   iterations: The layouts each thread scores.
+ *
+ * Returns:
+ *   The number of layouts scored.
+ */
+double pareto_search(layout *lt, int iterations);
+
+/*
+ * Copies the front out, ordered by the first objective, best first.
+ *
+ * Parameters:
+ *   out: Receives up to FRONT_CAPACITY allocated layouts.
+ *   values: Receives their objective values, OBJECTIVE_MAX per layout.
+ *
+ * Returns:
+ *   The number of layouts on the front.
+ */
+int collect_front(layout **out, float *values);
+
+/*
+ * Writes a front as a bundle of layout files, 00.glg onwards, in the
+ * <layout>-front directory of the language's layouts, replacing the layout
+ * files of an earlier bundle there.
+ *
+ * Returns:
+ *   The path of the bundle, to be freed.
+ */
+char *write_front(layout **front, int count);
+
+/* Frees the layouts held by the front. */
+void free_front();
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef PERMUTE_H
+#define PERMUTE_H
+
+#include "structs.h"
+
+/*
+ * Groups the whole rows and columns the selected subspace permutes, builds the
+ * incremental scoring index, and logs the size of the subspace.
+ *
+ * Returns:
+ *   The number of arrangements in the subspace, 1 if nothing can move.
+ */
+double setup_subspace();
+
+/*
+ * Enumerates every arrangement of the subspace around a layout on all threads
+ * and keeps each thread's best.
+ *
+ * Parameters:
+ *   lt: The analyzed starting layout.
+ *   best_layouts: Receives threads allocated layouts, each analyzed exactly.
+ *
+ * Returns:
+ *   The number of arrangements scored.
+ */
+double search_subspace(layout *lt, layout **best_layouts);
+
+/* Frees the groups and the incremental scoring index. */
+void free_subspace();
+
+#endif
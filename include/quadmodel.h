@@ -0,0 +1,38 @@
+#ifndef QUADMODEL_H
+#define QUADMODEL_H
+
+#include <stddef.h>
+
+/*
+ * Picks the most frequent quadgrams until they hold quad_mass percent of the
+ * quadgram mass and stores them in the hash table.
+ *
+ * Returns:
+ *   The share of the quadgram mass kept, in percent.
+ */
+float keep_top_quads();
+
+/* Returns the bytes held by the hash table of exactly kept quadgrams. */
+size_t quad_model_bytes();
+
+/*
+ * Builds the selected quadgram model from the normalized corpus, reports its
+ * error against the exact quadgram table, then frees both dense quadgram
+ * tables.
+ */
+void build_quad_model();
+
+/*
+ * Returns the frequency of a quadgram under the model in use, in percent of
+ * all quadgrams: the exact value when the quadgram is kept, the rescaled
+ * markov estimate otherwise.
+ *
+ * Parameters:
+ *   i, j, k, l: The indices of the characters in the language array.
+ */
+float quad_frequency(int i, int j, int k, int l);
+
+/* Frees the hash table of exactly kept quadgrams. */
+void free_quad_model();
+
+#endif
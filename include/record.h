@@ -0,0 +1,43 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "structs.h"
+
+/*
+ * Opens the record file selected by 'format_file' for the machine readable
+ * output chosen with 'format_mode'. Does nothing in the human readable
+ * format.
+ */
+void record_open();
+
+/*
+ * Appends one record for a layout to the record file: its name, score,
+ * matrix, and the value of every active stat. CSV and TSV files get a header
+ * row before the first record. Does nothing in the human readable format.
+ *
+ * Parameters:
+ *   lt: A pointer to the analyzed and scored layout.
+ */
+void record_layout(layout *lt);
+
+/*
+ * Appends the best score against time curve of one benchmark run to the
+ * record file: a JSON record with both series, or one CSV or TSV row per
+ * point under a header row. Does nothing if no record file is open.
+ *
+ * Parameters:
+ *   name: The configuration that ran.
+ *   seed: The seed of the run.
+ *   curve: The best score at each point.
+ *   points: The number of points.
+ *   step: The seconds between points, the first is one step in.
+ */
+void record_curve(const char *name, int seed, float *curve, int points, float step);
+
+/*
+ * Writes out any buffered records and closes the record file. Does nothing if
+ * no record file is open.
+ */
+void record_close();
+
+#endif
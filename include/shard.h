@@ -0,0 +1,63 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "structs.h"
+
+/* Largest number of shards a corpus can be split into. */
+#define SHARD_MAX 32
+
+/*
+ * Splits the corpus text into 'shard_count' byte ranges, cut at line ends,
+ * and normalizes each range into its own slice of the stacked shard tables.
+ * The global corpus count arrays are used as scratch space, so this must run
+ * after the full corpus has been normalized.
+ */
+void read_shards();
+
+/* Frees the stacked shard tables. */
+void free_shards();
+
+/*
+ * Scores a layout against every corpus shard in a single walk over the stats.
+ * Each ngram's index is calculated once and its frequency in every shard is
+ * gathered from the stacked tables. The layout's stats are left holding the
+ * values of the last shard.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout to analyze.
+ *   scores: Filled with the score of the layout on each of the shards.
+ */
+void shard_analyze(layout *lt, float *scores);
+
+/*
+ * Summarizes the scores of a layout on the corpus shards.
+ *
+ * Parameters:
+ *   scores: The score on each shard.
+ *   mean: Set to the mean score.
+ *   sd: Set to the standard deviation of the scores.
+ *   worst: Set to the lowest score.
+ */
+void shard_summary(float *scores, float *mean, float *sd, float *worst);
+
+/*
+ * Reduces the shard scores of a layout to the selected objective: the worst
+ * shard, the mean minus 'shard_lambda' standard deviations, or the mean.
+ *
+ * Parameters:
+ *   scores: The score on each shard.
+ * Returns: The value of the objective.
+ */
+float shard_objective_value(float *scores);
+
+/*
+ * Analyzes and scores a layout under the selected objective. Without one
+ * this is single_analyze() and get_score() on the full corpus, otherwise the
+ * layout's score is set to the objective over the corpus shards.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout to analyze.
+ */
+void objective_analyze(layout *lt);
+
+#endif
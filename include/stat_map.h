@@ -0,0 +1,35 @@
+#ifndef STAT_MAP_H
+#define STAT_MAP_H
+
+#include "structs.h"
+
+/* Stats walking each position ngram, stats[start[i]] to stats[start[i+1]]. */
+typedef struct stat_map {
+    int *start;
+    int *stats;
+} stat_map;
+
+/* One map per ngram length, skipgrams use bigram positions. */
+extern stat_map map_mono, map_bi, map_tri, map_quad, map_skip;
+
+/*
+ * Builds the stat maps of every ngram length from the walked stats. Derived
+ * stats are left out, they are summed from their children afterwards.
+ */
+void build_stat_maps();
+
+/* Frees the stat maps of every ngram length. */
+void free_stat_maps();
+
+/*
+ * Lists the key positions of every character of a layout. A character may
+ * sit on several keys, so the positions form a linked list per character.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   first: LANG_LENGTH entries, set to each character's first position or -1.
+ *   next: ROW * COL entries, set to the position after each one or -1.
+ */
+void map_positions(layout *lt, int *first, int *next);
+
+#endif
@@ -18,6 +18,14 @@ void initialize_stats();
  */
 void clean_stats();
 
+/*
+ * Replaces the weights of every statistic with those of the weights file
+ * 'weight_name' and cleans again. All weights and skip flags are first reset
+ * to their initial values, so stats the new file leaves out or weights to 0
+ * behave exactly as on a fresh start.
+ */
+void refold_weights();
+
 /*
  * Frees the memory allocated for all statistics data structures. This function
  * deallocates the memory used by the statistics arrays for each n-gram
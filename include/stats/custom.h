@@ -0,0 +1,15 @@
+#ifndef CUSTOM_H
+#define CUSTOM_H
+
+/*
+ * Reads the user defined stats file selected by 'custom_stats_name', compiles
+ * each definition into a small predicate program, and appends the resulting
+ * stats to the monogram, bigram, trigram, quadgram, and skipgram arrays. All
+ * definitions of one ngram type are classified together in a single pass over
+ * the tuple space. Does nothing if no stats file is selected.
+ *
+ * Returns: The number of stats added.
+ */
+int initialize_custom_stats();
+
+#endif
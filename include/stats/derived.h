@@ -0,0 +1,19 @@
+#ifndef DERIVED_H
+#define DERIVED_H
+
+/*
+ * Detects statistics whose ngram set is exactly the disjoint union of other
+ * statistics of the same type. Such parents are marked as derived and are
+ * computed as the sum of their children instead of walking their own ngrams.
+ * Children that were skipped are re-enabled as hidden so they are evaluated
+ * without being printed. Must run after the stats are trimmed and cleaned.
+ */
+void define_derived_stats();
+
+/*
+ * Returns the number of statistics currently marked as derived, summed
+ * across all ngram types.
+ */
+int count_derived_stats();
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef FIVE_H
+#define FIVE_H
+
+/*
+ * Initializes the array of five-gram statistics. The function allocates memory
+ * for the stat array and sets default values. Unlike other stats the weight
+ * defaults to 0, so weights files written before five-grams existed leave them
+ * off instead of failing.
+ */
+void initialize_five_stats();
+
+/*
+ * Cleans the five-gram statistics array by skipping statistics with zero
+ * weight. Their bitsets are never built.
+ */
+void clean_five_stats();
+
+/*
+ * Builds the bitset of every five-gram statistic left after cleaning. Each
+ * sequence is checked once against the stat's predicate, and a stat that
+ * matches no sequence at all is skipped like an empty ngram stat.
+ */
+void define_five_stats();
+
+/* Returns the number of five-gram statistics left after cleaning. */
+int count_five_stats();
+
+/* Frees the memory allocated for the five-gram statistics array. */
+void free_five_stats();
+
+#endif
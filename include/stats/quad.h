@@ -11,6 +11,7 @@ void initialize_quad_stats();
 /*
  * Trims the ngrams in the array to move unused entries to the end.
  * This process ensures memory efficiency by eliminating gaps in the array.
+ * Ngrams touching a position without a key are dropped first.
  */
 void trim_quad_stats();
 
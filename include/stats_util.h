@@ -17,15 +17,35 @@
  */
 int find_stat_index(char *stat_name, char type);
 
-/* 'l' for left hand, 'r' for right hand. */
+/* 'l' for left hand, 'r' for right hand, from the geometry file. */
 char hand(int row0, int col0);
 
-/* An integer representing the finger used (0-7). */
+/* An integer representing the finger used (0-7), from the geometry file. */
 int finger(int row0, int col0);
 
-/* pinky and index stretch */
+/* The logical row used by row based stats, from the geometry file. */
+int logical_row(int row0, int col0);
+
+/* pinky and index stretch, from the geometry file */
 int is_stretch(int row0, int col0);
 
+/* 1 if the geometry has a key at the position, 0 for a '-' position. */
+int has_key(int row0, int col0);
+
+/*
+ * Marks the ngrams of a stat that touch a position without a key as unused,
+ * so analysis never walks tuples no character can fill. Both hand and finger
+ * of such positions compare equal to each other, so the same hand and same
+ * finger checks would otherwise list them.
+ *
+ * Parameters:
+ *   ngrams: The ngrams of the stat, unused entries -1.
+ *   dim: The number of entries, DIM1 to DIM4.
+ *   order: The number of positions per ngram.
+ *   length: The length of the stat, decreased for every ngram dropped.
+ */
+void drop_keyless(int *ngrams, int dim, int order, int *length);
+
 int is_same_hand_bi(int row0, int col0, int row1, int col1);
 int is_same_hand_tri(int row0, int col0, int row1, int col1, int row2, int col2);
 int is_same_hand_quad(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3);
@@ -190,4 +210,13 @@ int is_same_row_adjacent_finger_chained_roll(int row0, int col0, int row1, int c
 int is_same_row_adjacent_finger_chained_roll_in(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3);
 int is_same_row_adjacent_finger_chained_roll_out(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3);
 int is_same_row_adjacent_finger_chained_roll_mix(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3);
+
+/* five-gram predicates, each built from the quadgram ones on both overlaps */
+int is_five_chained_redirect(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4);
+int is_five_bad_chained_redirect(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4);
+int is_five_roll(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4);
+int is_five_roll_in(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4);
+int is_five_roll_out(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4);
+int is_five_chained_alt(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4);
+int is_five_same_hand(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4);
 #endif
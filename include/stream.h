@@ -0,0 +1,22 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+
+#include "structs.h"
+
+/*
+ * Scores a layout on a text by streaming it once, without building ngram
+ * tables. Every window of characters is mapped to the keys it lands on, and
+ * the stats walking those keys are counted through the stat maps, which
+ * build_stat_maps() must have built.
+ *
+ * Parameters:
+ *   text: The open text to read to its end.
+ *   lt: The layout, its stats and score are set from the text.
+ *   first, next: The layout's key positions from map_positions().
+ * Returns: The number of characters read.
+ */
+long stream_document(FILE *text, layout *lt, int *first, int *next);
+
+#endif
@@ -1,9 +1,20 @@
 #ifndef STRUCTS_H
 #define STRUCTS_H
 
-/* Dimensions of the layout grid. */
-#define row 3
-#define col 12
+/*
+ * Dimensions of the layout grid. These are compile time constants so the
+ * analysis loops are specialized for the grid, the standard 3x12 board is the
+ * default. Other grids are built with e.g. make ROWS=4 COLS=12, and the key
+ * properties within the grid are read at runtime from a geometry file.
+ */
+#ifndef LAYOUT_ROWS
+#define LAYOUT_ROWS 3
+#endif
+#ifndef LAYOUT_COLS
+#define LAYOUT_COLS 12
+#endif
+#define row LAYOUT_ROWS
+#define col LAYOUT_COLS
 #define dim1 row * col
 #define dim2 dim1 * dim1
 #define dim3 dim2 * dim1
@@ -21,6 +32,7 @@ typedef struct layout {
     float *quad_score;
     float **skip_score;
     float *meta_score;
+    float *five_score;
     float score;
 } layout;
 
@@ -38,6 +50,12 @@ typedef struct mono_stat {
     int length;
     float weight;
     int skip;
+    /* 1 if the value is the sum of the disjoint stats in children */
+    int derived;
+    /* 1 if only evaluated to feed a derived stat, never printed */
+    int hidden;
+    int child_count;
+    int children[100];
 } mono_stat;
 
 typedef struct bi_stat {
@@ -46,6 +64,12 @@ typedef struct bi_stat {
     int length;
     float weight;
     int skip;
+    /* 1 if the value is the sum of the disjoint stats in children */
+    int derived;
+    /* 1 if only evaluated to feed a derived stat, never printed */
+    int hidden;
+    int child_count;
+    int children[100];
 } bi_stat;
 
 typedef struct tri_stat {
@@ -54,6 +78,12 @@ typedef struct tri_stat {
     int length;
     float weight;
     int skip;
+    /* 1 if the value is the sum of the disjoint stats in children */
+    int derived;
+    /* 1 if only evaluated to feed a derived stat, never printed */
+    int hidden;
+    int child_count;
+    int children[100];
 } tri_stat;
 
 typedef struct quad_stat {
@@ -62,6 +92,12 @@ typedef struct quad_stat {
     int length;
     float weight;
     int skip;
+    /* 1 if the value is the sum of the disjoint stats in children */
+    int derived;
+    /* 1 if only evaluated to feed a derived stat, never printed */
+    int hidden;
+    int child_count;
+    int children[100];
 } quad_stat;
 
 typedef struct skip_stat {
@@ -71,8 +107,27 @@ typedef struct skip_stat {
     /* multiple weights for skip-X-grams */
     float weight[10];
     int skip;
+    /* 1 if the value is the sum of the disjoint stats in children */
+    int derived;
+    /* 1 if only evaluated to feed a derived stat, never printed */
+    int hidden;
+    int child_count;
+    int children[100];
 } skip_stat;
 
+/*
+ * Five key sequences are too many to list like the other ngrams, so each
+ * five-gram stat marks the position sequences that fall under it in a bitset
+ * of dim1^5 bits, built only when the stat is used.
+ */
+typedef struct five_stat {
+    char name[61];
+    unsigned char *bits;
+    long length;
+    float weight;
+    int skip;
+} five_stat;
+
 /*
  * Structure to represent a meta statistic which is based on
  * more than one kind of ngram, calculated through other stats
@@ -4,9 +4,13 @@
 #include "global.h"
 #include "structs.h"
 
+/* Alignment of the tables OpenCL devices sharing host memory read in place. */
+#define HOST_ALIGN 4096
+
 /*
- * Error handling function: Shows the cursor, prints an error message to
- * standard error, and terminates the program.
+ * Error handling function: Writes out any queued log output, shows the
+ * cursor, prints an error message to standard error, and terminates the
+ * program.
  * Parameters:
  *   msg: The error message to be displayed.
  * Does not return (terminates program).
@@ -120,6 +124,28 @@ size_t index_quad(int i, int j, int k, int l);
  */
 size_t index_skip(int skip_index, int j, int k);
 
+/*
+ * Allocates zeroed memory aligned to HOST_ALIGN, rounded up to a whole number
+ * of HOST_ALIGN blocks. Freed with free().
+ * Parameters:
+ *   size: The size in bytes.
+ * Returns: The allocation, or NULL on failure.
+ */
+void *alloc_aligned(size_t size);
+
+/*
+ * Grows or shrinks an allocation from alloc_aligned(), keeping it aligned.
+ * Parameters:
+ *   ptr: The allocation to resize, freed on success.
+ *   old_size: Its current size in bytes.
+ *   new_size: The new size in bytes.
+ * Returns: The new allocation, or NULL on failure.
+ */
+void *realloc_aligned(void *ptr, size_t old_size, size_t new_size);
+
+/* Zeroes the global corpus count arrays. */
+void clear_corpus();
+
 /* Normalizes the corpus data from raw frequencies to percentages. */
 void normalize_corpus();
 
@@ -166,12 +192,30 @@ void create_node(layout *lt);
 void free_list();
 
 /*
- * Randomly shuffles the keys in a layout.
+ * Randomly shuffles the keys in a layout, leaving pinned positions in place.
  * Parameters:
  *   lt: Pointer to the layout to be shuffled.
  */
 void shuffle_layout(layout *lt);
 
+/*
+ * Collects the reserve characters of a layout: the characters of the
+ * language, other than space, that are not on any of its keys.
+ * Parameters:
+ *   lt: Pointer to the layout.
+ *   pool: Filled with the reserve characters, needs LANG_LENGTH entries.
+ * Returns: The number of reserve characters.
+ */
+int reserve_pool(layout *lt, int *pool);
+
+/*
+ * Sums the monogram frequency of the reserve characters of a layout.
+ * Parameters:
+ *   lt: Pointer to the layout.
+ * Returns: The percentage of corpus characters that are not on the layout.
+ */
+float off_layout_mass(layout *lt);
+
 /*
  * Copies the contents of one layout to another.
  * Parameters:
@@ -191,4 +235,23 @@ void skeleton_copy(layout *lt_dest, layout *lt_src);
 /* Returns a random float between 0 and 1. */
 float random_float();
 
+/*
+ * Signal handler for the optimization modes. SIGINT and SIGTERM request a
+ * stop, SIGUSR1 requests a dump of the current best layout. Only sets flags,
+ * the threads poll them and do the actual work.
+ * Parameters:
+ *   sig: The signal number.
+ */
+void signal_handler(int sig);
+
+/*
+ * Installs the handlers that let a long optimization be stopped early or
+ * asked for its current best layout. The stop handlers reset themselves, so
+ * a second SIGINT or SIGTERM terminates the program as usual.
+ */
+void catch_signals();
+
+/* Restores the default signal handling once an optimization is done. */
+void release_signals();
+
 #endif
@@ -9,10 +9,13 @@
 #include "structs.h"
 #include "util.h"
 #include "meta.h"
+#include "fivegram.h"
+#include "quadmodel.h"
 
 /*
  * Performs analysis on a single layout, calculating statistics for monograms,
- * bigrams, trigrams, quadgrams, and skipgrams. Then uses those values for meta
+ * bigrams, trigrams, quadgrams, skipgrams, and five-grams. Derived statistics are summed
+ * from their children rather than walked. Then uses those values for meta
  * statistics.
  *
  * Parameters:
@@ -25,7 +28,7 @@ void single_analyze(layout *lt)
     /* Calculate monogram statistics. */
     for (int i = 0; i < MONO_LENGTH; i++)
     {
-        if(!stats_mono[i].skip)
+        if(!stats_mono[i].skip && !stats_mono[i].derived)
         {
             lt->mono_score[i] = 0;
             int length = stats_mono[i].length;
@@ -46,7 +49,7 @@ void single_analyze(layout *lt)
     /* Calculate bigram statistics. */
     for (int i = 0; i < BI_LENGTH; i++)
     {
-        if(!stats_bi[i].skip)
+        if(!stats_bi[i].skip && !stats_bi[i].derived)
         {
             lt->bi_score[i] = 0;
             int length = stats_bi[i].length;
@@ -67,7 +70,7 @@ void single_analyze(layout *lt)
     /* Calculate trigram statistics. */
     for (int i = 0; i < TRI_LENGTH; i++)
     {
-        if(!stats_tri[i].skip)
+        if(!stats_tri[i].skip && !stats_tri[i].derived)
         {
             lt->tri_score[i] = 0;
             int length = stats_tri[i].length;
@@ -88,10 +91,23 @@ void single_analyze(layout *lt)
     /* Calculate quadgram statistics. */
     for (int i = 0; i < QUAD_LENGTH; i++)
     {
-        if(!stats_quad[i].skip)
+        if(!stats_quad[i].skip && !stats_quad[i].derived)
         {
             lt->quad_score[i] = 0;
             int length = stats_quad[i].length;
+            if (quad_model != 'e')
+            {
+                /* estimates the quadgrams when the dense table was freed */
+                for (int j = 0; j < length; j++)
+                {
+                    unflat_quad(stats_quad[i].ngrams[j], &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3); /* util.c */
+                    if (lt->matrix[row0][col0] != -1 && lt->matrix[row1][col1] != -1 && lt->matrix[row2][col2] != -1 && lt->matrix[row3][col3] != -1)
+                    {
+                        lt->quad_score[i] += quad_frequency(lt->matrix[row0][col0], lt->matrix[row1][col1], lt->matrix[row2][col2], lt->matrix[row3][col3]); /* quadmodel.c */
+                    }
+                }
+                continue;
+            }
             for (int j = 0; j < length; j++)
             {
                 /* unflattens a 1D index into a 8D matrix coordinate */
@@ -109,7 +125,7 @@ void single_analyze(layout *lt)
     /* Calculate skipgram statistics. */
     for (int i = 0; i < SKIP_LENGTH; i++)
     {
-        if(!stats_skip[i].skip)
+        if(!stats_skip[i].skip && !stats_skip[i].derived)
         {
             int length = stats_skip[i].length;
             for (int k = 1; k <= 9; k++)
@@ -130,7 +146,103 @@ void single_analyze(layout *lt)
         }
     }
 
+    /* Five-gram statistics walk the observed five-grams, if any are used. */
+    five_analyze(lt); /* fivegram.c */
+
+    /* Derived statistics are summed from what was just walked. */
+    derive_stats(lt);
+
     /* Perform meta-analysis, which may depend on previously calculated statistics. */
+    meta_analyze(lt);
+}
+
+/*
+ * Calculates the derived statistics of a layout, each the sum of its
+ * disjoint children, from its already calculated ngram statistics.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout, its walked statistics must be filled in.
+ */
+void derive_stats(layout *lt)
+{
+    /* Derived monogram statistics are the sum of their disjoint children. */
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if(stats_mono[i].derived)
+        {
+            lt->mono_score[i] = 0;
+            for (int j = 0; j < stats_mono[i].child_count; j++)
+            {
+                lt->mono_score[i] += lt->mono_score[stats_mono[i].children[j]];
+            }
+        }
+    }
+
+    /* Derived bigram statistics are the sum of their disjoint children. */
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        if(stats_bi[i].derived)
+        {
+            lt->bi_score[i] = 0;
+            for (int j = 0; j < stats_bi[i].child_count; j++)
+            {
+                lt->bi_score[i] += lt->bi_score[stats_bi[i].children[j]];
+            }
+        }
+    }
+
+    /* Derived trigram statistics are the sum of their disjoint children. */
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        if(stats_tri[i].derived)
+        {
+            lt->tri_score[i] = 0;
+            for (int j = 0; j < stats_tri[i].child_count; j++)
+            {
+                lt->tri_score[i] += lt->tri_score[stats_tri[i].children[j]];
+            }
+        }
+    }
+
+    /* Derived quadgram statistics are the sum of their disjoint children. */
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        if(stats_quad[i].derived)
+        {
+            lt->quad_score[i] = 0;
+            for (int j = 0; j < stats_quad[i].child_count; j++)
+            {
+                lt->quad_score[i] += lt->quad_score[stats_quad[i].children[j]];
+            }
+        }
+    }
+
+    /* Derived skipgram statistics are the sum of their disjoint children. */
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if(stats_skip[i].derived)
+        {
+            for (int k = 1; k <= 9; k++)
+            {
+                lt->skip_score[k][i] = 0;
+                for (int j = 0; j < stats_skip[i].child_count; j++)
+                {
+                    lt->skip_score[k][i] += lt->skip_score[k][stats_skip[i].children[j]];
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Calculates the meta statistics of a layout from its already calculated
+ * ngram statistics.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout, its ngram statistics must be filled in.
+ */
+void meta_analyze(layout *lt)
+{
     for (int i = 0; i < META_LENGTH; i++)
     {
         if (!stats_meta[i].skip)
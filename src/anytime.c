@@ -0,0 +1,464 @@
+/*
+ * anytime.c - Anytime quality benchmark for the GULAG.
+ *
+ * Layouts per second says little about which optimizer to use, what matters
+ * is how good a layout each one finds in a given amount of compute. Every
+ * configuration of engine and backend runs for the same time budget from the
+ * same shuffles, and the best score found so far is sampled at evenly spaced
+ * checkpoints of the budget. The resulting curves are summed up by their final
+ * best, the area under them, and the time they take to reach a common target.
+ *
+ * Scores only compare when the corpus and weights do, so the benchmark draws
+ * its corpus from a fixed seed Markov chain instead of reading one, and always
+ * uses the anytime weights file.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <wchar.h>
+
+#include "anytime.h"
+#include "analyze.h"
+#include "engine.h"
+#include "lanes.h"
+#include "blame.h"
+#include "record.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Seed of the synthetic corpus, changing it changes every benchmark score. */
+#define ANYTIME_CORPUS_SEED 0x47554c4147ULL
+/* Seconds spent measuring the moves per second of a configuration. */
+#define ANYTIME_CALIBRATION 0.25
+
+/* The state of one benchmark thread. */
+typedef struct anytime_data {
+    layout *start;
+    int thread_id;
+    unsigned int seed;
+    int steps;
+    float budget;
+    struct timespec begin;
+    float curve[ANYTIME_CHECKPOINTS];
+    double completed;
+} anytime_data;
+
+/* Returns the next value of a splitmix64 generator. */
+uint64_t synthetic_next(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Draws an entry from a table of cumulative weights.
+ *
+ * Returns:
+ *   The index of the entry.
+ */
+int synthetic_draw(uint64_t *state, uint64_t *cumulative, int count)
+{
+    uint64_t x = synthetic_next(state) % cumulative[count - 1];
+    int i = 0;
+    while (cumulative[i] <= x) {i++;}
+    return i;
+}
+
+/*
+ * Fills the corpus arrays from a synthetic text drawn by a fixed seed Markov
+ * chain over the language, so the benchmark scores the same corpus on every
+ * machine and commit.
+ */
+void synthetic_corpus()
+{
+    uint64_t state = ANYTIME_CORPUS_SEED;
+
+    /* the characters of the language, shuffled into the rank of a Zipf law */
+    int chars[LANG_LENGTH];
+    int count = 0;
+    for (int i = 1; i < LANG_LENGTH; i++) {
+        if (lang_arr[2 * i] != L'@') {chars[count++] = i;}
+    }
+    if (count == 0) {error("The language has no characters for the synthetic corpus.");}
+    for (int i = count - 1; i > 0; i--)
+    {
+        int j = synthetic_next(&state) % (i + 1);
+        int temp = chars[i];
+        chars[i] = chars[j];
+        chars[j] = temp;
+    }
+
+    /* integer weights only, so every platform draws the same text */
+    uint64_t *first = (uint64_t *)malloc(sizeof(uint64_t) * count);
+    uint64_t *next = (uint64_t *)malloc(sizeof(uint64_t) * count * count);
+    if (first == NULL || next == NULL) {error("Failed to allocate memory for the synthetic corpus.");}
+    uint64_t sum = 0;
+    for (int b = 0; b < count; b++)
+    {
+        sum += 720720 / (b + 1);
+        first[b] = sum;
+    }
+    /* every character strongly prefers about a quarter of the others */
+    for (int a = 0; a < count; a++)
+    {
+        sum = 0;
+        for (int b = 0; b < count; b++)
+        {
+            int affinity = synthetic_next(&state) % 4 == 0 && a != b ? 16 : 1;
+            sum += (uint64_t)(720720 / (b + 1)) * affinity;
+            next[a * count + b] = sum;
+        }
+    }
+
+    /* spaces are index 0, they end words and are not counted themselves */
+    int mem[] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+    int previous = -1;
+    for (int i = 0; i < ANYTIME_CORPUS_LENGTH; i++)
+    {
+        if (previous >= 0 && synthetic_next(&state) % 5 == 0)
+        {
+            mem[0] = 0;
+            previous = -1;
+        }
+        else
+        {
+            previous = previous < 0 ? synthetic_draw(&state, first, count)
+                : synthetic_draw(&state, &next[previous * count], count);
+            mem[0] = chars[previous];
+        }
+        count_ngrams(mem); /* io.c */
+        iterate(mem, 11); /* io_util.c */
+    }
+    log_print('v',L"%d characters over %d letters... ", ANYTIME_CORPUS_LENGTH, count);
+
+    free(first);
+    free(next);
+}
+
+/*
+ * Runs the chains of one thread until the budget or their schedule runs out,
+ * noting the best score at every checkpoint passed.
+ */
+void *anytime_thread(void *arg)
+{
+    anytime_data *data = (anytime_data *)arg;
+    int lanes = backend_mode == 'v' ? LANE_COUNT : 1;
+
+    layout *current[LANE_COUNT], *working[LANE_COUNT];
+    for (int l = 0; l < lanes; l++) {
+        alloc_layout(&current[l]); /* util.c */
+        alloc_layout(&working[l]); /* util.c */
+        copy(current[l], data->start); /* util.c */
+        copy(working[l], data->start); /* util.c */
+    }
+    float best = data->start->score;
+
+    engine *search = find_engine(search_engine); /* engine.c */
+    engine_state states[LANE_COUNT];
+    for (int l = 0; l < lanes; l++) {
+        /* the benchmark prints its own summary, keep the engines quiet */
+        states[l].thread_id = 1;
+        search->init(&states[l], data->steps, current[l]->score);
+    }
+
+    /* guided swaps draw their endpoints from each chain's blame */
+    float blame[DIM1], blame_cumulative[LANE_COUNT][DIM1], blame_total[LANE_COUNT];
+    for (int l = 0; l < lanes; l++) {blame_total[l] = 0;}
+
+    int checkpoint = 0;
+    data->completed = 0;
+    for (int i = 0; i < data->steps; i++)
+    {
+        if (atomic_load_explicit(&stop_requested, memory_order_relaxed)) {break;}
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed = (now.tv_sec - data->begin.tv_sec) + (now.tv_nsec - data->begin.tv_nsec) / 1e9;
+        while (checkpoint < ANYTIME_CHECKPOINTS
+            && elapsed >= data->budget * (checkpoint + 1) / ANYTIME_CHECKPOINTS)
+        {
+            data->curve[checkpoint++] = best;
+        }
+        if (checkpoint == ANYTIME_CHECKPOINTS) {break;}
+        if (guide_rate > 0 && i % BLAME_REFRESH == 0)
+        {
+            for (int l = 0; l < lanes; l++)
+            {
+                layout_blame(working[l], blame); /* blame.c */
+                blame_total[l] = blame_table(blame, pins, blame_cumulative[l]); /* blame.c */
+            }
+        }
+
+        /* swapped positions of each chain, as flat indices */
+        int swaps1[LANE_COUNT][MAX_SWAPS];
+        int swaps2[LANE_COUNT][MAX_SWAPS];
+        for (int l = 0; l < lanes; l++)
+        {
+            int (*matrix)[COL] = working[l]->matrix;
+            for (int j = 0; j < states[l].swaps; j++)
+            {
+                int p1, p2, tries = 0;
+                do {
+                    if (guide_rate > 0)
+                    {
+                        /* after a few rejected picks fall back to uniform ones */
+                        float total = tries++ < 8 ? blame_total[l] : 0;
+                        int r1, c1, r2, c2;
+                        guided_position(&r1, &c1, blame_cumulative[l], total, &data->seed); /* blame.c */
+                        guided_position(&r2, &c2, blame_cumulative[l], total, &data->seed); /* blame.c */
+                        p1 = r1 * COL + c1;
+                        p2 = r2 * COL + c2;
+                    }
+                    else
+                    {
+                        p1 = rand_r(&data->seed) % DIM1;
+                        p2 = rand_r(&data->seed) % DIM1;
+                    }
+                } while (pins[p1 / COL][p1 % COL] || pins[p2 / COL][p2 % COL] || p1 == p2);
+                swaps1[l][j] = p1;
+                swaps2[l][j] = p2;
+
+                int temp = matrix[p1 / COL][p1 % COL];
+                matrix[p1 / COL][p1 % COL] = matrix[p2 / COL][p2 % COL];
+                matrix[p2 / COL][p2 % COL] = temp;
+            }
+        }
+
+        if (lanes > 1) {
+            lane_analyze(working); /* lanes.c */
+        } else {
+            single_analyze(working[0]); /* analyze.c */
+            get_score(working[0]); /* util.c */
+        }
+        data->completed += lanes;
+
+        for (int l = 0; l < lanes; l++)
+        {
+            if (working[l]->score > best) {best = working[l]->score;}
+            if (search->accept(&states[l], working[l]->score, current[l]->score))
+            {
+                copy(current[l], working[l]); /* util.c */
+            }
+            else
+            {
+                int (*matrix)[COL] = working[l]->matrix;
+                for (int j = states[l].swaps - 1; j >= 0; j--)
+                {
+                    int p1 = swaps1[l][j], p2 = swaps2[l][j];
+                    int temp = matrix[p1 / COL][p1 % COL];
+                    matrix[p1 / COL][p1 % COL] = matrix[p2 / COL][p2 % COL];
+                    matrix[p2 / COL][p2 % COL] = temp;
+                }
+            }
+            search->step(&states[l], i);
+        }
+    }
+    /* a schedule that ends early keeps its best for the rest of the budget */
+    while (checkpoint < ANYTIME_CHECKPOINTS) {data->curve[checkpoint++] = best;}
+
+    for (int l = 0; l < lanes; l++) {
+        free_layout(current[l]); /* util.c */
+        free_layout(working[l]); /* util.c */
+    }
+    return NULL;
+}
+
+/*
+ * Starts every thread from a layout and merges their curves.
+ *
+ * Parameters:
+ *   lt: The analyzed and scored starting layout.
+ *   budget: The seconds to run for.
+ *   steps: The length of each chain's schedule.
+ *   seed: Seeds the random moves of the threads.
+ *   curve: Receives the best score at each checkpoint.
+ *
+ * Returns:
+ *   The number of layouts scored.
+ */
+double anytime_threads(layout *lt, float budget, int steps, unsigned int seed, float *curve)
+{
+    anytime_data *data = (anytime_data *)malloc(sizeof(anytime_data) * threads);
+    pthread_t *thread_ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    if (data == NULL || thread_ids == NULL) {error("Failed to allocate memory for benchmark threads.");}
+
+    /* the clock starts once for every thread, their start up counts */
+    struct timespec begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int i = 0; i < threads; i++)
+    {
+        data[i].start = lt;
+        data[i].thread_id = i;
+        data[i].seed = seed * 7919 + i;
+        data[i].steps = steps;
+        data[i].budget = budget;
+        data[i].begin = begin;
+        pthread_create(&thread_ids[i], NULL, anytime_thread, (void *)&data[i]);
+    }
+
+    double completed = 0;
+    for (int k = 0; k < ANYTIME_CHECKPOINTS; k++) {curve[k] = -INFINITY;}
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(thread_ids[i], NULL);
+        completed += data[i].completed;
+        for (int k = 0; k < ANYTIME_CHECKPOINTS; k++) {
+            if (data[i].curve[k] > curve[k]) {curve[k] = data[i].curve[k];}
+        }
+    }
+    free(data);
+    free(thread_ids);
+    return completed;
+}
+
+/*
+ * Measures how many moves a single chain of the selected backend makes per
+ * second, used to size the engine schedules to the time budget.
+ *
+ * Parameters:
+ *   lt: The analyzed and scored starting layout.
+ *
+ * Returns:
+ *   The moves per second of one chain.
+ */
+double anytime_rate(layout *lt)
+{
+    /* run with every thread, so contention is part of the measurement */
+    float curve[ANYTIME_CHECKPOINTS];
+    double completed = anytime_threads(lt, ANYTIME_CALIBRATION, 1 << 30, 0, curve);
+    int lanes = backend_mode == 'v' ? LANE_COUNT : 1;
+    return completed / lanes / threads / ANYTIME_CALIBRATION;
+}
+
+/*
+ * Runs the selected engine and backend on every thread from a layout for
+ * time_budget seconds and samples the best score found so far.
+ *
+ * Parameters:
+ *   lt: The analyzed and scored starting layout.
+ *   rate: The moves per second of one chain, from anytime_rate().
+ *   seed: Seeds the random moves of the threads.
+ *   curve: Receives the best score at each of the ANYTIME_CHECKPOINTS evenly
+ *          spaced points of the budget.
+ *
+ * Returns:
+ *   The number of layouts scored.
+ */
+double anytime_run(layout *lt, double rate, unsigned int seed, float *curve)
+{
+    /* the schedule is sized to end with the budget */
+    double steps = rate * time_budget;
+    if (steps < 1) {steps = 1;}
+    if (steps > 1 << 30) {steps = 1 << 30;}
+    return anytime_threads(lt, time_budget, (int)steps, seed, curve);
+}
+
+/* Returns the median of a few values, sorting them in place. */
+float median_of(float *values, int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        float value = values[i];
+        int j = i;
+        while (j > 0 && values[j - 1] > value) {values[j] = values[j - 1]; j--;}
+        values[j] = value;
+    }
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+/*
+ * Prints the median curve, final best, area under the curve, and time to
+ * target of every configuration. The target is the median final best over
+ * every run of every configuration.
+ *
+ * Parameters:
+ *   names: The name of each configuration.
+ *   count: The number of configurations.
+ *   curves: ANYTIME_SEEDS curves per configuration, in order.
+ *   rates: The layouts per second of each configuration.
+ */
+void report_anytime(char **names, int count, float *curves, double *rates)
+{
+    int runs = count * ANYTIME_SEEDS;
+    float *values = (float *)malloc(sizeof(float) * runs);
+    if (values == NULL) {error("Failed to allocate memory for the benchmark report.");}
+    for (int r = 0; r < runs; r++) {values[r] = curves[r * ANYTIME_CHECKPOINTS + ANYTIME_CHECKPOINTS - 1];}
+    float target = median_of(values, runs);
+    float step = time_budget / ANYTIME_CHECKPOINTS;
+
+    log_print('q',L"Target %f, the median final best of %d runs, %g seconds each\n\n",
+        target, runs, time_budget);
+    log_print('q',L"%-22s %10s %10s %10s %7s %11s\n", "Configuration", "Final Best",
+        "AUC", "To Target", "Reached", "Layouts/Sec");
+    for (int c = 0; c < count; c++)
+    {
+        float finals[ANYTIME_SEEDS], areas[ANYTIME_SEEDS], times[ANYTIME_SEEDS];
+        int reached = 0;
+        for (int s = 0; s < ANYTIME_SEEDS; s++)
+        {
+            float *curve = &curves[(c * ANYTIME_SEEDS + s) * ANYTIME_CHECKPOINTS];
+            finals[s] = curve[ANYTIME_CHECKPOINTS - 1];
+            /* the area under the curve over the budget, a time weighted mean */
+            double area = 0;
+            for (int k = 0; k < ANYTIME_CHECKPOINTS; k++) {area += curve[k];}
+            areas[s] = area / ANYTIME_CHECKPOINTS;
+            /* never reaching it counts as the longest time */
+            times[s] = FLT_MAX;
+            for (int k = 0; k < ANYTIME_CHECKPOINTS; k++)
+            {
+                if (curve[k] >= target) {times[s] = (k + 1) * step; reached++; break;}
+            }
+        }
+        float to_target = median_of(times, ANYTIME_SEEDS);
+        wchar_t target_text[16];
+        if (reached * 2 <= ANYTIME_SEEDS) {swprintf(target_text, 16, L"-");}
+        else {swprintf(target_text, 16, L"%.2fs", to_target);}
+        log_print('q',L"%-22s %10.4f %10.4f %10ls %3d/%-3d %11.0f\n", names[c],
+            median_of(finals, ANYTIME_SEEDS), median_of(areas, ANYTIME_SEEDS),
+            target_text, reached, ANYTIME_SEEDS, rates[c]);
+    }
+    log_print('q',L"\nAll columns are medians over %d seeds, AUC is the area under the best\n"
+        "score curve divided by the budget.\n\n", ANYTIME_SEEDS);
+
+    /* the median curves at a few shares of the budget */
+    int shares[] = {1, 5, 10, 25, 50, 100};
+    int share_count = sizeof(shares) / sizeof(shares[0]);
+    log_print('q',L"Median best score by share of the budget:\n\n%-22s", "Configuration");
+    for (int i = 0; i < share_count; i++) {log_print('q',L" %8d%%", shares[i]);}
+    log_print('q',L"\n");
+    for (int c = 0; c < count; c++)
+    {
+        log_print('q',L"%-22s", names[c]);
+        for (int i = 0; i < share_count; i++)
+        {
+            int k = shares[i] * ANYTIME_CHECKPOINTS / 100 - 1;
+            float points[ANYTIME_SEEDS];
+            for (int s = 0; s < ANYTIME_SEEDS; s++) {
+                points[s] = curves[(c * ANYTIME_SEEDS + s) * ANYTIME_CHECKPOINTS + k];
+            }
+            log_print('q',L" %9.4f", median_of(points, ANYTIME_SEEDS));
+        }
+        log_print('q',L"\n");
+    }
+    log_print('q',L"\n");
+
+    /* every curve in full goes to the record file */
+    for (int c = 0; c < count; c++)
+    {
+        for (int s = 0; s < ANYTIME_SEEDS; s++) {
+            record_curve(names[c], s + 1, &curves[(c * ANYTIME_SEEDS + s) * ANYTIME_CHECKPOINTS],
+                ANYTIME_CHECKPOINTS, step); /* record.c */
+        }
+    }
+    free(values);
+}
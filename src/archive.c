@@ -0,0 +1,314 @@
+/*
+ * archive.c - Persistent archive of generated layouts for the GULAG.
+ *
+ * Every generate or improve run appends the final layout of each of its
+ * threads to an append-only archive kept per language, so the territory
+ * searched by many runs with different seeds is not lost. Each line holds a
+ * hash of the layout, a hash of the configuration it was scored under, a
+ * timestamp, the score, and the layout itself written like a layout file.
+ * Entries are deduplicated on the (layout, configuration) pair when written.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <time.h>
+#include <sys/file.h>
+
+#include "archive.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* Folds a block of bytes into an FNV-1a hash. */
+unsigned long long fnv_bytes(unsigned long long hash, const void *bytes, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)bytes;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/* Folds a null terminated string, including the terminator, into a hash. */
+unsigned long long fnv_string(unsigned long long hash, const char *s)
+{
+    return fnv_bytes(hash, s, strlen(s) + 1);
+}
+
+/*
+ * Hashes the keys of a layout. The hash is taken over the characters rather
+ * than their language indices so it stays valid if the language file changes.
+ *
+ * Parameters:
+ *   matrix: The layout matrix.
+ * Returns: A 64 bit FNV-1a hash of the layout.
+ */
+unsigned long long hash_layout(int matrix[row][col])
+{
+    unsigned long long hash = FNV_OFFSET;
+    for (int i = 0; i < ROW; i++)
+    {
+        for (int j = 0; j < COL; j++)
+        {
+            unsigned int c = (unsigned int)convert_back(matrix[i][j]); /* io_util.c */
+            hash = fnv_bytes(hash, &c, sizeof(c));
+        }
+    }
+    return hash;
+}
+
+/*
+ * Hashes everything that decides a layout's score: the corpus, the geometry,
+ * and the name and weight of every stat. Layouts archived under the same hash
+ * have directly comparable scores.
+ *
+ * Returns: A 64 bit FNV-1a hash of the current configuration.
+ */
+unsigned long long hash_config()
+{
+    unsigned long long hash = FNV_OFFSET;
+    hash = fnv_string(hash, corpus_name);
+    hash = fnv_string(hash, geometry_name);
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        hash = fnv_string(hash, stats_mono[i].name);
+        hash = fnv_bytes(hash, &stats_mono[i].weight, sizeof(float));
+    }
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        hash = fnv_string(hash, stats_bi[i].name);
+        hash = fnv_bytes(hash, &stats_bi[i].weight, sizeof(float));
+    }
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        hash = fnv_string(hash, stats_tri[i].name);
+        hash = fnv_bytes(hash, &stats_tri[i].weight, sizeof(float));
+    }
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        hash = fnv_string(hash, stats_quad[i].name);
+        hash = fnv_bytes(hash, &stats_quad[i].weight, sizeof(float));
+    }
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        hash = fnv_string(hash, stats_skip[i].name);
+        hash = fnv_bytes(hash, stats_skip[i].weight, sizeof(float) * 10);
+    }
+    for (int i = 0; i < META_LENGTH; i++)
+    {
+        hash = fnv_string(hash, stats_meta[i].name);
+        hash = fnv_bytes(hash, &stats_meta[i].weight, sizeof(float));
+    }
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        hash = fnv_string(hash, stats_five[i].name);
+        hash = fnv_bytes(hash, &stats_five[i].weight, sizeof(float));
+    }
+    /* approximated quadgrams score differently, exact keeps older hashes */
+    if (quad_model != 'e')
+    {
+        hash = fnv_bytes(hash, &quad_model, sizeof(char));
+        hash = fnv_bytes(hash, &quad_mass, sizeof(float));
+    }
+    return hash;
+}
+
+/* Returns the path of the current language's archive, to be freed. */
+char *archive_path()
+{
+    char *path = (char *)malloc(strlen("./data//archive.arc") + strlen(lang_name) + 1);
+    if (path == NULL) {error("Failed to allocate memory for archive path.");}
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/archive.arc");
+    return path;
+}
+
+/*
+ * Reads every entry of an open archive from its current position to its end.
+ *
+ * Parameters:
+ *   archive: The archive file, left open.
+ *   entries: Set to a newly allocated array of entries, to be freed by the
+ *            caller. NULL if the archive is empty.
+ * Returns: The number of entries read.
+ */
+int read_entries(FILE *archive, archive_entry **entries)
+{
+    *entries = NULL;
+    int count = 0, capacity = 0;
+    archive_entry entry;
+    while (fwscanf(archive, L" %llx %llx %lld %f %60s %60s", &entry.layout_hash,
+        &entry.config_hash, &entry.timestamp, &entry.score, entry.corpus,
+        entry.weights) == 6)
+    {
+        wchar_t curr;
+        for (int i = 0; i < ROW; i++)
+        {
+            for (int j = 0; j < COL; j++)
+            {
+                if (fwscanf(archive, L" %lc", &curr) != 1) {error("Archive entry is truncated.");}
+                entry.matrix[i][j] = convert_char(curr); /* io_util.c */
+            }
+        }
+
+        if (count == capacity)
+        {
+            capacity = capacity == 0 ? 256 : capacity * 2;
+            *entries = (archive_entry *)realloc(*entries, sizeof(archive_entry) * capacity);
+            if (*entries == NULL) {error("Failed to allocate memory for archive entries.");}
+        }
+        (*entries)[count++] = entry;
+    }
+    if (!feof(archive)) {error("Malformed line in archive file.");}
+    return count;
+}
+
+/*
+ * Reads every entry of the current language's archive, under a shared lock so
+ * a run archiving at the same time is never seen half written.
+ *
+ * Parameters:
+ *   entries: Set to a newly allocated array of entries, to be freed by the
+ *            caller. NULL if the archive is empty or does not exist.
+ * Returns: The number of entries read.
+ */
+int read_archive(archive_entry **entries)
+{
+    *entries = NULL;
+    char *path = archive_path();
+    FILE *archive = fopen(path, "r");
+    free(path);
+    if (archive == NULL) {return 0;}
+    if (flock(fileno(archive), LOCK_SH) != 0) {error("Failed to lock archive file.");}
+
+    int count = read_entries(archive, entries);
+    fclose(archive); /* releases the lock */
+    return count;
+}
+
+/*
+ * Appends layouts to the current language's archive under the current
+ * configuration. Layouts already archived under the same configuration, and
+ * duplicates within the batch, are skipped. The archive stays locked from the
+ * read of the stored entries to the end of the append, so concurrent runs
+ * neither interleave their lines nor add the same layout twice.
+ *
+ * Parameters:
+ *   lts: The scored layouts to archive.
+ *   count: The number of layouts.
+ * Returns: The number of layouts added.
+ */
+int archive_layouts(layout **lts, int count)
+{
+    unsigned long long config = hash_config();
+
+    char *path = archive_path();
+    FILE *archive = fopen(path, "a+");
+    free(path);
+    if (archive == NULL) {error("Failed to open archive file.");}
+    if (flock(fileno(archive), LOCK_EX) != 0) {error("Failed to lock archive file.");}
+
+    /* collect what is already stored under this configuration */
+    archive_entry *entries;
+    rewind(archive);
+    int stored = read_entries(archive, &entries);
+    int known_count = 0;
+    unsigned long long *known = (unsigned long long *)malloc(sizeof(unsigned long long) * (stored + count));
+    if (known == NULL) {error("Failed to allocate memory for archive hashes.");}
+    for (int i = 0; i < stored; i++)
+    {
+        if (entries[i].config_hash == config) {known[known_count++] = entries[i].layout_hash;}
+    }
+    free(entries);
+    /* switching from reading to writing needs a seek */
+    fseek(archive, 0, SEEK_END);
+
+    long long now = (long long)time(NULL);
+    int added = 0;
+    for (int n = 0; n < count; n++)
+    {
+        unsigned long long hash = hash_layout(lts[n]->matrix);
+        int seen = 0;
+        for (int i = 0; i < known_count && !seen; i++) {seen = known[i] == hash;}
+        if (seen) {continue;}
+        known[known_count++] = hash;
+
+        fwprintf(archive, L"%016llx %016llx %lld %f %s %s", hash, config, now,
+            lts[n]->score, corpus_name, weight_name);
+        for (int i = 0; i < ROW; i++)
+        {
+            for (int j = 0; j < COL; j++)
+            {
+                fwprintf(archive, L" %lc", convert_back(lts[n]->matrix[i][j])); /* io_util.c */
+            }
+        }
+        fwprintf(archive, L"\n");
+        added++;
+    }
+
+    fclose(archive); /* flushes, then releases the lock */
+    free(known);
+    return added;
+}
+
+/*
+ * qsort comparator ordering archive entries by configuration, and by
+ * descending score within a configuration.
+ */
+int compare_archive_config(const void *a, const void *b)
+{
+    const archive_entry *x = (const archive_entry *)a;
+    const archive_entry *y = (const archive_entry *)b;
+    if (x->config_hash != y->config_hash) {return x->config_hash < y->config_hash ? -1 : 1;}
+    if (x->score != y->score) {return x->score > y->score ? -1 : 1;}
+    return 0;
+}
+
+/* qsort comparator ordering archive entries by layout hash. */
+int compare_archive_layout(const void *a, const void *b)
+{
+    const archive_entry *x = (const archive_entry *)a;
+    const archive_entry *y = (const archive_entry *)b;
+    if (x->layout_hash != y->layout_hash) {return x->layout_hash < y->layout_hash ? -1 : 1;}
+    return 0;
+}
+
+/* qsort comparator ordering archive entries by descending score. */
+int compare_archive_score(const void *a, const void *b)
+{
+    const archive_entry *x = (const archive_entry *)a;
+    const archive_entry *y = (const archive_entry *)b;
+    if (x->score != y->score) {return x->score > y->score ? -1 : 1;}
+    return 0;
+}
+
+/*
+ * Prints one archive entry on a single line: its score, hash, and keys row
+ * by row.
+ *
+ * Parameters:
+ *   rank: The position to print in front of the entry.
+ *   entry: The entry to print.
+ */
+void print_archive_entry(int rank, archive_entry *entry)
+{
+    log_print('q', L"%4d. %11f  %016llx  ", rank, entry->score, entry->layout_hash);
+    for (int i = 0; i < ROW; i++)
+    {
+        for (int j = 0; j < COL; j++)
+        {
+            log_print('q', L"%lc", convert_back(entry->matrix[i][j])); /* io_util.c */
+        }
+        log_print('q', i == ROW - 1 ? L"\n" : L" ");
+    }
+}
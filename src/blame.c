@@ -0,0 +1,251 @@
+/*
+ * blame.c - Cost guided swap proposals for the GULAG.
+ *
+ * Uniformly random swaps spend most of their evaluations moving keys that are
+ * already well placed. Every ngram tuple of a stat adds its weighted share of
+ * the score to the positions it touches, so the positions where the penalties
+ * gather are the keys worth moving. The optimizer threads keep a table of that
+ * blame, refreshed every BLAME_REFRESH moves at the cost of about one analysis,
+ * and draw part of their swap endpoints from it.
+ */
+
+#include <stdlib.h>
+
+#include "blame.h"
+#include "explain.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/*
+ * Adds a weight to a stat and, if it is derived, to every stat it is summed
+ * from, since their tuples are the ones that count towards it.
+ *
+ * Parameters:
+ *   type: The ngram type, 'm', 'b', 't', 'q', or 's'.
+ *   i: The index of the stat.
+ *   weight: The weight to add.
+ *   weights: The effective weights of the type.
+ */
+void spread_weight(char type, int i, float weight, float *weights)
+{
+    weights[i] += weight;
+    int derived, child_count, *children;
+    switch (type)
+    {
+    case 'm':
+        derived = stats_mono[i].derived;
+        child_count = stats_mono[i].child_count;
+        children = stats_mono[i].children;
+        break;
+    case 'b':
+        derived = stats_bi[i].derived;
+        child_count = stats_bi[i].child_count;
+        children = stats_bi[i].children;
+        break;
+    case 't':
+        derived = stats_tri[i].derived;
+        child_count = stats_tri[i].child_count;
+        children = stats_tri[i].children;
+        break;
+    case 'q':
+        derived = stats_quad[i].derived;
+        child_count = stats_quad[i].child_count;
+        children = stats_quad[i].children;
+        break;
+    default:
+        derived = stats_skip[i].derived;
+        child_count = stats_skip[i].child_count;
+        children = stats_skip[i].children;
+        break;
+    }
+    if (!derived) {return;}
+    for (int c = 0; c < child_count; c++) {spread_weight(type, children[c], weight, weights);}
+}
+
+/*
+ * Adds the weighted frequency of every tuple of a walked stat to the
+ * positions it touches.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   ngrams, length: The position tuples of the stat.
+ *   order: The number of positions per tuple.
+ *   weight: The effective weight of the stat, or of each skip distance.
+ *   skipgram: 1 if the stat is a skipgram stat.
+ *   blame: The blame of every position, updated.
+ */
+void blame_stat(layout *lt, int *ngrams, int length, int order, float *weight,
+    int skipgram, float *blame)
+{
+    int chars[4];
+    for (int j = 0; j < length; j++)
+    {
+        if (!place_ngram(lt, ngrams[j], order, chars)) {continue;} /* explain.c */
+        float cost = 0;
+        if (skipgram)
+        {
+            for (int k = 1; k <= 9; k++) {
+                cost -= weight[k] * linear_skip[index_skip(k, chars[0], chars[1])];
+            }
+        }
+        else
+        {
+            cost = -weight[0] * ngram_frequency(chars, order, 0); /* explain.c */
+        }
+        if (cost == 0) {continue;}
+
+        int r[4], c[4];
+        switch (order)
+        {
+        case 1:
+            unflat_mono(ngrams[j], &r[0], &c[0]); /* util.c */
+            break;
+        case 2:
+            unflat_bi(ngrams[j], &r[0], &c[0], &r[1], &c[1]); /* util.c */
+            break;
+        case 3:
+            unflat_tri(ngrams[j], &r[0], &c[0], &r[1], &c[1], &r[2], &c[2]); /* util.c */
+            break;
+        default:
+            unflat_quad(ngrams[j], &r[0], &c[0], &r[1], &c[1], &r[2], &c[2], &r[3], &c[3]); /* util.c */
+            break;
+        }
+        for (int k = 0; k < order; k++) {blame[r[k] * COL + c[k]] += cost;}
+    }
+}
+
+/*
+ * Fills the blame of every key position of a layout: the weighted penalty of
+ * the ngram tuples touching it, less their weighted reward, and never below
+ * zero. Derived stats pass their weight on to the stats they are summed from,
+ * meta and five-gram stats are not sums over tuples and are left out.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   blame: Receives DIM1 values, one per flattened position.
+ */
+void layout_blame(layout *lt, float *blame)
+{
+    for (int p = 0; p < DIM1; p++) {blame[p] = 0;}
+
+    /* the weights every walked stat carries, its own and its parents' */
+    float mono_weights[MONO_LENGTH], bi_weights[BI_LENGTH];
+    float tri_weights[TRI_LENGTH], quad_weights[QUAD_LENGTH];
+    float skip_weights[10][SKIP_LENGTH];
+    for (int i = 0; i < MONO_LENGTH; i++) {mono_weights[i] = 0;}
+    for (int i = 0; i < BI_LENGTH; i++) {bi_weights[i] = 0;}
+    for (int i = 0; i < TRI_LENGTH; i++) {tri_weights[i] = 0;}
+    for (int i = 0; i < QUAD_LENGTH; i++) {quad_weights[i] = 0;}
+    for (int k = 0; k < 10; k++) {
+        for (int i = 0; i < SKIP_LENGTH; i++) {skip_weights[k][i] = 0;}
+    }
+    for (int i = 0; i < MONO_LENGTH; i++) {
+        if (!stats_mono[i].skip) {spread_weight('m', i, stats_mono[i].weight, mono_weights);}
+    }
+    for (int i = 0; i < BI_LENGTH; i++) {
+        if (!stats_bi[i].skip) {spread_weight('b', i, stats_bi[i].weight, bi_weights);}
+    }
+    for (int i = 0; i < TRI_LENGTH; i++) {
+        if (!stats_tri[i].skip) {spread_weight('t', i, stats_tri[i].weight, tri_weights);}
+    }
+    for (int i = 0; i < QUAD_LENGTH; i++) {
+        if (!stats_quad[i].skip) {spread_weight('q', i, stats_quad[i].weight, quad_weights);}
+    }
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if (stats_skip[i].skip) {continue;}
+        for (int k = 1; k <= 9; k++) {spread_weight('s', i, stats_skip[i].weight[k], skip_weights[k]);}
+    }
+
+    /* only the stats analysis walks hold tuples */
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if (stats_mono[i].skip || stats_mono[i].derived || mono_weights[i] == 0) {continue;}
+        blame_stat(lt, stats_mono[i].ngrams, stats_mono[i].length, 1, &mono_weights[i], 0, blame);
+    }
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        if (stats_bi[i].skip || stats_bi[i].derived || bi_weights[i] == 0) {continue;}
+        blame_stat(lt, stats_bi[i].ngrams, stats_bi[i].length, 2, &bi_weights[i], 0, blame);
+    }
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        if (stats_tri[i].skip || stats_tri[i].derived || tri_weights[i] == 0) {continue;}
+        blame_stat(lt, stats_tri[i].ngrams, stats_tri[i].length, 3, &tri_weights[i], 0, blame);
+    }
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        if (stats_quad[i].skip || stats_quad[i].derived || quad_weights[i] == 0) {continue;}
+        blame_stat(lt, stats_quad[i].ngrams, stats_quad[i].length, 4, &quad_weights[i], 0, blame);
+    }
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if (stats_skip[i].skip || stats_skip[i].derived) {continue;}
+        float weight[10];
+        int used = 0;
+        for (int k = 1; k <= 9; k++)
+        {
+            weight[k] = skip_weights[k][i];
+            used |= weight[k] != 0;
+        }
+        if (used) {blame_stat(lt, stats_skip[i].ngrams, stats_skip[i].length, 2, weight, 1, blame);}
+    }
+
+    /* a key that earns more than it costs is not to blame */
+    for (int p = 0; p < DIM1; p++) {
+        if (blame[p] < 0) {blame[p] = 0;}
+    }
+}
+
+/*
+ * Builds the cumulative table blamed positions are drawn from, leaving the
+ * positions the chain has pinned out.
+ *
+ * Parameters:
+ *   blame: The blame of every position, from layout_blame().
+ *   chain_pins: The pins of the chain, which may differ from the global ones
+ *               in the jobs mode.
+ *   cumulative: Receives DIM1 running sums.
+ *
+ * Returns:
+ *   The total blame, 0 if nothing free is to blame.
+ */
+float blame_table(float *blame, int (*chain_pins)[col], float *cumulative)
+{
+    float total = 0;
+    for (int p = 0; p < DIM1; p++)
+    {
+        if (!chain_pins[p / COL][p % COL]) {total += blame[p];}
+        cumulative[p] = total;
+    }
+    return total;
+}
+
+/*
+ * Picks a swap endpoint, in proportion to blame for guide_rate percent of the
+ * picks and uniformly otherwise, so every swap stays possible. The caller
+ * still rejects pinned positions, and passes a total of 0 after a few rejected
+ * picks so the draws cannot keep landing on the same few keys.
+ *
+ * Parameters:
+ *   pick_row, pick_col: Receive the position.
+ *   cumulative: The table from blame_table().
+ *   total: The total blame, 0 for a uniform pick.
+ *   seed: The random state of the calling thread, for rand_r().
+ */
+void guided_position(int *pick_row, int *pick_col, float *cumulative, float total,
+    unsigned int *seed)
+{
+    if (total > 0 && rand_r(seed) % 100 < guide_rate)
+    {
+        float x = (float)rand_r(seed) / ((float)RAND_MAX + 1) * total;
+        int p = 0;
+        while (p < DIM1 - 1 && cumulative[p] <= x) {p++;}
+        *pick_row = p / COL;
+        *pick_col = p % COL;
+        return;
+    }
+    *pick_row = rand_r(seed) % ROW;
+    *pick_col = rand_r(seed) % COL;
+}
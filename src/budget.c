@@ -0,0 +1,188 @@
+/*
+ * budget.c - Memory budget for the GULAG.
+ *
+ * The only table in the GULAG with more than one representation is the
+ * quadgram table: dense, hybrid, or markov, see quadmodel.c. Given a memory
+ * budget, the fixed footprint of everything else is estimated, each quadgram
+ * representation that would fit is timed on random lookups, and the most
+ * accurate one at least half as fast as the fastest fitting one is chosen.
+ * The budget limits the footprint once the quadgram model is built: the dense
+ * quadgram tables are resident while the corpus is read and while the budget
+ * is fitted, so the start up peaks above it by up to their 54 MB.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wchar.h>
+
+#include "budget.h"
+#include "quadmodel.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Random quadgram lookups timed per representation. */
+#define CALIBRATION_SAMPLES (1 << 20)
+/* Hybrid masses tried, most accurate first. */
+#define HYBRID_STEPS 5
+/*
+ * A less accurate representation is only worth it when it is this many times
+ * faster than every more accurate one that fits; timings on a busy machine
+ * are noisy, so smaller gains would flip the choice from run to run.
+ */
+#define RATE_SLACK 0.5
+
+/* One quadgram representation considered for the budget. */
+typedef struct candidate {
+    char model;
+    float mass;
+    double bytes;
+    double rate;
+} candidate;
+
+/* Returns the estimated bytes held for the run by everything but quadgrams. */
+double fixed_footprint()
+{
+    double L = LANG_LENGTH;
+    double bytes = 0;
+    /* counts and percentages of monograms, bigrams, trigrams, skipgrams */
+    bytes += (L + L * L + L * L * L + 9 * L * L) * sizeof(int);
+    bytes += (L + L * L + L * L * L + 10 * L * L) * sizeof(float);
+    bytes += (65535 + 1) * sizeof(int);
+    bytes += sizeof(mono_stat) * MONO_LENGTH + sizeof(bi_stat) * BI_LENGTH
+        + sizeof(tri_stat) * TRI_LENGTH + sizeof(quad_stat) * QUAD_LENGTH
+        + sizeof(skip_stat) * SKIP_LENGTH + sizeof(meta_stat) * META_LENGTH;
+    /* a working and a best layout per thread */
+    bytes += threads * 2 * (sizeof(layout) + sizeof(float) * (MONO_LENGTH
+        + BI_LENGTH + TRI_LENGTH + QUAD_LENGTH + 10 * SKIP_LENGTH
+        + META_LENGTH + FIVE_LENGTH));
+    return bytes;
+}
+
+/*
+ * Times quadgram lookups under the representation currently set up.
+ *
+ * Parameters:
+ *   samples: Random quadgrams, four language indices each.
+ *   exact: 1 to read the dense table, 0 to go through quad_frequency().
+ *
+ * Returns:
+ *   Lookups per second.
+ */
+double time_lookups(unsigned char *samples, int exact)
+{
+    struct timespec start, end;
+    volatile float sink = 0;
+    float sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int n = 0; n < CALIBRATION_SAMPLES; n++)
+    {
+        unsigned char *q = &samples[n * 4];
+        if (exact) {sum += linear_quad[index_quad(q[0], q[1], q[2], q[3])];} /* util.c */
+        else {sum += quad_frequency(q[0], q[1], q[2], q[3]);} /* quadmodel.c */
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sink = sum;
+    (void)sink;
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return elapsed > 0 ? CALIBRATION_SAMPLES / elapsed : 0;
+}
+
+/*
+ * Picks the quadgram representation for the memory budget, setting quad_model
+ * and quad_mass, and logs every candidate and the decision. Must run after
+ * normalize_corpus() and before build_quad_model(). Only the footprint after
+ * the model is built is held to the budget, not the start up.
+ */
+void fit_memory_budget()
+{
+    double budget = memory_budget * 1e6;
+    double fixed = fixed_footprint();
+    log_print('n',L"fixed %.1f MB of %.1f MB after start up... ", fixed / 1e6, budget / 1e6);
+    if (fixed > budget) {
+        error("Memory budget is below what the corpus tables and stats need.");
+    }
+
+    /* same limits as the quadgram options in check_setup() */
+    int approximable = quads_approximable(); /* io.c */
+
+    unsigned char *samples = (unsigned char *)malloc(CALIBRATION_SAMPLES * 4);
+    if (samples == NULL) {error("Failed to allocate memory for calibration.");}
+    /* layouts hold the most frequent characters, so the lookups draw on those */
+    int chars[LANG_LENGTH];
+    int char_count = 0;
+    for (int i = 1; i < LANG_LENGTH; i++) {if (linear_mono[i] > 0) {chars[char_count++] = i;}}
+    for (int i = 1; i < char_count; i++)
+    {
+        for (int j = i; j > 0 && linear_mono[chars[j]] > linear_mono[chars[j - 1]]; j--)
+        {
+            int swap = chars[j];
+            chars[j] = chars[j - 1];
+            chars[j - 1] = swap;
+        }
+    }
+    if (char_count > DIM1) {char_count = DIM1;}
+    if (char_count == 0) {chars[char_count++] = 1;}
+    for (int n = 0; n < CALIBRATION_SAMPLES * 4; n++) {samples[n] = chars[rand() % char_count];}
+
+    float masses[HYBRID_STEPS] = {99, 95, 90, 75, 50};
+    candidate candidates[HYBRID_STEPS + 2];
+    int count = 0;
+    candidates[count++] = (candidate){'e', 0, (double)LANG_LENGTH * LANG_LENGTH
+        * LANG_LENGTH * LANG_LENGTH * (sizeof(int) + sizeof(float)), 0};
+    if (approximable)
+    {
+        for (int i = 0; i < HYBRID_STEPS; i++)
+        {
+            candidates[count++] = (candidate){'h', masses[i], 0, 0};
+        }
+        candidates[count++] = (candidate){'m', 0, 0, 0};
+    }
+
+    log_print('n',L"\n");
+    float saved_mass = quad_mass;
+    double best_rate = 0;
+    for (int i = 0; i < count; i++)
+    {
+        candidate *c = &candidates[i];
+        if (c->model == 'e') {c->rate = time_lookups(samples, 1);}
+        else
+        {
+            quad_mass = c->mass;
+            if (c->model == 'h') {keep_top_quads();} /* quadmodel.c */
+            c->bytes = quad_model_bytes(); /* quadmodel.c */
+            c->rate = time_lookups(samples, 0);
+            free_quad_model(); /* quadmodel.c */
+        }
+        int fits = fixed + c->bytes <= budget;
+        if (fits && c->rate > best_rate) {best_rate = c->rate;}
+        char label[16];
+        if (c->model == 'e') {sprintf(label, "exact");}
+        else if (c->model == 'h') {sprintf(label, "hybrid %.0f%%", c->mass);}
+        else {sprintf(label, "markov");}
+        log_print('n',L"       %-10s : %7.1f MB, %6.1f M lookups/s%s\n", label,
+            c->bytes / 1e6, c->rate / 1e6, fits ? "" : ", over budget");
+    }
+    quad_mass = saved_mass;
+    free(samples);
+
+    /* the candidates are in order of accuracy, markov always fits */
+    int chosen = -1;
+    for (int i = 0; i < count && chosen == -1; i++)
+    {
+        if (fixed + candidates[i].bytes <= budget && candidates[i].rate >= best_rate * RATE_SLACK) {
+            chosen = i;
+        }
+    }
+    if (chosen == -1) {
+        error("Memory budget cannot fit the quadgram table, approximations are not supported here.");
+    }
+
+    quad_model = candidates[chosen].model;
+    if (quad_model == 'h') {quad_mass = candidates[chosen].mass;}
+    log_print('n',L"     Chose %s quadgrams, estimated footprint after start up %.1f MB... ",
+        quad_model == 'e' ? "exact" : quad_model == 'h' ? "hybrid" : "markov",
+        (fixed + candidates[chosen].bytes) / 1e6);
+}
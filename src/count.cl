@@ -0,0 +1,79 @@
+/*
+ * count.cl - CL implementation of the ngram counting in read_corpus() for the
+ * GULAG.
+ *
+ * Counts monograms through quadgrams and skip-1 to skip-9 grams over a chunk of
+ * the corpus given as language indices, 0 standing for any character that is
+ * not in the language. Each chunk starts with the last HISTORY indices of the
+ * chunk before it, so ngrams crossing a chunk boundary are counted once, by the
+ * chunk they end in.
+ */
+
+#define LANG_LENGTH 51
+#define HISTORY 10
+
+/*
+ * The monograms and bigrams are dense and hot, so every work group counts them
+ * in local memory and adds its histogram to the global one at the end. The
+ * trigram, quadgram, and skipgram tables are too large for local memory and
+ * sparsely hit, so they are counted with global atomics directly.
+ *
+ * text: The chunk, HISTORY indices of history followed by length new ones.
+ * length: The number of new indices in the chunk.
+ * mono, bi, tri, quad: Linearized count tables, as index_mono() and friends.
+ * skip: Linearized skipgram counts, as index_skip().
+ */
+__kernel void count_kernel(__global const uchar *text, const int length,
+    __global int *mono, __global int *bi, __global int *tri, __global int *quad,
+    __global int *skip)
+{
+    __local int local_mono[LANG_LENGTH];
+    __local int local_bi[LANG_LENGTH * LANG_LENGTH];
+
+    int lid = get_local_id(0);
+    int lsize = get_local_size(0);
+    for (int i = lid; i < LANG_LENGTH * LANG_LENGTH; i += lsize)
+    {
+        local_bi[i] = 0;
+        if (i < LANG_LENGTH) {local_mono[i] = 0;}
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int p = get_global_id(0); p < length; p += get_global_size(0))
+    {
+        int n = p + HISTORY;
+        int c0 = text[n];
+        if (c0 == 0) {continue;}
+        atomic_inc(&local_mono[c0]);
+
+        int c1 = text[n - 1];
+        if (c1 != 0)
+        {
+            atomic_inc(&local_bi[c1 * LANG_LENGTH + c0]);
+            int c2 = text[n - 2];
+            if (c2 != 0)
+            {
+                atomic_inc(&tri[(c2 * LANG_LENGTH + c1) * LANG_LENGTH + c0]);
+                int c3 = text[n - 3];
+                if (c3 != 0)
+                {
+                    atomic_inc(&quad[((c3 * LANG_LENGTH + c2) * LANG_LENGTH + c1) * LANG_LENGTH + c0]);
+                }
+            }
+        }
+
+        /* skip-k pairs the newest index with the one k + 1 before it */
+        for (int k = 1; k < HISTORY; k++)
+        {
+            int c = text[n - k - 1];
+            if (c != 0) {atomic_inc(&skip[(k * LANG_LENGTH + c) * LANG_LENGTH + c0]);}
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int i = lid; i < LANG_LENGTH * LANG_LENGTH; i += lsize)
+    {
+        if (local_bi[i] != 0) {atomic_add(&bi[i], local_bi[i]);}
+        if (i < LANG_LENGTH && local_mono[i] != 0) {atomic_add(&mono[i], local_mono[i]);}
+    }
+}
@@ -0,0 +1,240 @@
+/*
+ * delta.c - Corpus delta analysis for the GULAG.
+ *
+ * Comparing how layouts score on two corpora does not need a second full
+ * analysis. Only the ngrams whose frequency differs between the corpora can
+ * move a score, so the two normalized tables are reduced to a sparse list of
+ * changed entries. For each layout, every changed entry is mapped to the
+ * position ngram its characters occupy and added straight into the stats
+ * that walk that position ngram, found through the stat maps.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "delta.h"
+#include "stat_map.h"
+#include "analyze.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* One changed entry of a normalized table. */
+typedef struct delta_entry {
+    size_t index;
+    float diff;
+} delta_entry;
+
+delta_entry *delta_mono, *delta_bi, *delta_tri, *delta_quad, *delta_skip;
+int delta_mono_count, delta_bi_count, delta_tri_count, delta_quad_count, delta_skip_count;
+
+/*
+ * Collects the entries of two tables that differ by more than DELTA_EPSILON.
+ *
+ * Parameters:
+ *   first: The table of the current corpus.
+ *   second: The table of the second corpus.
+ *   size: The number of entries in each table.
+ *   entries: Set to a newly allocated array of the changed entries.
+ *   dropped: Increased by the total size of the changes too small to keep.
+ * Returns: The number of changed entries.
+ */
+int sparse_diff(float *first, float *second, size_t size, delta_entry **entries, double *dropped)
+{
+    int count = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (fabsf(second[i] - first[i]) > DELTA_EPSILON) {count++;}
+    }
+    *entries = (delta_entry *)malloc(sizeof(delta_entry) * (count + 1));
+    if (*entries == NULL) {error("Failed to allocate memory for the corpus delta.");}
+
+    int n = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        float diff = second[i] - first[i];
+        if (fabsf(diff) > DELTA_EPSILON)
+        {
+            (*entries)[n].index = i;
+            (*entries)[n].diff = diff;
+            n++;
+        }
+        else {*dropped += fabsf(diff);}
+    }
+    return count;
+}
+
+/*
+ * Reads and normalizes the second corpus, then keeps only the entries of its
+ * tables that differ from the current corpus. Also builds the lists of stats
+ * walking each position ngram, so a changed entry can be applied to a
+ * layout without walking any stat.
+ */
+void read_delta()
+{
+    size_t L = LANG_LENGTH;
+    float *first_mono = linear_mono, *first_bi = linear_bi, *first_tri = linear_tri;
+    float *first_quad = linear_quad, *first_skip = linear_skip;
+    char *first_name = corpus_name;
+
+    /* load the second corpus the usual way, into tables of its own */
+    linear_mono = (float *)calloc(L, sizeof(float));
+    linear_bi = (float *)calloc(L * L, sizeof(float));
+    linear_tri = (float *)calloc(L * L * L, sizeof(float));
+    linear_quad = (float *)calloc(L * L * L * L, sizeof(float));
+    linear_skip = (float *)calloc(10 * L * L, sizeof(float));
+    if (linear_mono == NULL || linear_bi == NULL || linear_tri == NULL
+        || linear_quad == NULL || linear_skip == NULL) {
+        error("Failed to allocate memory for the second corpus.");
+    }
+    corpus_name = corpus2_name;
+    clear_corpus(); /* util.c */
+    if (!read_corpus_cache()) { /* io.c */
+        read_corpus(); /* io.c */
+        cache_corpus(); /* io.c */
+    }
+    normalize_corpus(); /* util.c */
+
+    double dropped = 0;
+    delta_mono_count = sparse_diff(first_mono, linear_mono, L, &delta_mono, &dropped);
+    delta_bi_count = sparse_diff(first_bi, linear_bi, L * L, &delta_bi, &dropped);
+    delta_tri_count = sparse_diff(first_tri, linear_tri, L * L * L, &delta_tri, &dropped);
+    delta_quad_count = sparse_diff(first_quad, linear_quad, L * L * L * L, &delta_quad, &dropped);
+    delta_skip_count = sparse_diff(first_skip, linear_skip, 10 * L * L, &delta_skip, &dropped);
+
+    free(linear_mono);
+    free(linear_bi);
+    free(linear_tri);
+    free(linear_quad);
+    free(linear_skip);
+    linear_mono = first_mono;
+    linear_bi = first_bi;
+    linear_tri = first_tri;
+    linear_quad = first_quad;
+    linear_skip = first_skip;
+    corpus_name = first_name;
+
+    log_print('v',L"Changed entries: %d mono, %d bi, %d tri, %d quad, %d skip, %g%% dropped... ",
+        delta_mono_count, delta_bi_count, delta_tri_count, delta_quad_count,
+        delta_skip_count, dropped);
+
+    build_stat_maps(); /* stat_map.c */
+}
+
+/* Frees the sparse difference and the stat lists. */
+void free_delta()
+{
+    free(delta_mono);
+    free(delta_bi);
+    free(delta_tri);
+    free(delta_quad);
+    free(delta_skip);
+    free_stat_maps(); /* stat_map.c */
+}
+
+/* Adds a frequency change to every stat walking a position ngram. */
+void apply_diff(stat_map *map, int ngram, float *scores, float diff)
+{
+    for (int k = map->start[ngram]; k < map->start[ngram + 1]; k++)
+    {
+        scores[map->stats[k]] += diff;
+    }
+}
+
+/*
+ * Moves an analyzed layout from the current corpus to the second one by
+ * applying only the changed entries to its stats, then recalculates its
+ * derived and meta stats and its score.
+ *
+ * Parameters:
+ *   lt: A pointer to a layout analyzed and scored on the current corpus.
+ */
+void delta_analyze(layout *lt)
+{
+    int L = LANG_LENGTH;
+
+    /* positions of each character, a character may sit on several keys */
+    int first[L];
+    int next[ROW * COL];
+    map_positions(lt, first, next); /* stat_map.c */
+
+    for (int n = 0; n < delta_mono_count; n++)
+    {
+        delta_entry *e = &delta_mono[n];
+        for (int p0 = first[e->index]; p0 >= 0; p0 = next[p0])
+        {
+            apply_diff(&map_mono, p0, lt->mono_score, e->diff);
+        }
+    }
+
+    for (int n = 0; n < delta_bi_count; n++)
+    {
+        delta_entry *e = &delta_bi[n];
+        int a = e->index / L, b = e->index % L;
+        for (int p0 = first[a]; p0 >= 0; p0 = next[p0])
+        {
+            for (int p1 = first[b]; p1 >= 0; p1 = next[p1])
+            {
+                apply_diff(&map_bi, p0 * DIM1 + p1, lt->bi_score, e->diff);
+            }
+        }
+    }
+
+    for (int n = 0; n < delta_tri_count; n++)
+    {
+        delta_entry *e = &delta_tri[n];
+        int a = e->index / (L * L), b = e->index / L % L, c = e->index % L;
+        for (int p0 = first[a]; p0 >= 0; p0 = next[p0])
+        {
+            for (int p1 = first[b]; p1 >= 0; p1 = next[p1])
+            {
+                for (int p2 = first[c]; p2 >= 0; p2 = next[p2])
+                {
+                    apply_diff(&map_tri, (p0 * DIM1 + p1) * DIM1 + p2, lt->tri_score, e->diff);
+                }
+            }
+        }
+    }
+
+    for (int n = 0; n < delta_quad_count; n++)
+    {
+        delta_entry *e = &delta_quad[n];
+        int a = e->index / (L * L * L), b = e->index / (L * L) % L;
+        int c = e->index / L % L, d = e->index % L;
+        for (int p0 = first[a]; p0 >= 0; p0 = next[p0])
+        {
+            for (int p1 = first[b]; p1 >= 0; p1 = next[p1])
+            {
+                for (int p2 = first[c]; p2 >= 0; p2 = next[p2])
+                {
+                    for (int p3 = first[d]; p3 >= 0; p3 = next[p3])
+                    {
+                        apply_diff(&map_quad, ((p0 * DIM1 + p1) * DIM1 + p2) * DIM1 + p3,
+                            lt->quad_score, e->diff);
+                    }
+                }
+            }
+        }
+    }
+
+    for (int n = 0; n < delta_skip_count; n++)
+    {
+        delta_entry *e = &delta_skip[n];
+        int k = e->index / (L * L), a = e->index / L % L, b = e->index % L;
+        if (k < 1 || k > 9) {continue;}
+        for (int p0 = first[a]; p0 >= 0; p0 = next[p0])
+        {
+            for (int p1 = first[b]; p1 >= 0; p1 = next[p1])
+            {
+                apply_diff(&map_skip, p0 * DIM1 + p1, lt->skip_score[k], e->diff);
+            }
+        }
+    }
+
+    derive_stats(lt); /* analyze.c */
+    meta_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+}
@@ -0,0 +1,215 @@
+/*
+ * engine.c - Search engines for the GULAG optimizer.
+ *
+ * The optimizer threads make random swaps, score the result, and keep or
+ * revert it. What varies between search strategies is only which candidates
+ * are kept and how many swaps a move makes, so each strategy is an engine of
+ * four functions the threads drive. Simulated annealing is the original
+ * search. Late acceptance hill climbing keeps a candidate that beats the
+ * score from a fixed number of moves ago, and threshold accepting keeps one
+ * that is at most a shrinking threshold worse. Neither needs exp() or a
+ * temperature to tune.
+ */
+
+#include <string.h>
+#include <wchar.h>
+#include <math.h>
+
+#include "engine.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+
+/* Returns an interval of iterations, never zero for short runs. */
+int schedule_interval(engine_state *s, int parts)
+{
+    return s->iterations / parts > 0 ? s->iterations / parts : 1;
+}
+
+/* Clears the fields every engine shares, moves are single swaps. */
+void base_init(engine_state *s, int iterations)
+{
+    s->iterations = iterations;
+    s->swaps = 1;
+    s->moves = 0;
+    s->accepted = 0;
+}
+
+/* Simulated annealing: starts hot, with the full number of swaps. */
+void anneal_init(engine_state *s, int iterations, float score)
+{
+    (void)score;
+    base_init(s, iterations);
+    s->swaps = MAX_SWAPS;
+    s->T = 1000.0;
+    s->max_T = s->T;
+    s->reheating_count = 0;
+    s->improvement_counter = 0;
+}
+
+/* Keeps a worse candidate with a sigmoid probability of the temperature. */
+int anneal_accept(engine_state *s, float candidate, float current)
+{
+    float delta_score = candidate - current;
+    s->moves++;
+    if (delta_score > 0 || (1.0 / (1.0 + exp(-10 * delta_score / s->T))) > random_float()) {
+        s->accepted++;
+        s->improvement_counter++;
+        return 1;
+    }
+    return 0;
+}
+
+/* Cools, reheats, and jolts the temperature, then scales the swaps to it. */
+void anneal_step(engine_state *s, int iteration)
+{
+    int i = iteration;
+
+    /* Adaptive cooling - Modified to adjust reheating temperature */
+    int cool_interval = schedule_interval(s, 20);
+    if (i > 0 && i % cool_interval == 0) {
+        double improvement_rate = (double)s->improvement_counter / cool_interval;
+        if (improvement_rate > 0.2) {
+            /* Cool faster if improving rapidly */
+            s->max_T *= 0.95;
+        } else {
+            /* Cool slower if not improving much */
+            s->max_T *= 1.05;
+        }
+        /* Limit max_T to a reasonable upper bound */
+        s->max_T = s->max_T > 1500.0 ? 1500.0 : s->max_T;
+        /* Don't let max_T be less than the current T */
+        s->max_T = s->max_T < s->T ? s->T : s->max_T;
+        /* Reset counter */
+        s->improvement_counter = 0;
+    }
+
+    /* Reheating with temperature clamp */
+    if (i > 0 && i % schedule_interval(s, 10) == 0) {
+        float old_T = s->T;
+        /* Reheat to the potentially adjusted max_T */
+        s->T = s->max_T;
+        s->reheating_count++;
+        if (s->thread_id == 0) {
+            log_print('v', L"\nReheating (%d) | Old Temp: %f - New Temp: %f\n", s->reheating_count, old_T, s->T);
+        }
+    }
+
+    /* Non-monotonic "jolt" */
+    if (i > 0 && i % schedule_interval(s, 50) == 0) {
+        s->T *= (1.0 + random_float() * 0.3);
+        if (s->T > s->max_T) {
+            s->T = s->max_T;
+        }
+    }
+
+    /* Temperature cooling tied to iteration count */
+    float progress = (float)i / s->iterations;
+    /* Linear decrease */
+    s->T = s->max_T * (1.0 - progress);
+    /* Exponential decrease - You can try this too (seems worse) */
+    /* T = max_T * exp(-5.0 * progress); */
+    /* Prevent T from going below 1.0 */
+    s->T = s->T < 1.0 ? 1.0 : s->T;
+
+    /* Temperature-dependent swap count */
+    s->swaps = (int)(MAX_SWAPS * (s->T / s->max_T));
+    s->swaps = s->swaps < 1 ? 1 : s->swaps;
+    s->swaps = s->swaps > MAX_SWAPS ? MAX_SWAPS : s->swaps;
+}
+
+/* Late acceptance: the history starts filled with the starting score. */
+void late_init(engine_state *s, int iterations, float score)
+{
+    base_init(s, iterations);
+    /* about two hundred passes over the history per run */
+    s->history_length = iterations / 200;
+    s->history_length = s->history_length < 1 ? 1 : s->history_length;
+    s->history_length = s->history_length > ENGINE_HISTORY_MAX ? ENGINE_HISTORY_MAX : s->history_length;
+    for (int i = 0; i < s->history_length; i++) {s->history[i] = score;}
+}
+
+/* Keeps a candidate no worse than the current score or the oldest one. */
+int late_accept(engine_state *s, float candidate, float current)
+{
+    int slot = s->moves % s->history_length;
+    int keep = candidate >= current || candidate >= s->history[slot];
+    s->history[slot] = keep ? candidate : current;
+    s->moves++;
+    s->accepted += keep;
+    return keep;
+}
+
+/* Late acceptance has no schedule, the history does the cooling. */
+void late_step(engine_state *s, int iteration)
+{
+    (void)s;
+    (void)iteration;
+}
+
+/* Threshold accepting: no threshold until the first moves are measured. */
+void threshold_init(engine_state *s, int iterations, float score)
+{
+    (void)score;
+    base_init(s, iterations);
+    s->threshold = 0;
+    s->start_threshold = 0;
+    s->calibration_sum = 0;
+}
+
+/*
+ * Keeps a candidate at most the threshold worse than the current score. The
+ * threshold starts at the mean score change of the first moves.
+ */
+int threshold_accept(engine_state *s, float candidate, float current)
+{
+    if (s->moves < ENGINE_CALIBRATION) {
+        s->calibration_sum += fabsf(candidate - current);
+        if (s->moves == ENGINE_CALIBRATION - 1) {
+            s->start_threshold = s->calibration_sum / ENGINE_CALIBRATION;
+            s->threshold = s->start_threshold;
+        }
+    }
+    s->moves++;
+    int keep = candidate >= current - s->threshold;
+    s->accepted += keep;
+    return keep;
+}
+
+/* Shrinks the threshold linearly to zero at the end of the run. */
+void threshold_step(engine_state *s, int iteration)
+{
+    if (s->moves < ENGINE_CALIBRATION) {return;}
+    s->threshold = s->start_threshold * (1.0 - (float)iteration / s->iterations);
+}
+
+/* Prints how many moves the chain kept. */
+void engine_report(engine_state *s)
+{
+    log_print('v', L"Accepted %d of %d moves (%.1f%%)\n", s->accepted, s->moves,
+        s->moves > 0 ? 100.0 * s->accepted / s->moves : 0.0);
+}
+
+engine engines[] = {
+    {'a', "anneal", anneal_init, anneal_accept, anneal_step, engine_report},
+    {'l', "late acceptance", late_init, late_accept, late_step, engine_report},
+    {'t', "threshold", threshold_init, threshold_accept, threshold_step, engine_report},
+};
+int engine_count = sizeof(engines) / sizeof(engines[0]);
+
+/*
+ * Finds an engine by its code.
+ *
+ * Parameters:
+ *   code: The code of the engine, as returned by check_engine_mode().
+ * Returns: A pointer to the engine.
+ */
+engine *find_engine(char code)
+{
+    for (int i = 0; i < engine_count; i++)
+    {
+        if (engines[i].code == code) {return &engines[i];}
+    }
+    error("invalid engine selected");
+    return &engines[0];
+}
@@ -0,0 +1,213 @@
+/*
+ * explain.c - Per ngram attribution of stats for the GULAG.
+ *
+ * Every stat is a sum of corpus frequencies over its list of key position
+ * tuples, so the tuples themselves are a reverse index from a stat to the
+ * ngrams it counts: placing the characters of the layout on each tuple gives
+ * the ngram and its share of the stat. One walk over a stat's tuples, keeping
+ * the largest contributions in a short sorted list, explains the stat.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <wchar.h>
+
+#include "explain.h"
+#include "quadmodel.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/*
+ * Inserts a contribution into a list sorted in descending order, dropping the
+ * smallest when the list is full.
+ *
+ * Parameters:
+ *   values, ids: The list of contributions and the tuple they come from.
+ *   count: The number of entries in the list, updated.
+ *   top: The capacity of the list.
+ *   value, id: The contribution to insert.
+ */
+void keep_top(float *values, int *ids, int *count, int top, float value, int id)
+{
+    if (*count == top && value <= values[top - 1]) {return;}
+    int i = *count < top ? (*count)++ : top - 1;
+    while (i > 0 && values[i - 1] < value)
+    {
+        values[i] = values[i - 1];
+        ids[i] = ids[i - 1];
+        i--;
+    }
+    values[i] = value;
+    ids[i] = id;
+}
+
+/*
+ * Places the characters of the layout on a position tuple.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   ngram: The flattened position tuple.
+ *   order: The number of positions, 1 to 4.
+ *   chars: Receives the language index on each position.
+ *
+ * Returns:
+ *   1 if every position holds a character, 0 otherwise.
+ */
+int place_ngram(layout *lt, int ngram, int order, int *chars)
+{
+    int r[4], c[4];
+    switch (order)
+    {
+    case 1:
+        unflat_mono(ngram, &r[0], &c[0]); /* util.c */
+        break;
+    case 2:
+        unflat_bi(ngram, &r[0], &c[0], &r[1], &c[1]); /* util.c */
+        break;
+    case 3:
+        unflat_tri(ngram, &r[0], &c[0], &r[1], &c[1], &r[2], &c[2]); /* util.c */
+        break;
+    default:
+        unflat_quad(ngram, &r[0], &c[0], &r[1], &c[1], &r[2], &c[2], &r[3], &c[3]); /* util.c */
+        break;
+    }
+    for (int k = 0; k < order; k++)
+    {
+        chars[k] = lt->matrix[r[k]][c[k]];
+        if (chars[k] == -1) {return 0;}
+    }
+    return 1;
+}
+
+/*
+ * Returns the corpus frequency of an ngram, summed over skip-1 to skip-9 for
+ * skipgrams, in percent.
+ */
+float ngram_frequency(int *chars, int order, int skipgram)
+{
+    if (skipgram)
+    {
+        float sum = 0;
+        for (int k = 1; k <= 9; k++) {sum += linear_skip[index_skip(k, chars[0], chars[1])];}
+        return sum;
+    }
+    switch (order)
+    {
+    case 1:
+        return linear_mono[index_mono(chars[0])];
+    case 2:
+        return linear_bi[index_bi(chars[0], chars[1])];
+    case 3:
+        return linear_tri[index_tri(chars[0], chars[1], chars[2])];
+    default:
+        if (quad_model != 'e') {return quad_frequency(chars[0], chars[1], chars[2], chars[3]);} /* quadmodel.c */
+        return linear_quad[index_quad(chars[0], chars[1], chars[2], chars[3])];
+    }
+}
+
+/*
+ * Prints the largest ngram contributions to one stat.
+ *
+ * Parameters:
+ *   lt: The analyzed layout.
+ *   name: The stat name.
+ *   value: The stat value of the layout.
+ *   ngrams, length: The position tuples of the stat.
+ *   order: The number of positions per tuple.
+ *   skipgram: 1 if the stat is a skipgram stat.
+ *   values, ids: Scratch space for archive_top contributions.
+ */
+void explain_stat(layout *lt, char *name, float value, int *ngrams, int length,
+    int order, int skipgram, float *values, int *ids)
+{
+    int count = 0;
+    int chars[4];
+    for (int j = 0; j < length; j++)
+    {
+        if (!place_ngram(lt, ngrams[j], order, chars)) {continue;}
+        float frequency = ngram_frequency(chars, order, skipgram);
+        if (frequency > 0) {keep_top(values, ids, &count, archive_top, frequency, j);}
+    }
+
+    log_print('q',L"%s : %08.5f%%%s\n", name, value, skipgram ? " over skip-1 to skip-9" : "");
+    for (int i = 0; i < count; i++)
+    {
+        place_ngram(lt, ngrams[ids[i]], order, chars);
+        wchar_t text[5];
+        for (int k = 0; k < order; k++) {text[k] = convert_back(chars[k]);} /* io_util.c */
+        text[order] = L'\0';
+        log_print('q',L"    [%ls] %08.5f%%  %5.1f%% of the stat\n", text, values[i],
+            value > 0 ? values[i] * 100 / value : 0);
+    }
+}
+
+/*
+ * Prints, for every stat shown by the normal output, the archive_top ngrams
+ * that contribute most to it on the layout. Meta and five-gram stats are not
+ * sums over tuples of the layout and are left out.
+ *
+ * Parameters:
+ *   lt: A layout already analyzed by single_analyze().
+ */
+void explain_layout(layout *lt)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    float *values = (float *)malloc(sizeof(float) * archive_top);
+    int *ids = (int *)malloc(sizeof(int) * archive_top);
+    if (values == NULL || ids == NULL) {error("Failed to allocate memory for the explanation.");}
+    int explained = 0;
+
+    log_print('q',L"\nMONOGRAM STATS\n");
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if (stats_mono[i].skip || stats_mono[i].hidden) {continue;}
+        explain_stat(lt, stats_mono[i].name, lt->mono_score[i], stats_mono[i].ngrams,
+            stats_mono[i].length, 1, 0, values, ids);
+        explained++;
+    }
+    log_print('q',L"\nBIGRAM STATS\n");
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        if (stats_bi[i].skip || stats_bi[i].hidden) {continue;}
+        explain_stat(lt, stats_bi[i].name, lt->bi_score[i], stats_bi[i].ngrams,
+            stats_bi[i].length, 2, 0, values, ids);
+        explained++;
+    }
+    log_print('q',L"\nTRIGRAM STATS\n");
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        if (stats_tri[i].skip || stats_tri[i].hidden) {continue;}
+        explain_stat(lt, stats_tri[i].name, lt->tri_score[i], stats_tri[i].ngrams,
+            stats_tri[i].length, 3, 0, values, ids);
+        explained++;
+    }
+    log_print('q',L"\nQUADGRAM STATS\n");
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        if (stats_quad[i].skip || stats_quad[i].hidden) {continue;}
+        explain_stat(lt, stats_quad[i].name, lt->quad_score[i], stats_quad[i].ngrams,
+            stats_quad[i].length, 4, 0, values, ids);
+        explained++;
+    }
+    log_print('q',L"\nSKIPGRAM STATS\n");
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if (stats_skip[i].skip || stats_skip[i].hidden) {continue;}
+        float total = 0;
+        for (int k = 1; k <= 9; k++) {total += lt->skip_score[k][i];}
+        explain_stat(lt, stats_skip[i].name, total, stats_skip[i].ngrams,
+            stats_skip[i].length, 2, 1, values, ids);
+        explained++;
+    }
+
+    free(values);
+    free(ids);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    log_print('n',L"\nExplained %d stats in %.3f ms\n", explained, elapsed * 1e3);
+}
@@ -0,0 +1,359 @@
+/*
+ * fivegram.c - Sparse five-gram frequencies for the GULAG.
+ *
+ * A dense table of every five-gram would need 51^5 entries, well over a
+ * gigabyte, while a real corpus only contains a small fraction of them. The
+ * five-grams are instead counted in an open addressing hash table of fixed
+ * size and then compacted into a list of the observed character tuples and
+ * their frequencies.
+ *
+ * When a corpus holds more distinct five-grams than the table can take, the
+ * table is pruned the way lossy counting does it: every entry with a count at
+ * or under a floor is dropped, the floor doubling from 1 until enough room is
+ * freed. A dropped five-gram lost at most the floor of that prune, so any
+ * count that survives is low by at most the sum of all floors used, and any
+ * five-gram seen more often than that sum is always kept. Both the bound and
+ * the dropped share of the corpus are reported.
+ *
+ * Analysis is driven by the corpus: each observed five-gram is placed on the
+ * layout and its position sequence is looked up in the bitset of every five-
+ * gram stat in use, see stats/five.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "fivegram.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* The hash table holds 2^FIVE_TABLE_BITS slots, 8 bytes each. */
+#define FIVE_TABLE_BITS 23
+/* A prune is forced once the table is this full, keeping probes short. */
+#define FIVE_TABLE_FILL (1 << (FIVE_TABLE_BITS - 1))
+
+/* Observed five-grams, five language indices each, and their percentages. */
+int five_count = 0;
+unsigned char *five_chars;
+float *linear_five;
+
+/* Largest amount any kept five-gram count may be low by after pruning. */
+long five_error = 0;
+
+/* Counting state, only alive while the corpus is read. */
+unsigned int *five_keys;
+unsigned int *five_counts;
+int five_used;
+long long five_dropped;
+
+/* Returns the path of the five-gram cache of the corpus, to be freed. */
+char *five_cache_path()
+{
+    char *path = (char*)malloc(strlen("./data//corpora/.five") +
+        strlen(lang_name) + strlen(corpus_name) + 1);
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/corpora/");
+    strcat(path, corpus_name);
+    strcat(path, ".five");
+    return path;
+}
+
+/* Returns the hash table slot of a five-gram key, or the empty slot for it. */
+int five_slot(unsigned int key)
+{
+    unsigned int mask = (1u << FIVE_TABLE_BITS) - 1;
+    unsigned int slot = (key * 2654435761u) >> (32 - FIVE_TABLE_BITS);
+    while (five_keys[slot] != 0 && five_keys[slot] != key)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/*
+ * Drops every entry with a count at or under the floor, doubling the floor
+ * from 1 until at least a quarter of the table is freed, then rehashes the
+ * rest. The floor used is added to the error bound.
+ */
+void prune_fivegrams()
+{
+    int size = 1 << FIVE_TABLE_BITS;
+    int kept;
+    long prune_floor = 0;
+    do {
+        prune_floor = prune_floor == 0 ? 1 : prune_floor * 2;
+        kept = 0;
+        for (int i = 0; i < size; i++)
+        {
+            if (five_keys[i] != 0 && five_counts[i] > prune_floor) {kept++;}
+        }
+    } while (kept > FIVE_TABLE_FILL * 3 / 4);
+    five_error += prune_floor;
+
+    unsigned int *keys = (unsigned int *)malloc(kept * sizeof(unsigned int));
+    unsigned int *counts = (unsigned int *)malloc(kept * sizeof(unsigned int));
+    int n = 0;
+    for (int i = 0; i < size; i++)
+    {
+        if (five_keys[i] == 0) {continue;}
+        if (five_counts[i] > prune_floor)
+        {
+            keys[n] = five_keys[i];
+            counts[n++] = five_counts[i];
+        }
+        else {five_dropped += five_counts[i];}
+    }
+
+    memset(five_keys, 0, size * sizeof(unsigned int));
+    for (int i = 0; i < n; i++)
+    {
+        int slot = five_slot(keys[i]);
+        five_keys[slot] = keys[i];
+        five_counts[slot] = counts[i];
+    }
+    five_used = n;
+    free(keys);
+    free(counts);
+}
+
+/* Counts one five-gram, given as five language indices. */
+void count_fivegram(int *chars)
+{
+    unsigned int key = 0;
+    for (int i = 0; i < 5; i++) {key = key * LANG_LENGTH + chars[i];}
+
+    int slot = five_slot(key);
+    if (five_keys[slot] == 0)
+    {
+        if (five_used >= FIVE_TABLE_FILL)
+        {
+            prune_fivegrams();
+            slot = five_slot(key);
+        }
+        five_keys[slot] = key;
+        five_counts[slot] = 0;
+        five_used++;
+    }
+    five_counts[slot]++;
+}
+
+/*
+ * Reads the five-gram cache of the corpus into the compact arrays.
+ *
+ * Returns:
+ *   1 if the cache file was successfully read, 0 otherwise.
+ */
+int read_five_cache()
+{
+    char *path = five_cache_path();
+    FILE *cache = fopen(path, "r");
+    free(path);
+    if (cache == NULL) {
+        log_print('v',L"Cache not found... ");
+        return 0;
+    }
+    log_print('v',L"Cache found... ");
+
+    if (fwscanf(cache, L"e %ld %d ", &five_error, &five_count) != 2) {
+        fclose(cache);
+        return 0;
+    }
+    five_chars = (unsigned char *)malloc(five_count * 5 + 1);
+    linear_five = (float *)malloc(five_count * sizeof(float) + 1);
+    int a, b, c, d, e;
+    for (int i = 0; i < five_count; i++)
+    {
+        if (fwscanf(cache, L"f %d %d %d %d %d %f ", &a, &b, &c, &d, &e,
+            &linear_five[i]) != 6)
+        {
+            error("Five-gram cache is corrupt, delete it to recount.");
+        }
+        five_chars[i * 5] = a;
+        five_chars[i * 5 + 1] = b;
+        five_chars[i * 5 + 2] = c;
+        five_chars[i * 5 + 3] = d;
+        five_chars[i * 5 + 4] = e;
+    }
+    fclose(cache);
+    return 1;
+}
+
+/* Writes the compact five-gram arrays to the cache of the corpus. */
+void cache_fivegrams()
+{
+    char *path = five_cache_path();
+    FILE *cache = fopen(path, "w");
+    free(path);
+    if (cache == NULL) {
+        error("Five-gram cache file failed to be created.");
+    }
+    fprintf(cache, "e %ld %d\n", five_error, five_count);
+    for (int i = 0; i < five_count; i++)
+    {
+        unsigned char *g = &five_chars[i * 5];
+        fprintf(cache, "f %d %d %d %d %d %.9g\n", g[0], g[1], g[2], g[3], g[4],
+            linear_five[i]);
+    }
+    fclose(cache);
+}
+
+/*
+ * Counts every five-gram of the corpus text in the hash table, pruning when
+ * it fills, then compacts the survivors into percentages of all five-grams.
+ */
+void count_fivegrams()
+{
+    char *path = (char*)malloc(strlen("./data//corpora/.txt") +
+        strlen(lang_name) + strlen(corpus_name) + 1);
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/corpora/");
+    strcat(path, corpus_name);
+    strcat(path, ".txt");
+    FILE *corpus = fopen(path, "r");
+    free(path);
+    if (corpus == NULL) {
+        error("Corpus file not found, make sure the file ends in .txt, but the name in config/parameters does not");
+    }
+
+    int size = 1 << FIVE_TABLE_BITS;
+    five_keys = (unsigned int *)calloc(size, sizeof(unsigned int));
+    five_counts = (unsigned int *)malloc(size * sizeof(unsigned int));
+    five_used = 0;
+    five_dropped = 0;
+    five_error = 0;
+
+    /* Memory for the last 5 seen characters, newest first */
+    int mem[] = {-1, -1, -1, -1, -1};
+    int chars[5];
+    long long total = 0;
+    wchar_t curr;
+    while ((curr = fgetwc(corpus)) != WEOF) {
+        mem[0] = convert_char(curr); /* io_util.c */
+        int valid = 1;
+        for (int i = 0; i < 5; i++)
+        {
+            if (mem[i] <= 0 || mem[i] >= 51) {valid = 0; break;}
+            chars[4 - i] = mem[i];
+        }
+        if (valid)
+        {
+            count_fivegram(chars);
+            total++;
+        }
+        iterate(mem, 5); /* io_util.c */
+    }
+    fclose(corpus);
+
+    five_count = five_used;
+    five_chars = (unsigned char *)malloc(five_count * 5 + 1);
+    linear_five = (float *)malloc(five_count * sizeof(float) + 1);
+    int n = 0;
+    for (int i = 0; i < size; i++)
+    {
+        if (five_keys[i] == 0) {continue;}
+        unsigned int key = five_keys[i];
+        for (int j = 4; j >= 0; j--)
+        {
+            five_chars[n * 5 + j] = key % LANG_LENGTH;
+            key /= LANG_LENGTH;
+        }
+        linear_five[n++] = (float)five_counts[i] * 100 / total;
+    }
+    free(five_keys);
+    free(five_counts);
+
+    log_print('n',L"%d distinct... ", five_count);
+    if (five_error > 0)
+    {
+        log_print('n',L"pruned %.3f%% of the corpus, counts low by at most %ld... ",
+            (float)five_dropped * 100 / total, five_error);
+    }
+}
+
+/*
+ * Reads the five-grams of the corpus, from its cache if there is one.
+ * Refuses setups whose analysis does not go through single_analyze(), since
+ * only it fills in the five-gram stats.
+ */
+void read_fivegrams()
+{
+    if (shard_count > 1) {
+        error("Five-gram stats are not supported with corpus shards.");
+    }
+    if (run_mode == 's' || run_mode == 'u') {
+        error("Five-gram stats are not supported in stream or delta mode.");
+    }
+    if ((run_mode == 'g' || run_mode == 'i' || run_mode == 'b' || run_mode == 'j')
+        && backend_mode != 'c') {
+        error("Five-gram stats are only supported by the cpu backend.");
+    }
+
+    /* already read for earlier weights */
+    if (five_count > 0) {return;}
+
+    log_print('v',L"Finding cache... ");
+    if (!read_five_cache())
+    {
+        log_print('n',L"Counting raw corpus... ");
+        count_fivegrams();
+        cache_fivegrams();
+        log_print('n',L"Created cache file... ");
+    }
+    log_print('n',L"%.1f MB... ", (five_count * (5 + sizeof(float))) / 1e6);
+}
+
+/* Frees the compact five-gram arrays. */
+void free_fivegrams()
+{
+    if (five_count == 0) {return;}
+    free(five_chars);
+    free(linear_five);
+    five_count = 0;
+}
+
+/*
+ * Calculates the five-gram statistics of a layout by placing every observed
+ * five-gram on it and testing its position sequence against each stat in use.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout to analyze.
+ */
+void five_analyze(layout *lt)
+{
+    if (five_count == 0) {return;}
+
+    /* position of each language character on the layout, -1 when off it */
+    int pos[LANG_LENGTH];
+    for (int i = 0; i < LANG_LENGTH; i++) {pos[i] = -1;}
+    for (int i = 0; i < ROW; i++)
+    {
+        for (int j = 0; j < COL; j++)
+        {
+            if (lt->matrix[i][j] != -1) {pos[lt->matrix[i][j]] = i * COL + j;}
+        }
+    }
+
+    for (int i = 0; i < FIVE_LENGTH; i++) {lt->five_score[i] = 0;}
+
+    for (int j = 0; j < five_count; j++)
+    {
+        unsigned char *g = &five_chars[j * 5];
+        int p0 = pos[g[0]], p1 = pos[g[1]], p2 = pos[g[2]], p3 = pos[g[3]], p4 = pos[g[4]];
+        if ((p0 | p1 | p2 | p3 | p4) < 0) {continue;}
+        long n = (((((long)p0 * DIM1 + p1) * DIM1 + p2) * DIM1) + p3) * DIM1 + p4;
+        for (int i = 0; i < FIVE_LENGTH; i++)
+        {
+            if (!stats_five[i].skip && (stats_five[i].bits[n >> 3] & (1 << (n & 7))))
+            {
+                lt->five_score[i] += linear_five[j];
+            }
+        }
+    }
+}
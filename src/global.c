@@ -12,14 +12,6 @@
 #include "global.h"
 #include "structs.h"
 
-/* Defining dimensions for the layout grid. */
-#define row 3
-#define col 12
-#define dim1 row * col
-#define dim2 dim1 * dim1
-#define dim3 dim2 * dim1
-#define dim4 dim3 * dim1
-
 /* Character count in the chosen language. */
 int LANG_LENGTH = 51;
 
@@ -40,20 +32,64 @@ int WORKERS = 16;
 /* Paths to data files. */
 char *lang_name = NULL;
 char *corpus_name = NULL;
+char *corpus2_name = NULL;
 char *layout_name = NULL;
 char *layout2_name = NULL;
 char *weight_name = NULL;
+char *geometry_name = NULL;
+char *custom_stats_name = NULL;
+char *format_file = NULL;
+char *jobs_name = NULL;
+/* Comma separated stats the front mode trades off. */
+char *objective_list = NULL;
+
+/* Text files named after the options, scored by the stream mode. */
+char **document_paths = NULL;
+int document_count = 0;
 
 /* Control flags for program execution. */
 char run_mode = 'a';
 int repetitions = 10000;
 int threads = 8;
+int archive_top = 10;
 char output_mode = 'v';
 char backend_mode = 'c';
+char format_mode = 'h';
+char search_engine = 'a';
+
+/* Corpus shards for robustness evaluation, and the objective optimized. */
+int shard_count = 1;
+char shard_objective = 'n';
+float shard_lambda = 1.0;
+
+/* Percentage of optimizer moves that trade a key for an unused character. */
+int reserve_rate = 0;
+/* Score lost per percentage point of characters left off the layout. */
+float reserve_penalty = 10.0;
+
+/* Quadgram model (exact, markov, hybrid) and the mass the hybrid keeps exact. */
+char quad_model = 'e';
+float quad_mass = 50.0;
+
+/* Megabytes the data structures should fit in, 0 for no budget. */
+float memory_budget = 0;
+
+/* Rows and columns the permutation mode moves: hands, columns, rows, all. */
+char subspace = 'h';
+
+/* Seconds each run of the anytime benchmark gets. */
+float time_budget = 2.0;
+
+/* Percentage of swap endpoints drawn in proportion to the blame of each key. */
+int guide_rate = 0;
 
 double layouts_analyzed = 0;
 double elapsed_compute_time = 0;
 
+/* Set by the signal handlers, polled by the optimizer threads. */
+atomic_int stop_requested = 0;
+atomic_int dump_requested = 0;
+
 /* The selected language's character set. */
 wchar_t *lang_arr;
 
@@ -63,6 +99,14 @@ int *char_table;
 /* Pinned key positions on the layout for improvement. */
 int pins[row][col];
 
+/* Key properties of each grid position, read from the geometry file. */
+char geo_hand[row][col];
+int geo_finger[row][col];
+int geo_row[row][col];
+int geo_stretch[row][col];
+float geo_x[row][col];
+float geo_y[row][col];
+
 /* Head of the linked list for layout ranking. */
 layout_node *head_node;
 
@@ -87,6 +131,7 @@ int TRI_LENGTH = 0;
 int QUAD_LENGTH = 0;
 int SKIP_LENGTH = 0;
 int META_LENGTH = 0;
+int FIVE_LENGTH = 0;
 
 /* Arrays to hold all statistics after processing. */
 mono_stat *stats_mono;
@@ -95,3 +140,4 @@ tri_stat *stats_tri;
 quad_stat *stats_quad;
 skip_stat *stats_skip;
 meta_stat *stats_meta;
+five_stat *stats_five;
@@ -0,0 +1,311 @@
+/*
+ * ingest.c - OpenCL corpus ingestion for the GULAG.
+ *
+ * Counting ngrams is a histogram over the corpus, which read_corpus() builds
+ * one character at a time. With the OpenCL backend selected the host only
+ * decodes the corpus into a stream of language indices, in chunks, and the
+ * device counts every chunk with count.cl. Two chunks are in flight at a time
+ * on separate transfer and compute queues, so decoding the next chunk, copying
+ * one, and counting another overlap.
+ *
+ * Any OpenCL failure leaves the corpus arrays untouched and reports it, so the
+ * caller can fall back to read_corpus().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <CL/cl.h>
+
+#include "ingest.h"
+#include "mode.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+
+/* Language indices decoded per chunk. */
+#define CHUNK_LENGTH (1 << 22)
+/* Indices of the previous chunk repeated at the start of each, see count.cl. */
+#define HISTORY 10
+/* Work items per work group, and work groups per compute unit. */
+#define COUNT_LOCAL 64
+#define COUNT_GROUPS 4
+
+/* OpenCL objects of the ingestion, NULL until created. */
+typedef struct counter {
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue transfer;
+    cl_command_queue compute;
+    cl_program program;
+    cl_kernel kernel;
+    cl_mem text[2];
+    cl_mem mono, bi, tri, quad, skip;
+    size_t global_size;
+} counter;
+
+/* Releases every OpenCL object of the counter that was created. */
+void release_counter(counter *c)
+{
+    cl_mem *buffers[] = {&c->text[0], &c->text[1], &c->mono, &c->bi, &c->tri,
+        &c->quad, &c->skip};
+    for (int i = 0; i < 7; i++)
+    {
+        if (*buffers[i] != NULL) {clReleaseMemObject(*buffers[i]);}
+    }
+    if (c->kernel != NULL) {clReleaseKernel(c->kernel);}
+    if (c->program != NULL) {clReleaseProgram(c->program);}
+    if (c->transfer != NULL) {clReleaseCommandQueue(c->transfer);}
+    if (c->compute != NULL) {clReleaseCommandQueue(c->compute);}
+    if (c->context != NULL) {clReleaseContext(c->context);}
+}
+
+/*
+ * Finds a device, preferring a GPU as cl_improve() does, and builds the
+ * counting kernel with zeroed count tables.
+ *
+ * Returns:
+ *   1 on success, 0 if any step failed.
+ */
+int setup_counter(counter *c)
+{
+    cl_int err;
+    cl_uint num_platforms;
+    if (clGetPlatformIDs(0, NULL, &num_platforms) != CL_SUCCESS || num_platforms == 0) {
+        return 0;
+    }
+    cl_platform_id *platforms = (cl_platform_id *)malloc(sizeof(cl_platform_id) * num_platforms);
+    if (clGetPlatformIDs(num_platforms, platforms, NULL) != CL_SUCCESS) {
+        free(platforms);
+        return 0;
+    }
+    int device_found = 0;
+    for (int i = 0; i < num_platforms && !device_found; i++) {
+        device_found = clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU, 1, &c->device, NULL) == CL_SUCCESS;
+    }
+    for (int i = 0; i < num_platforms && !device_found; i++) {
+        device_found = clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, 1, &c->device, NULL) == CL_SUCCESS;
+    }
+    free(platforms);
+    if (!device_found) {return 0;}
+
+    c->context = clCreateContext(NULL, 1, &c->device, NULL, NULL, &err);
+    if (err != CL_SUCCESS) {return 0;}
+    cl_queue_properties props[] = {0};
+    c->transfer = clCreateCommandQueueWithProperties(c->context, c->device, props, &err);
+    if (err != CL_SUCCESS) {return 0;}
+    c->compute = clCreateCommandQueueWithProperties(c->context, c->device, props, &err);
+    if (err != CL_SUCCESS) {return 0;}
+
+    size_t source_length;
+    char *source = read_source_file("src/count.cl", &source_length); /* mode.c */
+    if (source == NULL) {return 0;}
+    c->program = clCreateProgramWithSource(c->context, 1, (const char **)&source, &source_length, &err);
+    free(source);
+    if (err != CL_SUCCESS) {return 0;}
+    if (clBuildProgram(c->program, 1, &c->device, "", NULL, NULL) != CL_SUCCESS) {return 0;}
+    c->kernel = clCreateKernel(c->program, "count_kernel", &err);
+    if (err != CL_SUCCESS) {return 0;}
+
+    size_t L = LANG_LENGTH;
+    size_t sizes[] = {L, L * L, L * L * L, L * L * L * L, 10 * L * L};
+    cl_mem *tables[] = {&c->mono, &c->bi, &c->tri, &c->quad, &c->skip};
+    int zero = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        *tables[i] = clCreateBuffer(c->context, CL_MEM_READ_WRITE, sizeof(int) * sizes[i], NULL, &err);
+        if (err != CL_SUCCESS) {return 0;}
+        if (clEnqueueFillBuffer(c->compute, *tables[i], &zero, sizeof(int), 0,
+            sizeof(int) * sizes[i], 0, NULL, NULL) != CL_SUCCESS) {return 0;}
+        if (clSetKernelArg(c->kernel, i + 2, sizeof(cl_mem), tables[i]) != CL_SUCCESS) {return 0;}
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        c->text[i] = clCreateBuffer(c->context, CL_MEM_READ_ONLY, CHUNK_LENGTH + HISTORY, NULL, &err);
+        if (err != CL_SUCCESS) {return 0;}
+    }
+
+    cl_uint units = 1;
+    clGetDeviceInfo(c->device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(units), &units, NULL);
+    c->global_size = (size_t)units * COUNT_GROUPS * COUNT_LOCAL;
+    return 1;
+}
+
+/*
+ * Decodes the corpus into chunks and counts them on the device, double
+ * buffered.
+ *
+ * Returns:
+ *   The number of chunks counted, or -1 if an OpenCL call failed.
+ */
+long count_chunks(counter *c, FILE *corpus)
+{
+    unsigned char *host[2];
+    host[0] = (unsigned char *)malloc(CHUNK_LENGTH + HISTORY);
+    host[1] = (unsigned char *)malloc(CHUNK_LENGTH + HISTORY);
+    if (host[0] == NULL || host[1] == NULL) {error("Failed to allocate memory for corpus chunks.");}
+    cl_event written[2] = {NULL, NULL};
+    cl_event counted[2] = {NULL, NULL};
+    unsigned char history[HISTORY];
+    memset(history, 0, HISTORY);
+
+    long chunks = 0;
+    int slot = 0;
+    int done = 0;
+    int failed = 0;
+    size_t local_size = COUNT_LOCAL;
+    wchar_t curr;
+    while (!done && !failed)
+    {
+        /* the host chunk of two chunks ago may still be copying */
+        if (written[slot] != NULL)
+        {
+            clWaitForEvents(1, &written[slot]);
+            clReleaseEvent(written[slot]);
+            written[slot] = NULL;
+        }
+
+        memcpy(host[slot], history, HISTORY);
+        int length = 0;
+        while (length < CHUNK_LENGTH && (curr = fgetwc(corpus)) != WEOF)
+        {
+            int index = convert_char(curr); /* io_util.c */
+            host[slot][HISTORY + length++] = index > 0 && index < 51 ? index : 0;
+        }
+        if (length < CHUNK_LENGTH) {done = 1;}
+        if (length == 0) {break;}
+        memcpy(history, host[slot] + length, HISTORY);
+
+        /* the device chunk of two chunks ago may still be counting */
+        cl_event *wait = counted[slot] != NULL ? &counted[slot] : NULL;
+        failed |= clEnqueueWriteBuffer(c->transfer, c->text[slot], CL_FALSE, 0,
+            length + HISTORY, host[slot], wait != NULL, wait, &written[slot]) != CL_SUCCESS;
+        if (counted[slot] != NULL)
+        {
+            clReleaseEvent(counted[slot]);
+            counted[slot] = NULL;
+        }
+        if (failed) {break;}
+
+        failed |= clSetKernelArg(c->kernel, 0, sizeof(cl_mem), &c->text[slot]) != CL_SUCCESS;
+        failed |= clSetKernelArg(c->kernel, 1, sizeof(int), &length) != CL_SUCCESS;
+        failed |= clEnqueueNDRangeKernel(c->compute, c->kernel, 1, NULL, &c->global_size,
+            &local_size, 1, &written[slot], &counted[slot]) != CL_SUCCESS;
+        clFlush(c->transfer);
+        clFlush(c->compute);
+        chunks++;
+        slot ^= 1;
+    }
+
+    clFinish(c->transfer);
+    clFinish(c->compute);
+    for (int i = 0; i < 2; i++)
+    {
+        if (written[i] != NULL) {clReleaseEvent(written[i]);}
+        if (counted[i] != NULL) {clReleaseEvent(counted[i]);}
+    }
+    free(host[0]);
+    free(host[1]);
+    return failed ? -1 : chunks;
+}
+
+/*
+ * Reads the count tables back from the device and adds them to the global
+ * corpus arrays.
+ *
+ * Returns:
+ *   1 on success, 0 if a read failed.
+ */
+int gather_counts(counter *c)
+{
+    size_t L = LANG_LENGTH;
+    int *mono = (int *)malloc(sizeof(int) * L);
+    int *bi = (int *)malloc(sizeof(int) * L * L);
+    int *tri = (int *)malloc(sizeof(int) * L * L * L);
+    int *quad = (int *)malloc(sizeof(int) * L * L * L * L);
+    int *skip = (int *)malloc(sizeof(int) * 10 * L * L);
+    if (mono == NULL || bi == NULL || tri == NULL || quad == NULL || skip == NULL) {
+        error("Failed to allocate memory for corpus counts.");
+    }
+
+    int ok = clEnqueueReadBuffer(c->compute, c->mono, CL_TRUE, 0, sizeof(int) * L, mono, 0, NULL, NULL) == CL_SUCCESS
+        && clEnqueueReadBuffer(c->compute, c->bi, CL_TRUE, 0, sizeof(int) * L * L, bi, 0, NULL, NULL) == CL_SUCCESS
+        && clEnqueueReadBuffer(c->compute, c->tri, CL_TRUE, 0, sizeof(int) * L * L * L, tri, 0, NULL, NULL) == CL_SUCCESS
+        && clEnqueueReadBuffer(c->compute, c->quad, CL_TRUE, 0, sizeof(int) * L * L * L * L, quad, 0, NULL, NULL) == CL_SUCCESS
+        && clEnqueueReadBuffer(c->compute, c->skip, CL_TRUE, 0, sizeof(int) * 10 * L * L, skip, 0, NULL, NULL) == CL_SUCCESS;
+
+    if (ok)
+    {
+        for (int i = 0; i < L; i++) {
+            corpus_mono[i] += mono[index_mono(i)]; /* util.c */
+            for (int j = 0; j < L; j++) {
+                corpus_bi[i][j] += bi[index_bi(i, j)];
+                for (int k = 0; k < L; k++) {
+                    corpus_tri[i][j][k] += tri[index_tri(i, j, k)];
+                    for (int l = 0; l < L; l++) {
+                        corpus_quad[i][j][k][l] += quad[index_quad(i, j, k, l)];
+                    }
+                }
+                for (int k = 1; k <= 9; k++) {
+                    corpus_skip[k][i][j] += skip[index_skip(k, i, j)];
+                }
+            }
+        }
+    }
+
+    free(mono);
+    free(bi);
+    free(tri);
+    free(quad);
+    free(skip);
+    return ok;
+}
+
+/*
+ * Counts the ngrams of the corpus text on an OpenCL device, filling the global
+ * corpus arrays as read_corpus() does.
+ *
+ * Returns:
+ *   1 if the corpus was counted, 0 if OpenCL was unavailable or failed, in
+ *   which case the corpus arrays are untouched.
+ */
+int cl_read_corpus()
+{
+    counter c;
+    memset(&c, 0, sizeof(counter));
+    log_print('v',L"Setting up OpenCL... ");
+    if (!setup_counter(&c))
+    {
+        release_counter(&c);
+        log_print('n',L"OpenCL unavailable... ");
+        return 0;
+    }
+
+    char *path = (char*)malloc(strlen("./data//corpora/.txt") +
+        strlen(lang_name) + strlen(corpus_name) + 1);
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/corpora/");
+    strcat(path, corpus_name);
+    strcat(path, ".txt");
+    FILE *corpus = fopen(path, "r");
+    free(path);
+    if (corpus == NULL) {
+        error("Corpus file not found, make sure the file ends in .txt, but the name in config/parameters does not");
+    }
+    log_print('v',L"Corpus file found... ");
+
+    long chunks = count_chunks(&c, corpus);
+    fclose(corpus);
+    int ok = chunks >= 0 && gather_counts(&c);
+    release_counter(&c);
+    if (!ok)
+    {
+        log_print('n',L"OpenCL counting failed... ");
+        return 0;
+    }
+    log_print('n',L"Counted %ld chunk%s on the device... ", chunks, chunks == 1 ? "" : "s");
+    return 1;
+}
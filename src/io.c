@@ -16,7 +16,10 @@
 
 #include "io.h"
 #include "io_util.h"
+#include "logger.h"
 #include "util.h"
+#include "shard.h"
+#include "five.h"
 #include "global.h"
 #include "structs.h"
 
@@ -25,10 +28,40 @@
 
 #include <wctype.h>
 
+/*
+ * Formats a message into a newly allocated wide string, growing the buffer
+ * until the whole message fits.
+ *
+ * Parameters:
+ *   format: The format string for the message.
+ *   args:   Variable arguments for the format string.
+ * Returns: The formatted message, to be freed by the caller.
+ */
+wchar_t *format_message(const wchar_t *format, va_list args)
+{
+    size_t size = 256;
+    while (1)
+    {
+        wchar_t *buffer = (wchar_t *)malloc(sizeof(wchar_t) * size);
+        if (buffer == NULL) {error("Failed to allocate memory for log message.");}
+        va_list copy;
+        va_copy(copy, args);
+        int len = vswprintf(buffer, size, format, copy);
+        va_end(copy);
+        if (len >= 0 && (size_t)len < size) {return buffer;}
+        free(buffer);
+        /* vswprintf does not report the needed size, keep doubling */
+        size *= 2;
+        if (size > 1 << 24) {error("Error formatting log message.");}
+    }
+}
+
 /*
  * Prints a message to the standard output stream, with verbosity control.
  * The message will only be printed if the current output mode meets or
  * exceeds the required verbosity level specified by 'required_level'.
+ * The message is formatted on the calling thread and handed to the logger,
+ * which writes it out asynchronously.
  *
  * Parameters:
  *   required_level: The minimum verbosity level required to print the message.
@@ -46,10 +79,9 @@ void log_print(char required_level, const wchar_t *format, ...) {
     {
         va_list args;
         va_start(args, format);
-        vwprintf(format, args);
+        wchar_t *message = format_message(format, args);
         va_end(args);
-        /* force the message to be printed immediately */
-        fflush(stdout);
+        log_write(message);
     }
 }
 
@@ -85,10 +117,33 @@ void log_print_centered(char required_level, const wchar_t *format, ...) {
         int padding = (80 - len) / 2;
         if(padding < 0) {error("Error finding padding for centered message.");}
 
-        wprintf(L"%*s%ls\n", padding, "", buffer);
+        log_print(required_level, L"%*s%ls\n", padding, "", buffer);
+    }
+}
 
-        /* force the message to be printed immediately */
-        fflush(stdout);
+/*
+ * Prints a progress line, rate limited to the logger's refresh rate so
+ * optimizer threads can report as often as they like without flooding the
+ * output. Updates that arrive too soon after the previous one are dropped.
+ *
+ * Parameters:
+ *   required_level: The minimum verbosity level required to print the message.
+ *   format:         The format string for the message.
+ *   ...:            Variable arguments for the format string.
+ */
+void log_progress(char required_level, const wchar_t *format, ...) {
+    if (
+        (required_level == 'q' && (output_mode == 'q' || output_mode == 'n' || output_mode == 'v')) ||
+        (required_level == 'n' && (output_mode == 'n' || output_mode == 'v')) ||
+        (required_level == 'v' &&  output_mode == 'v')
+       )
+    {
+        if (!log_progress_due()) {return;}
+        va_list args;
+        va_start(args, format);
+        wchar_t *message = format_message(format, args);
+        va_end(args);
+        log_write(message);
     }
 }
 
@@ -200,9 +255,75 @@ void read_config()
     }
     backend_mode = check_backend_mode(buff); /* io_util.c */
 
+    /* Optional settings may follow in any order. */
+    while (fscanf(config, "%s %s", discard, buff) == 2) {
+        if (strcmp(discard, "geometry=") == 0) {
+            free(geometry_name);
+            geometry_name = (char *)malloc((sizeof(char) * strlen(buff)) + 1);
+            strcpy(geometry_name, buff);
+        } else if (strcmp(discard, "custom_stats=") == 0) {
+            free(custom_stats_name);
+            custom_stats_name = (char *)malloc((sizeof(char) * strlen(buff)) + 1);
+            strcpy(custom_stats_name, buff);
+        } else if (strcmp(discard, "format=") == 0) {
+            /* validate and convert record format */
+            format_mode = check_format_mode(buff); /* io_util.c */
+        } else if (strcmp(discard, "format_file=") == 0) {
+            free(format_file);
+            format_file = (char *)malloc((sizeof(char) * strlen(buff)) + 1);
+            strcpy(format_file, buff);
+        } else if (strcmp(discard, "corpus2=") == 0) {
+            free(corpus2_name);
+            corpus2_name = (char *)malloc((sizeof(char) * strlen(buff)) + 1);
+            strcpy(corpus2_name, buff);
+        } else if (strcmp(discard, "shards=") == 0) {
+            shard_count = atoi(buff);
+        } else if (strcmp(discard, "objective=") == 0) {
+            /* validate and convert shard objective */
+            shard_objective = check_objective_mode(buff); /* io_util.c */
+        } else if (strcmp(discard, "lambda=") == 0) {
+            shard_lambda = atof(buff);
+        } else if (strcmp(discard, "engine=") == 0) {
+            /* validate and convert search engine */
+            search_engine = check_engine_mode(buff); /* io_util.c */
+        } else if (strcmp(discard, "reserve=") == 0) {
+            reserve_rate = atoi(buff);
+        } else if (strcmp(discard, "reserve_penalty=") == 0) {
+            reserve_penalty = atof(buff);
+        } else if (strcmp(discard, "jobs=") == 0) {
+            free(jobs_name);
+            jobs_name = (char *)malloc((sizeof(char) * strlen(buff)) + 1);
+            strcpy(jobs_name, buff);
+        } else if (strcmp(discard, "quads=") == 0) {
+            /* validate and convert quadgram model */
+            quad_model = check_quad_mode(buff); /* io_util.c */
+        } else if (strcmp(discard, "quad_mass=") == 0) {
+            quad_mass = atof(buff);
+        } else if (strcmp(discard, "memory_budget=") == 0) {
+            memory_budget = atof(buff);
+        } else if (strcmp(discard, "subspace=") == 0) {
+            /* validate and convert permutation subspace */
+            subspace = check_subspace_mode(buff); /* io_util.c */
+        } else if (strcmp(discard, "guide=") == 0) {
+            guide_rate = atoi(buff);
+        } else if (strcmp(discard, "time_budget=") == 0) {
+            time_budget = atof(buff);
+        } else if (strcmp(discard, "objectives=") == 0) {
+            free(objective_list);
+            objective_list = (char *)malloc((sizeof(char) * strlen(buff)) + 1);
+            strcpy(objective_list, buff);
+        } else {
+            error("Unknown option in config file.");
+        }
+    }
+
     fclose(config);
 }
 
+/* 1 once -c or -w is given on the command line, the anytime benchmark warns. */
+int corpus_given = 0;
+int weights_given = 0;
+
 /*
  * Processes command line arguments to override configuration settings.
  * It parses arguments passed to the main function and updates
@@ -213,8 +334,29 @@ void read_config()
 void read_args(int argc, char **argv)
 {
     int opt;
+    /* Long forms of the record output options. */
+    struct option long_options[] = {
+        {"format", required_argument, NULL, 'f'},
+        {"format-file", required_argument, NULL, 'F'},
+        {"corpus2", required_argument, NULL, 'C'},
+        {"shards", required_argument, NULL, 'K'},
+        {"objective", required_argument, NULL, 'O'},
+        {"lambda", required_argument, NULL, 'L'},
+        {"engine", required_argument, NULL, 'E'},
+        {"reserve", required_argument, NULL, 'R'},
+        {"reserve-penalty", required_argument, NULL, 'P'},
+        {"jobs", required_argument, NULL, 'J'},
+        {"quads", required_argument, NULL, 'Q'},
+        {"quad-mass", required_argument, NULL, 'M'},
+        {"memory-budget", required_argument, NULL, 'B'},
+        {"subspace", required_argument, NULL, 'S'},
+        {"objectives", required_argument, NULL, 'Y'},
+        {"time-budget", required_argument, NULL, 'T'},
+        {"guide", required_argument, NULL, 'G'},
+        {NULL, 0, NULL, 0}
+    };
     /* Parse command line arguments. */
-    while ((opt = getopt(argc, argv, "l:c:1:2:w:r:t:m:o:b:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "l:c:C:1:2:w:g:s:r:t:k:m:o:b:f:F:K:O:L:R:P:E:J:Q:M:B:S:Y:T:G:", long_options, NULL)) != -1) {
     switch (opt) {
         case 'l':
             free(lang_name);
@@ -223,6 +365,11 @@ void read_args(int argc, char **argv)
         case 'c':
             free(corpus_name);
             corpus_name = strdup(optarg);
+            corpus_given = 1;
+            break;
+        case 'C':
+            free(corpus2_name);
+            corpus2_name = strdup(optarg);
             break;
         case '1':
             free(layout_name);
@@ -235,6 +382,15 @@ void read_args(int argc, char **argv)
         case 'w':
             free(weight_name);
             weight_name = strdup(optarg);
+            weights_given = 1;
+            break;
+        case 'g':
+            free(geometry_name);
+            geometry_name = strdup(optarg);
+            break;
+        case 's':
+            free(custom_stats_name);
+            custom_stats_name = strdup(optarg);
             break;
         case 'r':
             repetitions = atoi(optarg);
@@ -242,6 +398,9 @@ void read_args(int argc, char **argv)
         case 't':
             threads = atoi(optarg);
             break;
+        case 'k':
+            archive_top = atoi(optarg);
+            break;
         case 'm':
             /* validate and convert run mode */
             run_mode = check_run_mode(optarg); /* io_util.c */
@@ -254,14 +413,93 @@ void read_args(int argc, char **argv)
             /* validate and convert backend mode */
             backend_mode = check_backend_mode(optarg); /* io_util.c */
             break;
+        case 'f':
+            /* validate and convert record format */
+            format_mode = check_format_mode(optarg); /* io_util.c */
+            break;
+        case 'F':
+            free(format_file);
+            format_file = strdup(optarg);
+            break;
+        case 'K':
+            shard_count = atoi(optarg);
+            break;
+        case 'O':
+            /* validate and convert shard objective */
+            shard_objective = check_objective_mode(optarg); /* io_util.c */
+            break;
+        case 'L':
+            shard_lambda = atof(optarg);
+            break;
+        case 'E':
+            /* validate and convert search engine */
+            search_engine = check_engine_mode(optarg); /* io_util.c */
+            break;
+        case 'R':
+            reserve_rate = atoi(optarg);
+            break;
+        case 'P':
+            reserve_penalty = atof(optarg);
+            break;
+        case 'J':
+            free(jobs_name);
+            jobs_name = strdup(optarg);
+            break;
+        case 'Q':
+            /* validate and convert quadgram model */
+            quad_model = check_quad_mode(optarg); /* io_util.c */
+            break;
+        case 'M':
+            quad_mass = atof(optarg);
+            break;
+        case 'B':
+            memory_budget = atof(optarg);
+            break;
+        case 'S':
+            /* validate and convert permutation subspace */
+            subspace = check_subspace_mode(optarg); /* io_util.c */
+            break;
+        case 'Y':
+            free(objective_list);
+            objective_list = strdup(optarg);
+            break;
+        case 'T':
+            time_budget = atof(optarg);
+            break;
+        case 'G':
+            guide_rate = atoi(optarg);
+            break;
         case '?':
-            error("Improper Usage: %s -l lang_name -c corpus_name "
-                "-1 layout_name -2 layout2_name -w weight_name -r repetitions "
-                "-t threads -m run_mode -o output_mode -b backend_mode");
+            error("Improper Usage: %s -l lang_name -c corpus_name -C corpus2_name "
+                "-1 layout_name -2 layout2_name -w weight_name -g geometry_name "
+                "-s custom_stats_name -r repetitions "
+                "-t threads -k archive_top -m run_mode -o output_mode -b backend_mode "
+                "-f format -F format_file -K shards -O objective -L lambda "
+                "-R reserve_rate -P reserve_penalty -E engine -J jobs -Q quads "
+                "-M quad_mass -B memory_budget -S subspace "
+                "-Y objectives -T time_budget -G guide_rate");
         default:
             abort();
         }
     }
+
+    /* anything after the options is a document for the stream mode */
+    document_paths = argv + optind;
+    document_count = argc - optind;
+}
+
+/*
+ * Returns 1 if the selected run can use approximated quadgrams, 0 if it reads
+ * the dense quadgram table: shards, stream, and delta count quadgrams of their
+ * own, the opencl and lane backends of the optimizing modes read the table
+ * directly, and the anytime benchmark always runs the lane backend.
+ */
+int quads_approximable()
+{
+    if (shard_count > 1 || run_mode == 's' || run_mode == 'u') {return 0;}
+    if (run_mode == 'q') {return 0;}
+    return backend_mode == 'c' || (run_mode != 'g' && run_mode != 'i'
+        && run_mode != 'b' && run_mode != 'j');
 }
 
 /*
@@ -273,11 +511,16 @@ void check_setup()
     /* Ensure necessary parameters are set and have valid values. */
     if (lang_name == NULL) {error("no lang selected");}
     if (corpus_name == NULL) {error("no corpus selected");}
+    if (run_mode == 'u' && corpus2_name == NULL) {error("no second corpus selected, set -C");}
     if (layout_name == NULL) {error("no layout selected");}
     if (layout2_name == NULL) {error("no layout2 selected");}
     if (weight_name == NULL) {error("no weight selected");}
+    if (geometry_name == NULL) {geometry_name = strdup("default");}
     if (run_mode != 'a' && run_mode != 'c' && run_mode != 'r' && run_mode != 'g'
-        && run_mode != 'i' && run_mode != 'b' && run_mode != 'h' && run_mode != 'f')
+        && run_mode != 'i' && run_mode != 'b' && run_mode != 'h' && run_mode != 'f'
+        && run_mode != 'x' && run_mode != 'd' && run_mode != 'e' && run_mode != 'u'
+        && run_mode != 's' && run_mode != 'j' && run_mode != 'w' && run_mode != 'p'
+        && run_mode != 'm' && run_mode != 'q')
     {
         error("invalid run mode selected");
     }
@@ -285,12 +528,196 @@ void check_setup()
     {
         error("invalid output mode selected");
     }
-    if (backend_mode != 'c' && backend_mode != 'o')
+    if (backend_mode != 'c' && backend_mode != 'o' && backend_mode != 'v')
     {
         error("invalid backend mode selected");
     }
+    if (format_mode != 'h' && format_mode != 'j' && format_mode != 'c'
+        && format_mode != 't')
+    {
+        error("invalid format selected");
+    }
+    if (format_mode != 'h' && format_file == NULL)
+    {
+        if (format_mode == 'j') {format_file = strdup("gulag.json");}
+        else if (format_mode == 'c') {format_file = strdup("gulag.csv");}
+        else {format_file = strdup("gulag.tsv");}
+    }
     if (threads < 1) {error("invalid threads selected");}
+    if (archive_top < 1) {error("invalid archive top selected");}
+    if (shard_count < 1 || shard_count > SHARD_MAX) {error("invalid shard count selected");}
+    if (shard_objective != 'n' && shard_objective != 'w' && shard_objective != 'r')
+    {
+        error("invalid objective selected");
+    }
+    if ((shard_objective != 'n' || run_mode == 'e') && shard_count < 2)
+    {
+        error("shard evaluation needs at least 2 shards, set -K");
+    }
+    if (shard_lambda < 0) {error("invalid lambda selected");}
+    if (shard_objective != 'n' && backend_mode != 'c'
+        && (run_mode == 'g' || run_mode == 'i' || run_mode == 'j'))
+    {
+        error("shard objectives are only supported by the cpu backend");
+    }
+    if (search_engine != 'a' && search_engine != 'l' && search_engine != 't')
+    {
+        error("invalid engine selected");
+    }
+    if (search_engine != 'a' && backend_mode == 'o' && (run_mode == 'g' || run_mode == 'i'))
+    {
+        error("search engines are only supported by the cpu backends");
+    }
+    if (reserve_rate < 0 || reserve_rate > 100) {error("invalid reserve rate selected");}
+    if (reserve_penalty < 0) {error("invalid reserve penalty selected");}
+    if (reserve_rate > 0 && backend_mode != 'c'
+        && (run_mode == 'g' || run_mode == 'i' || run_mode == 'j'))
+    {
+        error("reserve swaps are only supported by the cpu backend");
+    }
+    if (guide_rate < 0 || guide_rate > 100) {error("invalid guide rate selected");}
+    if (guide_rate > 0 && backend_mode != 'c'
+        && (run_mode == 'g' || run_mode == 'i' || run_mode == 'j'))
+    {
+        error("guided swaps are only supported by the cpu backend");
+    }
     if (repetitions < threads) {error("invalid repetitions selected");}
+    if (run_mode == 'j' && jobs_name == NULL) {error("no job file selected, set -J");}
+    if (run_mode == 'j' && backend_mode == 'o') {error("jobs are only supported by the cpu backends");}
+    if (run_mode == 'j' && (format_mode == 'c' || format_mode == 't'))
+    {
+        error("job records need the json format, jobs may weight different stats");
+    }
+    if (quad_model != 'e' && quad_model != 'm' && quad_model != 'h')
+    {
+        error("invalid quadgram model selected");
+    }
+    if (quad_mass < 0 || quad_mass > 100) {error("invalid quadgram mass selected");}
+    if (memory_budget < 0) {error("invalid memory budget selected");}
+    if (subspace != 'h' && subspace != 'c' && subspace != 'r' && subspace != 'a')
+    {
+        error("invalid subspace selected");
+    }
+    if (run_mode == 'p' && shard_objective != 'n')
+    {
+        error("the permutation mode only scores the full corpus, unset -O");
+    }
+    if (run_mode == 'm' && objective_list == NULL) {error("no objectives selected, set -Y");}
+    if (run_mode == 'm' && backend_mode != 'c') {error("the front mode is only supported by the cpu backend");}
+    if (run_mode == 'm' && (shard_objective != 'n' || reserve_rate > 0))
+    {
+        error("the front mode does not support shard objectives or reserve swaps");
+    }
+    if (time_budget <= 0) {error("invalid time budget selected");}
+    if (run_mode == 'q' && backend_mode == 'o')
+    {
+        error("the anytime benchmark only compares the cpu backends");
+    }
+    if (run_mode == 'q' && (shard_count > 1 || shard_objective != 'n' || reserve_rate > 0))
+    {
+        error("the anytime benchmark does not support shards or reserve swaps");
+    }
+    if (run_mode == 'q')
+    {
+        /* the benchmark only compares on its own corpus and weights */
+        if (corpus_given || weights_given) {
+            log_print('n',L"ignoring %s, the anytime benchmark has its own corpus and weights... ",
+                corpus_given && weights_given ? "-c and -w" : corpus_given ? "-c" : "-w");
+        }
+        free(corpus_name);
+        corpus_name = strdup("synthetic");
+        free(weight_name);
+        weight_name = strdup("anytime");
+    }
+    if (quad_model != 'e' && !quads_approximable())
+    {
+        error("approximated quadgrams need the cpu backend, and are not supported with shards, stream, delta, or the anytime benchmark");
+    }
+}
+
+/*
+ * Reads the keyboard geometry file and fills the per position key tables used
+ * to build the stats. The file is a series of sections, each a name followed
+ * by a ROW by COL grid: 'hand:' (l, r, or - for no key) and 'finger:' (0-7
+ * from left pinky to right pinky) are required, 'row:' (logical row),
+ * 'stretch:' (1 or 0), 'x:' and 'y:' (physical coordinates) are optional.
+ * The coordinates are kept for distance based stats, none of which exist yet.
+ * Positions without a key are pinned so they are never filled.
+ */
+void read_geometry()
+{
+    FILE *geometry;
+    /* Construct the path to the geometry file. */
+    char *path = (char*)malloc(strlen("./data/geometry/.geo") + strlen(geometry_name) + 1);
+    strcpy(path, "./data/geometry/");
+    strcat(path, geometry_name);
+    strcat(path, ".geo");
+    geometry = fopen(path, "r");
+    free(path);
+    if (geometry == NULL) {
+        error("Geometry file not found.");
+    }
+    log_print('v',L"Geometry found... ");
+
+    /* Defaults for the optional sections. */
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            geo_hand[i][j] = 0;
+            geo_finger[i][j] = -2;
+            geo_row[i][j] = i;
+            geo_stretch[i][j] = 0;
+            geo_x[i][j] = j;
+            geo_y[i][j] = i;
+        }
+    }
+
+    log_print('v',L"Reading... ");
+    char section[100];
+    char buff[100];
+    while (fscanf(geometry, " %99s", section) == 1) {
+        for (int i = 0; i < ROW * COL; i++) {
+            if (fscanf(geometry, " %99s", buff) != 1) {
+                error("Geometry section does not match the layout grid.");
+            }
+            int r = i / COL;
+            int c = i % COL;
+            if (strcmp(section, "hand:") == 0) {
+                if (strcmp(buff, "l") != 0 && strcmp(buff, "r") != 0 && strcmp(buff, "-") != 0) {
+                    error("Geometry hand must be l, r, or -.");
+                }
+                geo_hand[r][c] = buff[0];
+            } else if (strcmp(section, "finger:") == 0) {
+                geo_finger[r][c] = atoi(buff);
+            } else if (strcmp(section, "row:") == 0) {
+                geo_row[r][c] = atoi(buff);
+            } else if (strcmp(section, "stretch:") == 0) {
+                geo_stretch[r][c] = atoi(buff);
+            } else if (strcmp(section, "x:") == 0) {
+                geo_x[r][c] = atof(buff);
+            } else if (strcmp(section, "y:") == 0) {
+                geo_y[r][c] = atof(buff);
+            } else {
+                error("Unknown section in geometry file.");
+            }
+        }
+    }
+    fclose(geometry);
+
+    /* Validate and pin positions without a key. */
+    log_print('v',L"Checking... ");
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            if (geo_hand[i][j] == 0 || geo_finger[i][j] == -2) {
+                error("Geometry file missing hand or finger section.");
+            }
+            if (geo_hand[i][j] == '-') {
+                geo_finger[i][j] = -1;
+                pins[i][j] = 1;
+            } else if (geo_finger[i][j] < 0) {
+                error("Geometry finger must not be negative.");
+            }
+        }
+    }
 }
 
 /*
@@ -453,6 +880,43 @@ int read_corpus_cache()
     return 1;
 }
 
+/*
+ * Counts every ngram ending at the newest character in the global corpus
+ * arrays.
+ *
+ * Parameters:
+ *   mem: The last 11 seen characters as language indices, newest first.
+ */
+void count_ngrams(int *mem)
+{
+    /* If character is valid in the language */
+    if (mem[0] > 0 && mem[0] < 51) {
+        corpus_mono[mem[0]]++;
+
+        /* If there is a previous character, record the bigram */
+        if (mem[1] > 0 && mem[1] < 51) {
+            corpus_bi[mem[1]][mem[0]]++;
+            /* If there are two, record the trigram */
+            if (mem[2] > 0 && mem[2] < 51) {
+                corpus_tri[mem[2]][mem[1]][mem[0]]++;
+                /* If there are three, record the quadgram */
+                if (mem[3] > 0 && mem[3] < 51) {
+                    corpus_quad[mem[3]][mem[2]][mem[1]][mem[0]]++;
+                }
+            }
+        }
+
+        /* Record skipgrams from skip-1 to skip-9 */
+        for (int i = 2; i < 11; i++)
+        {
+            if (mem[i] > 0 && mem[i] < 51)
+            {
+                corpus_skip[i-1][mem[i]][mem[0]]++;
+            }
+        }
+    }
+}
+
 /*
  * Reads and processes a corpus text file to collect ngram frequency data. Reads
  * the corpus character by character, updating the frequency counts in the
@@ -483,32 +947,7 @@ void read_corpus()
     while ((curr = fgetwc(corpus)) != WEOF) {
         /* convert characters based on the lang file */
         mem[0] = convert_char(curr); /* io_util.c */
-        /* If character is valid in the language */
-        if (mem[0] > 0 && mem[0] < 51) {
-            corpus_mono[mem[0]]++;
-
-            /* If there is a previous character, record the bigram */
-            if (mem[1] > 0 && mem[1] < 51) {
-                corpus_bi[mem[1]][mem[0]]++;
-                /* If there are two, record the trigram */
-                if (mem[2] > 0 && mem[2] < 51) {
-                    corpus_tri[mem[2]][mem[1]][mem[0]]++;
-                    /* If there are three, record the quadgram */
-                    if (mem[3] > 0 && mem[3] < 51) {
-                        corpus_quad[mem[3]][mem[2]][mem[1]][mem[0]]++;
-                    }
-                }
-            }
-
-            /* Record skipgrams from skip-1 to skip-9 */
-            for (int i = 2; i < 11; i++)
-            {
-                if (mem[i] > 0 && mem[i] < 51)
-                {
-                    corpus_skip[i-1][mem[i]][mem[0]]++;
-                }
-            }
-        }
+        count_ngrams(mem);
         /* shift over an array one index, dropping the last value */
         iterate(mem, 11); /* io_util.c */
     }
@@ -691,6 +1130,14 @@ void read_weights()
                 stats_meta[i].weight = weights[0];
             }
         }
+
+        for (int i = 0; i < FIVE_LENGTH; i++)
+        {
+            if (strcmp(stats_five[i].name, name_buffer) == 0)
+            {
+                stats_five[i].weight = weights[0];
+            }
+        }
     }
 
     fclose(weight_file);
@@ -748,6 +1195,29 @@ void read_layout(layout *lt, int which_layout)
     return;
 }
 
+/*
+ * Writes a layout to a file in the format read_layout() reads, a blank column
+ * between the hands.
+ * Parameters:
+ *   lt:   A pointer to the layout structure to be written.
+ *   path: The path of the file, replaced if it exists.
+ */
+void write_layout(layout *lt, char *path)
+{
+    FILE *layout_file = fopen(path, "w");
+    if (layout_file == NULL) {
+        error("Failed to write layout file.");
+    }
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            if (j > 0) {fwprintf(layout_file, j == COL / 2 ? L"  " : L" ");}
+            fwprintf(layout_file, L"%lc", convert_back(lt->matrix[i][j])); /* io_util.c */
+        }
+        fwprintf(layout_file, L"\n");
+    }
+    fclose(layout_file);
+}
+
 /*
  * Prints the layout name and score.
  * Parameters:
@@ -778,27 +1248,27 @@ void normal_print(layout *lt)
     log_print('n',L"\nMONOGRAM STATS\n");
     for (int i = 0; i < MONO_LENGTH; i++)
     {
-        if (!stats_mono[i].skip) {log_print('n',L"%s : %08.5f\%\n", stats_mono[i].name, lt->mono_score[i]);}
+        if (!stats_mono[i].skip && !stats_mono[i].hidden) {log_print('n',L"%s : %08.5f\%\n", stats_mono[i].name, lt->mono_score[i]);}
     }
     log_print('n',L"\nBIGRAM STATS\n");
     for (int i = 0; i < BI_LENGTH; i++)
     {
-        if (!stats_bi[i].skip) {log_print('n',L"%s : %08.5f\%\n", stats_bi[i].name, lt->bi_score[i]);}
+        if (!stats_bi[i].skip && !stats_bi[i].hidden) {log_print('n',L"%s : %08.5f\%\n", stats_bi[i].name, lt->bi_score[i]);}
     }
     log_print('n',L"\nTRIGRAM STATS\n");
     for (int i = 0; i < TRI_LENGTH; i++)
     {
-        if (!stats_tri[i].skip) {log_print('n',L"%s : %08.5f\%\n", stats_tri[i].name, lt->tri_score[i]);}
+        if (!stats_tri[i].skip && !stats_tri[i].hidden) {log_print('n',L"%s : %08.5f\%\n", stats_tri[i].name, lt->tri_score[i]);}
     }
     log_print('n',L"\nQUADGRAM STATS\n");
     for (int i = 0; i < QUAD_LENGTH; i++)
     {
-        if (!stats_quad[i].skip) {log_print('n',L"%s : %08.5f\%\n", stats_quad[i].name, lt->quad_score[i]);}
+        if (!stats_quad[i].skip && !stats_quad[i].hidden) {log_print('n',L"%s : %08.5f\%\n", stats_quad[i].name, lt->quad_score[i]);}
     }
     log_print('n',L"\nSKIPGRAM STATS\n");
     for (int i = 0; i < SKIP_LENGTH; i++)
     {
-        if (!stats_skip[i].skip)
+        if (!stats_skip[i].skip && !stats_skip[i].hidden)
         {
             log_print('n',L"%s :\n    |", stats_skip[i].name);
             for (int j = 1; j <= 9; j++)
@@ -814,6 +1284,14 @@ void normal_print(layout *lt)
     {
         if (!stats_meta[i].skip) {log_print('n',L"%s : %08.5f\%\n", stats_meta[i].name, lt->meta_score[i]);}
     }
+    if (count_five_stats() > 0) /* stats/five.c */
+    {
+        log_print('n',L"\nFIVEGRAM STATS\n");
+        for (int i = 0; i < FIVE_LENGTH; i++)
+        {
+            if (!stats_five[i].skip) {log_print('n',L"%s : %08.5f\%\n", stats_five[i].name, lt->five_score[i]);}
+        }
+    }
     log_print('n',L"\n");
 }
 
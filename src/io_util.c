@@ -112,6 +112,45 @@ char check_run_mode(char *optarg)
         || strcmp(optarg, "bench") == 0
         || strcmp(optarg, "benchmark") == 0) {
         return 'b';
+    } else if (strcmp(optarg, "d") == 0
+        || strcmp(optarg, "dist") == 0
+        || strcmp(optarg, "distribution") == 0) {
+        return 'd';
+    } else if (strcmp(optarg, "s") == 0
+        || strcmp(optarg, "stream") == 0) {
+        return 's';
+    } else if (strcmp(optarg, "u") == 0
+        || strcmp(optarg, "delta") == 0
+        || strcmp(optarg, "update") == 0) {
+        return 'u';
+    } else if (strcmp(optarg, "x") == 0
+        || strcmp(optarg, "archive") == 0) {
+        return 'x';
+    } else if (strcmp(optarg, "j") == 0
+        || strcmp(optarg, "jobs") == 0
+        || strcmp(optarg, "batch") == 0) {
+        return 'j';
+    } else if (strcmp(optarg, "w") == 0
+        || strcmp(optarg, "why") == 0
+        || strcmp(optarg, "explain") == 0) {
+        return 'w';
+    } else if (strcmp(optarg, "m") == 0
+        || strcmp(optarg, "multi") == 0
+        || strcmp(optarg, "pareto") == 0
+        || strcmp(optarg, "front") == 0) {
+        return 'm';
+    } else if (strcmp(optarg, "q") == 0
+        || strcmp(optarg, "quality") == 0
+        || strcmp(optarg, "anytime") == 0) {
+        return 'q';
+    } else if (strcmp(optarg, "p") == 0
+        || strcmp(optarg, "permute") == 0
+        || strcmp(optarg, "exhaustive") == 0) {
+        return 'p';
+    } else if (strcmp(optarg, "e") == 0
+        || strcmp(optarg, "shard") == 0
+        || strcmp(optarg, "robust") == 0) {
+        return 'e';
     } else if (strcmp(optarg, "h") == 0
         || strcmp(optarg, "help") == 0) {
         return 'h';
@@ -169,8 +208,131 @@ char check_backend_mode(char *optarg)
         || strcmp(optarg, "ocl") == 0
         || strcmp(optarg, "opencl") == 0) {
         return 'o';
+    } else if (strcmp(optarg, "v") == 0
+        || strcmp(optarg, "vec") == 0
+        || strcmp(optarg, "lanes") == 0) {
+        return 'v';
     } else {
         error("Invalid output mode in arguments.");
         return 'c';
     }
 }
+
+/*
+ * Validates and converts a record format string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the record format.
+ * Returns: The character representing the validated format, or 'h' if
+ *          invalid.
+ */
+char check_format_mode(char *optarg)
+{
+    if (strcmp(optarg, "h") == 0 || strcmp(optarg, "human") == 0
+        || strcmp(optarg, "text") == 0) {
+        return 'h';
+    } else if (strcmp(optarg, "j") == 0 || strcmp(optarg, "json") == 0) {
+        return 'j';
+    } else if (strcmp(optarg, "c") == 0 || strcmp(optarg, "csv") == 0) {
+        return 'c';
+    } else if (strcmp(optarg, "t") == 0 || strcmp(optarg, "tsv") == 0) {
+        return 't';
+    } else {
+        error("Invalid format in arguments.");
+        return 'h';
+    }
+}
+
+/*
+ * Validates and converts a shard objective string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the objective.
+ * Returns: The character representing the validated objective, or 'n' if
+ *          invalid.
+ */
+char check_objective_mode(char *optarg)
+{
+    if (strcmp(optarg, "n") == 0 || strcmp(optarg, "none") == 0
+        || strcmp(optarg, "corpus") == 0) {
+        return 'n';
+    } else if (strcmp(optarg, "w") == 0 || strcmp(optarg, "worst") == 0) {
+        return 'w';
+    } else if (strcmp(optarg, "r") == 0 || strcmp(optarg, "robust") == 0) {
+        return 'r';
+    } else {
+        error("Invalid objective in arguments.");
+        return 'n';
+    }
+}
+
+/*
+ * Validates and converts a search engine string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the engine.
+ * Returns: The character representing the validated engine, or 'a' if
+ *          invalid.
+ */
+char check_engine_mode(char *optarg)
+{
+    if (strcmp(optarg, "a") == 0 || strcmp(optarg, "anneal") == 0
+        || strcmp(optarg, "sa") == 0) {
+        return 'a';
+    } else if (strcmp(optarg, "l") == 0 || strcmp(optarg, "late") == 0
+        || strcmp(optarg, "lahc") == 0) {
+        return 'l';
+    } else if (strcmp(optarg, "t") == 0 || strcmp(optarg, "threshold") == 0
+        || strcmp(optarg, "ta") == 0) {
+        return 't';
+    } else {
+        error("Invalid engine in arguments.");
+        return 'a';
+    }
+}
+
+/*
+ * Validates and converts a quadgram model string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the quadgram model.
+ * Returns: The character representing the validated model, or 'e' if
+ *          invalid.
+ */
+char check_quad_mode(char *optarg)
+{
+    if (strcmp(optarg, "e") == 0 || strcmp(optarg, "exact") == 0) {
+        return 'e';
+    } else if (strcmp(optarg, "m") == 0 || strcmp(optarg, "markov") == 0) {
+        return 'm';
+    } else if (strcmp(optarg, "h") == 0 || strcmp(optarg, "hybrid") == 0) {
+        return 'h';
+    } else {
+        error("Invalid quadgram model in arguments.");
+        return 'e';
+    }
+}
+
+/*
+ * Validates and converts a permutation subspace string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the subspace.
+ * Returns: The character representing the validated subspace, or 'h' if
+ *          invalid.
+ */
+char check_subspace_mode(char *optarg)
+{
+    if (strcmp(optarg, "h") == 0 || strcmp(optarg, "hands") == 0) {
+        return 'h';
+    } else if (strcmp(optarg, "c") == 0 || strcmp(optarg, "columns") == 0) {
+        return 'c';
+    } else if (strcmp(optarg, "r") == 0 || strcmp(optarg, "rows") == 0) {
+        return 'r';
+    } else if (strcmp(optarg, "a") == 0 || strcmp(optarg, "all") == 0) {
+        return 'a';
+    } else {
+        error("Invalid subspace in arguments.");
+        return 'h';
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * jobs.c - Job files for the GULAG.
+ *
+ * A job file lists many improve and generate runs over the same language and
+ * corpus, so one process can load the corpus and build the stats once and
+ * run them all. This file only parses the jobs, the scheduling lives with the
+ * other run modes in mode.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jobs.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/*
+ * Parses the pins of a job. '-' copies the pins of config.conf, otherwise
+ * every character other than '/' is one position, '.' for free.
+ *
+ * Parameters:
+ *   text: The pins as written in the job file.
+ *   pins_out: Filled with 1 for pinned positions and 0 for free ones.
+ * Returns: 1 if the pins were valid, 0 otherwise.
+ */
+int parse_job_pins(const char *text, int pins_out[row][col])
+{
+    if (strcmp(text, "-") == 0)
+    {
+        memcpy(pins_out, pins, sizeof(int) * ROW * COL);
+        return 1;
+    }
+    int i = 0;
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        if (*c == '/') {continue;}
+        if (i == ROW * COL) {return 0;}
+        pins_out[i / COL][i % COL] = *c != '.';
+        i++;
+    }
+    return i == ROW * COL;
+}
+
+/*
+ * Reads the job file 'jobs_name' from data/jobs/. Each line holds a mode (g
+ * or i), a layout, a weights file, pins, and a budget, separated by spaces.
+ * Pins are ROW*COL characters, '.' for a free key and anything else for a
+ * pinned one, '/' may separate the rows, and '-' keeps the pins of
+ * config.conf. The budget is a number of repetitions, or seconds when it ends
+ * in 's'. Blank lines and lines starting with '#' are skipped.
+ *
+ * Parameters:
+ *   jobs: Set to the allocated array of jobs.
+ * Returns: The number of jobs read.
+ */
+int read_jobs(job **jobs)
+{
+    char *path = (char*)malloc(strlen("./data/jobs/.job") + strlen(jobs_name) + 1);
+    strcpy(path, "./data/jobs/");
+    strcat(path, jobs_name);
+    strcat(path, ".job");
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (file == NULL) {
+        error("Job file not found.");
+    }
+
+    int count = 0, capacity = 16;
+    *jobs = (job *)malloc(sizeof(job) * capacity);
+    char line[1024];
+    char mode[64], layout[256], weights[256], pin_text[256], budget[64];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char *start = line;
+        while (*start == ' ' || *start == '\t') {start++;}
+        if (*start == '#' || *start == '\n' || *start == '\0') {continue;}
+
+        if (sscanf(start, "%63s %255s %255s %255s %63s", mode, layout, weights,
+            pin_text, budget) != 5)
+        {
+            error("Job lines need a mode, layout, weights, pins, and budget.");
+        }
+
+        if (count == capacity)
+        {
+            capacity *= 2;
+            *jobs = (job *)realloc(*jobs, sizeof(job) * capacity);
+        }
+        job *j = &(*jobs)[count];
+
+        j->mode = check_run_mode(mode); /* io_util.c */
+        if (j->mode != 'g' && j->mode != 'i') {
+            error("Jobs can only generate or improve layouts.");
+        }
+        if (!parse_job_pins(pin_text, j->pins)) {
+            error("Job pins need one character per position.");
+        }
+
+        char *end;
+        j->repetitions = 0;
+        j->seconds = 0;
+        if (budget[strlen(budget) - 1] == 's')
+        {
+            j->seconds = strtof(budget, &end);
+            if (*end != 's' || j->seconds <= 0) {error("Invalid job time budget.");}
+        }
+        else
+        {
+            j->repetitions = strtol(budget, &end, 10);
+            if (*end != '\0' || j->repetitions < threads) {
+                error("Job repetitions must be at least the thread count.");
+            }
+        }
+
+        j->layout_name = strdup(layout);
+        j->weight_name = strdup(weights);
+        count++;
+    }
+    fclose(file);
+    return count;
+}
+
+/*
+ * Frees an array of jobs.
+ *
+ * Parameters:
+ *   jobs: The array from read_jobs().
+ *   count: The number of jobs in it.
+ */
+void free_jobs(job *jobs, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        free(jobs[i].layout_name);
+        free(jobs[i].weight_name);
+    }
+    free(jobs);
+}
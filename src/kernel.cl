@@ -8,8 +8,9 @@
 
 #include "include/structs.h"
 
-#define ROW 3
-#define COL 12
+/* grid dimensions come from structs.h, see LAYOUT_ROWS and LAYOUT_COLS */
+#define ROW row
+#define COL col
 #define DIM1 ROW * COL
 #define DIM2 DIM1 * DIM1
 #define DIM3 DIM2 * DIM1
@@ -267,7 +268,7 @@ inline void calculate_mono_stats(__local cl_layout *working,
                                  __constant float *linear_mono) {
     int row0, col0;
     for (int i = local_id; i < MONO_LENGTH; i += WORKERS) {
-        if(!stats_mono[i].skip)
+        if(!stats_mono[i].skip && !stats_mono[i].derived)
         {
             working->mono_score[i] = 0;
             int length = stats_mono[i].length;
@@ -298,7 +299,7 @@ inline void calculate_bi_stats(__local cl_layout *working,
                                __constant float *linear_bi) {
     int row0, col0, row1, col1;
     for (int i = local_id; i < BI_LENGTH; i += WORKERS) {
-        if(!stats_bi[i].skip)
+        if(!stats_bi[i].skip && !stats_bi[i].derived)
         {
             working->bi_score[i] = 0;
             int length = stats_bi[i].length;
@@ -332,7 +333,7 @@ inline void calculate_tri_stats(__local cl_layout *working,
                                 __constant float *linear_tri) {
     int row0, col0, row1, col1, row2, col2;
     for (int i = local_id; i < TRI_LENGTH; i += WORKERS) {
-        if(!stats_tri[i].skip)
+        if(!stats_tri[i].skip && !stats_tri[i].derived)
         {
             working->tri_score[i] = 0;
             int length = stats_tri[i].length;
@@ -369,7 +370,7 @@ inline void calculate_quad_stats(__local cl_layout *working,
                                  __constant float *linear_quad) {
     int row0, col0, row1, col1, row2, col2, row3, col3;
     for (int i = local_id; i < QUAD_LENGTH; i += WORKERS) {
-        if(!stats_quad[i].skip)
+        if(!stats_quad[i].skip && !stats_quad[i].derived)
         {
             working->quad_score[i] = 0;
             int length = stats_quad[i].length;
@@ -409,7 +410,7 @@ inline void calculate_skip_stats(__local cl_layout *working,
                                  __constant float *linear_skip) {
     int row0, col0, row1, col1;
     for (int i = local_id; i < SKIP_LENGTH; i += WORKERS) {
-        if(!stats_skip[i].skip)
+        if(!stats_skip[i].skip && !stats_skip[i].derived)
         {
             int length = stats_skip[i].length;
             for (int k = 1; k <= 9; k++) {
@@ -431,6 +432,66 @@ inline void calculate_skip_stats(__local cl_layout *working,
     }
 }
 
+/*
+ * Sums derived statistics from their children, which must already be
+ * calculated for the current layout.
+ * Parameters:
+ *   working: Pointer to the cl_layout being analyzed.
+ *   local_id: The local ID of the work item.
+ *   stats_mono, stats_bi, stats_tri, stats_quad, stats_skip: Constant pointers
+ *       to the arrays of stat structures.
+ */
+inline void calculate_derived_stats(__local cl_layout *working,
+                                    size_t local_id,
+                                    __constant mono_stat *stats_mono,
+                                    __constant bi_stat *stats_bi,
+                                    __constant tri_stat *stats_tri,
+                                    __constant quad_stat *stats_quad,
+                                    __constant skip_stat *stats_skip) {
+    for (int i = local_id; i < MONO_LENGTH; i += WORKERS) {
+        if (stats_mono[i].derived) {
+            working->mono_score[i] = 0;
+            for (int j = 0; j < stats_mono[i].child_count; j++) {
+                working->mono_score[i] += working->mono_score[stats_mono[i].children[j]];
+            }
+        }
+    }
+    for (int i = local_id; i < BI_LENGTH; i += WORKERS) {
+        if (stats_bi[i].derived) {
+            working->bi_score[i] = 0;
+            for (int j = 0; j < stats_bi[i].child_count; j++) {
+                working->bi_score[i] += working->bi_score[stats_bi[i].children[j]];
+            }
+        }
+    }
+    for (int i = local_id; i < TRI_LENGTH; i += WORKERS) {
+        if (stats_tri[i].derived) {
+            working->tri_score[i] = 0;
+            for (int j = 0; j < stats_tri[i].child_count; j++) {
+                working->tri_score[i] += working->tri_score[stats_tri[i].children[j]];
+            }
+        }
+    }
+    for (int i = local_id; i < QUAD_LENGTH; i += WORKERS) {
+        if (stats_quad[i].derived) {
+            working->quad_score[i] = 0;
+            for (int j = 0; j < stats_quad[i].child_count; j++) {
+                working->quad_score[i] += working->quad_score[stats_quad[i].children[j]];
+            }
+        }
+    }
+    for (int i = local_id; i < SKIP_LENGTH; i += WORKERS) {
+        if (stats_skip[i].derived) {
+            for (int k = 1; k <= 9; k++) {
+                working->skip_score[k][i] = 0;
+                for (int j = 0; j < stats_skip[i].child_count; j++) {
+                    working->skip_score[k][i] += working->skip_score[k][stats_skip[i].children[j]];
+                }
+            }
+        }
+    }
+}
+
 /*
  * Performs meta-analysis on a layout.
  * Parameters:
@@ -585,6 +646,8 @@ __kernel void improve_kernel(__constant float *linear_mono,
         calculate_quad_stats(&working, local_id, stats_quad, linear_quad);
         calculate_skip_stats(&working, local_id, stats_skip, linear_skip);
 
+        barrier(CLK_LOCAL_MEM_FENCE);
+        calculate_derived_stats(&working, local_id, stats_mono, stats_bi, stats_tri, stats_quad, stats_skip);
         barrier(CLK_LOCAL_MEM_FENCE);
         cl_meta_analysis(&working, local_id, stats_meta);
         barrier(CLK_LOCAL_MEM_FENCE);
@@ -0,0 +1,153 @@
+/*
+ * lanes.c - Lane parallel layout analysis for the GULAG.
+ *
+ * The cpu optimizer scores one layout at a time, spending most of its time
+ * unflattening position ngrams and chasing single table lookups. The lane
+ * backend runs LANE_COUNT annealing chains per thread in lockstep instead.
+ * Their matrices are copied into one lane major array, so the characters of
+ * every chain on a key sit next to each other, and each position ngram is
+ * unflattened once for all chains. The loop over the chains is branch free,
+ * empty keys are masked rather than skipped, which lets the compiler turn it
+ * into vector gathers from the frequency tables.
+ */
+
+#include <string.h>
+
+#include "lanes.h"
+#include "analyze.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/*
+ * Analyzes LANE_COUNT layouts in one walk over the stats. Each position
+ * ngram is unflattened once, then the keys of every layout are gathered from
+ * a lane major copy of their matrices and their frequencies summed side by
+ * side, so the inner loop over the lanes can be vectorized. Derived and meta
+ * stats and the scores are then calculated per layout.
+ *
+ * Parameters:
+ *   lts: The LANE_COUNT layouts to analyze and score.
+ */
+void lane_analyze(layout **lts)
+{
+    int L = LANG_LENGTH;
+    int D = DIM1;
+
+    /* keys[p * LANE_COUNT + l] is the character at position p of lane l */
+    int keys[D * LANE_COUNT];
+    for (int p = 0; p < D; p++)
+    {
+        for (int l = 0; l < LANE_COUNT; l++)
+        {
+            keys[p * LANE_COUNT + l] = lts[l]->matrix[p / COL][p % COL];
+        }
+    }
+
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if (stats_mono[i].skip || stats_mono[i].derived) {continue;}
+        float sums[LANE_COUNT] = {0};
+        for (int j = 0; j < stats_mono[i].length; j++)
+        {
+            int *k0 = &keys[stats_mono[i].ngrams[j] * LANE_COUNT];
+            for (int l = 0; l < LANE_COUNT; l++)
+            {
+                int a = k0[l];
+                sums[l] += a >= 0 ? linear_mono[a] : 0;
+            }
+        }
+        for (int l = 0; l < LANE_COUNT; l++) {lts[l]->mono_score[i] = sums[l];}
+    }
+
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        if (stats_bi[i].skip || stats_bi[i].derived) {continue;}
+        float sums[LANE_COUNT] = {0};
+        for (int j = 0; j < stats_bi[i].length; j++)
+        {
+            int n = stats_bi[i].ngrams[j];
+            int *k0 = &keys[n / D * LANE_COUNT];
+            int *k1 = &keys[n % D * LANE_COUNT];
+            for (int l = 0; l < LANE_COUNT; l++)
+            {
+                int a = k0[l], b = k1[l];
+                /* an empty key is -1, so any empty key makes the or negative */
+                sums[l] += (a | b) >= 0 ? linear_bi[a * L + b] : 0;
+            }
+        }
+        for (int l = 0; l < LANE_COUNT; l++) {lts[l]->bi_score[i] = sums[l];}
+    }
+
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        if (stats_tri[i].skip || stats_tri[i].derived) {continue;}
+        float sums[LANE_COUNT] = {0};
+        for (int j = 0; j < stats_tri[i].length; j++)
+        {
+            int n = stats_tri[i].ngrams[j];
+            int *k0 = &keys[n / (D * D) * LANE_COUNT];
+            int *k1 = &keys[n / D % D * LANE_COUNT];
+            int *k2 = &keys[n % D * LANE_COUNT];
+            for (int l = 0; l < LANE_COUNT; l++)
+            {
+                int a = k0[l], b = k1[l], c = k2[l];
+                sums[l] += (a | b | c) >= 0 ? linear_tri[(a * L + b) * L + c] : 0;
+            }
+        }
+        for (int l = 0; l < LANE_COUNT; l++) {lts[l]->tri_score[i] = sums[l];}
+    }
+
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        if (stats_quad[i].skip || stats_quad[i].derived) {continue;}
+        float sums[LANE_COUNT] = {0};
+        for (int j = 0; j < stats_quad[i].length; j++)
+        {
+            int n = stats_quad[i].ngrams[j];
+            int *k0 = &keys[n / (D * D * D) * LANE_COUNT];
+            int *k1 = &keys[n / (D * D) % D * LANE_COUNT];
+            int *k2 = &keys[n / D % D * LANE_COUNT];
+            int *k3 = &keys[n % D * LANE_COUNT];
+            for (int l = 0; l < LANE_COUNT; l++)
+            {
+                int a = k0[l], b = k1[l], c = k2[l], d = k3[l];
+                sums[l] += (a | b | c | d) >= 0 ? linear_quad[((a * L + b) * L + c) * L + d] : 0;
+            }
+        }
+        for (int l = 0; l < LANE_COUNT; l++) {lts[l]->quad_score[i] = sums[l];}
+    }
+
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if (stats_skip[i].skip || stats_skip[i].derived) {continue;}
+        float sums[10][LANE_COUNT];
+        memset(sums, 0, sizeof(sums));
+        for (int j = 0; j < stats_skip[i].length; j++)
+        {
+            int n = stats_skip[i].ngrams[j];
+            int *k0 = &keys[n / D * LANE_COUNT];
+            int *k1 = &keys[n % D * LANE_COUNT];
+            for (int k = 1; k <= 9; k++)
+            {
+                float *table = &linear_skip[k * L * L];
+                for (int l = 0; l < LANE_COUNT; l++)
+                {
+                    int a = k0[l], b = k1[l];
+                    sums[k][l] += (a | b) >= 0 ? table[a * L + b] : 0;
+                }
+            }
+        }
+        for (int k = 1; k <= 9; k++)
+        {
+            for (int l = 0; l < LANE_COUNT; l++) {lts[l]->skip_score[k][i] = sums[k][l];}
+        }
+    }
+
+    for (int l = 0; l < LANE_COUNT; l++)
+    {
+        derive_stats(lts[l]); /* analyze.c */
+        meta_analyze(lts[l]); /* analyze.c */
+        get_score(lts[l]); /* util.c */
+    }
+}
@@ -0,0 +1,246 @@
+/*
+ * logger.c - Asynchronous output for the GULAG.
+ *
+ * Formatting happens on the calling thread, but writing to stdout is left to
+ * a dedicated output thread so optimizer threads never block on a slow
+ * terminal or pipe. Messages are passed through a bounded lock-free queue
+ * (one sequence number per slot, any number of producers, one consumer). The
+ * output thread copies them into a large block buffer, which is written out
+ * when full or when the queue runs dry, so a printed layout costs one write
+ * instead of hundreds of flushes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "logger.h"
+#include "util.h"
+
+/* Number of queue slots, must be a power of two. */
+#define LOG_QUEUE_SIZE 4096
+/* Size of the block buffer in wide characters. */
+#define LOG_BLOCK_SIZE 16384
+/* Minimum time between progress updates in nanoseconds (10 per second). */
+#define LOG_PROGRESS_INTERVAL 100000000L
+/* How long the output thread sleeps when there is nothing to write. */
+#define LOG_IDLE_SLEEP 1000000L
+
+/* A queue slot, sequence tells producers and the consumer who owns it. */
+typedef struct log_slot {
+    atomic_size_t sequence;
+    wchar_t *text;
+} log_slot;
+
+log_slot log_queue[LOG_QUEUE_SIZE];
+atomic_size_t log_enqueue_pos;
+size_t log_dequeue_pos;
+
+/* Number of messages queued and written, used by log_flush(). */
+atomic_size_t log_pushed;
+atomic_size_t log_written;
+
+atomic_int log_running;
+atomic_int log_stopping;
+atomic_long log_last_progress;
+pthread_t log_thread;
+
+/* Returns the monotonic clock in nanoseconds. */
+long log_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/*
+ * Takes the next message off the queue.
+ * Returns: The message text, or NULL if the queue is empty.
+ */
+wchar_t *log_pop()
+{
+    log_slot *slot = &log_queue[log_dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != log_dequeue_pos + 1) {return NULL;}
+
+    wchar_t *text = slot->text;
+    /* hand the slot back to producers one lap later */
+    atomic_store_explicit(&slot->sequence, log_dequeue_pos + LOG_QUEUE_SIZE, memory_order_release);
+    log_dequeue_pos++;
+    return text;
+}
+
+/* Output thread, drains the queue into block sized writes. */
+void *log_thread_function(void *arg)
+{
+    wchar_t *block = (wchar_t *)malloc(sizeof(wchar_t) * (LOG_BLOCK_SIZE + 1));
+    if (block == NULL) {error("Failed to allocate memory for the logger.");}
+    size_t used = 0;
+    size_t pending = 0;
+
+    while (1)
+    {
+        wchar_t *text = log_pop();
+        if (text != NULL)
+        {
+            size_t length = wcslen(text);
+            /* write the block out before it would overflow */
+            if (used + length > LOG_BLOCK_SIZE && used > 0)
+            {
+                block[used] = L'\0';
+                fputws(block, stdout);
+                used = 0;
+            }
+            if (length > LOG_BLOCK_SIZE) {fputws(text, stdout);}
+            else
+            {
+                wmemcpy(block + used, text, length);
+                used += length;
+            }
+            free(text);
+            pending++;
+            continue;
+        }
+
+        /* queue is empty, write whatever we have */
+        if (used > 0)
+        {
+            block[used] = L'\0';
+            fputws(block, stdout);
+            used = 0;
+        }
+        if (pending > 0)
+        {
+            fflush(stdout);
+            atomic_fetch_add(&log_written, pending);
+            pending = 0;
+            continue;
+        }
+
+        if (atomic_load(&log_stopping)) {break;}
+        struct timespec idle = {0, LOG_IDLE_SLEEP};
+        nanosleep(&idle, NULL);
+    }
+
+    free(block);
+    return NULL;
+}
+
+/*
+ * Starts the output thread. Until this is called, and after log_stop(),
+ * messages are written directly to stdout.
+ */
+void log_start()
+{
+    for (size_t i = 0; i < LOG_QUEUE_SIZE; i++)
+    {
+        atomic_init(&log_queue[i].sequence, i);
+        log_queue[i].text = NULL;
+    }
+    atomic_init(&log_enqueue_pos, 0);
+    log_dequeue_pos = 0;
+    atomic_init(&log_pushed, 0);
+    atomic_init(&log_written, 0);
+    atomic_init(&log_stopping, 0);
+    atomic_init(&log_last_progress, 0);
+
+    if (pthread_create(&log_thread, NULL, log_thread_function, NULL) != 0)
+    {
+        error("Failed to start the logger thread.");
+    }
+    atomic_store(&log_running, 1);
+}
+
+/*
+ * Writes out every queued message, then stops and joins the output thread.
+ */
+void log_stop()
+{
+    if (!atomic_load(&log_running)) {return;}
+    log_flush();
+    atomic_store(&log_running, 0);
+    atomic_store(&log_stopping, 1);
+    pthread_join(log_thread, NULL);
+}
+
+/*
+ * Blocks until every message queued so far has been written and flushed.
+ * Does nothing if the output thread is not running.
+ */
+void log_flush()
+{
+    if (!atomic_load(&log_running)) {return;}
+    /* the output thread never flushes itself */
+    if (pthread_equal(pthread_self(), log_thread)) {return;}
+    size_t target = atomic_load(&log_pushed);
+    while (atomic_load(&log_written) < target)
+    {
+        struct timespec wait = {0, LOG_IDLE_SLEEP};
+        nanosleep(&wait, NULL);
+    }
+}
+
+/*
+ * Queues a formatted message for the output thread. Safe to call from any
+ * thread without locking; the queue takes ownership of the heap allocated
+ * text and frees it once written.
+ *
+ * Parameters:
+ *   text: A heap allocated, null terminated wide string.
+ */
+void log_write(wchar_t *text)
+{
+    if (!atomic_load(&log_running))
+    {
+        fputws(text, stdout);
+        fflush(stdout);
+        free(text);
+        return;
+    }
+
+    size_t pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+    log_slot *slot;
+    while (1)
+    {
+        slot = &log_queue[pos & (LOG_QUEUE_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == pos)
+        {
+            /* slot is free, try to claim it */
+            if (atomic_compare_exchange_weak_explicit(&log_enqueue_pos, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {break;}
+        }
+        else if (sequence < pos)
+        {
+            /* queue is full, let the output thread catch up */
+            sched_yield();
+            pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+        }
+        else
+        {
+            pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    slot->text = text;
+    atomic_fetch_add(&log_pushed, 1);
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+}
+
+/*
+ * Rate limits progress updates to a fixed refresh rate. Returns 1 if enough
+ * time has passed since the last update that the caller should print one,
+ * 0 otherwise.
+ */
+int log_progress_due()
+{
+    long now = log_now();
+    long last = atomic_load(&log_last_progress);
+    if (now - last < LOG_PROGRESS_INTERVAL) {return 0;}
+    /* only one caller wins each interval */
+    return atomic_compare_exchange_strong(&log_last_progress, &last, now);
+}
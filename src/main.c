@@ -6,11 +6,19 @@
 #include <time.h>
 
 #include "io.h"
+#include "logger.h"
 #include "global.h"
 #include "structs.h"
 #include "util.h"
 #include "mode.h"
 #include "stats.h"
+#include "shard.h"
+#include "five.h"
+#include "fivegram.h"
+#include "quadmodel.h"
+#include "ingest.h"
+#include "budget.h"
+#include "anytime.h"
 
 #define UNICODE_MAX 65535
 
@@ -19,7 +27,7 @@ void start_up()
 {
     /* Hide cursor. */
     log_print('n',L"1/3: Hiding cursor... ");
-    wprintf(L"\e[?25l");
+    log_print('q',L"\e[?25l");
 
     /* Seed random number generator. */
     log_print('n',L"Seeding RNG... ");
@@ -36,11 +44,12 @@ void start_up()
     log_print('n',L"Done\n\n");
 
     /* Allocate arrays for ngrams directly from corpus. */
+    /* the normalized tables are aligned for OpenCL devices to read in place */
     log_print('n',L"3/3: Allocating corpus arrays...\n");
     log_print('v',L"     Monograms... Integer... ");
     corpus_mono = (int *)calloc(LANG_LENGTH, sizeof(int));
     log_print('v',L"Floating Point... ");
-    linear_mono = (float *)calloc(LANG_LENGTH, sizeof(float));
+    linear_mono = (float *)alloc_aligned(LANG_LENGTH * sizeof(float));
     log_print('v',L"Done\n");
 
     log_print('v',L"     Bigrams... Integer... ");
@@ -49,7 +58,7 @@ void start_up()
         corpus_bi[i] = (int *)calloc(LANG_LENGTH, sizeof(int));
     }
     log_print('v',L"Floating Point... ");
-    linear_bi = (float *)calloc(LANG_LENGTH * LANG_LENGTH, sizeof(float));
+    linear_bi = (float *)alloc_aligned(LANG_LENGTH * LANG_LENGTH * sizeof(float));
     log_print('v',L"Done\n");
 
     log_print('v',L"     Trigrams... Integer... ");
@@ -61,7 +70,7 @@ void start_up()
         }
     }
     log_print('v',L"Floating Point... ");
-    linear_tri = (float *)calloc(LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, sizeof(float));
+    linear_tri = (float *)alloc_aligned(LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * sizeof(float));
     log_print('v',L"Done\n");
 
     log_print('v',L"     Quadgrams... Integer... ");
@@ -76,7 +85,7 @@ void start_up()
         }
     }
     log_print('v',L"Floating Point... ");
-    linear_quad = (float *)calloc(LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, sizeof(float));
+    linear_quad = (float *)alloc_aligned(LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * sizeof(float));
     log_print('v',L"Done\n");
 
     log_print('v',L"     Skipgrams...\n");
@@ -90,7 +99,7 @@ void start_up()
         log_print('v',L"Done\n");
     }
     log_print('v',L"       Floating Point... ");
-    linear_skip = (float *)calloc(10 * LANG_LENGTH * LANG_LENGTH, sizeof(float));
+    linear_skip = (float *)alloc_aligned(10 * LANG_LENGTH * LANG_LENGTH * sizeof(float));
     log_print('v',L"Done\n");
 
 
@@ -102,7 +111,7 @@ void shut_down()
 {
     /* Show cursor. */
     log_print('n',L"1/3: Showing cursor... ");
-    wprintf(L"\e[?25h");
+    log_print('q',L"\e[?25h");
 
     /* Free language array. */
     log_print('n',L"Freeing lang array... ");
@@ -140,17 +149,21 @@ void shut_down()
     log_print('v',L"Done\n");
 
     log_print('v',L"     Quadgrams... ");
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            for (int k = 0; k < LANG_LENGTH; k++) {
-                free(corpus_quad[i][j][k]);
+    /* already freed when the quadgrams were approximated */
+    if (corpus_quad != NULL) {
+        for (int i = 0; i < LANG_LENGTH; i++) {
+            for (int j = 0; j < LANG_LENGTH; j++) {
+                for (int k = 0; k < LANG_LENGTH; k++) {
+                    free(corpus_quad[i][j][k]);
+                }
+                free(corpus_quad[i][j]);
             }
-            free(corpus_quad[i][j]);
+            free(corpus_quad[i]);
         }
-        free(corpus_quad[i]);
+        free(corpus_quad);
     }
-    free(corpus_quad);
     free(linear_quad);
+    free_quad_model(); /* quadmodel.c */
     log_print('v',L"Done\n");
 
     log_print('v',L"     Skipgrams...\n");
@@ -165,6 +178,13 @@ void shut_down()
     free(corpus_skip);
     free(linear_skip);
     log_print('v',L"       Done\n");
+
+    log_print('v',L"     Shards... ");
+    free_shards(); /* shard.c */
+    log_print('v',L"Done\n");
+    log_print('v',L"     Five-grams... ");
+    free_fivegrams(); /* fivegram.c */
+    log_print('v',L"Done\n");
     log_print('n',L"     Done\n\n");
 
     /* frees all stats */
@@ -187,6 +207,8 @@ int main(int argc, char **argv) {
     if (fwide(stdout, 1) <= 0) {error("Failed to set wide-oriented stream.");}
     const char* locale = setlocale(LC_ALL, "en_US.UTF-8");
     if (locale == NULL) {error("Failed to set locale.");}
+    /* all output after this point goes through the logger thread */
+    log_start();
 
     log_print('q',L"\n");
     log_print_centered('q',L"Welcome to the");
@@ -250,13 +272,27 @@ int main(int argc, char **argv) {
      * Could allow for some purging/skipping? and proper verboseness */
     log_print('n',L"Language         :    %s\n", lang_name);
     log_print('n',L"Corpus File      :    %s\n", corpus_name);
+    if (corpus2_name != NULL) {log_print('n',L"Second Corpus    :    %s\n", corpus2_name);}
     log_print('n',L"Primary Layout   :    %s\n", layout_name);
     log_print('n',L"Secondary Layout :    %s\n", layout2_name);
     log_print('n',L"Weights File     :    %s\n", weight_name);
+    log_print('n',L"Geometry File    :    %s\n", geometry_name);
+    if (custom_stats_name != NULL) {log_print('n',L"Custom Stats     :    %s\n", custom_stats_name);}
     log_print('n',L"Run Mode         :    %c\n", run_mode);
     log_print('n',L"Repetitions      :    %d\n", repetitions);
     log_print('n',L"Threads          :    %d\n", threads);
     log_print('n',L"Output Mode      :    %c\n", output_mode);
+    if (format_mode != 'h') {log_print('n',L"Record Format    :    %c -> %s\n", format_mode, format_file);}
+    if (shard_count > 1) {log_print('n',L"Corpus Shards    :    %d\n", shard_count);}
+    if (shard_objective != 'n') {log_print('n',L"Objective        :    %c (lambda %g)\n", shard_objective, shard_lambda);}
+    if (run_mode == 'j') {log_print('n',L"Job File         :    %s\n", jobs_name);}
+    if (run_mode == 'p') {log_print('n',L"Subspace         :    %c\n", subspace);}
+    if (run_mode == 'm') {log_print('n',L"Objectives       :    %s\n", objective_list);}
+    if (run_mode == 'q') {log_print('n',L"Time Budget      :    %g seconds\n", time_budget);}
+    if (guide_rate > 0) {log_print('n',L"Guided Swaps     :    %d%%\n", guide_rate);}
+    if (memory_budget > 0) {log_print('n',L"Memory Budget    :    %g MB\n", memory_budget);}
+    if (quad_model == 'm') {log_print('n',L"Quadgram Model   :    %c\n", quad_model);}
+    if (quad_model == 'h') {log_print('n',L"Quadgram Model   :    %c (mass %g)\n", quad_model, quad_mass);}
 
     log_print('n',L"\n");
     print_bar('n');
@@ -273,7 +309,12 @@ int main(int argc, char **argv) {
     /* initializes and trims statistics */
 //log_print('q',L"----- Initializing Stats -----\n\n");
 
-    log_print('n',L"1/1: Building stats... ");
+    /* read key positions, fingers, and hands */
+    log_print('n',L"1/2: Reading geometry... ");
+    read_geometry(); /* io.c */
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"2/2: Building stats... ");
     initialize_stats(); /* stats.c */
     log_print('n',L"     Done\n\n");
 
@@ -303,14 +344,24 @@ int main(int argc, char **argv) {
     log_print('n',L"2/4: Reading corpus... ");
     log_print('v',L"Finding cache... ");
     int corpus_cache = 0;
-    corpus_cache = read_corpus_cache(); /* io.c */
+    if (run_mode == 'q') {
+        /* the anytime benchmark draws its own corpus, nothing is cached */
+        log_print('v',L"Drawing synthetic corpus... ");
+        synthetic_corpus(); /* anytime.c */
+        corpus_cache = 1;
+    } else {
+        corpus_cache = read_corpus_cache(); /* io.c */
+    }
     log_print('n',L"Done\n\n");
     if (!corpus_cache) {
         /* The next operation is slow so we want to let the user see
            what step they are stuck on. */
         /* read entire corpus file and fill arrays */
         log_print('n',L"     2.3/4: Reading raw corpus... ");
-        read_corpus(); /* io.c */
+        /* the opencl backend counts on the device, the cpu is the fallback */
+        if (backend_mode != 'o' || !cl_read_corpus()) { /* ingest.c */
+            read_corpus(); /* io.c */
+        }
         log_print('n',L"Done\n\n");
 
         /* create new corpus cache */
@@ -324,6 +375,27 @@ int main(int argc, char **argv) {
     normalize_corpus(); /* util.c */
     log_print('n',L"Done\n\n");
 
+    if (memory_budget > 0) {
+        /* the budget overrides the quadgram model of the options */
+        log_print('n',L"     3.2/4: Fitting memory budget... ");
+        fit_memory_budget(); /* budget.c */
+        log_print('n',L"Done\n\n");
+    }
+
+    if (quad_model != 'e') {
+        /* replace the dense quadgram tables with the approximation */
+        log_print('n',L"     3.3/4: Building quadgram model... ");
+        build_quad_model(); /* quadmodel.c */
+        log_print('n',L"Done\n\n");
+    }
+
+    if (shard_count > 1) {
+        /* split the corpus text and normalize each shard on its own */
+        log_print('n',L"     3.5/4: Reading %d corpus shards... ", shard_count);
+        read_shards(); /* shard.c */
+        log_print('n',L"Done\n\n");
+    }
+
     /* read weights and fill in stats*/
     log_print('n',L"4/4: Reading stat weights... ");
     read_weights(); /* io.c */
@@ -348,10 +420,15 @@ int main(int argc, char **argv) {
 //log_print('q',L"----- Cleaning Up -----\n\n");
 
     /* remove stats with 0 length or weight */
-    log_print('n',L"1/1: Removing irrelevant stats... ");
+    log_print('n',L"1/2: Removing irrelevant stats... ");
     clean_stats(); /* stats.c */
     log_print('n',L"     Done\n\n");
 
+    /* five-grams are only read when a five-gram stat is in use */
+    log_print('n',L"2/2: Reading five-grams... ");
+    if (count_five_stats() > 0) {read_fivegrams();} /* stats/five.c, fivegram.c */
+    log_print('n',L"Done\n\n");
+
     clock_gettime(CLOCK_MONOTONIC, &end);
     elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 //log_print('q',L"----- Clean Up Complete : %.9lf seconds -----\n\n", elapsed);
@@ -407,6 +484,12 @@ int main(int argc, char **argv) {
     {
         log_print('v',L"%s : % 5.4f\n", stats_meta[i].name, stats_meta[i].weight);
     }
+
+    log_print('v',L"\nFIVEGRAM:\n\n");
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        log_print('v',L"%s : % 5.4f\n", stats_five[i].name, stats_five[i].weight);
+    }
     log_print('v',L"\n");
 
 //log_print('v',L"----- Weights Complete -----\n\n");
@@ -443,9 +526,69 @@ int main(int argc, char **argv) {
             rank();
             log_print('n',L"\nDone\n\n");
             break;
+        case 'd':
+            /* sample the score distribution of random layouts */
+            log_print('n',L"Running distribution sampling\n\n");
+            distribution();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'e':
+            /* score layouts against every corpus shard */
+            log_print('n',L"Running shard evaluation\n\n");
+            robustness();
+            log_print('n',L"Done\n\n");
+            break;
+        case 's':
+            /* score documents by streaming them */
+            log_print('n',L"Running stream scoring\n\n");
+            stream();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'u':
+            /* rank changes between two corpora */
+            log_print('n',L"Running corpus delta\n\n");
+            delta();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'j':
+            /* run every job of a job file */
+            log_print('n',L"Running jobs\n\n");
+            jobs();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'w':
+            /* attribute each stat to the ngrams behind it */
+            log_print('n',L"Running explanation\n\n");
+            explain();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'p':
+            /* enumerate whole row and column permutations */
+            log_print('n',L"Running permutation search\n\n");
+            permute();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'm':
+            /* search for the pareto front of several objectives */
+            log_print('n',L"Running front search\n\n");
+            pareto();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'q':
+            /* compare the engines by the quality they reach in time */
+            log_print('n',L"Running anytime benchmark\n\n");
+            anytime();
+            log_print('n',L"Done\n\n");
+            break;
+        case 'x':
+            /* query the layout archive */
+            log_print('n',L"Running archive query\n\n");
+            archive();
+            log_print('n',L"Done\n\n");
+            break;
         case 'g':
             /* generate a new layout */
-            if (backend_mode == 'c') {
+            if (backend_mode == 'c' || backend_mode == 'v') {
                 log_print('n',L"Running cpu generation\n\n");
                 generate();
                 log_print('n',L"Done\n\n");
@@ -457,7 +600,7 @@ int main(int argc, char **argv) {
             break;
         case 'i':
             /* improve a layout */
-            if (backend_mode == 'c') {
+            if (backend_mode == 'c' || backend_mode == 'v') {
                 log_print('n',L"Running cpu optimization\n\n");
                 improve(0);
                 log_print('n',L"Done\n\n");
@@ -469,7 +612,7 @@ int main(int argc, char **argv) {
             break;
         case 'b':
             /* benchmark to find ideal number of threads */
-            if (backend_mode == 'c') {
+            if (backend_mode == 'c' || backend_mode == 'v') {
                 log_print('n',L"Running cpu benchmark\n\n");
                 gen_benchmark();
                 log_print('n',L"Done\n\n");
@@ -512,6 +655,7 @@ int main(int argc, char **argv) {
 
     free(lang_name);
     free(corpus_name);
+    free(corpus2_name);
     free(layout_name);
     free(layout2_name);
     free(weight_name);
@@ -537,5 +681,6 @@ int main(int argc, char **argv) {
     log_print('n',L"Layouts per second w/ startup and shutdown: %lf\n\n", layouts_analyzed / elapsed_total);
     log_print_centered('q',L"You are free to go.");
     log_print('q',L"\n");
+    log_stop();
     return 0;
 }
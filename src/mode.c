@@ -15,6 +15,8 @@
 #include <math.h>
 #include <unistd.h>
 #include <time.h>
+#include <limits.h>
+#include <stdint.h>
 
 #include <CL/cl.h>
 
@@ -23,7 +25,24 @@
 #include "util.h"
 #include "io_util.h"
 #include "io.h"
+#include "record.h"
+#include "archive.h"
 #include "analyze.h"
+#include "shard.h"
+#include "lanes.h"
+#include "engine.h"
+#include "delta.h"
+#include "stat_map.h"
+#include "stream.h"
+#include "five.h"
+#include "fivegram.h"
+#include "jobs.h"
+#include "explain.h"
+#include "permute.h"
+#include "pareto.h"
+#include "anytime.h"
+#include "blame.h"
+#include "stats.h"
 #include "global.h"
 #include "structs.h"
 
@@ -63,6 +82,10 @@ void analysis() {
     /* prints the contents of a layout structure to the standard output */
     log_print('n',L"5/6: Printing Output...\n\n");
     print_layout(lt); /* io.c */
+    /* writes the machine readable record if a format was selected */
+    record_open(); /* record.c */
+    record_layout(lt); /* record.c */
+    record_close(); /* record.c */
     log_print('n',L"Done\n\n");
 
     /* frees the memory occupied by a layout data structure */
@@ -75,6 +98,181 @@ void analysis() {
     return;
 }
 
+/*
+ * Analyzes the primary layout, prints it, then lists for each stat the
+ * archive_top ngrams of the corpus that contribute most to it.
+ */
+void explain() {
+    /* Work for timing total/real layouts/second */
+    layouts_analyzed = 1;
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    layout *lt;
+    log_print('n',L"1/4: Reading layout... ");
+    alloc_layout(&lt); /* util.c */
+    read_layout(lt, 1); /* io.c */
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"2/4: Analyzing layout... ");
+    single_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"3/4: Printing Output...\n\n");
+    print_layout(lt); /* io.c */
+    log_print('q',L"Top %d ngrams behind each stat:\n", archive_top);
+    explain_layout(lt); /* explain.c */
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"4/4: Freeing layout... ");
+    free_layout(lt); /* util.c */
+    log_print('n',L"Done\n\n");
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
+/*
+ * Scores every arrangement of the whole rows or columns of the primary layout
+ * selected by the subspace setting, leaving pins alone, and prints the best.
+ * Every thread's best is archived.
+ */
+void permute() {
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    /* prints the current pins */
+    log_print('v',L"Pins: \n");
+    print_pins(); /* io.c */
+    log_print('v',L"\n");
+
+    layout *lt;
+    log_print('n',L"1/5: Reading layout... ");
+    alloc_layout(&lt); /* util.c */
+    read_layout(lt, 1); /* io.c */
+    single_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+    log_print('n',L"Done\n\n");
+    print_layout(lt); /* io.c */
+    log_print('n',L"\n");
+
+    log_print('n',L"2/5: Indexing subspace... ");
+    double total = setup_subspace(); /* permute.c */
+    log_print('n',L"Done\n\n");
+
+    /* Ctrl-C stops the threads early instead of discarding their work */
+    log_print('n',L"3/5: Enumerating arrangements... ");
+    layout **best_layouts = (layout **)malloc(threads * sizeof(layout *));
+    atomic_store(&stop_requested, 0);
+    catch_signals(); /* util.c */
+    double evaluated = search_subspace(lt, best_layouts); /* permute.c */
+    release_signals(); /* util.c */
+    layouts_analyzed = evaluated;
+    if (atomic_load(&stop_requested)) {
+        log_print('q',L"Interrupted after %.0f of %.0f arrangements, the best so far is not the "
+            "exact optimum.\n", evaluated, total);
+    }
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"4/5: Printing best layout...\n\n");
+    layout *best_layout = best_layouts[0];
+    for (int i = 1; i < threads; i++) {
+        if (best_layouts[i]->score > best_layout->score) {best_layout = best_layouts[i];}
+    }
+    print_layout(best_layout); /* io.c */
+    log_print('q',L"Best of %.0f arrangements, %f over the starting layout\n\n", evaluated,
+        best_layout->score - lt->score);
+    int archived = archive_layouts(best_layouts, threads); /* archive.c */
+    log_print('n',L"Archived %d new layout%s\n\n", archived, archived == 1 ? "" : "s");
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"5/5: Freeing layouts... ");
+    for (int i = 0; i < threads; i++) {free_layout(best_layouts[i]);} /* util.c */
+    free(best_layouts);
+    free_layout(lt); /* util.c */
+    free_subspace(); /* permute.c */
+    log_print('n',L"Done\n\n");
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
+/*
+ * Searches from the primary layout for the Pareto front of the objectives
+ * named by objective_list, then prints the front, writes it as a bundle of
+ * layout files, and archives it.
+ */
+void pareto() {
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    /* prints the current pins */
+    log_print('v',L"Pins: \n");
+    print_pins(); /* io.c */
+    log_print('v',L"\n");
+
+    layout *lt;
+    log_print('n',L"1/5: Reading layout... ");
+    alloc_layout(&lt); /* util.c */
+    read_layout(lt, 1); /* io.c */
+    /* objectives may bring unweighted stats back into the analysis */
+    int count = parse_objectives(); /* pareto.c */
+    single_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+    log_print('n',L"%d objectives... Done\n\n", count);
+    float start_values[OBJECTIVE_MAX];
+    objective_values(lt, start_values); /* pareto.c */
+    quiet_print(lt); /* io.c */
+    print_objectives(start_values); /* pareto.c */
+    log_print('q',L"\n");
+
+    /* Ctrl-C stops the threads early, the front so far is kept */
+    log_print('n',L"2/5: Searching for the front... ");
+    atomic_store(&stop_requested, 0);
+    catch_signals(); /* util.c */
+    layouts_analyzed = pareto_search(lt, repetitions / threads); /* pareto.c */
+    release_signals(); /* util.c */
+    if (atomic_load(&stop_requested)) {
+        log_print('q',L"Interrupted, continuing with the front so far.\n");
+    }
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"3/5: Collecting front... ");
+    layout *front_layouts[FRONT_CAPACITY];
+    float values[FRONT_CAPACITY * OBJECTIVE_MAX];
+    int size = collect_front(front_layouts, values); /* pareto.c */
+    log_print('n',L"%d layouts... Done\n\n", size);
+
+    log_print('n',L"4/5: Printing front...\n\n");
+    record_open(); /* record.c */
+    for (int i = 0; i < size; i++) {
+        snprintf(front_layouts[i]->name, sizeof(front_layouts[i]->name), "%.50s front %02d",
+            layout_name, i);
+        quiet_print(front_layouts[i]); /* io.c */
+        print_objectives(&values[i * OBJECTIVE_MAX]); /* pareto.c */
+        log_print('q',L"\n");
+        record_layout(front_layouts[i]); /* record.c */
+    }
+    record_close(); /* record.c */
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"5/5: Writing front... ");
+    char *bundle = write_front(front_layouts, size); /* pareto.c */
+    log_print('n',L"Done\n\n");
+    log_print('q',L"Wrote %d layouts to %s\n", size, bundle);
+    int archived = archive_layouts(front_layouts, size); /* archive.c */
+    log_print('n',L"Archived %d new layout%s\n\n", archived, archived == 1 ? "" : "s");
+
+    free(bundle);
+    for (int i = 0; i < size; i++) {free_layout(front_layouts[i]);} /* util.c */
+    free_front(); /* pareto.c */
+    free_layout(lt); /* util.c */
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
 /*
  * Compares two layouts and outputs the difference. This function allocates
  * memory for three layouts, reads data for two layouts from files, performs
@@ -135,6 +333,12 @@ void compare() {
     /* print the diff layout */
     log_print('n',L"6/7: Printing Output...\n\n");
     print_layout(lt_diff);
+    /* writes records for both layouts and their difference */
+    record_open(); /* record.c */
+    record_layout(lt1); /* record.c */
+    record_layout(lt2); /* record.c */
+    record_layout(lt_diff); /* record.c */
+    record_close(); /* record.c */
     log_print('n',L"Done\n\n");
 
     /* free the memory */
@@ -173,6 +377,9 @@ void rank() {
     /* Free layout_name since it will be reallocated for each layout */
     free(layout_name);
 
+    /* records are streamed as each layout is scored */
+    record_open(); /* record.c */
+
     /* Iterate over each entry in the directory */
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
@@ -210,6 +417,7 @@ void rank() {
              */
             log_print('n',L"Ranking...");
             create_node(lt); /* util.c */
+            record_layout(lt); /* record.c */
 
             /* frees the memory occupied by a layout data structure */
             log_print('n',L"Freeing... ");
@@ -222,6 +430,7 @@ void rank() {
 
     /* print the ranked list of layouts */
     print_ranking(); /* io.c */
+    record_close(); /* record.c */
     log_print('q',L"Done\n\n");
 
     /* Reset layout_name to a safe state */
@@ -236,17 +445,736 @@ void rank() {
     elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
 }
 
+/* Shard scores of one layout, kept for sorting in the shard evaluation. */
+typedef struct shard_result {
+    char name[61];
+    float score;
+    float mean;
+    float sd;
+    float worst;
+    float objective;
+} shard_result;
+
+/* qsort comparator ordering shard results by descending objective. */
+int compare_shard_results(const void *a, const void *b) {
+    const shard_result *x = (const shard_result *)a;
+    const shard_result *y = (const shard_result *)b;
+    if (x->objective != y->objective) {return x->objective > y->objective ? -1 : 1;}
+    return 0;
+}
+
+/*
+ * Scores every layout in the language directory against each corpus shard
+ * and ranks them by the selected objective, the mean shard score if none is
+ * selected. Prints the full corpus score, the mean, standard deviation, and
+ * worst score over the shards, and the mean minus lambda deviations.
+ */
+void robustness() {
+    /* Work for timing total/real layouts/second */
+    layouts_analyzed = 0;
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    /* Construct the path to the layouts directory */
+    char *path = (char*)malloc(strlen("./data//layouts") + strlen(lang_name) + 1);
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/layouts");
+
+    /* Open the directory */
+    DIR *dir = opendir(path);
+    if (dir == NULL) {error("Error opening layouts directory");}
+
+    /* Free layout_name since it will be reallocated for each layout */
+    free(layout_name);
+
+    int count = 0, capacity = 0;
+    shard_result *results = NULL;
+    float scores[shard_count];
+    layout *lt;
+    alloc_layout(&lt); /* util.c */
+
+    /* Iterate over each entry in the directory */
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strstr(entry->d_name, ".glg") == NULL) {continue;}
+        /* Extract the layout name */
+        int len = strlen(entry->d_name);
+        char temp_name[len - 3];
+        strncpy(temp_name, entry->d_name, len - 4);
+        temp_name[len - 4] = '\0';
+        layout_name = temp_name;
+        log_print('n',L"%s: ", layout_name);
+
+        log_print('n',L"Reading... ");
+        read_layout(lt, 1); /* io.c */
+
+        if (count == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            results = (shard_result *)realloc(results, sizeof(shard_result) * capacity);
+            if (results == NULL) {error("Failed to allocate memory for shard results.");}
+        }
+        shard_result *result = &results[count++];
+
+        /* the full corpus score for reference */
+        log_print('n',L"Analyzing... ");
+        single_analyze(lt); /* analyze.c */
+        get_score(lt); /* util.c */
+        result->score = lt->score;
+
+        /* every shard in one pass over the stats */
+        log_print('n',L"Shards... ");
+        shard_analyze(lt, scores); /* shard.c */
+        shard_summary(scores, &result->mean, &result->sd, &result->worst); /* shard.c */
+        result->objective = shard_objective_value(scores); /* shard.c */
+        strcpy(result->name, lt->name);
+        log_print('n',L"Done\n");
+
+        log_print('v',L"    ");
+        for (int s = 0; s < shard_count; s++) {log_print('v',L" %9.4f", scores[s]);}
+        log_print('v',L"\n");
+        layouts_analyzed++;
+    }
+    log_print('n',L"\n");
+
+    qsort(results, count, sizeof(shard_result), compare_shard_results);
+    log_print('q',L"Ranked by %s over %d shards:\n", shard_objective == 'w' ? "worst shard"
+        : shard_objective == 'r' ? "mean minus lambda sd" : "mean shard score", shard_count);
+    log_print('q',L"%-25s %11s %11s %11s %11s %11s\n", "layout", "corpus", "mean", "sd",
+        "worst", "mean-l*sd");
+    for (int i = 0; i < count; i++) {
+        log_print('q',L"%-25s %11.4f %11.4f %11.4f %11.4f %11.4f\n", results[i].name,
+            results[i].score, results[i].mean, results[i].sd, results[i].worst,
+            results[i].mean - shard_lambda * results[i].sd);
+    }
+    log_print('q',L"\n");
+
+    /* Reset layout_name to a safe state */
+    layout_name = (char *)malloc(1);
+    closedir(dir);
+    free(path);
+    free(results);
+    free_layout(lt); /* util.c */
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
+/*
+ * Scores the primary layout on each document named after the options, or on
+ * standard input if there are none, by streaming the text once instead of
+ * building a corpus. Prints one line per document, and writes one record per
+ * document with every stat if a record format is selected.
+ */
+void stream() {
+    /* Work for timing total/real layouts/second */
+    layouts_analyzed = 0;
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    layout *lt, *doc_lt;
+    log_print('n',L"1/3: Reading layout... ");
+    alloc_layout(&lt); /* util.c */
+    alloc_layout(&doc_lt); /* util.c */
+    read_layout(lt, 1); /* io.c */
+    log_print('n',L"Done\n\n");
+
+    /* which stats each key combination counts towards */
+    log_print('n',L"2/3: Building stat maps... ");
+    int first[LANG_LENGTH];
+    int next[ROW * COL];
+    build_stat_maps(); /* stat_map.c */
+    map_positions(lt, first, next); /* stat_map.c */
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"3/3: Streaming documents...\n\n");
+    record_open(); /* record.c */
+    log_print('q',L"%s on:\n", lt->name);
+    log_print('q',L"%-40s %12s %11s\n", "document", "characters", "score");
+    int count = document_count > 0 ? document_count : 1;
+    for (int i = 0; i < count; i++) {
+        const char *doc_name = "stdin";
+        FILE *text = stdin;
+        if (document_count > 0) {
+            text = fopen(document_paths[i], "r");
+            if (text == NULL) {error("Failed to open a document for streaming.");}
+            const char *slash = strrchr(document_paths[i], '/');
+            doc_name = slash == NULL ? document_paths[i] : slash + 1;
+        }
+
+        copy(doc_lt, lt); /* util.c */
+        snprintf(doc_lt->name, sizeof(doc_lt->name), "%s", doc_name);
+        long chars = stream_document(text, doc_lt, first, next); /* stream.c */
+        if (text != stdin) {fclose(text);}
+
+        log_print('q',L"%-40s %12ld %11.4f\n", doc_lt->name, chars, doc_lt->score);
+        record_layout(doc_lt); /* record.c */
+        layouts_analyzed++;
+    }
+    log_print('q',L"\n");
+    record_close(); /* record.c */
+
+    free_stat_maps(); /* stat_map.c */
+    free_layout(doc_lt); /* util.c */
+    free_layout(lt); /* util.c */
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
+/* Scores of one layout on both corpora, kept for sorting in the delta mode. */
+typedef struct delta_result {
+    char name[61];
+    float before;
+    float after;
+    int rank_before;
+    int rank_after;
+} delta_result;
+
+/* qsort comparator ordering delta results by descending first corpus score. */
+int compare_delta_before(const void *a, const void *b) {
+    const delta_result *x = (const delta_result *)a;
+    const delta_result *y = (const delta_result *)b;
+    if (x->before != y->before) {return x->before > y->before ? -1 : 1;}
+    return 0;
+}
+
+/* qsort comparator ordering delta results by descending second corpus score. */
+int compare_delta_after(const void *a, const void *b) {
+    const delta_result *x = (const delta_result *)a;
+    const delta_result *y = (const delta_result *)b;
+    if (x->after != y->after) {return x->after > y->after ? -1 : 1;}
+    return 0;
+}
+
+/*
+ * qsort comparator ordering delta results by how far their rank moved, then
+ * by how far their score moved.
+ */
+int compare_delta_move(const void *a, const void *b) {
+    const delta_result *x = (const delta_result *)a;
+    const delta_result *y = (const delta_result *)b;
+    int move_x = abs(x->rank_after - x->rank_before);
+    int move_y = abs(y->rank_after - y->rank_before);
+    if (move_x != move_y) {return move_x > move_y ? -1 : 1;}
+    float diff_x = fabsf(x->after - x->before);
+    float diff_y = fabsf(y->after - y->before);
+    if (diff_x != diff_y) {return diff_x > diff_y ? -1 : 1;}
+    return 0;
+}
+
+/*
+ * Shows how every layout in the language directory moves between the current
+ * corpus and the second corpus. Each layout is analyzed once on the current
+ * corpus, then moved to the second one through the sparse difference of the
+ * two corpora. Prints the layouts ordered by how far their rank moved.
+ */
+void delta() {
+    /* Work for timing total/real layouts/second */
+    layouts_analyzed = 0;
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    log_print('n',L"1/3: Reading second corpus... ");
+    read_delta(); /* delta.c */
+    log_print('n',L"Done\n\n");
+
+    /* Construct the path to the layouts directory */
+    char *path = (char*)malloc(strlen("./data//layouts") + strlen(lang_name) + 1);
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/layouts");
+
+    /* Open the directory */
+    DIR *dir = opendir(path);
+    if (dir == NULL) {error("Error opening layouts directory");}
+
+    /* Free layout_name since it will be reallocated for each layout */
+    free(layout_name);
+
+    int count = 0, capacity = 0;
+    delta_result *results = NULL;
+    layout *lt;
+    alloc_layout(&lt); /* util.c */
+
+    log_print('n',L"2/3: Scoring layouts...\n");
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strstr(entry->d_name, ".glg") == NULL) {continue;}
+        /* Extract the layout name */
+        int len = strlen(entry->d_name);
+        char temp_name[len - 3];
+        strncpy(temp_name, entry->d_name, len - 4);
+        temp_name[len - 4] = '\0';
+        layout_name = temp_name;
+        log_print('n',L"%s: ", layout_name);
+
+        log_print('n',L"Reading... ");
+        read_layout(lt, 1); /* io.c */
+
+        if (count == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            results = (delta_result *)realloc(results, sizeof(delta_result) * capacity);
+            if (results == NULL) {error("Failed to allocate memory for delta results.");}
+        }
+        delta_result *result = &results[count++];
+        strcpy(result->name, lt->name);
+
+        log_print('n',L"Analyzing... ");
+        single_analyze(lt); /* analyze.c */
+        get_score(lt); /* util.c */
+        result->before = lt->score;
+
+        /* only the changed ngrams are visited */
+        log_print('n',L"Delta... ");
+        delta_analyze(lt); /* delta.c */
+        result->after = lt->score;
+        log_print('n',L"Done\n");
+        layouts_analyzed++;
+    }
+    log_print('n',L"Done\n\n");
+
+    /* rank on each corpus, then order by movement */
+    qsort(results, count, sizeof(delta_result), compare_delta_before);
+    for (int i = 0; i < count; i++) {results[i].rank_before = i + 1;}
+    qsort(results, count, sizeof(delta_result), compare_delta_after);
+    for (int i = 0; i < count; i++) {results[i].rank_after = i + 1;}
+    qsort(results, count, sizeof(delta_result), compare_delta_move);
+
+    log_print('n',L"3/3: Printing rank changes...\n\n");
+    log_print('q',L"From %s to %s:\n", corpus_name, corpus2_name);
+    log_print('q',L"%-25s %11s %11s %11s %6s %6s %6s\n", "layout", "before", "after",
+        "change", "rank", "to", "move");
+    for (int i = 0; i < count; i++) {
+        log_print('q',L"%-25s %11.4f %11.4f %+11.4f %6d %6d %+6d\n", results[i].name,
+            results[i].before, results[i].after, results[i].after - results[i].before,
+            results[i].rank_before, results[i].rank_after,
+            results[i].rank_before - results[i].rank_after);
+    }
+    log_print('q',L"\n");
+
+    /* Reset layout_name to a safe state */
+    layout_name = (char *)malloc(1);
+    closedir(dir);
+    free(path);
+    free(results);
+    free_layout(lt); /* util.c */
+    free_delta(); /* delta.c */
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
+/*
+ * Queries the layout archive of the language. Prints the best stored layouts
+ * of each configuration, then re-scores every distinct archived layout under
+ * the current corpus and weights and prints the best of them.
+ */
+void archive() {
+    /* Work for timing total/real layouts/second */
+    layouts_analyzed = 0;
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    archive_entry *entries;
+    log_print('n',L"1/4: Reading archive... ");
+    int count = read_archive(&entries); /* archive.c */
+    log_print('n',L"%d entries... Done\n\n", count);
+    if (count == 0) {
+        log_print('q',L"The archive for %s is empty, run generate or improve first.\n\n", lang_name);
+        return;
+    }
+
+    /* stored scores are only comparable within a configuration */
+    log_print('n',L"2/4: Listing stored layouts...\n\n");
+    unsigned long long current = hash_config(); /* archive.c */
+    qsort(entries, count, sizeof(archive_entry), compare_archive_config); /* archive.c */
+    for (int i = 0; i < count;) {
+        int end = i;
+        while (end < count && entries[end].config_hash == entries[i].config_hash) {end++;}
+        log_print('q',L"Configuration %016llx (%s, %s)%s : %d layout%s\n",
+            entries[i].config_hash, entries[i].corpus, entries[i].weights,
+            entries[i].config_hash == current ? " [current]" : "",
+            end - i, end - i == 1 ? "" : "s");
+        for (int k = i; k < end && k - i < archive_top; k++) {
+            print_archive_entry(k - i + 1, &entries[k]); /* archive.c */
+        }
+        log_print('q',L"\n");
+        i = end;
+    }
+
+    /* keep one entry per distinct layout */
+    qsort(entries, count, sizeof(archive_entry), compare_archive_layout); /* archive.c */
+    int unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (unique == 0 || entries[i].layout_hash != entries[unique - 1].layout_hash) {
+            entries[unique++] = entries[i];
+        }
+    }
+
+    log_print('n',L"3/4: Re-scoring %d distinct layouts... ", unique);
+    layout *lt;
+    alloc_layout(&lt); /* util.c */
+    for (int i = 0; i < unique; i++) {
+        memcpy(lt->matrix, entries[i].matrix, sizeof(lt->matrix));
+        single_analyze(lt); /* analyze.c */
+        get_score(lt); /* util.c */
+        entries[i].score = lt->score;
+        layouts_analyzed++;
+    }
+    log_print('n',L"Done\n\n");
+
+    log_print('q',L"Re-scored under the current configuration:\n");
+    qsort(entries, unique, sizeof(archive_entry), compare_archive_score); /* archive.c */
+    for (int i = 0; i < unique && i < archive_top; i++) {
+        print_archive_entry(i + 1, &entries[i]); /* archive.c */
+    }
+    log_print('q',L"\n");
+
+    /* print the best archived layout in full */
+    log_print('n',L"4/4: Printing best layout...\n\n");
+    memcpy(lt->matrix, entries[0].matrix, sizeof(lt->matrix));
+    snprintf(lt->name, sizeof(lt->name), "archived %016llx", entries[0].layout_hash);
+    single_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+    print_layout(lt); /* io.c */
+    log_print('n',L"Done\n\n");
+
+    free_layout(lt); /* util.c */
+    free(entries);
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
+/* Structure to hold data for each thread in the distribution sampling. */
+typedef struct sample_data {
+    layout *lt;
+    float *scores;
+    double *sum;
+    double *sum_sq;
+    int samples;
+    int thread_id;
+} sample_data;
+
+/* Returns the number of values collect_stat_values() writes per layout. */
+int stat_value_count() {
+    return MONO_LENGTH + BI_LENGTH + TRI_LENGTH + QUAD_LENGTH + SKIP_LENGTH * 9 + META_LENGTH
+        + FIVE_LENGTH;
+}
+
+/*
+ * Writes every stat value of an analyzed layout into a flat array, in the
+ * order monogram, bigram, trigram, quadgram, skipgram (9 distances each),
+ * meta, five-gram.
+ *
+ * Parameters:
+ *   lt: The analyzed layout.
+ *   values: An array of at least stat_value_count() entries.
+ */
+void collect_stat_values(layout *lt, double *values) {
+    int n = 0;
+    for (int i = 0; i < MONO_LENGTH; i++) {values[n++] = lt->mono_score[i];}
+    for (int i = 0; i < BI_LENGTH; i++) {values[n++] = lt->bi_score[i];}
+    for (int i = 0; i < TRI_LENGTH; i++) {values[n++] = lt->tri_score[i];}
+    for (int i = 0; i < QUAD_LENGTH; i++) {values[n++] = lt->quad_score[i];}
+    for (int i = 0; i < SKIP_LENGTH; i++) {
+        for (int j = 1; j <= 9; j++) {values[n++] = lt->skip_score[j][i];}
+    }
+    for (int i = 0; i < META_LENGTH; i++) {values[n++] = lt->meta_score[i];}
+    for (int i = 0; i < FIVE_LENGTH; i++) {values[n++] = lt->five_score[i];}
+}
+
+/*
+ * Function executed by each thread of the distribution mode. Scores random
+ * shuffles of the starting layout and accumulates the score of each sample
+ * and the sum and sum of squares of every stat.
+ *
+ * Parameters:
+ *   arg: A pointer to a sample_data structure.
+ */
+void *sample_thread(void *arg) {
+    sample_data *data = (sample_data *)arg;
+    int count = stat_value_count();
+    double *values = (double *)malloc(sizeof(double) * count);
+    layout *lt;
+    alloc_layout(&lt); /* util.c */
+    copy(lt, data->lt); /* util.c */
+
+    struct timespec start, current;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int s = 0; s < data->samples; s++) {
+        /* a fresh uniform permutation of the unpinned keys */
+        shuffle_layout(lt); /* util.c */
+        single_analyze(lt); /* analyze.c */
+        get_score(lt); /* util.c */
+        data->scores[s] = lt->score;
+
+        collect_stat_values(lt, values);
+        for (int i = 0; i < count; i++) {
+            data->sum[i] += values[i];
+            data->sum_sq[i] += values[i] * values[i];
+        }
+
+        if (data->thread_id == 0 && s % 100 == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &current);
+            double elapsed = (current.tv_sec - start.tv_sec) + (current.tv_nsec - start.tv_nsec) / 1e9;
+            log_progress('n', L"\r%3d%%  %8.0lf layouts/sec                 ",
+                (int)(100.0 * s / data->samples), s * threads / (elapsed > 0 ? elapsed : 1));
+        }
+    }
+    if (data->thread_id == 0) {log_print('n', L"\r100%%%40s\n", "");}
+
+    free_layout(lt); /* util.c */
+    free(values);
+    pthread_exit(NULL);
+}
+
+/* qsort comparator for floats in ascending order. */
+int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Returns the fraction of sorted sample scores strictly below a score, as a
+ * percentage.
+ */
+double score_percentile(float *sorted, int count, float score) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (sorted[mid] < score) {low = mid + 1;}
+        else {high = mid;}
+    }
+    return 100.0 * low / count;
+}
+
+/*
+ * Prints the mean and standard deviation of every active stat over the
+ * samples, and the z-score of a reference layout's value next to it.
+ *
+ * Parameters:
+ *   name: The stat name.
+ *   mean, sd: The sample mean and standard deviation.
+ *   value: The reference layout's value.
+ */
+void print_stat_distribution(const char *name, double mean, double sd, double value) {
+    double z = sd > 0 ? (value - mean) / sd : 0;
+    log_print('n', L"%-50s : %9.5f %9.5f  %9.5f %+7.2f\n", name, mean, sd, value, z);
+}
+
+/*
+ * Samples random layouts to describe the score distribution of the current
+ * configuration. Every thread scores random shuffles of the primary layout's
+ * keys, leaving the pinned positions alone. Prints score percentiles, the mean
+ * and standard deviation of every stat, and where the primary and secondary
+ * layouts fall in the distribution.
+ */
+void distribution() {
+    /* Work for timing total/real layouts/second */
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    layout *lt, *lt2;
+    log_print('n',L"1/5: Reading layouts... ");
+    alloc_layout(&lt); /* util.c */
+    alloc_layout(&lt2); /* util.c */
+    read_layout(lt, 1); /* io.c */
+    read_layout(lt2, 2); /* io.c */
+    single_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+    single_analyze(lt2); /* analyze.c */
+    get_score(lt2); /* util.c */
+    log_print('n',L"Done\n\n");
+
+    int samples = repetitions / threads;
+    int total = samples * threads;
+    int count = stat_value_count();
+    layouts_analyzed = total + 2;
+
+    log_print('n',L"2/5: Sampling %d random layouts... \n", total);
+    float *scores = (float *)malloc(sizeof(float) * total);
+    double *sum = (double *)calloc((size_t)count * threads, sizeof(double));
+    double *sum_sq = (double *)calloc((size_t)count * threads, sizeof(double));
+    sample_data *data = (sample_data *)malloc(sizeof(sample_data) * threads);
+    pthread_t *thread_ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    if (scores == NULL || sum == NULL || sum_sq == NULL || data == NULL || thread_ids == NULL) {
+        error("Failed to allocate memory for sampling.");
+    }
+    for (int i = 0; i < threads; i++) {
+        /* each thread owns its slice, nothing is shared while sampling */
+        data[i].lt = lt;
+        data[i].scores = scores + (size_t)i * samples;
+        data[i].sum = sum + (size_t)i * count;
+        data[i].sum_sq = sum_sq + (size_t)i * count;
+        data[i].samples = samples;
+        data[i].thread_id = i;
+        pthread_create(&thread_ids[i], NULL, sample_thread, (void *)&data[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(thread_ids[i], NULL);
+    }
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"3/5: Combining results... ");
+    for (int t = 1; t < threads; t++) {
+        for (int i = 0; i < count; i++) {
+            sum[i] += sum[(size_t)t * count + i];
+            sum_sq[i] += sum_sq[(size_t)t * count + i];
+        }
+    }
+    qsort(scores, total, sizeof(float), compare_floats);
+    double score_sum = 0, score_sum_sq = 0;
+    for (int i = 0; i < total; i++) {
+        score_sum += scores[i];
+        score_sum_sq += (double)scores[i] * scores[i];
+    }
+    double score_mean = score_sum / total;
+    double score_var = score_sum_sq / total - score_mean * score_mean;
+    log_print('n',L"Done\n\n");
+
+    log_print('q',L"4/5: Score distribution of %d random layouts\n\n", total);
+    log_print('q',L"mean : %f\n", score_mean);
+    log_print('q',L"sd   : %f\n", sqrt(score_var > 0 ? score_var : 0));
+    log_print('q',L"min  : %f\n", scores[0]);
+    double percentiles[] = {0.1, 1, 5, 10, 25, 50, 75, 90, 95, 99, 99.9};
+    for (int i = 0; i < (int)(sizeof(percentiles) / sizeof(double)); i++) {
+        int index = (int)(percentiles[i] / 100.0 * (total - 1) + 0.5);
+        log_print('q',L"p%-4.1f: %f\n", percentiles[i], scores[index]);
+    }
+    log_print('q',L"max  : %f\n\n", scores[total - 1]);
+    log_print('q',L"%s : %f, above %.4f%% of random layouts\n", lt->name, lt->score,
+        score_percentile(scores, total, lt->score));
+    log_print('q',L"%s : %f, above %.4f%% of random layouts\n\n", lt2->name, lt2->score,
+        score_percentile(scores, total, lt2->score));
+
+    /* per stat mean and standard deviation, with the primary layout's z-score */
+    log_print('n',L"5/5: Stat distribution (mean, sd, %s, z-score)\n", lt->name);
+    double *values = (double *)malloc(sizeof(double) * count);
+    collect_stat_values(lt, values);
+    char name[80];
+    int n = 0;
+    log_print('n',L"\nMONOGRAM STATS\n");
+    for (int i = 0; i < MONO_LENGTH; i++, n++) {
+        if (stats_mono[i].skip || stats_mono[i].hidden) {continue;}
+        double mean = sum[n] / total, var = sum_sq[n] / total - mean * mean;
+        print_stat_distribution(stats_mono[i].name, mean, sqrt(var > 0 ? var : 0), values[n]);
+    }
+    log_print('n',L"\nBIGRAM STATS\n");
+    for (int i = 0; i < BI_LENGTH; i++, n++) {
+        if (stats_bi[i].skip || stats_bi[i].hidden) {continue;}
+        double mean = sum[n] / total, var = sum_sq[n] / total - mean * mean;
+        print_stat_distribution(stats_bi[i].name, mean, sqrt(var > 0 ? var : 0), values[n]);
+    }
+    log_print('n',L"\nTRIGRAM STATS\n");
+    for (int i = 0; i < TRI_LENGTH; i++, n++) {
+        if (stats_tri[i].skip || stats_tri[i].hidden) {continue;}
+        double mean = sum[n] / total, var = sum_sq[n] / total - mean * mean;
+        print_stat_distribution(stats_tri[i].name, mean, sqrt(var > 0 ? var : 0), values[n]);
+    }
+    log_print('n',L"\nQUADGRAM STATS\n");
+    for (int i = 0; i < QUAD_LENGTH; i++, n++) {
+        if (stats_quad[i].skip || stats_quad[i].hidden) {continue;}
+        double mean = sum[n] / total, var = sum_sq[n] / total - mean * mean;
+        print_stat_distribution(stats_quad[i].name, mean, sqrt(var > 0 ? var : 0), values[n]);
+    }
+    log_print('n',L"\nSKIPGRAM STATS\n");
+    for (int i = 0; i < SKIP_LENGTH; i++) {
+        for (int j = 1; j <= 9; j++, n++) {
+            if (stats_skip[i].skip || stats_skip[i].hidden) {continue;}
+            double mean = sum[n] / total, var = sum_sq[n] / total - mean * mean;
+            snprintf(name, sizeof(name), "%s %d", stats_skip[i].name, j);
+            print_stat_distribution(name, mean, sqrt(var > 0 ? var : 0), values[n]);
+        }
+    }
+    log_print('n',L"\nMETA STATS\n");
+    for (int i = 0; i < META_LENGTH; i++, n++) {
+        if (stats_meta[i].skip) {continue;}
+        double mean = sum[n] / total, var = sum_sq[n] / total - mean * mean;
+        print_stat_distribution(stats_meta[i].name, mean, sqrt(var > 0 ? var : 0), values[n]);
+    }
+    if (count_five_stats() > 0) {log_print('n',L"\nFIVEGRAM STATS\n");} /* stats/five.c */
+    for (int i = 0; i < FIVE_LENGTH; i++, n++) {
+        if (stats_five[i].skip) {continue;}
+        double mean = sum[n] / total, var = sum_sq[n] / total - mean * mean;
+        print_stat_distribution(stats_five[i].name, mean, sqrt(var > 0 ? var : 0), values[n]);
+    }
+    log_print('n',L"\n");
+
+    free(values);
+    free(scores);
+    free(sum);
+    free(sum_sq);
+    free(data);
+    free(thread_ids);
+    free_layout(lt); /* util.c */
+    free_layout(lt2); /* util.c */
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
 /* Structure to hold data for each thread in the layout improvement process. */
 typedef struct thread_data {
     layout *lt;
     layout **best_lt;
     int iterations;
     int thread_id;
+    int completed;
+    /* positions the search may not move */
+    int (*pins)[col];
 } thread_data;
 
+/* Shared state for dumping the current best layout on SIGUSR1. */
+pthread_mutex_t dump_lock = PTHREAD_MUTEX_INITIALIZER;
+layout *dump_best;
+int dump_reports;
+int dump_active;
+
+/*
+ * Contributes a thread's layout to a requested dump, or takes a finishing
+ * thread out of the count. Once every running thread has reported, the best
+ * of their layouts is printed and the dump is reset.
+ *
+ * Parameters:
+ *   lt: The thread's current layout, unused when leaving.
+ *   leaving: 1 if the thread is finishing, 0 if it is reporting.
+ */
+void report_best(layout *lt, int leaving) {
+    pthread_mutex_lock(&dump_lock);
+    if (leaving) {
+        dump_active--;
+    } else {
+        if (lt->score > dump_best->score) {copy(dump_best, lt);} /* util.c */
+        dump_reports++;
+    }
+    if (dump_reports > 0 && dump_reports >= dump_active) {
+        log_print('q', L"\nCurrent best layout:\n\n");
+        print_layout(dump_best); /* io.c */
+        dump_best->score = -INFINITY;
+        dump_reports = 0;
+    }
+    pthread_mutex_unlock(&dump_lock);
+}
+
 /*
- * Function executed by each thread to improve a layout. It performs simulated
- * annealing to find a layout with a better score.
+ * Analyzes and scores a layout for the optimizer: under the selected
+ * objective, less the reserve penalty for the characters left off the layout
+ * when reserve swaps are on.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout to analyze.
+ */
+void search_analyze(layout *lt) {
+    objective_analyze(lt); /* shard.c */
+    if (reserve_rate > 0) {lt->score -= reserve_penalty * off_layout_mass(lt);} /* util.c */
+}
+
+/*
+ * Function executed by each thread to improve a layout. It runs the selected
+ * search engine, simulated annealing by default, to find a better layout.
  *
  * Parameters:
  *   arg: A pointer to a thread_data structure.
@@ -258,6 +1186,7 @@ void *thread_function(void *arg) {
     layout *lt = data->lt;
     int iterations = data->iterations;
     int thread_id = data->thread_id;
+    int (*pins)[col] = data->pins;
 
     /* Allocate max and working layouts */
     layout *max_lt, *working_lt;
@@ -271,37 +1200,59 @@ void *thread_function(void *arg) {
     /* Set name so we can see if we improved */
     strcat(working_lt->name, " improved");
 
-    /* analyze and score the initial layout */
-    single_analyze(working_lt); /* analyze.c */
-    /* calculate the overall score */
-    get_score(working_lt); /* util.c */
+    /* analyze and score the initial layout under the selected objective */
+    search_analyze(working_lt);
     /* copies the layout */
     copy(max_lt, working_lt); /* util.c */
 
-    /* Simulated annealing with enhancements */
+    /* characters off the layout that reserve swaps can trade keys for */
+    int reserve[LANG_LENGTH];
+    int reserve_count = reserve_rate > 0 ? reserve_pool(working_lt, reserve) : 0; /* util.c */
+    /* the number of free keys holding a character never changes, make sure there is one */
+    int tradable = 0;
+    for (int r = 0; r < ROW; r++) {
+        for (int c = 0; c < COL; c++) {
+            tradable += !pins[r][c] && working_lt->matrix[r][c] > 0;
+        }
+    }
+    if (tradable == 0) {reserve_count = 0;}
+
+    /* where the penalties gather, guided swaps draw their endpoints from it */
+    float blame[DIM1], blame_cumulative[DIM1];
+    float blame_total = 0;
+    unsigned int guide_seed = (unsigned int)rand() + thread_id;
+
+    /* the selected engine decides which moves are kept */
     struct timespec start, current;
     clock_gettime(CLOCK_MONOTONIC, &start);
-
-    /* Initial temperature */
-    float T = 1000.0;
-    int reheating_count = 0;
-    /* Starting number of swaps */
-    int initial_swap_count = MAX_SWAPS;
+    engine *search = find_engine(search_engine); /* engine.c */
+    engine_state state;
+    state.thread_id = thread_id;
+    search->init(&state, iterations, max_lt->score);
     int swap_count;
-    /* Store the initial temperature for scaling */
-    float max_T = T;
-
-    /* For adaptive cooling */
-    int improvement_counter = 0;
 
     if (thread_id == 0) {log_print('n',L"Done\n\n");}
     if (thread_id == 0) {log_print('n',L"6/9: Waiting for threads to complete... \n");}
 
-    for (int i = 0; i < iterations; i++) {
-        /* Temperature-dependent swap count */
-        swap_count = (int)(initial_swap_count * (T / max_T));
-        swap_count = swap_count < 1 ? 1 : swap_count;
-        swap_count = swap_count > initial_swap_count ? initial_swap_count : swap_count;
+    int dump_seen = atomic_load(&dump_requested);
+    int i;
+    for (i = 0; i < iterations; i++) {
+        /* stop early if interrupted, the layout so far is still used */
+        if (atomic_load_explicit(&stop_requested, memory_order_relaxed)) {break;}
+        /* contribute to a dump of the current best if one was requested */
+        if (atomic_load_explicit(&dump_requested, memory_order_relaxed) != dump_seen) {
+            dump_seen = atomic_load(&dump_requested);
+            report_best(max_lt, 0);
+        }
+
+        /* the working layout is the current one again, refresh its blame */
+        if (guide_rate > 0 && i % BLAME_REFRESH == 0) {
+            layout_blame(working_lt, blame); /* blame.c */
+            blame_total = blame_table(blame, pins, blame_cumulative); /* blame.c */
+        }
+
+        /* Engine-dependent swap count */
+        swap_count = state.swaps;
 
         /* Store the swaps for potential reversal */
         int swap_rows1[swap_count];
@@ -312,12 +1263,39 @@ void *thread_function(void *arg) {
         /* Perform the swaps */
         for (int j = 0; j < swap_count; j++) {
             int row1, col1, row2, col2;
-            do {
-                row1 = rand() % ROW;
-                col1 = rand() % COL;
-                row2 = rand() % ROW;
-                col2 = rand() % COL;
-            } while (pins[row1][col1] || pins[row2][col2] || (row1 == row2 && col1 == col2));
+            if (reserve_count > 0 && rand() % 100 < reserve_rate) {
+                /* trade a key's character for a reserve one, row2 marks the move */
+                do {
+                    row1 = rand() % ROW;
+                    col1 = rand() % COL;
+                } while (pins[row1][col1] || working_lt->matrix[row1][col1] <= 0);
+                int slot = rand() % reserve_count;
+                swap_rows1[j] = row1;
+                swap_cols1[j] = col1;
+                swap_rows2[j] = -1;
+                swap_cols2[j] = slot;
+
+                int temp = working_lt->matrix[row1][col1];
+                working_lt->matrix[row1][col1] = reserve[slot];
+                reserve[slot] = temp;
+                continue;
+            }
+            if (guide_rate > 0) {
+                /* after a few rejected picks fall back to uniform ones */
+                int tries = 0;
+                do {
+                    float total = tries++ < 8 ? blame_total : 0;
+                    guided_position(&row1, &col1, blame_cumulative, total, &guide_seed); /* blame.c */
+                    guided_position(&row2, &col2, blame_cumulative, total, &guide_seed); /* blame.c */
+                } while (pins[row1][col1] || pins[row2][col2] || (row1 == row2 && col1 == col2));
+            } else {
+                do {
+                    row1 = rand() % ROW;
+                    col1 = rand() % COL;
+                    row2 = rand() % ROW;
+                    col2 = rand() % COL;
+                } while (pins[row1][col1] || pins[row2][col2] || (row1 == row2 && col1 == col2));
+            }
 
             /* Store swap locations for BOTH positions */
             swap_rows1[j] = row1;
@@ -331,18 +1309,12 @@ void *thread_function(void *arg) {
             working_lt->matrix[row2][col2] = temp;
         }
 
-        /* analyze the new layout */
-        single_analyze(working_lt); /* analyze.c */
-        /* calculates the new score */
-        get_score(working_lt); /* util.c */
+        /* analyze and score the new layout */
+        search_analyze(working_lt);
 
-        /* Exponentiate the score difference for acceptance probability (using sigmoid) */
-        float delta_score = working_lt->score - max_lt->score;
-        if (delta_score > 0 || (1.0 / (1.0 + exp(-10 * delta_score / T))) > random_float()) {
+        if (search->accept(&state, working_lt->score, max_lt->score)) {
             /* copy the new layout if it passes */
             copy(max_lt, working_lt); /* util.c */
-            /* Increment improvement counter */
-            improvement_counter++;
         } else {
             /* Revert the swaps in reverse order if it fails */
             for (int j = swap_count - 1; j >= 0; j--) {
@@ -353,54 +1325,18 @@ void *thread_function(void *arg) {
 
                 /* Perform the reverse swap */
                 int temp = working_lt->matrix[row1][col1];
+                if (row2 < 0) {
+                    working_lt->matrix[row1][col1] = reserve[col2];
+                    reserve[col2] = temp;
+                    continue;
+                }
                 working_lt->matrix[row1][col1] = working_lt->matrix[row2][col2];
                 working_lt->matrix[row2][col2] = temp;
             }
         }
 
-        /* Adaptive cooling - Modified to adjust reheating temperature */
-        if (i > 0 && i % (iterations / 20) == 0) {
-            double improvement_rate = (double)improvement_counter / (iterations / 20);
-            if (improvement_rate > 0.2) {
-                /* Cool faster if improving rapidly */
-                max_T *= 0.95;
-            } else {
-                /* Cool slower if not improving much */
-                max_T *= 1.05;
-            }
-            /* Limit max_T to a reasonable upper bound */
-            max_T = max_T > 1500.0 ? 1500.0 : max_T;
-            /* Don't let max_T be less than the current T */
-            max_T = max_T < T ? T : max_T;
-            /* Reset counter */
-            improvement_counter = 0;
-        }
-
-        /* Reheating with temperature clamp */
-        if (i > 0 && i % (iterations / 10) == 0) {
-            float old_T = T;
-            /* Reheat to the potentially adjusted max_T */
-            T = max_T;
-            reheating_count++;
-            if (thread_id == 0) {log_print('v', L"\nReheating (%d) | Old Temp: %f - New Temp: %f\n", reheating_count, old_T, T);}
-        }
-
-        /* Non-monotonic "jolt" */
-        if (i > 0 && i % (iterations / 50) == 0) {
-            T *= (1.0 + random_float() * 0.3);
-            if (T > max_T) {
-                T = max_T;
-            }
-        }
-
-        /* Temperature cooling tied to iteration count */
-        float progress = (float)i / iterations;
-        /* Linear decrease */
-        T = max_T * (1.0 - progress);
-        /* Exponential decrease - You can try this too (seems worse) */
-        /* T = max_T * exp(-5.0 * progress); */
-        /* Prevent T from going below 1.0 */
-        T = T < 1.0 ? 1.0 : T;
+        /* advance the engine's schedule */
+        search->step(&state, i);
 
         /* Percentage completion and estimated time for the first thread */
         if (thread_id == 0 && i % 100 == 0) {
@@ -417,15 +1353,18 @@ void *thread_function(void *arg) {
             int seconds = estimatedRemaining % 60;
 
             /* Print the result (with correct pluralization) */
-            log_print('n', L"\r%3d%%  ETA: %02dh %02dm %02ds, %8.0lf layout%s/sec                 ",
+            /* rate limited, most calls are dropped before formatting */
+            log_progress('n', L"\r%3d%%  ETA: %02dh %02dm %02ds, %8.0lf layout%s/sec                 ",
                 (int)(progress_percent * 100), hours, minutes, seconds, totalIterationsPerSecond,
                 totalIterationsPerSecond == 1 ? "" : "s");
-            fflush(stdout);
         }
     }
+    data->completed = i;
+    report_best(NULL, 1);
     if (thread_id == 0) {
         /* Newline after percentage reaches 100% */
         log_print('q', L"\n");
+        search->report(&state);
     }
 
     layout *best_layout;
@@ -440,32 +1379,243 @@ void *thread_function(void *arg) {
     free_layout(max_lt);     /* util.c */
     free_layout(working_lt); /* util.c */
 
-    pthread_exit(NULL);
+    return NULL;
+}
+
+/*
+ * Function executed by each thread of the lane backend. It runs LANE_COUNT
+ * chains of the selected engine in lockstep and scores the candidates of all
+ * chains together with lane_analyze(). Each chain keeps or reverts its own
+ * swaps.
+ *
+ * Parameters:
+ *   arg: A pointer to a thread_data structure.
+ *
+ * Returns: A pointer to the best layout found by any of the thread's chains.
+ */
+void *lane_thread_function(void *arg) {
+    thread_data *data = (thread_data *)arg;
+    layout *lt = data->lt;
+    int thread_id = data->thread_id;
+    int (*pins)[col] = data->pins;
+    /* every step analyzes a layout per lane */
+    int steps = data->iterations / LANE_COUNT;
+    steps = steps < 1 ? 1 : steps;
+
+    layout *max_lts[LANE_COUNT], *working_lts[LANE_COUNT];
+    for (int l = 0; l < LANE_COUNT; l++) {
+        alloc_layout(&max_lts[l]);     /* util.c */
+        alloc_layout(&working_lts[l]); /* util.c */
+        copy(working_lts[l], lt); /* util.c */
+        strcat(working_lts[l]->name, " improved");
+    }
+    lane_analyze(working_lts); /* lanes.c */
+    for (int l = 0; l < LANE_COUNT; l++) {copy(max_lts[l], working_lts[l]);} /* util.c */
+
+    struct timespec start, current;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* every lane is a chain of its own under the selected engine */
+    engine *search = find_engine(search_engine); /* engine.c */
+    engine_state states[LANE_COUNT];
+    for (int l = 0; l < LANE_COUNT; l++) {
+        /* only the first lane of the first thread logs */
+        states[l].thread_id = thread_id == 0 && l == 0 ? 0 : 1;
+        search->init(&states[l], steps, max_lts[l]->score);
+    }
+
+    if (thread_id == 0) {log_print('n',L"Done\n\n");}
+    if (thread_id == 0) {log_print('n',L"6/9: Waiting for threads to complete... \n");}
+
+    int dump_seen = atomic_load(&dump_requested);
+    int i;
+    for (i = 0; i < steps; i++) {
+        if (atomic_load_explicit(&stop_requested, memory_order_relaxed)) {break;}
+        if (atomic_load_explicit(&dump_requested, memory_order_relaxed) != dump_seen) {
+            dump_seen = atomic_load(&dump_requested);
+            layout *best = max_lts[0];
+            for (int l = 1; l < LANE_COUNT; l++) {
+                if (max_lts[l]->score > best->score) {best = max_lts[l];}
+            }
+            report_best(best, 0);
+        }
+
+        /* swapped positions of each lane, as flat indices */
+        int swaps1[LANE_COUNT][MAX_SWAPS];
+        int swaps2[LANE_COUNT][MAX_SWAPS];
+
+        for (int l = 0; l < LANE_COUNT; l++) {
+            int (*matrix)[COL] = working_lts[l]->matrix;
+            for (int j = 0; j < states[l].swaps; j++) {
+                int p1, p2;
+                do {
+                    p1 = rand() % DIM1;
+                    p2 = rand() % DIM1;
+                } while (pins[p1 / COL][p1 % COL] || pins[p2 / COL][p2 % COL] || p1 == p2);
+                swaps1[l][j] = p1;
+                swaps2[l][j] = p2;
+
+                int temp = matrix[p1 / COL][p1 % COL];
+                matrix[p1 / COL][p1 % COL] = matrix[p2 / COL][p2 % COL];
+                matrix[p2 / COL][p2 % COL] = temp;
+            }
+        }
+
+        /* analyze and score every lane's new layout together */
+        lane_analyze(working_lts); /* lanes.c */
+
+        for (int l = 0; l < LANE_COUNT; l++) {
+            if (search->accept(&states[l], working_lts[l]->score, max_lts[l]->score)) {
+                copy(max_lts[l], working_lts[l]); /* util.c */
+            } else {
+                int (*matrix)[COL] = working_lts[l]->matrix;
+                for (int j = states[l].swaps - 1; j >= 0; j--) {
+                    int p1 = swaps1[l][j], p2 = swaps2[l][j];
+                    int temp = matrix[p1 / COL][p1 % COL];
+                    matrix[p1 / COL][p1 % COL] = matrix[p2 / COL][p2 % COL];
+                    matrix[p2 / COL][p2 % COL] = temp;
+                }
+            }
+        }
+
+        /* advance every lane's schedule */
+        for (int l = 0; l < LANE_COUNT; l++) {search->step(&states[l], i);}
+
+        /* Percentage completion and estimated time for the first thread */
+        if (thread_id == 0 && i % 100 == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &current);
+            double elapsed = (current.tv_sec - start.tv_sec) + (current.tv_nsec - start.tv_nsec) / 1e9;
+            double stepsPerSecond = i / elapsed;
+            double totalIterationsPerSecond = stepsPerSecond * LANE_COUNT * threads;
+            int estimatedRemaining = (int)((steps - i) / stepsPerSecond);
+
+            int hours = estimatedRemaining / 3600;
+            int minutes = (estimatedRemaining % 3600) / 60;
+            int seconds = estimatedRemaining % 60;
+
+            log_progress('n', L"\r%3d%%  ETA: %02dh %02dm %02ds, %8.0lf layout%s/sec                 ",
+                (int)((double)i / steps * 100), hours, minutes, seconds, totalIterationsPerSecond,
+                totalIterationsPerSecond == 1 ? "" : "s");
+        }
+    }
+    data->completed = i * LANE_COUNT;
+    report_best(NULL, 1);
+    if (thread_id == 0) {
+        /* Newline after percentage reaches 100% */
+        log_print('q', L"\n");
+        search->report(&states[0]);
+    }
+
+    /* the thread's result is the best of its chains */
+    layout *best = max_lts[0];
+    for (int l = 1; l < LANE_COUNT; l++) {
+        if (max_lts[l]->score > best->score) {best = max_lts[l];}
+    }
+    layout *best_layout;
+    alloc_layout(&best_layout); /* util.c */
+    copy(best_layout, best); /* util.c */
+    *(data->best_lt) = best_layout;
+
+    for (int l = 0; l < LANE_COUNT; l++) {
+        free_layout(max_lts[l]);     /* util.c */
+        free_layout(working_lts[l]); /* util.c */
+    }
+
+    return NULL;
+}
+
+/*
+ * Scores a copy of a layout under the selected shard objective, leaving the
+ * layout's own stats alone.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   print: 1 to also print the layout's shard summary.
+ * Returns: The layout's objective value.
+ */
+float shard_value(layout *lt, int print) {
+    layout *shard_lt;
+    alloc_layout(&shard_lt); /* util.c */
+    copy(shard_lt, lt); /* util.c */
+    float scores[shard_count];
+    shard_analyze(shard_lt, scores); /* shard.c */
+    free_layout(shard_lt); /* util.c */
+
+    float mean, sd, worst;
+    shard_summary(scores, &mean, &sd, &worst); /* shard.c */
+    float value = shard_objective_value(scores); /* shard.c */
+    if (print) {
+        log_print('q',L"Shards: mean %f, sd %f, worst %f, objective %f\n\n",
+            mean, sd, worst, value);
+    }
+    return value;
+}
+
+/*
+ * Prints which characters an optimized layout dropped from, and added to, the
+ * key set of the starting layout, with the share of the corpus each set of
+ * characters makes up.
+ *
+ * Parameters:
+ *   start: The starting layout.
+ *   end: The optimized layout.
+ */
+void print_key_set(layout *start, layout *end) {
+    int start_reserve[LANG_LENGTH], end_reserve[LANG_LENGTH];
+    int start_count = reserve_pool(start, start_reserve); /* util.c */
+    int end_count = reserve_pool(end, end_reserve); /* util.c */
+
+    float dropped_mass = 0, added_mass = 0, off_mass = 0;
+    log_print('q',L"Dropped keys:");
+    for (int i = 0; i < end_count; i++) {
+        int c = end_reserve[i], was_reserve = 0;
+        for (int j = 0; j < start_count; j++) {was_reserve |= start_reserve[j] == c;}
+        off_mass += linear_mono[c];
+        if (was_reserve) {continue;}
+        log_print('q',L" %lc", convert_back(c)); /* io_util.c */
+        dropped_mass += linear_mono[c];
+    }
+    log_print('q',L" (%f%% of characters)\n", dropped_mass);
+
+    log_print('q',L"Added keys:  ");
+    for (int i = 0; i < start_count; i++) {
+        int c = start_reserve[i], is_reserve = 0;
+        for (int j = 0; j < end_count; j++) {is_reserve |= end_reserve[j] == c;}
+        if (is_reserve) {continue;}
+        log_print('q',L" %lc", convert_back(c)); /* io_util.c */
+        added_mass += linear_mono[c];
+    }
+    log_print('q',L" (%f%% of characters)\n", added_mass);
+    log_print('q',L"Off the layout: %f%% of characters\n\n", off_mass);
 }
 
 /*
  * Initiates the layout generation process without a specific starting layout.
  * Calls improve with shuffle set to 1, effectively starting from a random
- * layout, with no pins. Will still use set of keys from selected layout.
+ * layout, with no pins other than positions the geometry has no key for.
+ * Will still use set of keys from selected layout.
+ *
+ * Returns: The full corpus score of the best layout the search found.
  */
-void generate() {
+float generate() {
     /* No specific layout used, so unpin all positions for a fresh start */
     for (int i = 0; i < ROW; i++) {
         for (int j = 0; j < COL; j++) {
-            pins[i][j] = 0;
+            pins[i][j] = geo_hand[i][j] == '-';
         }
     }
-    improve(1);
+    return improve(1);
 }
 
 /*
  * Improves an existing layout using multiple threads.
- * Each thread runs a simulated annealing process to find a better layout.
+ * Each thread runs the selected search engine to find a better layout.
  *
  * Parameters:
  *   shuffle: A flag indicating whether to shuffle the layout before starting.
+ * Returns: The full corpus score of the best layout the search found.
  */
-void improve(int shuffle) {
+float improve(int shuffle) {
     /* Work for timing total/real layouts/second */
     layouts_analyzed += ((int)repetitions/threads + 1) * threads;
     layouts_analyzed += 2;
@@ -518,6 +1668,14 @@ void improve(int shuffle) {
     pthread_t *thread_ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
     layout **best_layouts = (layout **)malloc(threads * sizeof(layout *));
 
+    /* Ctrl-C stops the threads early instead of discarding their work */
+    atomic_store(&stop_requested, 0);
+    alloc_layout(&dump_best); /* util.c */
+    dump_best->score = -INFINITY;
+    dump_reports = 0;
+    dump_active = threads;
+    catch_signals(); /* util.c */
+
     /* Create and start the threads */
     log_print('n',L"5/9: Initializing threads... ");
     for (int i = 0; i < threads; i++) {
@@ -526,13 +1684,26 @@ void improve(int shuffle) {
         thread_data_array[i].best_lt = &best_layouts[i];
         thread_data_array[i].iterations = iterations;
         thread_data_array[i].thread_id = i;
-        pthread_create(&thread_ids[i], NULL, thread_function, (void *)&thread_data_array[i]);
+        thread_data_array[i].completed = 0;
+        thread_data_array[i].pins = pins;
+        /* the lane backend runs several chains per thread */
+        pthread_create(&thread_ids[i], NULL, backend_mode == 'v' ? lane_thread_function : thread_function,
+            (void *)&thread_data_array[i]);
     }
 
     /* Wait for all threads to complete */
     for (int i = 0; i < threads; i++) {
         pthread_join(thread_ids[i], NULL);
     }
+    release_signals(); /* util.c */
+    free_layout(dump_best); /* util.c */
+    if (atomic_load(&stop_requested)) {
+        /* only count the iterations that actually ran */
+        for (int i = 0; i < threads; i++) {
+            layouts_analyzed -= iterations - thread_data_array[i].completed;
+        }
+        log_print('q',L"Interrupted, continuing with the best layouts so far.\n");
+    }
     log_print('n',L"Done\n\n");
 
     /* Find the best layout among all threads */
@@ -546,7 +1717,19 @@ void improve(int shuffle) {
     log_print('n',L"Done\n\n");
 
     /* perform a single layout analysis */
+    /* the threads compared objective values, the start needs one too */
+    float best_value = best_layout->score;
+    float start_value = shard_objective == 'n' ? lt->score : shard_value(lt, 0);
+    if (reserve_rate > 0) {start_value -= reserve_penalty * off_layout_mass(lt);} /* util.c */
+
     log_print('n',L"8/9: Analyzing best layout... ");
+    if (shard_objective != 'n' || reserve_rate > 0) {
+        /* the archive keeps full corpus scores whatever the objective */
+        for (int i = 0; i < threads; i++) {
+            single_analyze(best_layouts[i]); /* analyze.c */
+            get_score(best_layouts[i]); /* util.c */
+        }
+    }
     single_analyze(best_layout); /* analyze.c */
     /* calculates the overall score */
     get_score(best_layout); /* util.c */
@@ -554,15 +1737,18 @@ void improve(int shuffle) {
 
     /* Compare with the original layout and print the better one */
     log_print('n',L"9/9: Printing layout...\n\n");
-    if (best_layout->score > lt->score) {
-        /* prints the best layout */
-        print_layout(best_layout); /* io.c */
-    } else {
-        /* prints the starting layout */
-        print_layout(lt); /* io.c */
-    }
+    layout *better = best_value > start_value ? best_layout : lt;
+    print_layout(better); /* io.c */
+    if (shard_objective != 'n') {shard_value(better, 1);}
+    if (reserve_rate > 0) {print_key_set(lt, better);}
     log_print('n',L"Done\n\n");
 
+    /* keep every thread's result for later runs to query */
+    int archived = archive_layouts(best_layouts, threads); /* archive.c */
+    log_print('n',L"Archived %d new layout%s\n\n", archived, archived == 1 ? "" : "s");
+
+    float result = best_layout->score;
+
     /* free all allocated layouts and thread data */
     for (int i = 0; i < threads; i++) {
         if (best_layouts[i] != NULL) {
@@ -576,6 +1762,333 @@ void improve(int shuffle) {
     free(best_layouts);
     clock_gettime(CLOCK_MONOTONIC, &compute_end);
     elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+    return result;
+}
+
+/* A worker's queue of chains in the job mode, other workers steal its oldest. */
+typedef struct job_queue {
+    pthread_mutex_t lock;
+    int *tasks;
+    int head;
+    int tail;
+} job_queue;
+
+/* The chains of a group of jobs and the worker queues they are dealt into. */
+typedef struct job_pool {
+    thread_data *tasks;
+    job_queue *queues;
+    int workers;
+} job_pool;
+
+/* What a job mode worker thread is started with. */
+typedef struct job_worker {
+    job_pool *pool;
+    int id;
+} job_worker;
+
+/*
+ * Takes the next chain for a worker: the newest in its own queue, or else the
+ * oldest in the queue of another worker.
+ *
+ * Parameters:
+ *   pool: The worker pool.
+ *   id: The worker taking a chain.
+ * Returns: The index of the chain in the pool's tasks, or -1 once every queue
+ *          is empty.
+ */
+int take_chain(job_pool *pool, int id) {
+    for (int k = 0; k < pool->workers; k++) {
+        job_queue *queue = &pool->queues[(id + k) % pool->workers];
+        int task = -1;
+        pthread_mutex_lock(&queue->lock);
+        if (queue->head < queue->tail) {
+            /* own work is taken newest first, stolen work oldest first */
+            task = k == 0 ? queue->tasks[--queue->tail] : queue->tasks[queue->head++];
+        }
+        pthread_mutex_unlock(&queue->lock);
+        if (task != -1) {return task;}
+    }
+    return -1;
+}
+
+/*
+ * Function executed by each job mode worker. It runs chains until no queue
+ * has any left, with the same chain functions as the improve mode.
+ *
+ * Parameters:
+ *   arg: A pointer to a job_worker structure.
+ */
+void *job_worker_function(void *arg) {
+    job_worker *worker = (job_worker *)arg;
+    job_pool *pool = worker->pool;
+    int task;
+    while ((task = take_chain(pool, worker->id)) != -1) {
+        if (backend_mode == 'v') {lane_thread_function(&pool->tasks[task]);}
+        else {thread_function(&pool->tasks[task]);}
+    }
+    return NULL;
+}
+
+/*
+ * Measures how many layouts one worker analyzes per second, used to turn the
+ * time budget of a job into repetitions.
+ *
+ * Parameters:
+ *   lt: A layout to analyze repeatedly.
+ * Returns: Layouts per second of one worker.
+ */
+double job_rate(layout *lt) {
+    layout *probes[LANE_COUNT];
+    for (int l = 0; l < LANE_COUNT; l++) {
+        alloc_layout(&probes[l]); /* util.c */
+        copy(probes[l], lt); /* util.c */
+    }
+
+    struct timespec start, end;
+    double elapsed = 0;
+    int rounds = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (elapsed < 0.2) {
+        if (backend_mode == 'v') {lane_analyze(probes);} /* lanes.c */
+        else {search_analyze(probes[0]);}
+        rounds++;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    }
+
+    for (int l = 0; l < LANE_COUNT; l++) {free_layout(probes[l]);} /* util.c */
+    return rounds * (backend_mode == 'v' ? LANE_COUNT : 1) / elapsed;
+}
+
+/*
+ * Runs a group of jobs that share the current weights. Every job is split
+ * into one chain per thread, like the improve mode splits its repetitions,
+ * and all chains of the group are dealt round robin to the workers. A worker
+ * that runs out steals from the others, so short and long jobs mix without
+ * leaving workers idle. Each job's best layout is printed, recorded, and
+ * archived.
+ *
+ * Parameters:
+ *   list: All jobs of the file.
+ *   members: The indices of the jobs in this group.
+ *   member_count: The number of jobs in this group.
+ */
+void run_jobs(job *list, int *members, int member_count) {
+    int chains = threads;
+    int total = member_count * chains;
+    layout **starts = (layout **)malloc(member_count * sizeof(layout *));
+    layout **results = (layout **)malloc(total * sizeof(layout *));
+    thread_data *tasks = (thread_data *)malloc(total * sizeof(thread_data));
+
+    /* read, shuffle, and score every starting layout */
+    double rate = 0;
+    for (int m = 0; m < member_count; m++) {
+        job *j = &list[members[m]];
+        /* positions the geometry has no key for are always pinned */
+        for (int r = 0; r < ROW; r++) {
+            for (int c = 0; c < COL; c++) {
+                j->pins[r][c] = j->pins[r][c] || geo_hand[r][c] == '-';
+            }
+        }
+
+        alloc_layout(&starts[m]); /* util.c */
+        layout_name = j->layout_name;
+        read_layout(starts[m], 1); /* io.c */
+        if (j->mode == 'g') {
+            /* shuffle_layout() reads the global pins */
+            memcpy(pins, j->pins, sizeof(int) * ROW * COL);
+            shuffle_layout(starts[m]); /* util.c */
+            strcpy(starts[m]->name, "random shuffle");
+        }
+        single_analyze(starts[m]); /* analyze.c */
+        get_score(starts[m]); /* util.c */
+
+        if (j->seconds > 0) {
+            /* as if the job had every worker to itself for that long */
+            if (rate == 0) {rate = job_rate(starts[m]);}
+            double reps = j->seconds * rate * threads;
+            j->repetitions = reps > INT_MAX ? INT_MAX : (int)reps;
+            if (j->repetitions < threads) {j->repetitions = threads;}
+        }
+
+        for (int c = 0; c < chains; c++) {
+            int t = m * chains + c;
+            results[t] = NULL;
+            tasks[t].lt = starts[m];
+            tasks[t].best_lt = &results[t];
+            tasks[t].iterations = j->repetitions / chains;
+            /* only thread 0 logs progress, and no chain here is thread 0 */
+            tasks[t].thread_id = t + 1;
+            tasks[t].completed = 0;
+            tasks[t].pins = j->pins;
+        }
+        log_print('n',L"     Job %d: %s %s, %d repetitions\n", members[m] + 1,
+            j->mode == 'g' ? "generate from" : "improve", j->layout_name, j->repetitions);
+    }
+
+    /* deal the chains round robin, so every job is spread over the workers */
+    job_pool pool;
+    pool.tasks = tasks;
+    pool.workers = threads;
+    pool.queues = (job_queue *)malloc(threads * sizeof(job_queue));
+    for (int w = 0; w < threads; w++) {
+        pthread_mutex_init(&pool.queues[w].lock, NULL);
+        pool.queues[w].tasks = (int *)malloc((total / threads + 1) * sizeof(int));
+        pool.queues[w].head = 0;
+        pool.queues[w].tail = 0;
+    }
+    for (int t = 0; t < total; t++) {
+        job_queue *queue = &pool.queues[t % threads];
+        queue->tasks[queue->tail++] = t;
+    }
+
+    /* Ctrl-C stops the chains early, SIGUSR1 dumps the best of the group */
+    atomic_store(&stop_requested, 0);
+    alloc_layout(&dump_best); /* util.c */
+    dump_best->score = -INFINITY;
+    dump_reports = 0;
+    dump_active = total;
+    catch_signals(); /* util.c */
+
+    log_print('n',L"     Running %d chain%s on %d worker%s... ", total, total == 1 ? "" : "s",
+        threads, threads == 1 ? "" : "s");
+    pthread_t *worker_ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    job_worker *workers = (job_worker *)malloc(threads * sizeof(job_worker));
+    for (int w = 0; w < threads; w++) {
+        workers[w].pool = &pool;
+        workers[w].id = w;
+        pthread_create(&worker_ids[w], NULL, job_worker_function, (void *)&workers[w]);
+    }
+    for (int w = 0; w < threads; w++) {
+        pthread_join(worker_ids[w], NULL);
+    }
+    release_signals(); /* util.c */
+    free_layout(dump_best); /* util.c */
+    log_print('n',L"Done\n\n");
+
+    for (int m = 0; m < member_count; m++) {
+        job *j = &list[members[m]];
+        layout *start = starts[m];
+        layout **job_results = &results[m * chains];
+
+        /* only the iterations that ran count */
+        layouts_analyzed += 2;
+        for (int c = 0; c < chains; c++) {
+            layouts_analyzed += tasks[m * chains + c].completed;
+        }
+
+        layout *best_layout = job_results[0];
+        for (int c = 1; c < chains; c++) {
+            if (job_results[c]->score > best_layout->score) {best_layout = job_results[c];}
+        }
+
+        /* the chains compared objective values, the start needs one too */
+        float best_value = best_layout->score;
+        float start_value = shard_objective == 'n' ? start->score : shard_value(start, 0);
+        if (reserve_rate > 0) {start_value -= reserve_penalty * off_layout_mass(start);} /* util.c */
+        if (shard_objective != 'n' || reserve_rate > 0) {
+            /* the archive keeps full corpus scores whatever the objective */
+            for (int c = 0; c < chains; c++) {
+                single_analyze(job_results[c]); /* analyze.c */
+                get_score(job_results[c]); /* util.c */
+            }
+        }
+        single_analyze(best_layout); /* analyze.c */
+        get_score(best_layout); /* util.c */
+
+        layout *better = best_value > start_value ? best_layout : start;
+        log_print('q',L"Job %d: %s %s with %s\n\n", members[m] + 1,
+            j->mode == 'g' ? "generate from" : "improve", j->layout_name, j->weight_name);
+        print_layout(better); /* io.c */
+        if (shard_objective != 'n') {shard_value(better, 1);}
+        if (reserve_rate > 0) {print_key_set(start, better);}
+
+        /* the record names the job it came from */
+        char name[61];
+        snprintf(name, sizeof(name), "job %d: %s", members[m] + 1, better->name);
+        strcpy(better->name, name);
+        record_layout(better); /* record.c */
+
+        int archived = archive_layouts(job_results, chains); /* archive.c */
+        log_print('n',L"Archived %d new layout%s\n\n", archived, archived == 1 ? "" : "s");
+
+        for (int c = 0; c < chains; c++) {free_layout(job_results[c]);} /* util.c */
+        free_layout(start); /* util.c */
+    }
+
+    for (int w = 0; w < threads; w++) {
+        pthread_mutex_destroy(&pool.queues[w].lock);
+        free(pool.queues[w].tasks);
+    }
+    free(pool.queues);
+    free(worker_ids);
+    free(workers);
+    free(tasks);
+    free(results);
+    free(starts);
+}
+
+/*
+ * Runs every job of the job file 'jobs_name' in one process, so the corpus is
+ * read and the stats are built only once. Jobs sharing a weights file run
+ * together on one worker pool, and the weights are folded again between
+ * those groups. The pins, layout, and weights of config.conf are restored
+ * afterwards.
+ */
+void jobs() {
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    log_print('n',L"1/3: Reading jobs... ");
+    job *list;
+    int count = read_jobs(&list); /* jobs.c */
+    if (count == 0) {error("The job file has no jobs.");}
+    log_print('n',L"%d found... Done\n\n", count);
+
+    int config_pins[row][col];
+    memcpy(config_pins, pins, sizeof(int) * ROW * COL);
+    char *config_layout = layout_name;
+    char *config_weights = weight_name;
+    record_open(); /* record.c */
+
+    int *members = (int *)malloc(count * sizeof(int));
+    int *scheduled = (int *)calloc(count, sizeof(int));
+    for (int first = 0; first < count; first++) {
+        if (scheduled[first]) {continue;}
+        if (atomic_load(&stop_requested)) {
+            log_print('q',L"Interrupted, skipping the remaining jobs.\n");
+            break;
+        }
+
+        /* gather every job with the same weights as the first unscheduled one */
+        int member_count = 0;
+        for (int i = first; i < count; i++) {
+            if (!scheduled[i] && strcmp(list[i].weight_name, list[first].weight_name) == 0) {
+                members[member_count++] = i;
+                scheduled[i] = 1;
+            }
+        }
+
+        log_print('n',L"2/3: Folding weights %s... ", list[first].weight_name);
+        weight_name = list[first].weight_name;
+        refold_weights(); /* stats.c */
+        if (count_five_stats() > 0) {read_fivegrams();} /* stats/five.c, fivegram.c */
+        log_print('n',L"Done\n\n");
+
+        log_print('n',L"3/3: Running %d job%s...\n", member_count, member_count == 1 ? "" : "s");
+        run_jobs(list, members, member_count);
+    }
+
+    record_close(); /* record.c */
+    memcpy(pins, config_pins, sizeof(int) * ROW * COL);
+    layout_name = config_layout;
+    weight_name = config_weights;
+    free(members);
+    free(scheduled);
+    free_jobs(list, count); /* jobs.c */
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
 }
 
 /* Generates a new layout using OpenCL. */
@@ -583,7 +2096,7 @@ void cl_generate() {
     /* No specific layout used, so unpin all positions for a fresh start */
     for (int i = 0; i < ROW; i++) {
         for (int j = 0; j < COL; j++) {
-            pins[i][j] = 0;
+            pins[i][j] = geo_hand[i][j] == '-';
         }
     }
     cl_improve(1);
@@ -627,6 +2140,42 @@ char* read_source_file(const char* filename, size_t* length) {
     return source;
 }
 
+/*
+ * Creates a read only OpenCL buffer over host data. On a device sharing host
+ * memory an aligned allocation is used in place, otherwise the data is copied
+ * into memory owned by the driver.
+ *
+ * Parameters:
+ *   context: The OpenCL context.
+ *   host: The host data, left untouched while the buffer is alive.
+ *   size: The size of the data in bytes.
+ *   zero_copy: 1 if the device shares host memory.
+ *   align: The alignment in bytes the device needs to use host data in place.
+ *   in_place: Incremented by the size when the data is used in place.
+ *   copied: Incremented by the size when the data is copied.
+ *
+ * Returns:
+ *   The buffer, or NULL if it could not be created.
+ */
+cl_mem host_buffer(cl_context context, void *host, size_t size, int zero_copy,
+    size_t align, size_t *in_place, size_t *copied)
+{
+    cl_int err;
+    if (zero_copy && (uintptr_t)host % align == 0)
+    {
+        cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, size, host, &err);
+        if (err == CL_SUCCESS)
+        {
+            *in_place += size;
+            return buffer;
+        }
+    }
+    cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size, host, &err);
+    if (err != CL_SUCCESS) {return NULL;}
+    *copied += size;
+    return buffer;
+}
+
 /*
  * Improves an existing layout using OpenCL.
  *
@@ -790,8 +2339,8 @@ void cl_improve(int shuffle) {
     /* Compiler options to pass constants to the kernel using compiler flags */
     /* Ensure this is large enough for all defines */
     char options[512];
-    sprintf(options, "-Iinclude -cl-fast-relaxed-math -D MONO_LENGTH=%d -D BI_LENGTH=%d -D TRI_LENGTH=%d -D QUAD_LENGTH=%d -D SKIP_LENGTH=%d -D META_LENGTH=%d -D THREADS=%d -D REPETITIONS=%d -D MAX_SWAPS=%d -D WORKERS=%d",
-            MONO_LENGTH, BI_LENGTH, TRI_LENGTH, QUAD_LENGTH, SKIP_LENGTH, META_LENGTH, threads, repetitions, MAX_SWAPS, WORKERS);
+    sprintf(options, "-Iinclude -cl-fast-relaxed-math -D MONO_LENGTH=%d -D BI_LENGTH=%d -D TRI_LENGTH=%d -D QUAD_LENGTH=%d -D SKIP_LENGTH=%d -D META_LENGTH=%d -D THREADS=%d -D REPETITIONS=%d -D MAX_SWAPS=%d -D WORKERS=%d -D LAYOUT_ROWS=%d -D LAYOUT_COLS=%d",
+            MONO_LENGTH, BI_LENGTH, TRI_LENGTH, QUAD_LENGTH, SKIP_LENGTH, META_LENGTH, threads, repetitions, MAX_SWAPS, WORKERS, ROW, COL);
 
     err = clBuildProgram(program, 1, &device, options, NULL, NULL);
     if (err != CL_SUCCESS) {
@@ -828,28 +2377,40 @@ void cl_improve(int shuffle) {
     /* Allocate and copy data to device buffers */
     log_print('v', L"     Allocating and copying data to device buffers...");
 
-    cl_mem buffer_linear_mono = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * LANG_LENGTH, linear_mono, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for linear_mono.");}
-    cl_mem buffer_linear_bi = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * LANG_LENGTH * LANG_LENGTH, linear_bi, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for linear_bi.");}
-    cl_mem buffer_linear_tri = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, linear_tri, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for linear_tri.");}
-    cl_mem buffer_linear_quad = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, linear_quad, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for linear_quad.");}
-    cl_mem buffer_linear_skip = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * 10 * LANG_LENGTH * LANG_LENGTH, linear_skip, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for linear_skip.");}
-    cl_mem buffer_stats_mono = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(mono_stat) * MONO_LENGTH, stats_mono, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for stats_mono.");}
-    cl_mem buffer_stats_bi = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(bi_stat) * BI_LENGTH, stats_bi, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for stats_bi.");}
-    cl_mem buffer_stats_tri = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(tri_stat) * TRI_LENGTH, stats_tri, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for stats_tri.");}
-    cl_mem buffer_stats_quad = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(quad_stat) * QUAD_LENGTH, stats_quad, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for stats_quad.");}
-    cl_mem buffer_stats_skip = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(skip_stat) * SKIP_LENGTH, stats_skip, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for stats_skip.");}
-    cl_mem buffer_stats_meta = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(meta_stat) * META_LENGTH, stats_meta, &err);
-    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for stats_meta.");}
+    /* devices sharing host memory read the tables in place instead of a copy */
+    cl_device_type device_type = 0;
+    cl_bool unified = CL_FALSE;
+    cl_uint align_bits = 0;
+    clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(device_type), &device_type, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(align_bits), &align_bits, NULL);
+    int zero_copy = (device_type & CL_DEVICE_TYPE_CPU) || unified == CL_TRUE;
+    size_t align = align_bits >= 8 ? align_bits / 8 : HOST_ALIGN;
+    size_t in_place = 0;
+    size_t copied = 0;
+
+    cl_mem buffer_linear_mono = host_buffer(context, linear_mono, sizeof(float) * LANG_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_linear_mono == NULL) {error("OpenCL Error: Failed to create buffer for linear_mono.");}
+    cl_mem buffer_linear_bi = host_buffer(context, linear_bi, sizeof(float) * LANG_LENGTH * LANG_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_linear_bi == NULL) {error("OpenCL Error: Failed to create buffer for linear_bi.");}
+    cl_mem buffer_linear_tri = host_buffer(context, linear_tri, sizeof(float) * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_linear_tri == NULL) {error("OpenCL Error: Failed to create buffer for linear_tri.");}
+    cl_mem buffer_linear_quad = host_buffer(context, linear_quad, sizeof(float) * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_linear_quad == NULL) {error("OpenCL Error: Failed to create buffer for linear_quad.");}
+    cl_mem buffer_linear_skip = host_buffer(context, linear_skip, sizeof(float) * 10 * LANG_LENGTH * LANG_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_linear_skip == NULL) {error("OpenCL Error: Failed to create buffer for linear_skip.");}
+    cl_mem buffer_stats_mono = host_buffer(context, stats_mono, sizeof(mono_stat) * MONO_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_stats_mono == NULL) {error("OpenCL Error: Failed to create buffer for stats_mono.");}
+    cl_mem buffer_stats_bi = host_buffer(context, stats_bi, sizeof(bi_stat) * BI_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_stats_bi == NULL) {error("OpenCL Error: Failed to create buffer for stats_bi.");}
+    cl_mem buffer_stats_tri = host_buffer(context, stats_tri, sizeof(tri_stat) * TRI_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_stats_tri == NULL) {error("OpenCL Error: Failed to create buffer for stats_tri.");}
+    cl_mem buffer_stats_quad = host_buffer(context, stats_quad, sizeof(quad_stat) * QUAD_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_stats_quad == NULL) {error("OpenCL Error: Failed to create buffer for stats_quad.");}
+    cl_mem buffer_stats_skip = host_buffer(context, stats_skip, sizeof(skip_stat) * SKIP_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_stats_skip == NULL) {error("OpenCL Error: Failed to create buffer for stats_skip.");}
+    cl_mem buffer_stats_meta = host_buffer(context, stats_meta, sizeof(meta_stat) * META_LENGTH, zero_copy, align, &in_place, &copied);
+    if (buffer_stats_meta == NULL) {error("OpenCL Error: Failed to create buffer for stats_meta.");}
     cl_mem buffer_layouts = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(layout) * threads, NULL, &err);
     if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for layouts.");}
     err = clEnqueueWriteBuffer(queue, buffer_layouts, CL_TRUE, 0, sizeof(layout) * threads, layouts, 0, NULL, NULL);
@@ -858,6 +2419,8 @@ void cl_improve(int shuffle) {
     if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for pins.");}
     cl_mem buffer_reps = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(int) * threads, NULL, &err);
     if (err != CL_SUCCESS) { error("OpenCL Error: Failed to create buffer for reps."); }
+    log_print('v', L"     %s device, %.1f MB used in place, %.1f MB copied\n",
+        zero_copy ? "Shared memory" : "Discrete", in_place / 1e6, copied / 1e6);
     log_print('v', L"     Done\n");
 
     /* Generate a seed on the host */
@@ -919,7 +2482,14 @@ void cl_improve(int shuffle) {
 
     /* Wait for kernel to finish */
     log_print('v', L"     Waiting for kernel to finish... ");
+    /* a running kernel cannot be interrupted, a second signal aborts */
+    atomic_store(&stop_requested, 0);
+    catch_signals(); /* util.c */
     clFinish(queue);
+    release_signals(); /* util.c */
+    if (atomic_load(&stop_requested)) {
+        log_print('q', L"Interrupted, the kernel ran to completion.\n");
+    }
     log_print('v', L"Done\n");
     log_print('v', L"     Done\n\n");
 
@@ -1003,6 +2573,13 @@ void cl_improve(int shuffle) {
     print_layout(best_layout); /* io.c */
     log_print('v', L"Done\n\n");
 
+    /* keep every work group's result for later runs to query */
+    layout **results = (layout **)malloc(sizeof(layout *) * threads);
+    for (int i = 0; i < threads; i++) {results[i] = &layouts[i];}
+    int archived = archive_layouts(results, threads); /* archive.c */
+    log_print('n',L"Archived %d new layout%s\n\n", archived, archived == 1 ? "" : "s");
+    free(results);
+
     free(layouts);
     free_layout(lt);
     free(reps_data);
@@ -1039,7 +2616,8 @@ void gen_benchmark()
     /* fill in thread counts based on powers of 2 and cores */
     thread_array[0] = 1;
     for (int i = 1; i < count; i++) {thread_array[i] = thread_array[i-1] * 2;}
-    thread_array[count] = num_cpus / 2;
+    /* at least one thread on single core systems */
+    thread_array[count] = num_cpus / 2 > 0 ? num_cpus / 2 : 1;
     thread_array[count + 1] = num_cpus;
     thread_array[count + 2] = num_cpus * 2;
 
@@ -1073,6 +2651,36 @@ void gen_benchmark()
         log_print('q',L"Done\n\n");
     }
 
+    /* compare the engines head to head at the fastest thread count */
+    int fastest = 0;
+    for (int i = 1; i < total; i++) {
+        if (results[i] > results[fastest]) {fastest = i;}
+    }
+    threads = thread_array[fastest];
+    char selected_engine = search_engine;
+    float *engine_scores = (float *)calloc(engine_count, sizeof(float));
+    double *engine_rates = (double *)calloc(engine_count, sizeof(double));
+    /* every engine starts from the same shuffle */
+    unsigned int seed = (unsigned int)time(NULL);
+    for (int e = 0; e < engine_count; e++)
+    {
+        log_print('q',L"ENGINE RUN %d/%d\n", e + 1, engine_count);
+        search_engine = engines[e].code;
+        srand(seed);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        engine_scores[e] = generate();
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double elapsed = (end.tv_sec - start.tv_sec) +
+                         (end.tv_nsec - start.tv_nsec) / 1e9;
+        engine_rates[e] = repetitions / elapsed;
+        log_print('q',L"Done\n\n");
+    }
+    search_engine = selected_engine;
+
     /* reset output mode */
     output_mode = temp;
 
@@ -1093,11 +2701,121 @@ void gen_benchmark()
     log_print('q',L"\n");
     log_print('q',L"Choose the lowest number of threads with acceptable Layouts/Second for best results.\n\n");
 
+    log_print('q',L"Engines at %d threads, %d layouts each:\n\n", threads, repetitions);
+    log_print('q',L"%-16s %12s %16s\n", "Engine", "Best Score", "Layouts/Second");
+    for (int e = 0; e < engine_count; e++)
+    {
+        log_print('q',L"%-16s %12f %16lf\n", engines[e].name, engine_scores[e], engine_rates[e]);
+    }
+    log_print('q',L"\n");
+    free(engine_scores);
+    free(engine_rates);
+
     /* free allocated memory */
     free(thread_array);
     free(results);
 }
 
+/*
+ * Compares the best score every engine reaches on each cpu backend within
+ * time_budget seconds, over ANYTIME_SEEDS shuffles of the primary layout, on
+ * the synthetic corpus and the anytime weights. Prints the curves and their
+ * summary, and records every curve in the record file.
+ */
+void anytime() {
+    struct timespec compute_start, compute_end;
+    clock_gettime(CLOCK_MONOTONIC, &compute_start);
+
+    /* like generation, every key of the layout is free to move */
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            pins[i][j] = geo_hand[i][j] == '-';
+        }
+    }
+
+    log_print('n',L"1/4: Shuffling starting layouts... ");
+    layout *lt;
+    alloc_layout(&lt); /* util.c */
+    read_layout(lt, 1); /* io.c */
+    layout *starts[ANYTIME_SEEDS];
+    for (int s = 0; s < ANYTIME_SEEDS; s++)
+    {
+        /* fixed seeds, every configuration and machine starts alike */
+        alloc_layout(&starts[s]); /* util.c */
+        copy(starts[s], lt); /* util.c */
+        srand(s + 1);
+        shuffle_layout(starts[s]); /* util.c */
+        single_analyze(starts[s]); /* analyze.c */
+        get_score(starts[s]); /* util.c */
+    }
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"2/4: Planning runs... ");
+    char backends[] = {'c', 'v'};
+    const char *backend_names[] = {"cpu", "lanes"};
+    int count = 2 * engine_count;
+    char **names = (char **)malloc(count * sizeof(char *));
+    float *curves = (float *)malloc(count * ANYTIME_SEEDS * ANYTIME_CHECKPOINTS * sizeof(float));
+    double *rates = (double *)calloc(count, sizeof(double));
+    if (names == NULL || curves == NULL || rates == NULL) {error("Failed to allocate memory for the benchmark.");}
+    for (int c = 0; c < count; c++)
+    {
+        names[c] = (char *)malloc(strlen(engines[c % engine_count].name) + 8);
+        sprintf(names[c], "%s/%s", engines[c % engine_count].name, backend_names[c / engine_count]);
+    }
+    log_print('n',L"Done\n\n");
+    log_print('v',L"%d configurations, %d seeds, %g seconds each, about %.0f seconds in total\n\n",
+        count, ANYTIME_SEEDS, time_budget, count * (ANYTIME_SEEDS * time_budget + 0.25));
+
+    /* Ctrl-C stops the benchmark, the runs so far are not reported */
+    log_print('n',L"3/4: Running... \n");
+    char selected_backend = backend_mode;
+    char selected_engine = search_engine;
+    atomic_store(&stop_requested, 0);
+    catch_signals(); /* util.c */
+    for (int c = 0; c < count && !atomic_load(&stop_requested); c++)
+    {
+        backend_mode = backends[c / engine_count];
+        search_engine = engines[c % engine_count].code;
+        double rate = anytime_rate(starts[0]); /* anytime.c */
+        double completed = 0;
+        for (int s = 0; s < ANYTIME_SEEDS && !atomic_load(&stop_requested); s++)
+        {
+            log_progress('n',L"\r     %-22s seed %d/%d          ", names[c], s + 1, ANYTIME_SEEDS);
+            completed += anytime_run(starts[s], rate, s + 1,
+                &curves[(c * ANYTIME_SEEDS + s) * ANYTIME_CHECKPOINTS]); /* anytime.c */
+        }
+        rates[c] = completed / (ANYTIME_SEEDS * time_budget);
+        layouts_analyzed += completed;
+    }
+    release_signals(); /* util.c */
+    backend_mode = selected_backend;
+    search_engine = selected_engine;
+    log_print('n',L"\r%40s\n", "");
+    log_print('n',L"Done\n\n");
+
+    log_print('n',L"4/4: Printing results...\n\n");
+    if (atomic_load(&stop_requested)) {
+        log_print('q',L"Interrupted, no results.\n\n");
+    } else {
+        log_print('q',L"ANYTIME RESULTS:\n\n");
+        record_open(); /* record.c */
+        report_anytime(names, count, curves, rates); /* anytime.c */
+        record_close(); /* record.c */
+    }
+    log_print('n',L"Done\n\n");
+
+    for (int c = 0; c < count; c++) {free(names[c]);}
+    free(names);
+    free(curves);
+    free(rates);
+    for (int s = 0; s < ANYTIME_SEEDS; s++) {free_layout(starts[s]);} /* util.c */
+    free_layout(lt); /* util.c */
+
+    clock_gettime(CLOCK_MONOTONIC, &compute_end);
+    elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
+}
+
 /*
  * Performs a benchmark to determine the optimal number of threads for layout
  * generation on opencl. It runs the generation process with different numbers
@@ -1271,15 +2989,66 @@ void print_help() {
     log_print('q',L"  -l <language> : Chooses the language, the basis of all data in this program.\n");
     log_print('q',L"                  The language chooses which corpora and layouts you can access.\n");
     log_print('q',L"  -c <corpus>   : Chooses the corpus file within the language directory.\n");
+    log_print('q',L"  -C, --corpus2 <corpus> : Chooses the corpus the delta mode compares against.\n");
     log_print('q',L"  -1 <layout>   : Chooses the primary layout within the language directory.\n");
     log_print('q',L"  -2 <layout>   : Chooses the secondary layout within the language directory.\n");
     log_print('q',L"  -w <weights>  : Chooses the weights file within the weights directory.\n");
+    log_print('q',L"  -g <geometry> : Chooses the keyboard geometry file within the geometry\n");
+    log_print('q',L"                  directory, which assigns a hand, finger, and row to each key.\n");
+    log_print('q',L"  -s <stats>    : Chooses a file of user defined stats within the stats\n");
+    log_print('q',L"                  directory, added to the built in stats.\n");
     log_print('q',L"  -r <val>      : Chooses the total number of layouts to analyze during\n");
     log_print('q',L"                  generation modes, it is recommended to set this number\n");
     log_print('q',L"                  between 5,000 and 100,000.\n");
     log_print('q',L"  -t <val>      : Chooses the number of layouts to analyze concurrently in the\n");
     log_print('q',L"                  generation modes. It is recommended to set this number based\n");
     log_print('q',L"                  on the benchmark output.\n");
+    log_print('q',L"  -k <val>      : Chooses how many layouts the archive mode lists, and how many\n");
+    log_print('q',L"                  ngrams the explain mode lists per stat (default 10).\n");
+    log_print('q',L"  -K, --shards <val> : Splits the corpus into this many shards, cut at line\n");
+    log_print('q',L"                  ends, for the shard mode and the objectives (default 1).\n");
+    log_print('q',L"  -O, --objective <objective> : What the cpu generate and improve modes\n");
+    log_print('q',L"                  maximize, needs -K.\n");
+    log_print('q',L"    n;none;corpus        : The score on the full corpus (default).\n");
+    log_print('q',L"    w;worst              : The score on the worst shard.\n");
+    log_print('q',L"    r;robust             : The mean shard score minus lambda deviations.\n");
+    log_print('q',L"  -L, --lambda <val> : The lambda of the robust objective (default 1).\n");
+    log_print('q',L"  -E, --engine <engine> : The search the cpu generate and improve modes run.\n");
+    log_print('q',L"    a;anneal;sa          : Simulated annealing (default).\n");
+    log_print('q',L"    l;late;lahc          : Late acceptance hill climbing.\n");
+    log_print('q',L"    t;threshold;ta       : Threshold accepting.\n");
+    log_print('q',L"  -R, --reserve <val> : Percentage of cpu generate and improve moves that\n");
+    log_print('q',L"                  trade a key for a language character not on the layout\n");
+    log_print('q',L"                  (default 0).\n");
+    log_print('q',L"  -P, --reserve-penalty <val> : Score the reserve swaps lose per percentage\n");
+    log_print('q',L"                  point of characters off the layout (default 10).\n");
+    log_print('q',L"  -G, --guide <val> : Percentage of cpu swap endpoints drawn in proportion to\n");
+    log_print('q',L"                  the weighted penalty of the ngrams touching each key, the\n");
+    log_print('q',L"                  rest uniformly (default 0).\n");
+    log_print('q',L"  -J, --jobs <jobs> : Chooses the job file within the jobs directory.\n");
+    log_print('q',L"  -Q, --quads <model> : How quadgram frequencies are stored, the approximations\n");
+    log_print('q',L"                  free the 54 MB dense quadgram tables after reading.\n");
+    log_print('q',L"    e;exact              : The dense quadgram tables (default).\n");
+    log_print('q',L"    m;markov             : Estimated from trigrams and bigrams on the fly.\n");
+    log_print('q',L"    h;hybrid             : The most frequent quadgrams kept exact, estimated\n");
+    log_print('q',L"                           for the rest.\n");
+    log_print('q',L"  -M, --quad-mass <val> : Percentage of the quadgram mass the hybrid model\n");
+    log_print('q',L"                  keeps exact (default 50).\n");
+    log_print('q',L"  -B, --memory-budget <MB> : Times the quadgram models on this machine and\n");
+    log_print('q',L"                  picks the most accurate fast one that fits in the budget.\n");
+    log_print('q',L"  -S, --subspace <set> : Whole rows or columns the permute mode rearranges,\n");
+    log_print('q',L"                  those holding a pin or gap in different places are not mixed.\n");
+    log_print('q',L"    h;hands              : The columns within each hand (default).\n");
+    log_print('q',L"    c;columns            : All columns.\n");
+    log_print('q',L"    r;rows               : All rows.\n");
+    log_print('q',L"    a;all                : The rows and the columns within each hand.\n");
+    log_print('q',L"  -Y, --objectives <list> : 2 to 4 comma separated stat names, or score, the\n");
+    log_print('q',L"                  front mode trades off. Case, spaces, dashes, and\n");
+    log_print('q',L"                  underscores are ignored. A bare name maximizes the stat's\n");
+    log_print('q',L"                  weighted share of the score, +name and -name maximize and\n");
+    log_print('q',L"                  minimize its raw value.\n");
+    log_print('q',L"  -T, --time-budget <s> : Seconds each run of the anytime benchmark gets\n");
+    log_print('q',L"                  (default 2).\n");
 
 
     log_print('q',L"Modes:\n");
@@ -1294,8 +3063,31 @@ void print_help() {
     log_print('q',L"                           uses first 36 characters in language.\n");
     log_print('q',L"    i;improve;optimize   : Optimizes an existing layout, won't swap keys pinned\n");
     log_print('q',L"                           in the config.\n");
+    log_print('q',L"    d;dist;distribution  : Scores -r random shuffles of the primary layout,\n");
+    log_print('q',L"                           leaving pins alone, and prints the score\n");
+    log_print('q',L"                           distribution.\n");
+    log_print('q',L"    e;shard;robust       : Scores every layout in the language on each corpus\n");
+    log_print('q',L"                           shard and ranks them by the objective.\n");
+    log_print('q',L"    s;stream             : Scores the primary layout on each text file named\n");
+    log_print('q',L"                           after the options, or standard input, in one pass.\n");
+    log_print('q',L"    u;delta;update       : Scores every layout in the language on the corpus and\n");
+    log_print('q',L"                           on -C, and prints how far each one's rank moves.\n");
+    log_print('q',L"    x;archive            : Lists the best archived layouts of each configuration\n");
+    log_print('q',L"                           and re-scores all of them with the current weights.\n");
+    log_print('q',L"    w;why;explain        : Analyzes the primary layout and lists the -k ngrams\n");
+    log_print('q',L"                           that contribute most to each stat.\n");
+    log_print('q',L"    p;permute;exhaustive : Scores every arrangement of the primary layout's -S\n");
+    log_print('q',L"                           rows or columns and keeps the exact best.\n");
+    log_print('q',L"    m;multi;pareto;front : Improves the primary layout towards every trade-off\n");
+    log_print('q',L"                           of the -Y objectives and writes the Pareto front.\n");
+    log_print('q',L"    j;jobs;batch         : Runs every generate and improve job of -J in one\n");
+    log_print('q',L"                           process, sharing the corpus and a worker pool.\n");
     log_print('q',L"    b;bench;benchmark    : Prints the optimal number of threads for generation\n");
-    log_print('q',L"                           performance on this system.\n");
+    log_print('q',L"                           performance on this system, then compares the\n");
+    log_print('q',L"                           cpu engines on the same number of layouts.\n");
+    log_print('q',L"    q;quality;anytime    : Runs every engine on each cpu backend for -T seconds\n");
+    log_print('q',L"                           from %d shuffles on a synthetic corpus, and prints\n", ANYTIME_SEEDS);
+    log_print('q',L"                           the best score reached against time.\n");
     log_print('q',L"    h;help               : Prints this message.\n");
     log_print('q',L"    f;info;information   : Prints more in-depth information about this program.\n");
     // 80           @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
@@ -1307,6 +3099,18 @@ void print_help() {
     log_print('q',L"  -b <mode>     : decides which backend to use.\n");
     log_print('q',L"    c;cpu                : Uses a pure C cpu backend, best for CPU.\n");
     log_print('q',L"    o;ocl;opencl         : Uses an opencl backend, best for GPU, worse for CPU.\n");
+    log_print('q',L"    v;vec;lanes          : Uses the C backend with %d annealing chains per thread\n", LANE_COUNT);
+    log_print('q',L"                           scored together, so the compiler can vectorize them.\n");
+    // 80           @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
+    log_print('q',L"  -f, --format <format> : Also writes one machine readable record per layout in\n");
+    log_print('q',L"                  the analysis, compare, and rank modes, and one per run\n");
+    log_print('q',L"                  curve in the anytime mode.\n");
+    log_print('q',L"    h;human;text         : No records, only the normal output (default).\n");
+    log_print('q',L"    j;json               : One JSON object per line.\n");
+    log_print('q',L"    c;csv                : Comma separated values with a header row.\n");
+    log_print('q',L"    t;tsv                : Tab separated values with a header row.\n");
+    log_print('q',L"  -F, --format-file <file> : Where records are written, gulag.<format> by\n");
+    log_print('q',L"                  default.\n");
     // 80           @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
     log_print('q',L"Config:\n");
     log_print('q',L"  All of these options can be set in config.conf but command line arguments will\n");
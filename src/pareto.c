@@ -0,0 +1,655 @@
+/*
+ * pareto.c - Multi objective layout search for the GULAG.
+ *
+ * One weighted score hides how a layout trades one stat against another. Here
+ * the user names two to four objectives and the search keeps the Pareto
+ * front: every layout found that no other layout found beats on all of them.
+ *
+ * Each thread runs the selected search engine on a weighted sum of the
+ * objectives, redrawing the weights at random a few times per run so that
+ * the threads spread out along the front, and offers every layout it scores
+ * to the shared front. Almost every offer is beaten by a layout already on
+ * the front, so that check runs without a lock: each front slot carries a
+ * sequence number that is odd while the slot is being written, and readers
+ * ignore slots that were written while they looked. Only an offer that
+ * survives takes the lock, to be checked again, drop the layouts it beats,
+ * and take a slot. A full front drops its most crowded layout, by the
+ * crowding distance of NSGA-II.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <wchar.h>
+
+#include "pareto.h"
+#include "analyze.h"
+#include "engine.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Times each thread redraws the weights of its objectives. */
+#define PARETO_SEGMENTS 4
+
+/* One objective: a stat, or the score, and how it is read. */
+typedef struct objective {
+    char name[61];
+    /* m, b, t, q, s (skipgram), e (meta), f (five-gram), or S for the score */
+    char type;
+    int index;
+    /* w for the weighted share of the score, + to maximize, - to minimize */
+    char sense;
+} objective;
+
+/* A place on the front, read without the lock through its sequence number. */
+typedef struct front_slot {
+    atomic_uint seq;
+    atomic_int alive;
+    _Atomic float values[OBJECTIVE_MAX];
+    layout *lt;
+} front_slot;
+
+/* What a front thread is started with. */
+typedef struct pareto_data {
+    layout *start;
+    int iterations;
+    int thread_id;
+    double completed;
+} pareto_data;
+
+objective objectives[OBJECTIVE_MAX];
+int objective_count = 0;
+/* brings each objective to the size of the score, so the engines' schedules fit */
+float objective_scale[OBJECTIVE_MAX];
+
+front_slot front[FRONT_CAPACITY];
+/* slots ever used, readers scan up to here */
+atomic_int front_used;
+pthread_mutex_t front_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Lowercases a name and drops spaces, dashes, and underscores. */
+void fold_name(const char *name, char *folded)
+{
+    int n = 0;
+    for (int i = 0; name[i] != '\0' && n < 60; i++)
+    {
+        if (name[i] == ' ' || name[i] == '-' || name[i] == '_') {continue;}
+        folded[n++] = tolower((unsigned char)name[i]);
+    }
+    folded[n] = '\0';
+}
+
+/* Returns 1 if an ngram stat has no position tuples on the geometry. */
+int stat_empty(char type, int i)
+{
+    switch (type)
+    {
+    case 'm': return stats_mono[i].length == 0;
+    case 'b': return stats_bi[i].length == 0;
+    case 't': return stats_tri[i].length == 0;
+    case 'q': return stats_quad[i].length == 0;
+    default: return stats_skip[i].length == 0;
+    }
+}
+
+/* Finds a stat by folded name, filling type and index, 0 if there is none. */
+int find_objective_stat(const char *folded, objective *o)
+{
+    char name[61];
+    struct {char type; int length;} lists[] = {
+        {'m', MONO_LENGTH}, {'b', BI_LENGTH}, {'t', TRI_LENGTH}, {'q', QUAD_LENGTH},
+        {'s', SKIP_LENGTH}, {'e', META_LENGTH}, {'f', FIVE_LENGTH}
+    };
+    for (int l = 0; l < 7; l++)
+    {
+        for (int i = 0; i < lists[l].length; i++)
+        {
+            char *stat_name;
+            int *skip;
+            switch (lists[l].type)
+            {
+            case 'm': stat_name = stats_mono[i].name; skip = &stats_mono[i].skip; break;
+            case 'b': stat_name = stats_bi[i].name; skip = &stats_bi[i].skip; break;
+            case 't': stat_name = stats_tri[i].name; skip = &stats_tri[i].skip; break;
+            case 'q': stat_name = stats_quad[i].name; skip = &stats_quad[i].skip; break;
+            case 's': stat_name = stats_skip[i].name; skip = &stats_skip[i].skip; break;
+            case 'e': stat_name = stats_meta[i].name; skip = &stats_meta[i].skip; break;
+            default: stat_name = stats_five[i].name; skip = &stats_five[i].skip; break;
+            }
+            fold_name(stat_name, name);
+            if (strcmp(name, folded) != 0) {continue;}
+            if (*skip)
+            {
+                /* meta and five-gram stats are only built for weighted stats */
+                if (lists[l].type == 'e' || lists[l].type == 'f') {
+                    error("An objective meta or five-gram stat needs a weight in the weight file.");
+                }
+                /* an ngram stat without weight is walked again, adding 0 to the score */
+                if (stat_empty(lists[l].type, i)) {error("An objective stat has no ngrams.");}
+                *skip = 0;
+            }
+            o->type = lists[l].type;
+            o->index = i;
+            strncpy(o->name, stat_name, 60);
+            o->name[60] = '\0';
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Parses objective_list into the objectives of the front. Each is a stat name,
+ * compared ignoring case, spaces, dashes, and underscores, or "score". A bare
+ * name maximizes the stat's weighted share of the score, a leading '+' or '-'
+ * maximizes or minimizes its raw value instead.
+ *
+ * Returns:
+ *   The number of objectives.
+ */
+int parse_objectives()
+{
+    char *list = strdup(objective_list);
+    objective_count = 0;
+    for (char *token = strtok(list, ","); token != NULL; token = strtok(NULL, ","))
+    {
+        if (objective_count == OBJECTIVE_MAX) {error("At most 4 objectives can be named.");}
+        objective *o = &objectives[objective_count];
+        o->sense = 'w';
+        if (token[0] == '+' || token[0] == '-') {o->sense = *token++;}
+        char folded[61];
+        fold_name(token, folded);
+        if (strcmp(folded, "score") == 0)
+        {
+            o->type = 'S';
+            o->index = 0;
+            strcpy(o->name, "Score");
+        }
+        else if (!find_objective_stat(folded, o))
+        {
+            error("Objective is not the name of a stat or score.");
+        }
+        if (o->sense == 'w' && o->type != 'S')
+        {
+            float weight = 0;
+            switch (o->type)
+            {
+            case 'm': weight = stats_mono[o->index].weight; break;
+            case 'b': weight = stats_bi[o->index].weight; break;
+            case 't': weight = stats_tri[o->index].weight; break;
+            case 'q': weight = stats_quad[o->index].weight; break;
+            case 'e': weight = stats_meta[o->index].weight; break;
+            case 'f': weight = stats_five[o->index].weight; break;
+            default:
+                for (int k = 1; k <= 9; k++) {weight += fabsf(stats_skip[o->index].weight[k]);}
+                break;
+            }
+            if (weight == 0) {error("An objective stat has no weight, prefix it with + or -.");}
+        }
+        objective_count++;
+    }
+    free(list);
+    if (objective_count < 2) {error("At least 2 objectives must be named.");}
+    return objective_count;
+}
+
+/* Returns the raw value of an objective, or its weighted share of the score. */
+float objective_value(layout *lt, objective *o)
+{
+    int weighted = o->sense == 'w';
+    int i = o->index;
+    switch (o->type)
+    {
+    case 'S': return lt->score;
+    case 'm': return lt->mono_score[i] * (weighted ? stats_mono[i].weight : 1);
+    case 'b': return lt->bi_score[i] * (weighted ? stats_bi[i].weight : 1);
+    case 't': return lt->tri_score[i] * (weighted ? stats_tri[i].weight : 1);
+    case 'q': return lt->quad_score[i] * (weighted ? stats_quad[i].weight : 1);
+    case 'e': return lt->meta_score[i] * (weighted ? stats_meta[i].weight : 1);
+    case 'f': return lt->five_score[i] * (weighted ? stats_five[i].weight : 1);
+    default:
+    {
+        float value = 0;
+        for (int k = 1; k <= 9; k++) {
+            value += lt->skip_score[k][i] * (weighted ? stats_skip[i].weight[k] : 1);
+        }
+        return value;
+    }
+    }
+}
+
+/*
+ * Fills the objective values of an analyzed and scored layout, each oriented
+ * so that higher is better.
+ */
+void objective_values(layout *lt, float *values)
+{
+    for (int i = 0; i < objective_count; i++)
+    {
+        float value = objective_value(lt, &objectives[i]);
+        values[i] = objectives[i].sense == '-' ? -value : value;
+    }
+}
+
+/* Prints the objective values of a layout as they read in its stats. */
+void print_objectives(float *values)
+{
+    for (int i = 0; i < objective_count; i++)
+    {
+        objective *o = &objectives[i];
+        float value = o->sense == '-' ? -values[i] : values[i];
+        if (o->sense == 'w' && o->type != 'S') {
+            log_print('q',L"%s : %f (weighted)\n", o->name, value);
+        } else if (o->sense == 'w') {
+            log_print('q',L"%s : %f\n", o->name, value);
+        } else {
+            log_print('q',L"%c%s : %f\n", o->sense, o->name, value);
+        }
+    }
+}
+
+/* Returns 1 if a is at least as good as b on every objective. */
+int covers(float *a, float *b)
+{
+    for (int i = 0; i < objective_count; i++) {if (a[i] < b[i]) {return 0;}}
+    return 1;
+}
+
+/*
+ * Reads a slot without the lock.
+ *
+ * Returns:
+ *   1 with the values of a live slot, 0 if the slot is empty or was written
+ *   while being read.
+ */
+int read_slot(front_slot *slot, float *values)
+{
+    unsigned int before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (before & 1) {return 0;}
+    int alive = atomic_load_explicit(&slot->alive, memory_order_relaxed);
+    for (int i = 0; i < objective_count; i++)
+    {
+        values[i] = atomic_load_explicit(&slot->values[i], memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return alive && atomic_load_explicit(&slot->seq, memory_order_relaxed) == before;
+}
+
+/* Marks a slot as being written, readers skip it until write_done(). */
+void write_begin(front_slot *slot)
+{
+    atomic_fetch_add_explicit(&slot->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/* Publishes what was written to a slot since write_begin(). */
+void write_done(front_slot *slot)
+{
+    atomic_fetch_add_explicit(&slot->seq, 1, memory_order_release);
+}
+
+/*
+ * Returns the slot with the smallest crowding distance among the live slots
+ * and a candidate, given as slot -1, or -1 if the candidate is the most
+ * crowded. Called with the lock held.
+ */
+int most_crowded(float *candidate)
+{
+    int used = atomic_load(&front_used);
+    int ids[FRONT_CAPACITY + 1];
+    int count = 0;
+    for (int s = 0; s < used; s++) {if (atomic_load(&front[s].alive)) {ids[count++] = s;}}
+    ids[count++] = -1;
+
+    double distance[FRONT_CAPACITY + 1] = {0};
+    for (int o = 0; o < objective_count; o++)
+    {
+        /* order the entries by this objective */
+        float value[FRONT_CAPACITY + 1];
+        int order[FRONT_CAPACITY + 1];
+        for (int n = 0; n < count; n++)
+        {
+            value[n] = ids[n] < 0 ? candidate[o] : atomic_load(&front[ids[n]].values[o]);
+            order[n] = n;
+        }
+        for (int n = 1; n < count; n++)
+        {
+            for (int m = n; m > 0 && value[order[m]] < value[order[m - 1]]; m--)
+            {
+                int swap = order[m];
+                order[m] = order[m - 1];
+                order[m - 1] = swap;
+            }
+        }
+        float range = value[order[count - 1]] - value[order[0]];
+        distance[order[0]] = INFINITY;
+        distance[order[count - 1]] = INFINITY;
+        if (range <= 0) {continue;}
+        for (int n = 1; n < count - 1; n++)
+        {
+            distance[order[n]] += (value[order[n + 1]] - value[order[n - 1]]) / range;
+        }
+    }
+
+    int crowded = 0;
+    for (int n = 1; n < count; n++) {if (distance[n] < distance[crowded]) {crowded = n;}}
+    return ids[crowded];
+}
+
+/*
+ * Offers a layout to the front.
+ *
+ * Returns:
+ *   1 if the layout joined the front, 0 if a layout on it is as good.
+ */
+int offer_front(layout *lt, float *values)
+{
+    /* the common case, beaten by a layout already there, needs no lock */
+    float seen[OBJECTIVE_MAX];
+    int used = atomic_load_explicit(&front_used, memory_order_acquire);
+    for (int s = 0; s < used; s++)
+    {
+        if (read_slot(&front[s], seen) && covers(seen, values)) {return 0;}
+    }
+
+    pthread_mutex_lock(&front_lock);
+    used = atomic_load(&front_used);
+    int free_slot = -1;
+    for (int s = 0; s < used; s++)
+    {
+        if (!atomic_load(&front[s].alive))
+        {
+            if (free_slot < 0) {free_slot = s;}
+            continue;
+        }
+        for (int i = 0; i < objective_count; i++) {seen[i] = atomic_load(&front[s].values[i]);}
+        if (covers(seen, values))
+        {
+            pthread_mutex_unlock(&front_lock);
+            return 0;
+        }
+        if (covers(values, seen))
+        {
+            /* the newcomer beats this one */
+            write_begin(&front[s]);
+            atomic_store_explicit(&front[s].alive, 0, memory_order_relaxed);
+            write_done(&front[s]);
+            if (free_slot < 0) {free_slot = s;}
+        }
+    }
+    if (free_slot < 0 && used < FRONT_CAPACITY) {free_slot = used;}
+    if (free_slot < 0)
+    {
+        free_slot = most_crowded(values);
+        if (free_slot < 0)
+        {
+            pthread_mutex_unlock(&front_lock);
+            return 0;
+        }
+    }
+
+    front_slot *slot = &front[free_slot];
+    write_begin(slot);
+    if (slot->lt == NULL) {alloc_layout(&slot->lt);} /* util.c */
+    copy(slot->lt, lt); /* util.c */
+    for (int i = 0; i < objective_count; i++)
+    {
+        atomic_store_explicit(&slot->values[i], values[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&slot->alive, 1, memory_order_relaxed);
+    write_done(slot);
+    if (free_slot == used) {atomic_store_explicit(&front_used, used + 1, memory_order_release);}
+    pthread_mutex_unlock(&front_lock);
+    return 1;
+}
+
+/* Returns the weighted sum of objective values the engines climb. */
+float scalarize(float *values, float *weights)
+{
+    float sum = 0;
+    for (int i = 0; i < objective_count; i++) {sum += weights[i] * objective_scale[i] * values[i];}
+    return sum;
+}
+
+/* Draws weights uniformly from the simplex, equal weights for thread 0 first. */
+void draw_weights(float *weights, int equal)
+{
+    float total = 0;
+    for (int i = 0; i < objective_count; i++)
+    {
+        weights[i] = equal ? 1 : -logf(1 - random_float() * 0.999999f); /* util.c */
+        total += weights[i];
+    }
+    for (int i = 0; i < objective_count; i++) {weights[i] /= total;}
+}
+
+/*
+ * Function executed by each front thread. Runs the selected engine on a
+ * weighted sum of the objectives, redrawing the weights every segment, and
+ * offers each scored layout to the front.
+ *
+ * Parameters:
+ *   arg: A pointer to a pareto_data structure.
+ *
+ * Returns: NULL.
+ */
+void *pareto_thread(void *arg)
+{
+    pareto_data *data = (pareto_data *)arg;
+    layout *current, *working;
+    alloc_layout(&current); /* util.c */
+    alloc_layout(&working); /* util.c */
+    copy(current, data->start); /* util.c */
+    copy(working, data->start); /* util.c */
+
+    float current_values[OBJECTIVE_MAX], working_values[OBJECTIVE_MAX], weights[OBJECTIVE_MAX];
+    objective_values(current, current_values);
+    offer_front(current, current_values);
+
+    engine *search = find_engine(search_engine); /* engine.c */
+    engine_state state;
+    state.thread_id = data->thread_id;
+    int per_segment = data->iterations / PARETO_SEGMENTS > 0 ? data->iterations / PARETO_SEGMENTS : 1;
+    data->completed = 0;
+
+    for (int segment = 0; segment < PARETO_SEGMENTS; segment++)
+    {
+        draw_weights(weights, data->thread_id == 0 && segment == 0);
+        float current_value = scalarize(current_values, weights);
+        search->init(&state, per_segment, current_value);
+
+        for (int i = 0; i < per_segment; i++)
+        {
+            if (atomic_load_explicit(&stop_requested, memory_order_relaxed)) {break;}
+
+            int swap_count = state.swaps;
+            int rows1[swap_count], cols1[swap_count], rows2[swap_count], cols2[swap_count];
+            for (int j = 0; j < swap_count; j++)
+            {
+                do {
+                    rows1[j] = rand() % ROW;
+                    cols1[j] = rand() % COL;
+                    rows2[j] = rand() % ROW;
+                    cols2[j] = rand() % COL;
+                } while (pins[rows1[j]][cols1[j]] || pins[rows2[j]][cols2[j]]
+                    || (rows1[j] == rows2[j] && cols1[j] == cols2[j]));
+                int temp = working->matrix[rows1[j]][cols1[j]];
+                working->matrix[rows1[j]][cols1[j]] = working->matrix[rows2[j]][cols2[j]];
+                working->matrix[rows2[j]][cols2[j]] = temp;
+            }
+
+            single_analyze(working); /* analyze.c */
+            get_score(working); /* util.c */
+            objective_values(working, working_values);
+            offer_front(working, working_values);
+            data->completed++;
+
+            float working_value = scalarize(working_values, weights);
+            if (search->accept(&state, working_value, current_value))
+            {
+                copy(current, working); /* util.c */
+                for (int o = 0; o < objective_count; o++) {current_values[o] = working_values[o];}
+                current_value = working_value;
+            }
+            else
+            {
+                for (int j = swap_count - 1; j >= 0; j--)
+                {
+                    int temp = working->matrix[rows1[j]][cols1[j]];
+                    working->matrix[rows1[j]][cols1[j]] = working->matrix[rows2[j]][cols2[j]];
+                    working->matrix[rows2[j]][cols2[j]] = temp;
+                }
+            }
+            search->step(&state, i);
+        }
+    }
+
+    free_layout(current); /* util.c */
+    free_layout(working); /* util.c */
+    return NULL;
+}
+
+/*
+ * Runs the selected search engine on every thread from a layout, each thread
+ * chasing a random weighting of the objectives at a time, and keeps every
+ * layout no other one beats on all objectives in the shared front.
+ *
+ * Parameters:
+ *   lt: The analyzed and scored starting layout.
+ *   iterations: The layouts each thread scores.
+ *
+ * Returns:
+ *   The number of layouts scored.
+ */
+double pareto_search(layout *lt, int iterations)
+{
+    /* each objective counts as much as the whole score at the start */
+    float values[OBJECTIVE_MAX];
+    objective_values(lt, values);
+    for (int i = 0; i < objective_count; i++)
+    {
+        objective_scale[i] = fabsf(values[i]) > 1e-6 && fabsf(lt->score) > 1e-6
+            ? fabsf(lt->score) / fabsf(values[i]) : 1;
+    }
+
+    atomic_store(&front_used, 0);
+    for (int s = 0; s < FRONT_CAPACITY; s++)
+    {
+        atomic_store(&front[s].seq, 0);
+        atomic_store(&front[s].alive, 0);
+        front[s].lt = NULL;
+    }
+
+    pareto_data *data = (pareto_data *)malloc(sizeof(pareto_data) * threads);
+    pthread_t *thread_ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    if (data == NULL || thread_ids == NULL) {error("Failed to allocate memory for front threads.");}
+    for (int i = 0; i < threads; i++)
+    {
+        data[i].start = lt;
+        data[i].iterations = iterations;
+        data[i].thread_id = i;
+        pthread_create(&thread_ids[i], NULL, pareto_thread, (void *)&data[i]);
+    }
+    double completed = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(thread_ids[i], NULL);
+        completed += data[i].completed;
+    }
+    free(data);
+    free(thread_ids);
+    return completed;
+}
+
+/*
+ * Copies the front out, ordered by the first objective, best first.
+ *
+ * Parameters:
+ *   out: Receives up to FRONT_CAPACITY allocated layouts.
+ *   values: Receives their objective values, OBJECTIVE_MAX per layout.
+ *
+ * Returns:
+ *   The number of layouts on the front.
+ */
+int collect_front(layout **out, float *values)
+{
+    int count = 0;
+    int used = atomic_load(&front_used);
+    for (int s = 0; s < used; s++)
+    {
+        if (!atomic_load(&front[s].alive)) {continue;}
+        float first = atomic_load(&front[s].values[0]);
+        /* insertion by the first objective */
+        int n = count++;
+        while (n > 0 && values[(n - 1) * OBJECTIVE_MAX] < first)
+        {
+            out[n] = out[n - 1];
+            for (int i = 0; i < OBJECTIVE_MAX; i++) {
+                values[n * OBJECTIVE_MAX + i] = values[(n - 1) * OBJECTIVE_MAX + i];
+            }
+            n--;
+        }
+        alloc_layout(&out[n]); /* util.c */
+        copy(out[n], front[s].lt); /* util.c */
+        for (int i = 0; i < OBJECTIVE_MAX; i++) {
+            values[n * OBJECTIVE_MAX + i] = i < objective_count ? atomic_load(&front[s].values[i]) : 0;
+        }
+    }
+    return count;
+}
+
+/*
+ * Writes a front as a bundle of layout files, 00.glg onwards, in the
+ * <layout>-front directory of the language's layouts, replacing the layout
+ * files of an earlier bundle there.
+ *
+ * Returns:
+ *   The path of the bundle, to be freed.
+ */
+char *write_front(layout **front_layouts, int count)
+{
+    char *dir = (char *)malloc(strlen("./data//layouts/-front") + strlen(lang_name)
+        + strlen(layout_name) + 1);
+    sprintf(dir, "./data/%s/layouts/%s-front", lang_name, layout_name);
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {error("Failed to create the front directory.");}
+
+    /* an earlier front may have had more layouts */
+    DIR *old = opendir(dir);
+    if (old == NULL) {error("Failed to open the front directory.");}
+    struct dirent *entry;
+    char path[4096];
+    while ((entry = readdir(old)) != NULL)
+    {
+        if (strstr(entry->d_name, ".glg") == NULL) {continue;}
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(old);
+
+    for (int n = 0; n < count; n++)
+    {
+        snprintf(path, sizeof(path), "%s/%02d.glg", dir, n);
+        write_layout(front_layouts[n], path); /* io.c */
+    }
+    return dir;
+}
+
+/* Frees the layouts held by the front. */
+void free_front()
+{
+    for (int s = 0; s < FRONT_CAPACITY; s++)
+    {
+        if (front[s].lt != NULL) {free_layout(front[s].lt);} /* util.c */
+        front[s].lt = NULL;
+    }
+}
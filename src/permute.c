@@ -0,0 +1,675 @@
+/*
+ * permute.c - Exhaustive search over whole row and column permutations for the
+ * GULAG.
+ *
+ * Keeping the keys of each column (or row) together and only permuting which
+ * column they sit on leaves a subspace small enough to enumerate: 6! per hand,
+ * 12! for every column. The rows and columns moved together are grouped by the
+ * subspace setting, every group is walked in Heap's algorithm order, and the
+ * groups are nested like the digits of an odometer, so consecutive
+ * arrangements always differ by a single swap of two columns or two rows.
+ *
+ * That swap only changes the ngram tuples that touch one of the two, so each
+ * stat is updated by subtracting those tuples before the swap and adding them
+ * back after it, using a reverse index from each row and column to the tuples
+ * touching it. Those sums run in double, derived, meta, and five-gram stats are
+ * recomputed as usual, the whole layout is analyzed from scratch every
+ * RESYNC_STEPS swaps anyway, and every new best is analyzed from scratch before
+ * it is kept.
+ *
+ * Threads split the subspace by fixing the contents of the last slots of the
+ * largest group, and take the pieces from a shared counter.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <wchar.h>
+
+#include "permute.h"
+#include "analyze.h"
+#include "fivegram.h"
+#include "quadmodel.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Swaps between two full analyses of the working layout. */
+#define RESYNC_STEPS 4096
+/* Pieces of work per thread the subspace is split into, at least. */
+#define PIECES_PER_THREAD 8
+/* Row and column units, columns first, rows from COL on. */
+#define UNITS (row + col)
+
+/* Rows or columns with the same free positions, permuted among themselves. */
+typedef struct unit_group {
+    int units[UNITS];
+    int count;
+} unit_group;
+
+/* Heap's algorithm over the slots of a group, one swap per step. */
+typedef struct heap_state {
+    int *units;
+    int count;
+    int c[UNITS];
+    int i;
+} heap_state;
+
+/* One ngram position tuple of a walked stat. */
+typedef struct perm_tuple {
+    int stat;
+    /* 1 to 4 for the ngram order, 5 for skipgrams */
+    char kind;
+    short pos[4];
+} perm_tuple;
+
+/*
+ * A thread's running sums of the walked stats, kept in double so that adding
+ * and removing tuples swap after swap does not drift.
+ */
+typedef struct stat_sums {
+    double *mono;
+    double *bi;
+    double *tri;
+    double *quad;
+    /* skip-k of stat i at [k * SKIP_LENGTH + i] */
+    double *skip;
+} stat_sums;
+
+/* What a permutation thread is started with. */
+typedef struct permute_data {
+    layout *start;
+    layout *best;
+    double evaluated;
+} permute_data;
+
+unit_group groups[UNITS];
+int group_count = 0;
+/* 1 where a position may move, neither pinned nor without a key */
+int free_pos[row][col];
+
+perm_tuple *tuples = NULL;
+int tuple_count = 0;
+/* tuples touching each unit, unit u owns touch[touch_start[u]..touch_start[u + 1]] */
+int *touch = NULL;
+int touch_start[UNITS + 1];
+
+/* pieces of the subspace, each fixing the last split_depth slots of groups[0] */
+long piece_count = 1;
+int split_depth = 0;
+atomic_long next_piece;
+
+/*
+ * Swaps the keys of two rows or two columns of the same group on their free
+ * positions.
+ */
+void swap_units(layout *lt, int a, int b)
+{
+    if (a < COL)
+    {
+        for (int i = 0; i < ROW; i++)
+        {
+            if (!free_pos[i][a]) {continue;}
+            int swap = lt->matrix[i][a];
+            lt->matrix[i][a] = lt->matrix[i][b];
+            lt->matrix[i][b] = swap;
+        }
+    }
+    else
+    {
+        a -= COL;
+        b -= COL;
+        for (int j = 0; j < COL; j++)
+        {
+            if (!free_pos[a][j]) {continue;}
+            int swap = lt->matrix[a][j];
+            lt->matrix[a][j] = lt->matrix[b][j];
+            lt->matrix[b][j] = swap;
+        }
+    }
+}
+
+/* Loads the running sums from the walked stats of an analyzed layout. */
+void load_sums(stat_sums *sums, layout *lt)
+{
+    for (int i = 0; i < MONO_LENGTH; i++) {sums->mono[i] = lt->mono_score[i];}
+    for (int i = 0; i < BI_LENGTH; i++) {sums->bi[i] = lt->bi_score[i];}
+    for (int i = 0; i < TRI_LENGTH; i++) {sums->tri[i] = lt->tri_score[i];}
+    for (int i = 0; i < QUAD_LENGTH; i++) {sums->quad[i] = lt->quad_score[i];}
+    for (int k = 1; k <= 9; k++) {
+        for (int i = 0; i < SKIP_LENGTH; i++) {sums->skip[k * SKIP_LENGTH + i] = lt->skip_score[k][i];}
+    }
+}
+
+/* Stores the running sums into the walked stats of a layout. */
+void store_sums(stat_sums *sums, layout *lt)
+{
+    for (int i = 0; i < MONO_LENGTH; i++) {
+        if (!stats_mono[i].skip && !stats_mono[i].derived) {lt->mono_score[i] = sums->mono[i];}
+    }
+    for (int i = 0; i < BI_LENGTH; i++) {
+        if (!stats_bi[i].skip && !stats_bi[i].derived) {lt->bi_score[i] = sums->bi[i];}
+    }
+    for (int i = 0; i < TRI_LENGTH; i++) {
+        if (!stats_tri[i].skip && !stats_tri[i].derived) {lt->tri_score[i] = sums->tri[i];}
+    }
+    for (int i = 0; i < QUAD_LENGTH; i++) {
+        if (!stats_quad[i].skip && !stats_quad[i].derived) {lt->quad_score[i] = sums->quad[i];}
+    }
+    for (int i = 0; i < SKIP_LENGTH; i++) {
+        if (stats_skip[i].skip || stats_skip[i].derived) {continue;}
+        for (int k = 1; k <= 9; k++) {lt->skip_score[k][i] = sums->skip[k * SKIP_LENGTH + i];}
+    }
+}
+
+/*
+ * Adds or removes the contribution of a list of tuples to the running sums of
+ * the walked stats of a layout.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   sums: The running sums of its walked stats.
+ *   ids: The tuples.
+ *   count: The number of tuples.
+ *   sign: 1 to add, -1 to remove.
+ */
+void apply_tuples(layout *lt, stat_sums *sums, int *ids, int count, double sign)
+{
+    int *keys = &lt->matrix[0][0];
+    for (int n = 0; n < count; n++)
+    {
+        perm_tuple *t = &tuples[ids[n]];
+        int c0 = keys[t->pos[0]];
+        if (c0 == -1) {continue;}
+        if (t->kind == 1)
+        {
+            sums->mono[t->stat] += sign * linear_mono[index_mono(c0)]; /* util.c */
+            continue;
+        }
+        int c1 = keys[t->pos[1]];
+        if (c1 == -1) {continue;}
+        switch (t->kind)
+        {
+        case 2:
+            sums->bi[t->stat] += sign * linear_bi[index_bi(c0, c1)]; /* util.c */
+            break;
+        case 5:
+            for (int k = 1; k <= 9; k++)
+            {
+                sums->skip[k * SKIP_LENGTH + t->stat] += sign * linear_skip[index_skip(k, c0, c1)]; /* util.c */
+            }
+            break;
+        case 3:
+        {
+            int c2 = keys[t->pos[2]];
+            if (c2 == -1) {break;}
+            sums->tri[t->stat] += sign * linear_tri[index_tri(c0, c1, c2)]; /* util.c */
+            break;
+        }
+        default:
+        {
+            int c2 = keys[t->pos[2]];
+            int c3 = keys[t->pos[3]];
+            if (c2 == -1 || c3 == -1) {break;}
+            if (quad_model != 'e') {
+                sums->quad[t->stat] += sign * quad_frequency(c0, c1, c2, c3); /* quadmodel.c */
+            } else {
+                sums->quad[t->stat] += sign * linear_quad[index_quad(c0, c1, c2, c3)]; /* util.c */
+            }
+            break;
+        }
+        }
+    }
+}
+
+/* Appends the tuples of one stat that touch a free position. */
+void add_tuples(int stat, char kind, int *ngrams, int length)
+{
+    int order = kind == 5 ? 2 : kind;
+    for (int j = 0; j < length; j++)
+    {
+        int r[4], c[4];
+        switch (order)
+        {
+        case 1:
+            unflat_mono(ngrams[j], &r[0], &c[0]); /* util.c */
+            break;
+        case 2:
+            unflat_bi(ngrams[j], &r[0], &c[0], &r[1], &c[1]); /* util.c */
+            break;
+        case 3:
+            unflat_tri(ngrams[j], &r[0], &c[0], &r[1], &c[1], &r[2], &c[2]); /* util.c */
+            break;
+        default:
+            unflat_quad(ngrams[j], &r[0], &c[0], &r[1], &c[1], &r[2], &c[2], &r[3], &c[3]); /* util.c */
+            break;
+        }
+        int moves = 0;
+        for (int k = 0; k < order; k++) {moves |= free_pos[r[k]][c[k]];}
+        if (!moves) {continue;}
+
+        if (tuples != NULL)
+        {
+            perm_tuple *t = &tuples[tuple_count];
+            t->stat = stat;
+            t->kind = kind;
+            for (int k = 0; k < 4; k++) {t->pos[k] = k < order ? r[k] * COL + c[k] : 0;}
+        }
+        tuple_count++;
+    }
+}
+
+/* Walks the stats single_analyze() walks, counting or storing their tuples. */
+void gather_tuples()
+{
+    tuple_count = 0;
+    for (int i = 0; i < MONO_LENGTH; i++) {
+        if (!stats_mono[i].skip && !stats_mono[i].derived) {
+            add_tuples(i, 1, stats_mono[i].ngrams, stats_mono[i].length);
+        }
+    }
+    for (int i = 0; i < BI_LENGTH; i++) {
+        if (!stats_bi[i].skip && !stats_bi[i].derived) {
+            add_tuples(i, 2, stats_bi[i].ngrams, stats_bi[i].length);
+        }
+    }
+    for (int i = 0; i < TRI_LENGTH; i++) {
+        if (!stats_tri[i].skip && !stats_tri[i].derived) {
+            add_tuples(i, 3, stats_tri[i].ngrams, stats_tri[i].length);
+        }
+    }
+    for (int i = 0; i < QUAD_LENGTH; i++) {
+        if (!stats_quad[i].skip && !stats_quad[i].derived) {
+            add_tuples(i, 4, stats_quad[i].ngrams, stats_quad[i].length);
+        }
+    }
+    for (int i = 0; i < SKIP_LENGTH; i++) {
+        if (!stats_skip[i].skip && !stats_skip[i].derived) {
+            add_tuples(i, 5, stats_skip[i].ngrams, stats_skip[i].length);
+        }
+    }
+}
+
+/*
+ * Builds the reverse index from each unit to the tuples touching one of its
+ * free positions, each tuple listed once per unit.
+ */
+void index_tuples()
+{
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int fill[UNITS];
+        for (int u = 0; u < UNITS; u++) {fill[u] = pass ? touch_start[u] : 0;}
+        for (int n = 0; n < tuple_count; n++)
+        {
+            perm_tuple *t = &tuples[n];
+            int order = t->kind == 5 ? 2 : t->kind;
+            int seen[8];
+            int seen_count = 0;
+            for (int k = 0; k < order; k++)
+            {
+                int pos = t->pos[k];
+                if (!free_pos[pos / COL][pos % COL]) {continue;}
+                int units[2] = {pos % COL, COL + pos / COL};
+                for (int m = 0; m < 2; m++)
+                {
+                    int dup = 0;
+                    for (int s = 0; s < seen_count; s++) {dup |= seen[s] == units[m];}
+                    if (dup) {continue;}
+                    seen[seen_count++] = units[m];
+                    if (pass) {touch[fill[units[m]]] = n;}
+                    fill[units[m]]++;
+                }
+            }
+        }
+        if (!pass)
+        {
+            touch_start[0] = 0;
+            for (int u = 0; u < UNITS; u++) {touch_start[u + 1] = touch_start[u] + fill[u];}
+            touch = (int *)malloc(sizeof(int) * (touch_start[UNITS] + 1));
+            if (touch == NULL) {error("Failed to allocate memory for the permutation index.");}
+        }
+    }
+}
+
+/*
+ * Adds the rows or columns listed to groups, one group per distinct key,
+ * dropping groups of one.
+ */
+void group_units(int *units, long *keys, int count)
+{
+    int used[UNITS] = {0};
+    for (int i = 0; i < count; i++)
+    {
+        if (used[i]) {continue;}
+        unit_group *g = &groups[group_count];
+        g->count = 0;
+        for (int j = i; j < count; j++)
+        {
+            if (used[j] || keys[j] != keys[i]) {continue;}
+            used[j] = 1;
+            g->units[g->count++] = units[j];
+        }
+        if (g->count > 1) {group_count++;}
+    }
+}
+
+/*
+ * Groups the whole rows and columns the selected subspace permutes, builds the
+ * incremental scoring index, and logs the size of the subspace.
+ *
+ * Returns:
+ *   The number of arrangements in the subspace, 1 if nothing can move.
+ */
+double setup_subspace()
+{
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            free_pos[i][j] = !pins[i][j] && geo_hand[i][j] != '-';
+        }
+    }
+
+    /* only units with the same free positions can trade their keys */
+    group_count = 0;
+    int units[UNITS];
+    long keys[UNITS];
+    int count = 0;
+    if (subspace == 'h' || subspace == 'c' || subspace == 'a')
+    {
+        for (int j = 0; j < COL; j++)
+        {
+            long mask = 0;
+            char hand = 0;
+            int mixed = 0;
+            for (int i = 0; i < ROW; i++)
+            {
+                if (!free_pos[i][j]) {continue;}
+                mask |= 1L << i;
+                if (hand != 0 && hand != geo_hand[i][j]) {mixed = 1;}
+                hand = geo_hand[i][j];
+            }
+            /* a column across both hands has no hand to stay on */
+            if (mask == 0 || (mixed && subspace != 'c')) {continue;}
+            units[count] = j;
+            keys[count++] = subspace == 'c' ? mask : mask * 256 + hand;
+        }
+        group_units(units, keys, count);
+    }
+    count = 0;
+    if (subspace == 'r' || subspace == 'a')
+    {
+        for (int i = 0; i < ROW; i++)
+        {
+            long mask = 0;
+            for (int j = 0; j < COL; j++) {if (free_pos[i][j]) {mask |= 1L << j;}}
+            if (mask == 0) {continue;}
+            units[count] = COL + i;
+            keys[count++] = mask;
+        }
+        group_units(units, keys, count);
+    }
+
+    /* the largest group goes first, it is the one split across threads */
+    for (int i = 1; i < group_count; i++)
+    {
+        if (groups[i].count > groups[0].count)
+        {
+            unit_group swap = groups[0];
+            groups[0] = groups[i];
+            groups[i] = swap;
+        }
+    }
+
+    double total = 1;
+    for (int i = 0; i < group_count; i++)
+    {
+        for (int n = 2; n <= groups[i].count; n++) {total *= n;}
+        log_print('v',L"group %d: %d %s... ", i, groups[i].count,
+            groups[i].units[0] < COL ? "columns" : "rows");
+    }
+
+    piece_count = 1;
+    split_depth = 0;
+    if (group_count > 0)
+    {
+        while (split_depth < groups[0].count - 1 && piece_count < (long)threads * PIECES_PER_THREAD)
+        {
+            piece_count *= groups[0].count - split_depth;
+            split_depth++;
+        }
+    }
+
+    tuples = NULL;
+    gather_tuples();
+    tuples = (perm_tuple *)malloc(sizeof(perm_tuple) * (tuple_count + 1));
+    if (tuples == NULL) {error("Failed to allocate memory for the permutation index.");}
+    gather_tuples();
+    index_tuples();
+
+    log_print('n',L"%d groups, %.0f arrangements, %d tuples indexed... ",
+        group_count, total, tuple_count);
+    return total;
+}
+
+/* Frees the groups and the incremental scoring index. */
+void free_subspace()
+{
+    free(tuples);
+    free(touch);
+    tuples = NULL;
+    touch = NULL;
+    group_count = 0;
+}
+
+/* Sets up Heap's algorithm over the first count slots of a group. */
+void heap_init(heap_state *h, int *units, int count)
+{
+    h->units = units;
+    h->count = count;
+    for (int k = 0; k < UNITS; k++) {h->c[k] = 0;}
+    h->i = 1;
+}
+
+/*
+ * Advances Heap's algorithm by one swap.
+ *
+ * Returns:
+ *   1 with the two units to swap in a and b, or 0 once every arrangement of
+ *   the slots has been visited, the state then starting over from the current
+ *   arrangement.
+ */
+int heap_step(heap_state *h, int *a, int *b)
+{
+    while (h->i < h->count)
+    {
+        if (h->c[h->i] < h->i)
+        {
+            int j = h->i % 2 == 0 ? 0 : h->c[h->i];
+            *a = h->units[j];
+            *b = h->units[h->i];
+            h->c[h->i]++;
+            h->i = 1;
+            return 1;
+        }
+        h->c[h->i] = 0;
+        h->i++;
+    }
+    heap_init(h, h->units, h->count);
+    return 0;
+}
+
+/*
+ * Keeps a layout if it beats the best so far, analyzed from scratch so the
+ * kept score carries no drift.
+ */
+void consider(layout *lt, layout *best)
+{
+    if (lt->score <= best->score) {return;}
+    copy(best, lt); /* util.c */
+    single_analyze(best); /* analyze.c */
+    get_score(best); /* util.c */
+}
+
+/*
+ * Function executed by each permutation thread. Takes pieces of the subspace
+ * until none are left and walks each one swap by swap.
+ *
+ * Parameters:
+ *   arg: A pointer to a permute_data structure.
+ *
+ * Returns: NULL.
+ */
+void *permute_thread(void *arg)
+{
+    permute_data *data = (permute_data *)arg;
+    layout *lt;
+    alloc_layout(&lt); /* util.c */
+    data->best->score = -INFINITY;
+    data->evaluated = 0;
+
+    int *ids = (int *)malloc(sizeof(int) * (tuple_count + 1));
+    unsigned int *stamp = (unsigned int *)calloc(tuple_count + 1, sizeof(unsigned int));
+    if (ids == NULL || stamp == NULL) {error("Failed to allocate memory for a permutation thread.");}
+    unsigned int mark = 0;
+    stat_sums sums;
+    sums.mono = (double *)malloc(sizeof(double) * MONO_LENGTH);
+    sums.bi = (double *)malloc(sizeof(double) * BI_LENGTH);
+    sums.tri = (double *)malloc(sizeof(double) * TRI_LENGTH);
+    sums.quad = (double *)malloc(sizeof(double) * QUAD_LENGTH);
+    sums.skip = (double *)malloc(sizeof(double) * 10 * SKIP_LENGTH);
+    if (sums.mono == NULL || sums.bi == NULL || sums.tri == NULL || sums.quad == NULL
+        || sums.skip == NULL) {
+        error("Failed to allocate memory for a permutation thread.");
+    }
+
+    heap_state levels[UNITS];
+    int first[UNITS];
+    long piece;
+    while ((piece = atomic_fetch_add(&next_piece, 1)) < piece_count)
+    {
+        copy(lt, data->start); /* util.c */
+
+        /* decode the piece into the contents of the last slots of groups[0] */
+        int level_count = 0;
+        if (group_count > 0)
+        {
+            unit_group *g = &groups[0];
+            for (int k = 0; k < g->count; k++) {first[k] = g->units[k];}
+            long rest = piece;
+            for (int s = g->count - 1; s >= g->count - split_depth; s--)
+            {
+                int p = rest % (s + 1);
+                rest /= s + 1;
+                if (p != s) {swap_units(lt, first[p], first[s]);}
+            }
+            heap_init(&levels[level_count++], first, g->count - split_depth);
+            for (int i = 1; i < group_count; i++)
+            {
+                heap_init(&levels[level_count++], groups[i].units, groups[i].count);
+            }
+        }
+
+        single_analyze(lt); /* analyze.c */
+        get_score(lt); /* util.c */
+        load_sums(&sums, lt);
+        consider(lt, data->best);
+        data->evaluated++;
+
+        long steps = 0;
+        while (!atomic_load_explicit(&stop_requested, memory_order_relaxed))
+        {
+            /* the innermost group that still has a swap, resetting those done */
+            int a, b, level = level_count - 1;
+            while (level >= 0 && !heap_step(&levels[level], &a, &b)) {level--;}
+            if (level < 0) {break;}
+
+            if (++mark == 0)
+            {
+                memset(stamp, 0, sizeof(unsigned int) * tuple_count);
+                mark = 1;
+            }
+            int count = 0;
+            int units[2] = {a, b};
+            for (int m = 0; m < 2; m++)
+            {
+                for (int n = touch_start[units[m]]; n < touch_start[units[m] + 1]; n++)
+                {
+                    if (stamp[touch[n]] == mark) {continue;}
+                    stamp[touch[n]] = mark;
+                    ids[count++] = touch[n];
+                }
+            }
+
+            apply_tuples(lt, &sums, ids, count, -1);
+            swap_units(lt, a, b);
+            if (++steps % RESYNC_STEPS == 0)
+            {
+                single_analyze(lt); /* analyze.c */
+                load_sums(&sums, lt);
+            }
+            else
+            {
+                apply_tuples(lt, &sums, ids, count, 1);
+                store_sums(&sums, lt);
+                five_analyze(lt); /* fivegram.c */
+                derive_stats(lt); /* analyze.c */
+                meta_analyze(lt); /* analyze.c */
+            }
+            get_score(lt); /* util.c */
+            consider(lt, data->best);
+            data->evaluated++;
+        }
+    }
+
+    /* a thread left without a piece keeps the start */
+    if (data->best->score == -INFINITY) {copy(data->best, data->start);} /* util.c */
+    free(ids);
+    free(stamp);
+    free(sums.mono);
+    free(sums.bi);
+    free(sums.tri);
+    free(sums.quad);
+    free(sums.skip);
+    free_layout(lt); /* util.c */
+    return NULL;
+}
+
+/*
+ * Enumerates every arrangement of the subspace around a layout on all threads
+ * and keeps each thread's best.
+ *
+ * Parameters:
+ *   lt: The analyzed starting layout.
+ *   best_layouts: Receives threads allocated layouts, each analyzed exactly.
+ *
+ * Returns:
+ *   The number of arrangements scored.
+ */
+double search_subspace(layout *lt, layout **best_layouts)
+{
+    permute_data *data = (permute_data *)malloc(sizeof(permute_data) * threads);
+    pthread_t *thread_ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    if (data == NULL || thread_ids == NULL) {error("Failed to allocate memory for permutation threads.");}
+
+    atomic_store(&next_piece, 0);
+    for (int i = 0; i < threads; i++)
+    {
+        alloc_layout(&best_layouts[i]); /* util.c */
+        data[i].start = lt;
+        data[i].best = best_layouts[i];
+        pthread_create(&thread_ids[i], NULL, permute_thread, (void *)&data[i]);
+    }
+    double evaluated = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(thread_ids[i], NULL);
+        evaluated += data[i].evaluated;
+    }
+
+    free(data);
+    free(thread_ids);
+    return evaluated;
+}
@@ -0,0 +1,213 @@
+/*
+ * quadmodel.c - Approximated quadgram frequencies for the GULAG.
+ *
+ * The dense quadgram tables hold 51^4 entries twice over, once as counts and
+ * once as percentages, about 54 MB together. Quadgrams carry little more
+ * information than the trigrams they are made of, so a first order Markov
+ * chain over trigrams recovers most of them:
+ *
+ *     P(abcd) ~ P(abc) * P(bcd) / P(bc)
+ *
+ * In the markov model every quadgram is estimated this way from linear_tri
+ * and linear_bi. In the hybrid model the quadgrams carrying the top share of
+ * the quadgram mass are kept exactly in a small hash table and the estimate,
+ * rescaled to the mass left over, covers the rest. Either way both dense
+ * tables are freed once the model is built, and the error of the model
+ * against the exact table it replaced is reported. The dense tables are still
+ * filled while the corpus is read, so the peak of the start up is unchanged,
+ * only the footprint of the rest of the run drops.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <wchar.h>
+
+#include "quadmodel.h"
+#include "io_util.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+
+/* Exactly kept quadgrams, keyed by linear index + 1 so that 0 is empty. */
+int *quad_keys = NULL;
+float *quad_values = NULL;
+unsigned int quad_mask = 0;
+int quad_kept = 0;
+
+/* Scales the estimate so the quadgrams not kept sum to the mass left over. */
+float quad_scale = 1.0;
+
+/* Returns the hash table slot of a quadgram key, or the empty slot for it. */
+unsigned int quad_slot(int key)
+{
+    unsigned int slot = ((unsigned int)key * 2654435761u) & quad_mask;
+    while (quad_keys[slot] != 0 && quad_keys[slot] != key)
+    {
+        slot = (slot + 1) & quad_mask;
+    }
+    return slot;
+}
+
+/* Returns the unscaled markov estimate of a quadgram, in percent. */
+float quad_markov(int i, int j, int k, int l)
+{
+    float context = linear_bi[index_bi(j, k)];
+    if (context <= 0) {return 0;}
+    return linear_tri[index_tri(i, j, k)] * linear_tri[index_tri(j, k, l)] / context;
+}
+
+/* Orders quadgram indices by descending frequency in linear_quad. */
+int compare_quad_mass(const void *a, const void *b)
+{
+    float x = linear_quad[*(const int *)a];
+    float y = linear_quad[*(const int *)b];
+    return (x < y) - (x > y);
+}
+
+/*
+ * Picks the most frequent quadgrams until they hold quad_mass percent of the
+ * quadgram mass and stores them in the hash table.
+ *
+ * Returns:
+ *   The share of the quadgram mass kept, in percent.
+ */
+float keep_top_quads()
+{
+    int size = LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH;
+    int seen = 0;
+    for (int n = 0; n < size; n++) {if (linear_quad[n] > 0) {seen++;}}
+
+    int *order = (int *)malloc(sizeof(int) * (seen + 1));
+    if (order == NULL) {error("Failed to allocate memory for the quadgram model.");}
+    seen = 0;
+    for (int n = 0; n < size; n++) {if (linear_quad[n] > 0) {order[seen++] = n;}}
+    qsort(order, seen, sizeof(int), compare_quad_mass);
+
+    float kept_mass = 0;
+    quad_kept = 0;
+    while (quad_kept < seen && kept_mass < quad_mass)
+    {
+        kept_mass += linear_quad[order[quad_kept++]];
+    }
+
+    unsigned int slots = 16;
+    while (slots < (unsigned int)quad_kept * 2) {slots *= 2;}
+    quad_mask = slots - 1;
+    quad_keys = (int *)calloc(slots, sizeof(int));
+    quad_values = (float *)malloc(sizeof(float) * slots);
+    if (quad_keys == NULL || quad_values == NULL) {
+        error("Failed to allocate memory for the quadgram model.");
+    }
+    for (int n = 0; n < quad_kept; n++)
+    {
+        unsigned int slot = quad_slot(order[n] + 1);
+        quad_keys[slot] = order[n] + 1;
+        quad_values[slot] = linear_quad[order[n]];
+    }
+    free(order);
+    return kept_mass;
+}
+
+/* Returns the bytes held by the hash table of exactly kept quadgrams. */
+size_t quad_model_bytes()
+{
+    if (quad_kept == 0) {return 0;}
+    return (size_t)(quad_mask + 1) * (sizeof(int) + sizeof(float));
+}
+
+/*
+ * Builds the selected quadgram model from the normalized corpus, reports its
+ * error against the exact quadgram table, then frees both dense quadgram
+ * tables.
+ */
+void build_quad_model()
+{
+    float kept_mass = 0;
+    if (quad_model == 'h') {kept_mass = keep_top_quads();}
+
+    /* rescale the estimate of everything not kept to the mass left over */
+    double estimated = 0;
+    for (int i = 0; i < LANG_LENGTH; i++) {
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                for (int l = 0; l < LANG_LENGTH; l++) {
+                    if (quad_kept > 0
+                        && quad_keys[quad_slot(index_quad(i, j, k, l) + 1)] != 0) {
+                        continue;
+                    }
+                    estimated += quad_markov(i, j, k, l);
+                }
+            }
+        }
+    }
+    quad_scale = estimated > 0 ? (100 - kept_mass) / estimated : 0;
+
+    /* the summed error bounds the error of any quadgram stat */
+    double total_error = 0;
+    float worst_error = 0;
+    for (int i = 0; i < LANG_LENGTH; i++) {
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                for (int l = 0; l < LANG_LENGTH; l++) {
+                    float diff = fabsf(quad_frequency(i, j, k, l)
+                        - linear_quad[index_quad(i, j, k, l)]);
+                    total_error += diff;
+                    if (diff > worst_error) {worst_error = diff;}
+                }
+            }
+        }
+    }
+
+    if (quad_model == 'h') {
+        log_print('n',L"kept %d quadgrams (%.1f%% of mass)... ", quad_kept, kept_mass);
+    }
+    log_print('n',L"error %.3f%% of mass, worst quadgram %.4f%%... ",
+        total_error, worst_error);
+
+    /* nothing reads the dense tables past this point */
+    for (int i = 0; i < LANG_LENGTH; i++) {
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                free(corpus_quad[i][j][k]);
+            }
+            free(corpus_quad[i][j]);
+        }
+        free(corpus_quad[i]);
+    }
+    free(corpus_quad);
+    free(linear_quad);
+    corpus_quad = NULL;
+    linear_quad = NULL;
+    log_print('n',L"freed %.1f MB, model holds %.1f MB... ",
+        (double)LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH
+        * (sizeof(int) + sizeof(float)) / 1e6, quad_model_bytes() / 1e6);
+}
+
+/*
+ * Returns the frequency of a quadgram under the model in use, in percent of
+ * all quadgrams: the exact value when the quadgram is kept, the rescaled
+ * markov estimate otherwise.
+ *
+ * Parameters:
+ *   i, j, k, l: The indices of the characters in the language array.
+ */
+float quad_frequency(int i, int j, int k, int l)
+{
+    if (quad_kept > 0)
+    {
+        unsigned int slot = quad_slot(index_quad(i, j, k, l) + 1);
+        if (quad_keys[slot] != 0) {return quad_values[slot];}
+    }
+    return quad_markov(i, j, k, l) * quad_scale;
+}
+
+/* Frees the hash table of exactly kept quadgrams. */
+void free_quad_model()
+{
+    free(quad_keys);
+    free(quad_values);
+    quad_keys = NULL;
+    quad_values = NULL;
+    quad_kept = 0;
+}
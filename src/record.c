@@ -0,0 +1,451 @@
+/*
+ * record.c - Machine readable layout records for the GULAG.
+ *
+ * The human readable output is built from many small wide character writes
+ * meant for a terminal. Tools that process thousands of layouts instead want
+ * one record per layout in a stable format, so this file streams JSON lines,
+ * CSV, or TSV records to a separate file. Records are assembled as UTF-8
+ * bytes in a large buffer that is handed to write() only when full, so the
+ * output runs at disk speed regardless of how many fields a record has.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <wchar.h>
+#include <limits.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "record.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "five.h"
+#include "global.h"
+#include "structs.h"
+
+/* Size of the output buffer in bytes. */
+#define RECORD_BUFFER_SIZE (1 << 20)
+
+int record_fd = -1;
+char *record_buffer;
+size_t record_used;
+int record_count;
+
+/* Writes the whole buffer to the record file. */
+void record_flush()
+{
+    size_t done = 0;
+    while (done < record_used)
+    {
+        ssize_t written = write(record_fd, record_buffer + done, record_used - done);
+        if (written < 0)
+        {
+            if (errno == EINTR) {continue;}
+            error("Failed to write to the record file.");
+        }
+        done += written;
+    }
+    record_used = 0;
+}
+
+/* Appends raw bytes to the buffer. */
+void record_bytes(const char *bytes, size_t length)
+{
+    if (record_used + length > RECORD_BUFFER_SIZE) {record_flush();}
+    memcpy(record_buffer + record_used, bytes, length);
+    record_used += length;
+}
+
+/* Appends a single byte to the buffer. */
+void record_char(char c)
+{
+    if (record_used == RECORD_BUFFER_SIZE) {record_flush();}
+    record_buffer[record_used++] = c;
+}
+
+/* Appends formatted text to the buffer, meant for short fields like numbers. */
+void record_printf(const char *format, ...)
+{
+    if (RECORD_BUFFER_SIZE - record_used < 64) {record_flush();}
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(record_buffer + record_used, RECORD_BUFFER_SIZE - record_used, format, args);
+    va_end(args);
+    if (length < 0 || (size_t)length >= RECORD_BUFFER_SIZE - record_used)
+    {
+        error("Failed to format a record field.");
+    }
+    record_used += length;
+}
+
+/* Appends a string field, quoted or escaped as the format requires. */
+void record_text(const char *text)
+{
+    size_t length = strlen(text);
+    switch (format_mode)
+    {
+        case 'j':
+            record_char('"');
+            for (size_t i = 0; i < length; i++)
+            {
+                unsigned char c = text[i];
+                if (c == '"' || c == '\\') {record_char('\\'); record_char(c);}
+                else if (c < 0x20) {record_printf("\\u%04x", c);}
+                else {record_char(c);}
+            }
+            record_char('"');
+            break;
+        case 'c':
+            /* quote only when needed, doubling any quotes inside */
+            if (strpbrk(text, ",\"\r\n") == NULL) {record_bytes(text, length); break;}
+            record_char('"');
+            for (size_t i = 0; i < length; i++)
+            {
+                if (text[i] == '"') {record_char('"');}
+                record_char(text[i]);
+            }
+            record_char('"');
+            break;
+        default:
+        case 't':
+            /* tsv fields cannot hold tabs or newlines, escape them */
+            for (size_t i = 0; i < length; i++)
+            {
+                switch (text[i])
+                {
+                    case '\t': record_bytes("\\t", 2); break;
+                    case '\n': record_bytes("\\n", 2); break;
+                    case '\r': record_bytes("\\r", 2); break;
+                    case '\\': record_bytes("\\\\", 2); break;
+                    default: record_char(text[i]); break;
+                }
+            }
+            break;
+    }
+}
+
+/* Appends a stat or score value, JSON has no representation for nan or inf. */
+void record_value(float value)
+{
+    if (format_mode == 'j' && !isfinite(value)) {record_bytes("null", 4);}
+    else {record_printf("%.9g", value);}
+}
+
+/* Appends the field separator of the delimited formats. */
+void record_separator()
+{
+    record_char(format_mode == 'c' ? ',' : '\t');
+}
+
+/*
+ * Converts one row of a layout matrix to a UTF-8 string.
+ * Parameters:
+ *   lt: The layout.
+ *   i: The row index.
+ *   out: A buffer of at least COL * MB_LEN_MAX + 1 bytes.
+ */
+void record_row_text(layout *lt, int i, char *out)
+{
+    mbstate_t state;
+    memset(&state, 0, sizeof(state));
+    size_t used = 0;
+    for (int j = 0; j < COL; j++)
+    {
+        size_t n = wcrtomb(out + used, convert_back(lt->matrix[i][j]), &state); /* io_util.c */
+        if (n == (size_t)-1) {out[used] = '?'; n = 1;}
+        used += n;
+    }
+    out[used] = '\0';
+}
+
+/*
+ * Appends a stat to the current record. In the delimited formats this is a
+ * column, either its name for the header row or its value, in JSON it is a
+ * member of the group's object.
+ * Parameters:
+ *   name: The stat name.
+ *   value: The stat value.
+ *   header: 1 when writing the header row.
+ *   first: Points to 1 for the first member of a JSON object, cleared here.
+ */
+void record_stat(const char *name, float value, int header, int *first)
+{
+    if (format_mode == 'j')
+    {
+        if (!*first) {record_char(',');}
+        *first = 0;
+        record_text(name);
+        record_char(':');
+        record_value(value);
+        return;
+    }
+    record_separator();
+    if (header) {record_text(name);}
+    else {record_value(value);}
+}
+
+/* Opens a group of stats in a JSON record. */
+void record_group(const char *group, int *first_group, int *first)
+{
+    if (format_mode != 'j') {return;}
+    if (!*first_group) {record_char(',');}
+    *first_group = 0;
+    record_text(group);
+    record_bytes(":{", 2);
+    *first = 1;
+}
+
+/* Closes a group of stats in a JSON record. */
+void record_group_end()
+{
+    if (format_mode == 'j') {record_char('}');}
+}
+
+/*
+ * Appends every active stat of a layout to the current record, in the same
+ * order the human readable output uses.
+ * Parameters:
+ *   lt: The layout, unused for the header row.
+ *   header: 1 when writing the header row of a delimited format.
+ */
+void record_stats(layout *lt, int header)
+{
+    int first_group = 1, first = 1;
+    char name[80];
+
+    record_group("monogram", &first_group, &first);
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if (stats_mono[i].skip || stats_mono[i].hidden) {continue;}
+        record_stat(stats_mono[i].name, header ? 0 : lt->mono_score[i], header, &first);
+    }
+    record_group_end();
+
+    record_group("bigram", &first_group, &first);
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        if (stats_bi[i].skip || stats_bi[i].hidden) {continue;}
+        record_stat(stats_bi[i].name, header ? 0 : lt->bi_score[i], header, &first);
+    }
+    record_group_end();
+
+    record_group("trigram", &first_group, &first);
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        if (stats_tri[i].skip || stats_tri[i].hidden) {continue;}
+        record_stat(stats_tri[i].name, header ? 0 : lt->tri_score[i], header, &first);
+    }
+    record_group_end();
+
+    record_group("quadgram", &first_group, &first);
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        if (stats_quad[i].skip || stats_quad[i].hidden) {continue;}
+        record_stat(stats_quad[i].name, header ? 0 : lt->quad_score[i], header, &first);
+    }
+    record_group_end();
+
+    /* skipgrams have one value per skip distance */
+    record_group("skipgram", &first_group, &first);
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if (stats_skip[i].skip || stats_skip[i].hidden) {continue;}
+        if (format_mode == 'j')
+        {
+            if (!first) {record_char(',');}
+            first = 0;
+            record_text(stats_skip[i].name);
+            record_bytes(":[", 2);
+            for (int j = 1; j <= 9; j++)
+            {
+                if (j > 1) {record_char(',');}
+                record_value(lt->skip_score[j][i]);
+            }
+            record_char(']');
+            continue;
+        }
+        for (int j = 1; j <= 9; j++)
+        {
+            snprintf(name, sizeof(name), "%s %d", stats_skip[i].name, j);
+            record_stat(name, header ? 0 : lt->skip_score[j][i], header, &first);
+        }
+    }
+    record_group_end();
+
+    record_group("meta", &first_group, &first);
+    for (int i = 0; i < META_LENGTH; i++)
+    {
+        if (stats_meta[i].skip) {continue;}
+        record_stat(stats_meta[i].name, header ? 0 : lt->meta_score[i], header, &first);
+    }
+    record_group_end();
+
+    /* five-grams only get a group when one of their stats is used */
+    if (count_five_stats() == 0) {return;} /* stats/five.c */
+    record_group("five", &first_group, &first);
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        if (stats_five[i].skip) {continue;}
+        record_stat(stats_five[i].name, header ? 0 : lt->five_score[i], header, &first);
+    }
+    record_group_end();
+}
+
+/*
+ * Opens the record file selected by 'format_file' for the machine readable
+ * output chosen with 'format_mode'. Does nothing in the human readable
+ * format.
+ */
+void record_open()
+{
+    if (format_mode == 'h') {return;}
+    record_fd = open(format_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (record_fd < 0) {error("Failed to open the record file.");}
+    record_buffer = (char *)malloc(RECORD_BUFFER_SIZE);
+    if (record_buffer == NULL) {error("Failed to allocate memory for the record buffer.");}
+    record_used = 0;
+    record_count = 0;
+}
+
+/*
+ * Appends one record for a layout to the record file: its name, score,
+ * matrix, and the value of every active stat. CSV and TSV files get a header
+ * row before the first record. Does nothing in the human readable format.
+ *
+ * Parameters:
+ *   lt: A pointer to the analyzed and scored layout.
+ */
+void record_layout(layout *lt)
+{
+    if (record_fd < 0) {return;}
+    char row_text[COL * MB_LEN_MAX + 1];
+
+    if (format_mode == 'j')
+    {
+        record_bytes("{\"name\":", 8);
+        record_text(lt->name);
+        record_bytes(",\"score\":", 9);
+        record_value(lt->score);
+        record_bytes(",\"matrix\":[", 11);
+        for (int i = 0; i < ROW; i++)
+        {
+            if (i > 0) {record_char(',');}
+            record_row_text(lt, i, row_text);
+            record_text(row_text);
+        }
+        record_bytes("],\"stats\":{", 11);
+        record_stats(lt, 0);
+        record_bytes("}}\n", 3);
+        record_count++;
+        return;
+    }
+
+    if (record_count == 0)
+    {
+        record_text("name");
+        record_separator();
+        record_text("score");
+        for (int i = 0; i < ROW; i++)
+        {
+            record_separator();
+            record_printf("row %d", i);
+        }
+        record_stats(NULL, 1);
+        record_char('\n');
+    }
+
+    record_text(lt->name);
+    record_separator();
+    record_value(lt->score);
+    for (int i = 0; i < ROW; i++)
+    {
+        record_separator();
+        record_row_text(lt, i, row_text);
+        record_text(row_text);
+    }
+    record_stats(lt, 0);
+    record_char('\n');
+    record_count++;
+}
+
+/*
+ * Appends the best score against time curve of one benchmark run to the
+ * record file: a JSON record with both series, or one CSV or TSV row per
+ * point under a header row. Does nothing if no record file is open.
+ *
+ * Parameters:
+ *   name: The configuration that ran.
+ *   seed: The seed of the run.
+ *   curve: The best score at each point.
+ *   points: The number of points.
+ *   step: The seconds between points, the first is one step in.
+ */
+void record_curve(const char *name, int seed, float *curve, int points, float step)
+{
+    if (record_fd < 0) {return;}
+
+    if (format_mode == 'j')
+    {
+        record_bytes("{\"name\":", 8);
+        record_text(name);
+        record_printf(",\"seed\":%d,\"seconds\":[", seed);
+        for (int i = 0; i < points; i++)
+        {
+            if (i > 0) {record_char(',');}
+            record_printf("%.6g", (i + 1) * step);
+        }
+        record_bytes("],\"best\":[", 10);
+        for (int i = 0; i < points; i++)
+        {
+            if (i > 0) {record_char(',');}
+            record_value(curve[i]);
+        }
+        record_bytes("]}\n", 3);
+        record_count++;
+        return;
+    }
+
+    if (record_count == 0)
+    {
+        record_text("name");
+        record_separator();
+        record_text("seed");
+        record_separator();
+        record_text("seconds");
+        record_separator();
+        record_text("best");
+        record_char('\n');
+    }
+    for (int i = 0; i < points; i++)
+    {
+        record_text(name);
+        record_separator();
+        record_printf("%d", seed);
+        record_separator();
+        record_printf("%.6g", (i + 1) * step);
+        record_separator();
+        record_value(curve[i]);
+        record_char('\n');
+    }
+    record_count++;
+}
+
+/*
+ * Writes out any buffered records and closes the record file. Does nothing if
+ * no record file is open.
+ */
+void record_close()
+{
+    if (record_fd < 0) {return;}
+    record_flush();
+    close(record_fd);
+    record_fd = -1;
+    free(record_buffer);
+    log_print('q', L"Wrote %d record%s to %s\n", record_count,
+        record_count == 1 ? "" : "s", format_file);
+}
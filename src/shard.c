@@ -0,0 +1,440 @@
+/*
+ * shard.c - Corpus shards for robustness evaluation in the GULAG.
+ *
+ * A layout tuned to one corpus can overfit to it. When shards are requested
+ * the corpus text is split into byte ranges, cut at line ends, and each range
+ * is normalized on its own. The tables of all shards are stacked so the
+ * frequencies of one ngram in every shard sit next to each other, which lets
+ * a layout be scored against all shards in one walk over the stats: each
+ * ngram's index is calculated once and its values are gathered together.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <math.h>
+
+#include "shard.h"
+#include "analyze.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* How many characters may pass without a line end before a cut is tried. */
+#define SHARD_CHECK_INTERVAL 65536
+
+/* Stacked normalized tables, the values of an ngram are shard_count wide. */
+float *shard_mono;
+float *shard_bi;
+float *shard_tri;
+float *shard_quad;
+float *shard_skip;
+
+/* Number of characters read into each shard. */
+long shard_sizes[SHARD_MAX];
+
+/*
+ * Normalizes the global corpus counts into one shard's slice of the stacked
+ * tables, the same way normalize_corpus() fills the full corpus tables.
+ *
+ * Parameters:
+ *   shard: The index of the shard.
+ */
+void normalize_shard(int shard)
+{
+    size_t K = shard_count;
+    long long total_mono = 0;
+    long long total_bi = 0;
+    long long total_tri = 0;
+    long long total_quad = 0;
+    long long total_skip[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    for (int i = 0; i < LANG_LENGTH; i++) {
+        total_mono += corpus_mono[i];
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            total_bi += corpus_bi[i][j];
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                total_tri += corpus_tri[i][j][k];
+                for (int l = 0; l < LANG_LENGTH; l++) {
+                    total_quad += corpus_quad[i][j][k][l];
+                }
+            }
+        }
+    }
+    for (int i = 1; i <= 9; i++) {
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                total_skip[i] += corpus_skip[i][j][k];
+            }
+        }
+    }
+
+    for (int i = 0; i < LANG_LENGTH; i++) {
+        if (total_mono > 0) {
+            shard_mono[index_mono(i) * K + shard] = (float)corpus_mono[i] * 100 / total_mono;
+        }
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            if (total_bi > 0) {
+                shard_bi[index_bi(i, j) * K + shard] = (float)corpus_bi[i][j] * 100 / total_bi;
+            }
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                if (total_tri > 0) {
+                    shard_tri[index_tri(i, j, k) * K + shard] = (float)corpus_tri[i][j][k] * 100 / total_tri;
+                }
+                if (total_quad == 0) {continue;}
+                for (int l = 0; l < LANG_LENGTH; l++) {
+                    shard_quad[index_quad(i, j, k, l) * K + shard] = (float)corpus_quad[i][j][k][l] * 100 / total_quad;
+                }
+            }
+        }
+    }
+    for (int i = 1; i <= 9; i++) {
+        if (total_skip[i] == 0) {continue;}
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                shard_skip[index_skip(i, j, k) * K + shard] = (float)corpus_skip[i][j][k] * 100 / total_skip[i];
+            }
+        }
+    }
+}
+
+/* Returns the byte offset where a shard ends. */
+long shard_boundary(long size, int shard)
+{
+    return (long)((long long)size * (shard + 1) / shard_count);
+}
+
+/*
+ * Splits the corpus text into 'shard_count' byte ranges, cut at line ends,
+ * and normalizes each range into its own slice of the stacked shard tables.
+ * The global corpus count arrays are used as scratch space, so this must run
+ * after the full corpus has been normalized.
+ */
+void read_shards()
+{
+    FILE *corpus;
+    /* Construct the path to the corpus text file. */
+    char *path = (char*)malloc(strlen("./data//corpora/.txt") +
+        strlen(lang_name) + strlen(corpus_name) + 1);
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/corpora/");
+    strcat(path, corpus_name);
+    strcat(path, ".txt");
+    corpus = fopen(path, "r");
+    if (corpus == NULL) {
+        error("Corpus shards need the corpus text file, the cache alone is not enough.");
+    }
+
+    /* the size of the file decides where the shards are cut */
+    fseek(corpus, 0, SEEK_END);
+    long size = ftell(corpus);
+    rewind(corpus);
+
+    size_t K = shard_count;
+    size_t L = LANG_LENGTH;
+    shard_mono = (float *)calloc(L * K, sizeof(float));
+    shard_bi = (float *)calloc(L * L * K, sizeof(float));
+    shard_tri = (float *)calloc(L * L * L * K, sizeof(float));
+    shard_quad = (float *)calloc(L * L * L * L * K, sizeof(float));
+    shard_skip = (float *)calloc(10 * L * L * K, sizeof(float));
+    if (shard_mono == NULL || shard_bi == NULL || shard_tri == NULL
+        || shard_quad == NULL || shard_skip == NULL) {
+        error("Failed to allocate memory for corpus shards.");
+    }
+
+    /* Memory for the last 11 seen characters */
+    int mem[] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+    clear_corpus(); /* util.c */
+    int shard = 0;
+    long boundary = shard_boundary(size, shard);
+    long unchecked = 0;
+    wchar_t curr;
+    while ((curr = fgetwc(corpus)) != WEOF) {
+        /* convert characters based on the lang file */
+        mem[0] = convert_char(curr); /* io_util.c */
+        count_ngrams(mem); /* io.c */
+        /* shift over an array one index, dropping the last value */
+        iterate(mem, 11); /* io_util.c */
+        shard_sizes[shard]++;
+
+        /* cut at line ends, or anywhere in text that has none */
+        if (shard < shard_count - 1 && (curr == L'\n' || ++unchecked >= SHARD_CHECK_INTERVAL)) {
+            unchecked = 0;
+            if (ftell(corpus) >= boundary) {
+                normalize_shard(shard);
+                /* ngrams do not cross into the next shard */
+                clear_corpus(); /* util.c */
+                for (int i = 0; i < 11; i++) {mem[i] = -1;}
+                shard++;
+                boundary = shard_boundary(size, shard);
+            }
+        }
+    }
+    normalize_shard(shard);
+
+    fclose(corpus);
+    free(path);
+
+    if (shard < shard_count - 1 || shard_sizes[shard] == 0) {
+        error("Corpus is too small to split into that many shards.");
+    }
+    for (int i = 0; i < shard_count; i++) {
+        log_print('v',L"Shard %d: %ld characters... ", i + 1, shard_sizes[i]);
+    }
+}
+
+/* Frees the stacked shard tables. */
+void free_shards()
+{
+    free(shard_mono);
+    free(shard_bi);
+    free(shard_tri);
+    free(shard_quad);
+    free(shard_skip);
+}
+
+/* Adds the frequencies of one ngram in every shard to a row of sums. */
+void gather(float *sums, const float *table, size_t index)
+{
+    const float *values = table + index * shard_count;
+    for (int s = 0; s < shard_count; s++) {sums[s] += values[s];}
+}
+
+/*
+ * Scores a layout against every corpus shard in a single walk over the stats.
+ * Each ngram's index is calculated once and its frequency in every shard is
+ * gathered from the stacked tables. The layout's stats are left holding the
+ * values of the last shard.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout to analyze.
+ *   scores: Filled with the score of the layout on each of the shards.
+ */
+void shard_analyze(layout *lt, float *scores)
+{
+    int K = shard_count;
+    int row0, col0, row1, col1, row2, col2, row3, col3;
+
+    /* one row of K sums per stat, skipgrams have one block per distance */
+    float mono[MONO_LENGTH * K + 1];
+    float bi[BI_LENGTH * K + 1];
+    float tri[TRI_LENGTH * K + 1];
+    float quad[QUAD_LENGTH * K + 1];
+    float skip[10 * SKIP_LENGTH * K + 1];
+    memset(mono, 0, sizeof(mono));
+    memset(bi, 0, sizeof(bi));
+    memset(tri, 0, sizeof(tri));
+    memset(quad, 0, sizeof(quad));
+    memset(skip, 0, sizeof(skip));
+
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if (stats_mono[i].skip || stats_mono[i].derived) {continue;}
+        for (int j = 0; j < stats_mono[i].length; j++)
+        {
+            unflat_mono(stats_mono[i].ngrams[j], &row0, &col0); /* util.c */
+            if (lt->matrix[row0][col0] != -1)
+            {
+                gather(&mono[i * K], shard_mono, index_mono(lt->matrix[row0][col0])); /* util.c */
+            }
+        }
+    }
+
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        if (stats_bi[i].skip || stats_bi[i].derived) {continue;}
+        for (int j = 0; j < stats_bi[i].length; j++)
+        {
+            unflat_bi(stats_bi[i].ngrams[j], &row0, &col0, &row1, &col1); /* util.c */
+            if (lt->matrix[row0][col0] != -1 && lt->matrix[row1][col1] != -1)
+            {
+                gather(&bi[i * K], shard_bi, index_bi(lt->matrix[row0][col0], lt->matrix[row1][col1])); /* util.c */
+            }
+        }
+    }
+
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        if (stats_tri[i].skip || stats_tri[i].derived) {continue;}
+        for (int j = 0; j < stats_tri[i].length; j++)
+        {
+            unflat_tri(stats_tri[i].ngrams[j], &row0, &col0, &row1, &col1, &row2, &col2); /* util.c */
+            if (lt->matrix[row0][col0] != -1 && lt->matrix[row1][col1] != -1 && lt->matrix[row2][col2] != -1)
+            {
+                gather(&tri[i * K], shard_tri, index_tri(lt->matrix[row0][col0], lt->matrix[row1][col1],
+                    lt->matrix[row2][col2])); /* util.c */
+            }
+        }
+    }
+
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        if (stats_quad[i].skip || stats_quad[i].derived) {continue;}
+        for (int j = 0; j < stats_quad[i].length; j++)
+        {
+            unflat_quad(stats_quad[i].ngrams[j], &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3); /* util.c */
+            if (lt->matrix[row0][col0] != -1 && lt->matrix[row1][col1] != -1 && lt->matrix[row2][col2] != -1 && lt->matrix[row3][col3] != -1)
+            {
+                gather(&quad[i * K], shard_quad, index_quad(lt->matrix[row0][col0], lt->matrix[row1][col1],
+                    lt->matrix[row2][col2], lt->matrix[row3][col3])); /* util.c */
+            }
+        }
+    }
+
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if (stats_skip[i].skip || stats_skip[i].derived) {continue;}
+        for (int j = 0; j < stats_skip[i].length; j++)
+        {
+            unflat_bi(stats_skip[i].ngrams[j], &row0, &col0, &row1, &col1); /* util.c */
+            if (lt->matrix[row0][col0] != -1 && lt->matrix[row1][col1] != -1)
+            {
+                for (int k = 1; k <= 9; k++)
+                {
+                    gather(&skip[(k * SKIP_LENGTH + i) * K], shard_skip,
+                        index_skip(k, lt->matrix[row0][col0], lt->matrix[row1][col1])); /* util.c */
+                }
+            }
+        }
+    }
+
+    /* Derived statistics are the sum of their disjoint children in every shard. */
+    for (int s = 0; s < K; s++)
+    {
+        for (int i = 0; i < MONO_LENGTH; i++)
+        {
+            if (!stats_mono[i].derived) {continue;}
+            for (int j = 0; j < stats_mono[i].child_count; j++) {mono[i * K + s] += mono[stats_mono[i].children[j] * K + s];}
+        }
+        for (int i = 0; i < BI_LENGTH; i++)
+        {
+            if (!stats_bi[i].derived) {continue;}
+            for (int j = 0; j < stats_bi[i].child_count; j++) {bi[i * K + s] += bi[stats_bi[i].children[j] * K + s];}
+        }
+        for (int i = 0; i < TRI_LENGTH; i++)
+        {
+            if (!stats_tri[i].derived) {continue;}
+            for (int j = 0; j < stats_tri[i].child_count; j++) {tri[i * K + s] += tri[stats_tri[i].children[j] * K + s];}
+        }
+        for (int i = 0; i < QUAD_LENGTH; i++)
+        {
+            if (!stats_quad[i].derived) {continue;}
+            for (int j = 0; j < stats_quad[i].child_count; j++) {quad[i * K + s] += quad[stats_quad[i].children[j] * K + s];}
+        }
+        for (int i = 0; i < SKIP_LENGTH; i++)
+        {
+            if (!stats_skip[i].derived) {continue;}
+            for (int k = 1; k <= 9; k++)
+            {
+                for (int j = 0; j < stats_skip[i].child_count; j++)
+                {
+                    skip[(k * SKIP_LENGTH + i) * K + s] += skip[(k * SKIP_LENGTH + stats_skip[i].children[j]) * K + s];
+                }
+            }
+        }
+    }
+
+    /* Score each shard, meta statistics depend on the shard's own values. */
+    for (int s = 0; s < K; s++)
+    {
+        for (int i = 0; i < MONO_LENGTH; i++)
+        {
+            if (!stats_mono[i].skip || stats_mono[i].derived) {lt->mono_score[i] = mono[i * K + s];}
+        }
+        for (int i = 0; i < BI_LENGTH; i++)
+        {
+            if (!stats_bi[i].skip || stats_bi[i].derived) {lt->bi_score[i] = bi[i * K + s];}
+        }
+        for (int i = 0; i < TRI_LENGTH; i++)
+        {
+            if (!stats_tri[i].skip || stats_tri[i].derived) {lt->tri_score[i] = tri[i * K + s];}
+        }
+        for (int i = 0; i < QUAD_LENGTH; i++)
+        {
+            if (!stats_quad[i].skip || stats_quad[i].derived) {lt->quad_score[i] = quad[i * K + s];}
+        }
+        for (int i = 0; i < SKIP_LENGTH; i++)
+        {
+            if (stats_skip[i].skip && !stats_skip[i].derived) {continue;}
+            for (int k = 1; k <= 9; k++) {lt->skip_score[k][i] = skip[(k * SKIP_LENGTH + i) * K + s];}
+        }
+        meta_analyze(lt); /* analyze.c */
+        get_score(lt); /* util.c */
+        scores[s] = lt->score;
+    }
+}
+
+/*
+ * Summarizes the scores of a layout on the corpus shards.
+ *
+ * Parameters:
+ *   scores: The score on each shard.
+ *   mean: Set to the mean score.
+ *   sd: Set to the standard deviation of the scores.
+ *   worst: Set to the lowest score.
+ */
+void shard_summary(float *scores, float *mean, float *sd, float *worst)
+{
+    double sum = 0, sum_sq = 0;
+    *worst = scores[0];
+    for (int s = 0; s < shard_count; s++)
+    {
+        sum += scores[s];
+        if (scores[s] < *worst) {*worst = scores[s];}
+    }
+    *mean = sum / shard_count;
+    for (int s = 0; s < shard_count; s++)
+    {
+        sum_sq += (scores[s] - *mean) * (scores[s] - *mean);
+    }
+    *sd = sqrt(sum_sq / shard_count);
+}
+
+/*
+ * Reduces the shard scores of a layout to the selected objective: the worst
+ * shard, the mean minus 'shard_lambda' standard deviations, or the mean.
+ *
+ * Parameters:
+ *   scores: The score on each shard.
+ * Returns: The value of the objective.
+ */
+float shard_objective_value(float *scores)
+{
+    float mean, sd, worst;
+    shard_summary(scores, &mean, &sd, &worst);
+    switch (shard_objective)
+    {
+        case 'w':
+            return worst;
+        case 'r':
+            return mean - shard_lambda * sd;
+        default:
+            return mean;
+    }
+}
+
+/*
+ * Analyzes and scores a layout under the selected objective. Without one
+ * this is single_analyze() and get_score() on the full corpus, otherwise the
+ * layout's score is set to the objective over the corpus shards.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout to analyze.
+ */
+void objective_analyze(layout *lt)
+{
+    if (shard_objective == 'n')
+    {
+        single_analyze(lt); /* analyze.c */
+        get_score(lt); /* util.c */
+        return;
+    }
+    float scores[shard_count];
+    shard_analyze(lt, scores);
+    lt->score = shard_objective_value(scores);
+}
@@ -0,0 +1,140 @@
+/*
+ * stat_map.c - Position ngram to stat lookup for the GULAG.
+ *
+ * The analysis walks each stat's position ngrams and looks up what the layout
+ * puts there. Code that starts from characters instead, such as the corpus
+ * delta and streaming modes, needs the opposite direction: given the keys a
+ * run of characters lands on, which stats does it count towards. These maps
+ * answer that with one list of stat indices per position ngram.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stat_map.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+stat_map map_mono, map_bi, map_tri, map_quad, map_skip;
+
+/*
+ * Builds the list of stats walking each position ngram.
+ *
+ * Parameters:
+ *   map: The map to fill.
+ *   size: The number of position ngrams of this length.
+ *   count: The number of stats.
+ *   ngrams: The position ngrams of each stat.
+ *   lengths: The number of position ngrams of each stat, 0 if it is not walked.
+ */
+void build_map(stat_map *map, int size, int count, int **ngrams, int *lengths)
+{
+    map->start = (int *)calloc(size + 1, sizeof(int));
+    if (map->start == NULL) {error("Failed to allocate memory for the stat map.");}
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < lengths[i]; j++) {map->start[ngrams[i][j] + 1]++;}
+    }
+    for (int i = 0; i < size; i++) {map->start[i + 1] += map->start[i];}
+
+    map->stats = (int *)malloc(sizeof(int) * (map->start[size] + 1));
+    int *fill = (int *)malloc(sizeof(int) * (size + 1));
+    if (map->stats == NULL || fill == NULL) {error("Failed to allocate memory for the stat map.");}
+    memcpy(fill, map->start, sizeof(int) * (size + 1));
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < lengths[i]; j++) {map->stats[fill[ngrams[i][j]]++] = i;}
+    }
+    free(fill);
+}
+
+/*
+ * Builds the stat maps of every ngram length from the walked stats. Derived
+ * stats are left out, they are summed from their children afterwards.
+ */
+void build_stat_maps()
+{
+    int count = MONO_LENGTH;
+    if (BI_LENGTH > count) {count = BI_LENGTH;}
+    if (TRI_LENGTH > count) {count = TRI_LENGTH;}
+    if (QUAD_LENGTH > count) {count = QUAD_LENGTH;}
+    if (SKIP_LENGTH > count) {count = SKIP_LENGTH;}
+    int *ngrams[count + 1];
+    int lengths[count + 1];
+
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        ngrams[i] = stats_mono[i].ngrams;
+        lengths[i] = stats_mono[i].skip || stats_mono[i].derived ? 0 : stats_mono[i].length;
+    }
+    build_map(&map_mono, DIM1, MONO_LENGTH, ngrams, lengths);
+
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        ngrams[i] = stats_bi[i].ngrams;
+        lengths[i] = stats_bi[i].skip || stats_bi[i].derived ? 0 : stats_bi[i].length;
+    }
+    build_map(&map_bi, DIM2, BI_LENGTH, ngrams, lengths);
+
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        ngrams[i] = stats_tri[i].ngrams;
+        lengths[i] = stats_tri[i].skip || stats_tri[i].derived ? 0 : stats_tri[i].length;
+    }
+    build_map(&map_tri, DIM3, TRI_LENGTH, ngrams, lengths);
+
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        ngrams[i] = stats_quad[i].ngrams;
+        lengths[i] = stats_quad[i].skip || stats_quad[i].derived ? 0 : stats_quad[i].length;
+    }
+    build_map(&map_quad, DIM4, QUAD_LENGTH, ngrams, lengths);
+
+    /* skipgram stats walk bigram positions at every skip distance */
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        ngrams[i] = stats_skip[i].ngrams;
+        lengths[i] = stats_skip[i].skip || stats_skip[i].derived ? 0 : stats_skip[i].length;
+    }
+    build_map(&map_skip, DIM2, SKIP_LENGTH, ngrams, lengths);
+}
+
+/* Frees the stat maps of every ngram length. */
+void free_stat_maps()
+{
+    stat_map *maps[] = {&map_mono, &map_bi, &map_tri, &map_quad, &map_skip};
+    for (int i = 0; i < 5; i++)
+    {
+        free(maps[i]->start);
+        free(maps[i]->stats);
+        maps[i]->start = NULL;
+        maps[i]->stats = NULL;
+    }
+}
+
+/*
+ * Lists the key positions of every character of a layout. A character may
+ * sit on several keys, so the positions form a linked list per character.
+ *
+ * Parameters:
+ *   lt: The layout.
+ *   first: LANG_LENGTH entries, set to each character's first position or -1.
+ *   next: ROW * COL entries, set to the position after each one or -1.
+ */
+void map_positions(layout *lt, int *first, int *next)
+{
+    for (int i = 0; i < LANG_LENGTH; i++) {first[i] = -1;}
+    for (int i = ROW - 1; i >= 0; i--)
+    {
+        for (int j = COL - 1; j >= 0; j--)
+        {
+            int c = lt->matrix[i][j];
+            if (c < 0 || c >= LANG_LENGTH) {continue;}
+            int p;
+            flat_mono(i, j, &p); /* util.c */
+            next[p] = first[c];
+            first[c] = p;
+        }
+    }
+}
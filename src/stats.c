@@ -3,10 +3,13 @@
  *
  * This file contains functions for initializing, cleaning, and freeing
  * statistics used in the GULAG. Statistics are categorized into
- * monograms, bigrams, trigrams, quadgrams, skipgrams, and meta-statistics.
+ * monograms, bigrams, trigrams, quadgrams, skipgrams, meta-statistics, and
+ * five-grams.
  */
 
 
+#include <math.h>
+
 #include "stats.h"
 #include "mono.h"
 #include "bi.h"
@@ -14,6 +17,9 @@
 #include "quad.h"
 #include "skip.h"
 #include "meta.h"
+#include "five.h"
+#include "derived.h"
+#include "custom.h"
 
 #include "global.h"
 #include "structs.h"
@@ -22,8 +28,8 @@
 /*
  * Initializes all statistic data structures for the GULAG. This involves
  * initializing arrays for each type of n-gram statistic as well as
- * meta-statistics. The function delegates the initialization of each statistic
- * type to its respective module.
+ * meta-statistics, followed by any user defined statistics. The function
+ * delegates the initialization of each statistic type to its respective module.
  */
 void initialize_stats()
 {
@@ -69,6 +75,17 @@ void initialize_stats()
     log_print('v',L"trimming meta stats...     ");
     trim_meta_stats(); /* stats/meta.c */
     log_print('v',L"Done\n");
+
+    /* initializes array for five-gram stats, built only when used */
+    log_print('v',L"     Initializing five-gram stats... ");
+    initialize_five_stats(); /* stats/five.c */
+    log_print('v',L"Done\n");
+
+    /* appends user defined stats, already trimmed */
+    log_print('v',L"     Compiling custom stats...      ");
+    int custom_count = initialize_custom_stats(); /* stats/custom.c */
+    log_print('v',L"%d added... ", custom_count);
+    log_print('v',L"Done\n");
 }
 
 /*
@@ -76,7 +93,8 @@ void initialize_stats()
  * This function iterates through each category of statistics (monograms,
  * bigrams, trigrams, quadgrams, skipgrams, and meta-statistics) and marks skip
  * on any statistic that has a length of 0 or a weight of 0. This helps purge
- * irrelevant statistics for layout analysis.
+ * irrelevant statistics for layout analysis. Finally, statistics that are the
+ * disjoint union of others are marked as derived.
  */
 void clean_stats()
 {
@@ -106,6 +124,44 @@ void clean_stats()
     log_print('v',L"defining meta stats... ");
     define_meta_stats(); /* stats/meta.c */
     log_print('v',L"Done\n");
+
+    log_print('v',L"     Cleaning five-gram stats... ");
+    clean_five_stats(); /* stats/five.c */
+    log_print('v',L"defining five-gram stats... ");
+    define_five_stats(); /* stats/five.c */
+    log_print('v',L"%d kept... ", count_five_stats()); /* stats/five.c */
+    log_print('v',L"Done\n");
+
+    /* sum parents from disjoint children instead of walking their ngrams */
+    log_print('v',L"     Deriving stats... ");
+    define_derived_stats(); /* stats/derived.c */
+    log_print('v',L"%d derived... ", count_derived_stats()); /* stats/derived.c */
+    log_print('v',L"Done\n");
+}
+
+/*
+ * Replaces the weights of every statistic with those of the weights file
+ * 'weight_name' and cleans again. All weights and skip flags are first reset
+ * to their initial values, so stats the new file leaves out or weights to 0
+ * behave exactly as on a fresh start. Used by the job mode to run jobs with
+ * different weights without rebuilding the stats.
+ */
+void refold_weights()
+{
+    for (int i = 0; i < MONO_LENGTH; i++) {stats_mono[i].weight = -INFINITY; stats_mono[i].skip = 0;}
+    for (int i = 0; i < BI_LENGTH; i++) {stats_bi[i].weight = -INFINITY; stats_bi[i].skip = 0;}
+    for (int i = 0; i < TRI_LENGTH; i++) {stats_tri[i].weight = -INFINITY; stats_tri[i].skip = 0;}
+    for (int i = 0; i < QUAD_LENGTH; i++) {stats_quad[i].weight = -INFINITY; stats_quad[i].skip = 0;}
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        for (int k = 0; k < 10; k++) {stats_skip[i].weight[k] = -INFINITY;}
+        stats_skip[i].skip = 0;
+    }
+    for (int i = 0; i < META_LENGTH; i++) {stats_meta[i].weight = -INFINITY; stats_meta[i].skip = 0;}
+    for (int i = 0; i < FIVE_LENGTH; i++) {stats_five[i].weight = 0; stats_five[i].skip = 0;}
+
+    read_weights(); /* io.c */
+    clean_stats(); /* stats.c */
 }
 
 /*
@@ -140,4 +196,8 @@ void free_stats()
     log_print('v',L"     Freeing meta stats... ");
     free_meta_stats(); /* stats/meta.c */
     log_print('v',L"Done\n");
+
+    log_print('v',L"     Freeing five-gram stats... ");
+    free_five_stats(); /* stats/five.c */
+    log_print('v',L"Done\n");
 }
@@ -36,7 +36,7 @@
 void initialize_bi_stats()
 {
     BI_LENGTH = 27;
-    stats_bi = (bi_stat *)malloc(sizeof(bi_stat) * BI_LENGTH);
+    stats_bi = (bi_stat *)alloc_aligned(sizeof(bi_stat) * BI_LENGTH);
     int row0, col0, row1, col1;
     int index = 0;
 
@@ -567,11 +567,13 @@ void initialize_bi_stats()
 /*
  * Trims the ngrams in the array to move unused entries to the end.
  * This process ensures memory efficiency by eliminating gaps in the array.
+ * Ngrams touching a position without a key are dropped first.
  */
 void trim_bi_stats()
 {
     for (int i = 0; i < BI_LENGTH; i++)
     {
+        drop_keyless(stats_bi[i].ngrams, DIM2, 2, &stats_bi[i].length); /* stats_util.c */
         if (stats_bi[i].length != 0)
         {
             int left = 0;
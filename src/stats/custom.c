@@ -0,0 +1,637 @@
+/*
+ * stats/custom.c - User defined statistics for the GULAG.
+ *
+ * Reads stat definitions from data/stats/<name>.stat so new stats can be
+ * added without recompiling. Each line defines one stat:
+ *
+ *     <type> <name> : <predicate>
+ *
+ * where type is mono, bi, tri, quad, or skip and the predicate is built from
+ * position features combined with '&', '|', '!', and parentheses. Features
+ * take the index of a key in the ngram (0 is the first key):
+ *
+ *     hand(i) finger(i) row(i) col(i) stretch(i)
+ *     same_hand(i,j) same_finger(i,j) same_row(i,j) same_col(i,j)
+ *     same_pos(i,j) adjacent(i,j) inward(i,j) outward(i,j)
+ *     row_diff(i,j) finger_diff(i,j)
+ *
+ * A feature may be compared with '=', '!=', '<', '>', '<=', or '>=' against a
+ * number, or 'l'/'r' for hand, otherwise it is true when nonzero. Lines
+ * starting with '#' are comments.
+ *
+ * Each predicate is compiled once into a postfix program. Programs are then
+ * run over blocks of tuples at a time, so every instruction is a tight loop
+ * over the block, and all stats of a type share a single sweep of the tuple
+ * space.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "custom.h"
+#include "stats_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Number of tuples classified together. */
+#define CUSTOM_BLOCK 256
+/* Maximum number of instructions in a compiled predicate. */
+#define MAX_CUSTOM_OPS 128
+
+/* Instruction kinds. */
+enum {OP_FEATURE, OP_AND, OP_OR, OP_NOT};
+
+/* Comparison kinds. */
+enum {CMP_EQ, CMP_NE, CMP_LT, CMP_GT, CMP_LE, CMP_GE};
+
+/* Features, in the order of feature_names. */
+enum {F_HAND, F_FINGER, F_ROW, F_COL, F_STRETCH, F_SAME_HAND, F_SAME_FINGER,
+    F_SAME_ROW, F_SAME_COL, F_SAME_POS, F_ADJACENT, F_INWARD, F_OUTWARD,
+    F_ROW_DIFF, F_FINGER_DIFF, F_COUNT};
+
+/* Name of each feature, the first five take one key, the rest two. */
+const char *feature_names[F_COUNT] = {"hand", "finger", "row", "col",
+    "stretch", "same_hand", "same_finger", "same_row", "same_col", "same_pos",
+    "adjacent", "inward", "outward", "row_diff", "finger_diff"};
+
+/* A single instruction of a compiled predicate. */
+typedef struct custom_op {
+    int op;
+    int feature;
+    int pos0;
+    int pos1;
+    int cmp;
+    int value;
+} custom_op;
+
+/* A parsed stat definition. */
+typedef struct custom_def {
+    char type;
+    int keys;
+    int index;
+    custom_op ops[MAX_CUSTOM_OPS];
+    int op_count;
+    int depth;
+    int max_depth;
+} custom_def;
+
+/* Parser state for one definition line. */
+typedef struct custom_parser {
+    const char *p;
+    custom_def *def;
+    int line;
+} custom_parser;
+
+/* Features of every grid position, indexed by flattened position. */
+typedef struct position_features {
+    int hand[dim1];
+    int finger[dim1];
+    int row_of[dim1];
+    int col_of[dim1];
+    int stretch[dim1];
+} position_features;
+
+/*
+ * Terminates with a message pointing at the offending line of the stats file.
+ * Parameters:
+ *   ps: The parser state.
+ *   msg: Description of the problem.
+ */
+void custom_error(custom_parser *ps, const char *msg)
+{
+    char buff[200];
+    snprintf(buff, sizeof(buff), "Custom stats file line %d: %s", ps->line, msg);
+    error(buff);
+}
+
+/* Skips whitespace in the parser input. */
+void custom_skip_space(custom_parser *ps)
+{
+    while (*ps->p && isspace((unsigned char)*ps->p)) {ps->p++;}
+}
+
+/*
+ * Appends an instruction to the definition, tracking the stack depth the
+ * program will need.
+ */
+void custom_emit(custom_parser *ps, custom_op op)
+{
+    custom_def *def = ps->def;
+    if (def->op_count == MAX_CUSTOM_OPS) {custom_error(ps, "predicate too long");}
+    def->ops[def->op_count++] = op;
+    if (op.op == OP_FEATURE) {def->depth++;}
+    else if (op.op != OP_NOT) {def->depth--;}
+    if (def->depth > def->max_depth) {def->max_depth = def->depth;}
+}
+
+/* Reads a key index argument and checks it against the ngram size. */
+int custom_parse_key(custom_parser *ps)
+{
+    custom_skip_space(ps);
+    if (!isdigit((unsigned char)*ps->p)) {custom_error(ps, "expected key index");}
+    int key = strtol(ps->p, (char **)&ps->p, 10);
+    if (key >= ps->def->keys) {custom_error(ps, "key index larger than the ngram");}
+    return key;
+}
+
+/* Expects a single character in the input. */
+void custom_expect(custom_parser *ps, char c)
+{
+    custom_skip_space(ps);
+    if (*ps->p != c)
+    {
+        char buff[40];
+        snprintf(buff, sizeof(buff), "expected '%c'", c);
+        custom_error(ps, buff);
+    }
+    ps->p++;
+}
+
+/* Parses a feature call with an optional comparison. */
+void custom_parse_atom(custom_parser *ps)
+{
+    custom_skip_space(ps);
+    char ident[32];
+    int n = 0;
+    while ((isalpha((unsigned char)*ps->p) || *ps->p == '_') && n < 31) {ident[n++] = *ps->p++;}
+    ident[n] = '\0';
+
+    custom_op op = {OP_FEATURE, -1, 0, 0, CMP_NE, 0};
+    for (int i = 0; i < F_COUNT; i++)
+    {
+        if (strcmp(ident, feature_names[i]) == 0) {op.feature = i;}
+    }
+    if (op.feature == -1) {custom_error(ps, "unknown feature");}
+
+    custom_expect(ps, '(');
+    op.pos0 = custom_parse_key(ps);
+    if (op.feature > F_STRETCH)
+    {
+        custom_expect(ps, ',');
+        op.pos1 = custom_parse_key(ps);
+    }
+    custom_expect(ps, ')');
+
+    /* optional comparison, defaults to != 0 */
+    custom_skip_space(ps);
+    const char *c = ps->p;
+    if (c[0] == '!' && c[1] == '=') {op.cmp = CMP_NE; ps->p += 2;}
+    else if (c[0] == '<' && c[1] == '=') {op.cmp = CMP_LE; ps->p += 2;}
+    else if (c[0] == '>' && c[1] == '=') {op.cmp = CMP_GE; ps->p += 2;}
+    else if (c[0] == '=') {op.cmp = CMP_EQ; ps->p += 1;}
+    else if (c[0] == '<') {op.cmp = CMP_LT; ps->p += 1;}
+    else if (c[0] == '>') {op.cmp = CMP_GT; ps->p += 1;}
+    else
+    {
+        custom_emit(ps, op);
+        return;
+    }
+
+    custom_skip_space(ps);
+    if (op.feature == F_HAND && (*ps->p == 'l' || *ps->p == 'r'))
+    {
+        op.value = *ps->p == 'l' ? 0 : 1;
+        ps->p++;
+    }
+    else if (isdigit((unsigned char)*ps->p) || *ps->p == '-')
+    {
+        op.value = strtol(ps->p, (char **)&ps->p, 10);
+    }
+    else
+    {
+        custom_error(ps, "expected value after comparison");
+    }
+    custom_emit(ps, op);
+}
+
+void custom_parse_expr(custom_parser *ps);
+
+/* factor := '!' factor | '(' expr ')' | atom */
+void custom_parse_factor(custom_parser *ps)
+{
+    custom_skip_space(ps);
+    if (*ps->p == '!')
+    {
+        ps->p++;
+        custom_parse_factor(ps);
+        custom_op op = {OP_NOT, 0, 0, 0, 0, 0};
+        custom_emit(ps, op);
+    }
+    else if (*ps->p == '(')
+    {
+        ps->p++;
+        custom_parse_expr(ps);
+        custom_expect(ps, ')');
+    }
+    else
+    {
+        custom_parse_atom(ps);
+    }
+}
+
+/* term := factor ('&' factor)* */
+void custom_parse_term(custom_parser *ps)
+{
+    custom_parse_factor(ps);
+    custom_skip_space(ps);
+    while (*ps->p == '&')
+    {
+        ps->p++;
+        custom_parse_factor(ps);
+        custom_op op = {OP_AND, 0, 0, 0, 0, 0};
+        custom_emit(ps, op);
+        custom_skip_space(ps);
+    }
+}
+
+/* expr := term ('|' term)* */
+void custom_parse_expr(custom_parser *ps)
+{
+    custom_parse_term(ps);
+    custom_skip_space(ps);
+    while (*ps->p == '|')
+    {
+        ps->p++;
+        custom_parse_term(ps);
+        custom_op op = {OP_OR, 0, 0, 0, 0, 0};
+        custom_emit(ps, op);
+        custom_skip_space(ps);
+    }
+}
+
+/*
+ * Evaluates one feature instruction over a block of tuples.
+ * Parameters:
+ *   op: The instruction.
+ *   pf: The per position features.
+ *   pos: The flattened key positions of each tuple in the block.
+ *   count: The number of tuples in the block.
+ *   out: Receives 1 for each tuple that satisfies the instruction.
+ */
+void custom_eval_feature(custom_op *op, position_features *pf,
+    int pos[4][CUSTOM_BLOCK], int count, unsigned char *out)
+{
+    int value[CUSTOM_BLOCK];
+    int *a = pos[op->pos0];
+    int *b = pos[op->pos1];
+
+    switch (op->feature)
+    {
+    case F_HAND:
+        for (int k = 0; k < count; k++) {value[k] = pf->hand[a[k]];}
+        break;
+    case F_FINGER:
+        for (int k = 0; k < count; k++) {value[k] = pf->finger[a[k]];}
+        break;
+    case F_ROW:
+        for (int k = 0; k < count; k++) {value[k] = pf->row_of[a[k]];}
+        break;
+    case F_COL:
+        for (int k = 0; k < count; k++) {value[k] = pf->col_of[a[k]];}
+        break;
+    case F_STRETCH:
+        for (int k = 0; k < count; k++) {value[k] = pf->stretch[a[k]];}
+        break;
+    case F_SAME_HAND:
+        for (int k = 0; k < count; k++) {value[k] = pf->hand[a[k]] == pf->hand[b[k]];}
+        break;
+    case F_SAME_FINGER:
+        for (int k = 0; k < count; k++) {value[k] = pf->finger[a[k]] == pf->finger[b[k]];}
+        break;
+    case F_SAME_ROW:
+        for (int k = 0; k < count; k++) {value[k] = pf->row_of[a[k]] == pf->row_of[b[k]];}
+        break;
+    case F_SAME_COL:
+        for (int k = 0; k < count; k++) {value[k] = pf->col_of[a[k]] == pf->col_of[b[k]];}
+        break;
+    case F_SAME_POS:
+        for (int k = 0; k < count; k++) {value[k] = a[k] == b[k];}
+        break;
+    case F_ADJACENT:
+        for (int k = 0; k < count; k++)
+        {
+            int diff = pf->finger[a[k]] - pf->finger[b[k]];
+            value[k] = pf->hand[a[k]] == pf->hand[b[k]] && (diff == 1 || diff == -1);
+        }
+        break;
+    case F_INWARD:
+    case F_OUTWARD:
+        for (int k = 0; k < count; k++)
+        {
+            int f0 = pf->finger[a[k]];
+            int f1 = pf->finger[b[k]];
+            int h = pf->hand[a[k]];
+            int in = h == pf->hand[b[k]] && ((h == 0 && f1 > f0) || (h == 1 && f1 < f0));
+            int out = h == pf->hand[b[k]] && ((h == 0 && f1 < f0) || (h == 1 && f1 > f0));
+            value[k] = op->feature == F_INWARD ? in : out;
+        }
+        break;
+    case F_ROW_DIFF:
+        for (int k = 0; k < count; k++) {value[k] = abs(pf->row_of[a[k]] - pf->row_of[b[k]]);}
+        break;
+    case F_FINGER_DIFF:
+        for (int k = 0; k < count; k++) {value[k] = abs(pf->finger[a[k]] - pf->finger[b[k]]);}
+        break;
+    }
+
+    int v = op->value;
+    switch (op->cmp)
+    {
+    case CMP_EQ: for (int k = 0; k < count; k++) {out[k] = value[k] == v;} break;
+    case CMP_NE: for (int k = 0; k < count; k++) {out[k] = value[k] != v;} break;
+    case CMP_LT: for (int k = 0; k < count; k++) {out[k] = value[k] < v;} break;
+    case CMP_GT: for (int k = 0; k < count; k++) {out[k] = value[k] > v;} break;
+    case CMP_LE: for (int k = 0; k < count; k++) {out[k] = value[k] <= v;} break;
+    case CMP_GE: for (int k = 0; k < count; k++) {out[k] = value[k] >= v;} break;
+    }
+}
+
+/*
+ * Classifies every tuple of one ngram type against all definitions of that
+ * type in a single sweep, filling each stat's ngram array in order.
+ * Parameters:
+ *   defs: All parsed definitions.
+ *   def_count: The number of definitions.
+ *   type: The definition type to classify.
+ *   keys: The number of keys in the ngram.
+ *   pf: The per position features.
+ */
+void custom_classify(custom_def *defs, int def_count, char type, int keys,
+    position_features *pf)
+{
+    int *ngrams[def_count];
+    int lengths[def_count];
+    int active = 0;
+    int max_depth = 1;
+    size_t dim = 1;
+    for (int i = 0; i < keys; i++) {dim *= DIM1;}
+
+    for (int d = 0; d < def_count; d++)
+    {
+        ngrams[d] = NULL;
+        lengths[d] = 0;
+        if (defs[d].type != type) {continue;}
+        switch (type)
+        {
+            case 'm': ngrams[d] = stats_mono[defs[d].index].ngrams; break;
+            case 'b': ngrams[d] = stats_bi[defs[d].index].ngrams; break;
+            case 't': ngrams[d] = stats_tri[defs[d].index].ngrams; break;
+            case 'q': ngrams[d] = stats_quad[defs[d].index].ngrams; break;
+            case 's': ngrams[d] = stats_skip[defs[d].index].ngrams; break;
+        }
+        if (defs[d].max_depth > max_depth) {max_depth = defs[d].max_depth;}
+        active++;
+    }
+    if (active == 0) {return;}
+
+    int pos[4][CUSTOM_BLOCK];
+    unsigned char (*stack)[CUSTOM_BLOCK] = malloc(sizeof(*stack) * max_depth);
+    if (stack == NULL) {error("Failed to allocate memory for custom stats.");}
+
+    for (size_t start = 0; start < dim; start += CUSTOM_BLOCK)
+    {
+        int count = dim - start < CUSTOM_BLOCK ? dim - start : CUSTOM_BLOCK;
+
+        /* unflatten the block once for every definition */
+        for (int k = 0; k < count; k++)
+        {
+            size_t n = start + k;
+            for (int key = keys - 1; key >= 0; key--)
+            {
+                pos[key][k] = n % DIM1;
+                n /= DIM1;
+            }
+        }
+
+        for (int d = 0; d < def_count; d++)
+        {
+            if (ngrams[d] == NULL) {continue;}
+            int top = 0;
+            for (int o = 0; o < defs[d].op_count; o++)
+            {
+                custom_op *op = &defs[d].ops[o];
+                switch (op->op)
+                {
+                case OP_FEATURE:
+                    custom_eval_feature(op, pf, pos, count, stack[top++]);
+                    break;
+                case OP_AND:
+                    top--;
+                    for (int k = 0; k < count; k++) {stack[top-1][k] &= stack[top][k];}
+                    break;
+                case OP_OR:
+                    top--;
+                    for (int k = 0; k < count; k++) {stack[top-1][k] |= stack[top][k];}
+                    break;
+                case OP_NOT:
+                    for (int k = 0; k < count; k++) {stack[top-1][k] = !stack[top-1][k];}
+                    break;
+                }
+            }
+            for (int k = 0; k < count; k++)
+            {
+                if (!stack[0][k]) {continue;}
+                /* tuples on positions without a key never hold characters */
+                int keyed = 1;
+                for (int key = 0; key < keys && keyed; key++) {
+                    keyed = has_key(pos[key][k] / COL, pos[key][k] % COL); /* stats_util.c */
+                }
+                if (keyed) {ngrams[d][lengths[d]++] = start + k;}
+            }
+        }
+    }
+    free(stack);
+
+    /* match the trimmed layout, valid ngrams first then -1 */
+    for (int d = 0; d < def_count; d++)
+    {
+        if (ngrams[d] == NULL) {continue;}
+        for (size_t i = lengths[d]; i < dim; i++) {ngrams[d][i] = -1;}
+        switch (type)
+        {
+            case 'm': stats_mono[defs[d].index].length = lengths[d]; break;
+            case 'b': stats_bi[defs[d].index].length = lengths[d]; break;
+            case 't': stats_tri[defs[d].index].length = lengths[d]; break;
+            case 'q': stats_quad[defs[d].index].length = lengths[d]; break;
+            case 's': stats_skip[defs[d].index].length = lengths[d]; break;
+        }
+    }
+}
+
+/*
+ * Reads the user defined stats file selected by 'custom_stats_name', compiles
+ * each definition into a small predicate program, and appends the resulting
+ * stats to the monogram, bigram, trigram, quadgram, and skipgram arrays. All
+ * definitions of one ngram type are classified together in a single pass over
+ * the tuple space. Does nothing if no stats file is selected.
+ *
+ * Returns: The number of stats added.
+ */
+int initialize_custom_stats()
+{
+    if (custom_stats_name == NULL) {return 0;}
+
+    /* Construct the path to the stats file. */
+    char *path = (char*)malloc(strlen("./data/stats/.stat") + strlen(custom_stats_name) + 1);
+    strcpy(path, "./data/stats/");
+    strcat(path, custom_stats_name);
+    strcat(path, ".stat");
+    FILE *stat_file = fopen(path, "r");
+    free(path);
+    if (stat_file == NULL) {error("Custom stats file not found.");}
+
+    custom_def *defs = NULL;
+    int def_count = 0;
+    char line[1024];
+    custom_parser ps;
+    ps.line = 0;
+
+    while (fgets(line, sizeof(line), stat_file) != NULL)
+    {
+        ps.line++;
+        ps.p = line;
+        custom_skip_space(&ps);
+        if (*ps.p == '\0' || *ps.p == '#') {continue;}
+
+        defs = (custom_def *)realloc(defs, sizeof(custom_def) * (def_count + 1));
+        if (defs == NULL) {error("Failed to allocate memory for custom stats.");}
+        custom_def *def = &defs[def_count];
+        memset(def, 0, sizeof(custom_def));
+        ps.def = def;
+
+        /* type */
+        char type_name[8];
+        int n = 0;
+        while (isalpha((unsigned char)*ps.p) && n < 7) {type_name[n++] = *ps.p++;}
+        type_name[n] = '\0';
+        if (strcmp(type_name, "mono") == 0) {def->type = 'm'; def->keys = 1;}
+        else if (strcmp(type_name, "bi") == 0) {def->type = 'b'; def->keys = 2;}
+        else if (strcmp(type_name, "tri") == 0) {def->type = 't'; def->keys = 3;}
+        else if (strcmp(type_name, "quad") == 0) {def->type = 'q'; def->keys = 4;}
+        else if (strcmp(type_name, "skip") == 0) {def->type = 's'; def->keys = 2;}
+        else {custom_error(&ps, "type must be mono, bi, tri, quad, or skip");}
+
+        /* name, up to the colon */
+        custom_skip_space(&ps);
+        const char *colon = strchr(ps.p, ':');
+        if (colon == NULL) {custom_error(&ps, "expected ':' after the name");}
+        const char *end = colon;
+        while (end > ps.p && isspace((unsigned char)end[-1])) {end--;}
+        if (end == ps.p || end - ps.p > 60) {custom_error(&ps, "name must be 1 to 60 characters");}
+        char name[61];
+        memcpy(name, ps.p, end - ps.p);
+        name[end - ps.p] = '\0';
+        ps.p = colon + 1;
+
+        /* predicate */
+        custom_parse_expr(&ps);
+        custom_skip_space(&ps);
+        if (*ps.p != '\0') {custom_error(&ps, "unexpected text after predicate");}
+
+        /* append an empty stat of the right type */
+        switch (def->type)
+        {
+        case 'm':
+            for (int i = 0; i < MONO_LENGTH; i++)
+            {
+                if (strcmp(stats_mono[i].name, name) == 0) {custom_error(&ps, "duplicate stat name");}
+            }
+            stats_mono = (mono_stat *)realloc_aligned(stats_mono, sizeof(mono_stat) * MONO_LENGTH,
+                sizeof(mono_stat) * (MONO_LENGTH + 1));
+            if (stats_mono == NULL) {error("Failed to allocate memory for custom stats.");}
+            def->index = MONO_LENGTH++;
+            strcpy(stats_mono[def->index].name, name);
+            stats_mono[def->index].weight = -INFINITY;
+            stats_mono[def->index].length = 0;
+            stats_mono[def->index].skip = 0;
+            break;
+        case 'b':
+            for (int i = 0; i < BI_LENGTH; i++)
+            {
+                if (strcmp(stats_bi[i].name, name) == 0) {custom_error(&ps, "duplicate stat name");}
+            }
+            stats_bi = (bi_stat *)realloc_aligned(stats_bi, sizeof(bi_stat) * BI_LENGTH,
+                sizeof(bi_stat) * (BI_LENGTH + 1));
+            if (stats_bi == NULL) {error("Failed to allocate memory for custom stats.");}
+            def->index = BI_LENGTH++;
+            strcpy(stats_bi[def->index].name, name);
+            stats_bi[def->index].weight = -INFINITY;
+            stats_bi[def->index].length = 0;
+            stats_bi[def->index].skip = 0;
+            break;
+        case 't':
+            for (int i = 0; i < TRI_LENGTH; i++)
+            {
+                if (strcmp(stats_tri[i].name, name) == 0) {custom_error(&ps, "duplicate stat name");}
+            }
+            stats_tri = (tri_stat *)realloc_aligned(stats_tri, sizeof(tri_stat) * TRI_LENGTH,
+                sizeof(tri_stat) * (TRI_LENGTH + 1));
+            if (stats_tri == NULL) {error("Failed to allocate memory for custom stats.");}
+            def->index = TRI_LENGTH++;
+            strcpy(stats_tri[def->index].name, name);
+            stats_tri[def->index].weight = -INFINITY;
+            stats_tri[def->index].length = 0;
+            stats_tri[def->index].skip = 0;
+            break;
+        case 'q':
+            for (int i = 0; i < QUAD_LENGTH; i++)
+            {
+                if (strcmp(stats_quad[i].name, name) == 0) {custom_error(&ps, "duplicate stat name");}
+            }
+            stats_quad = (quad_stat *)realloc_aligned(stats_quad, sizeof(quad_stat) * QUAD_LENGTH,
+                sizeof(quad_stat) * (QUAD_LENGTH + 1));
+            if (stats_quad == NULL) {error("Failed to allocate memory for custom stats.");}
+            def->index = QUAD_LENGTH++;
+            strcpy(stats_quad[def->index].name, name);
+            stats_quad[def->index].weight = -INFINITY;
+            stats_quad[def->index].length = 0;
+            stats_quad[def->index].skip = 0;
+            break;
+        case 's':
+            for (int i = 0; i < SKIP_LENGTH; i++)
+            {
+                if (strcmp(stats_skip[i].name, name) == 0) {custom_error(&ps, "duplicate stat name");}
+            }
+            stats_skip = (skip_stat *)realloc_aligned(stats_skip, sizeof(skip_stat) * SKIP_LENGTH,
+                sizeof(skip_stat) * (SKIP_LENGTH + 1));
+            if (stats_skip == NULL) {error("Failed to allocate memory for custom stats.");}
+            def->index = SKIP_LENGTH++;
+            strcpy(stats_skip[def->index].name, name);
+            for (int i = 0; i < 10; i++) {stats_skip[def->index].weight[i] = -INFINITY;}
+            stats_skip[def->index].length = 0;
+            stats_skip[def->index].skip = 0;
+            break;
+        }
+        def_count++;
+    }
+    fclose(stat_file);
+    if (def_count == 0) {return 0;}
+
+    /* flatten the geometry once for the classifier */
+    position_features *pf = (position_features *)malloc(sizeof(position_features));
+    if (pf == NULL) {error("Failed to allocate memory for custom stats.");}
+    for (int i = 0; i < DIM1; i++)
+    {
+        int r = i / COL;
+        int c = i % COL;
+        pf->hand[i] = geo_hand[r][c] == 'l' ? 0 : geo_hand[r][c] == 'r' ? 1 : -1;
+        pf->finger[i] = geo_finger[r][c];
+        pf->row_of[i] = geo_row[r][c];
+        pf->col_of[i] = c;
+        pf->stretch[i] = geo_stretch[r][c];
+    }
+
+    custom_classify(defs, def_count, 'm', 1, pf);
+    custom_classify(defs, def_count, 'b', 2, pf);
+    custom_classify(defs, def_count, 't', 3, pf);
+    custom_classify(defs, def_count, 'q', 4, pf);
+    custom_classify(defs, def_count, 's', 2, pf);
+
+    free(pf);
+    free(defs);
+    return def_count;
+}
@@ -0,0 +1,318 @@
+/*
+ * stats/derived.c - Derived statistic detection.
+ *
+ * Many statistics are unions of others, for example a hand usage is the sum
+ * of its finger usages, and a same finger bigram stat is the sum of the per
+ * finger ones. Since every stat is a sum over its ngram set, a parent whose
+ * set is exactly the disjoint union of some children has a value equal to the
+ * sum of their values. This file finds those relations once at startup by
+ * comparing the ngram sets directly, so hand written definitions can never
+ * drift out of sync with the actual stat definitions.
+ *
+ * Only leaves are evaluated by walking ngrams. A child is never itself
+ * derived, which keeps the evaluation order a simple two pass sweep.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "derived.h"
+#include "global.h"
+#include "structs.h"
+#include "util.h"
+
+/* Upper bound on search nodes spent trying to cover a single parent. */
+#define MAX_COVER_NODES 100000
+
+/* Type independent view of a stat used during detection. */
+typedef struct stat_view {
+    int *ngrams;
+    int length;
+    int *skip;
+    int *derived;
+    int *hidden;
+    int *child_count;
+    int *children;
+} stat_view;
+
+/* State of the exact cover search for a single parent. */
+typedef struct cover_search {
+    stat_view *views;
+    uint64_t *covered;
+    int *target;
+    int target_length;
+    int *candidates;
+    int candidate_count;
+    int chosen[100];
+    int chosen_count;
+    int nodes;
+} cover_search;
+
+/*
+ * Fills a stat view with pointers into a stat structure.
+ * Parameters:
+ *   view: The view to fill.
+ *   ngrams: The stat's ngram array.
+ *   length: The number of valid ngrams.
+ *   skip, derived, hidden, child_count, children: The stat's fields.
+ */
+void fill_view(stat_view *view, int *ngrams, int length, int *skip,
+    int *derived, int *hidden, int *child_count, int *children)
+{
+    view->ngrams = ngrams;
+    view->length = length;
+    view->skip = skip;
+    view->derived = derived;
+    view->hidden = hidden;
+    view->child_count = child_count;
+    view->children = children;
+    *derived = 0;
+    *hidden = 0;
+    *child_count = 0;
+}
+
+/* Tests whether a bit is set in a bitmap. */
+int test_ngram(uint64_t *set, int n)
+{
+    return (set[n >> 6] >> (n & 63)) & 1;
+}
+
+/* Toggles a bit in a bitmap. */
+void flip_ngram(uint64_t *set, int n)
+{
+    set[n >> 6] ^= (uint64_t)1 << (n & 63);
+}
+
+/*
+ * Recursively searches for a set of disjoint candidates whose union is exactly
+ * the target ngram set. Branches on the first uncovered ngram, which keeps the
+ * search small since most ngrams belong to only a few candidates.
+ * Parameters:
+ *   s: The search state.
+ *   pos: Index into the target of the first possibly uncovered ngram.
+ * Returns: 1 if a cover was found and left in s->chosen, 0 otherwise.
+ */
+int find_cover(cover_search *s, int pos)
+{
+    while (pos < s->target_length && test_ngram(s->covered, s->target[pos])) {pos++;}
+    if (pos == s->target_length) {return 1;}
+    if (s->chosen_count == 100 || ++s->nodes > MAX_COVER_NODES) {return 0;}
+
+    int element = s->target[pos];
+    for (int i = 0; i < s->candidate_count; i++)
+    {
+        stat_view *c = &s->views[s->candidates[i]];
+
+        /* candidate must contain the element and not overlap the cover */
+        int contains = 0, overlaps = 0;
+        for (int j = 0; j < c->length && !overlaps; j++)
+        {
+            if (c->ngrams[j] == element) {contains = 1;}
+            if (test_ngram(s->covered, c->ngrams[j])) {overlaps = 1;}
+        }
+        if (!contains || overlaps) {continue;}
+
+        for (int j = 0; j < c->length; j++) {flip_ngram(s->covered, c->ngrams[j]);}
+        s->chosen[s->chosen_count++] = s->candidates[i];
+
+        if (find_cover(s, pos + 1)) {return 1;}
+
+        s->chosen_count--;
+        for (int j = 0; j < c->length; j++) {flip_ngram(s->covered, c->ngrams[j]);}
+    }
+    return 0;
+}
+
+/*
+ * Detects derived stats among the stats of one ngram type. Parents are
+ * visited from largest to smallest so the biggest sets are derived first,
+ * and any stat chosen as a child is locked as a leaf.
+ * Parameters:
+ *   views: The views of every stat of the type.
+ *   count: The number of stats.
+ *   dim: The number of possible ngrams of the type.
+ */
+void derive_type(stat_view *views, int count, int dim)
+{
+    size_t words = ((size_t)dim + 63) / 64;
+    uint64_t **sets = (uint64_t **)calloc(count, sizeof(uint64_t *));
+    uint64_t *covered = (uint64_t *)calloc(words, sizeof(uint64_t));
+    int *order = (int *)malloc(sizeof(int) * count);
+    int *locked = (int *)calloc(count, sizeof(int));
+    int *candidates = (int *)malloc(sizeof(int) * count);
+    if (sets == NULL || covered == NULL || order == NULL || locked == NULL || candidates == NULL)
+    {
+        error("Failed to allocate memory for derived stat detection.");
+    }
+
+    /* build the ngram set of every non empty stat */
+    for (int i = 0; i < count; i++)
+    {
+        if (views[i].length == 0) {continue;}
+        sets[i] = (uint64_t *)calloc(words, sizeof(uint64_t));
+        if (sets[i] == NULL) {error("Failed to allocate memory for derived stat detection.");}
+        for (int j = 0; j < views[i].length; j++) {flip_ngram(sets[i], views[i].ngrams[j]);}
+    }
+
+    /* order stats by length, largest first */
+    for (int i = 0; i < count; i++)
+    {
+        int j = i;
+        while (j > 0 && views[order[j-1]].length < views[i].length)
+        {
+            order[j] = order[j-1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    for (int o = 0; o < count; o++)
+    {
+        int p = order[o];
+        if (*views[p].skip || views[p].length == 0 || locked[p]) {continue;}
+
+        /* candidates are non derived subsets of the parent */
+        int candidate_count = 0;
+        for (int k = 0; k < count; k++)
+        {
+            int c = order[k];
+            if (c == p || sets[c] == NULL || *views[c].derived) {continue;}
+            if (views[c].length > views[p].length) {continue;}
+            int subset = 1;
+            for (int j = 0; j < views[c].length && subset; j++)
+            {
+                if (!test_ngram(sets[p], views[c].ngrams[j])) {subset = 0;}
+            }
+            if (subset) {candidates[candidate_count++] = c;}
+        }
+        if (candidate_count == 0) {continue;}
+
+        cover_search s;
+        s.views = views;
+        s.covered = covered;
+        s.target = views[p].ngrams;
+        s.target_length = views[p].length;
+        s.candidates = candidates;
+        s.candidate_count = candidate_count;
+        s.chosen_count = 0;
+        s.nodes = 0;
+        int found = find_cover(&s, 0);
+
+        /* clear the cover bitmap for the next parent */
+        for (int i = 0; i < s.chosen_count; i++)
+        {
+            stat_view *c = &views[s.chosen[i]];
+            for (int j = 0; j < c->length; j++) {flip_ngram(covered, c->ngrams[j]);}
+        }
+        if (!found) {continue;}
+
+        /* only worth it if some child is evaluated anyway */
+        int shared = 0;
+        for (int i = 0; i < s.chosen_count; i++)
+        {
+            if (!*views[s.chosen[i]].skip) {shared = 1;}
+        }
+        if (!shared) {continue;}
+
+        *views[p].derived = 1;
+        *views[p].child_count = s.chosen_count;
+        for (int i = 0; i < s.chosen_count; i++)
+        {
+            int c = s.chosen[i];
+            views[p].children[i] = c;
+            locked[c] = 1;
+        }
+        /* evaluate skipped children of the final cover without printing them */
+        for (int i = 0; i < s.chosen_count; i++)
+        {
+            int c = s.chosen[i];
+            if (*views[c].skip)
+            {
+                *views[c].skip = 0;
+                *views[c].hidden = 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {free(sets[i]);}
+    free(sets);
+    free(covered);
+    free(order);
+    free(locked);
+    free(candidates);
+}
+
+/*
+ * Detects statistics whose ngram set is exactly the disjoint union of other
+ * statistics of the same type. Such parents are marked as derived and are
+ * computed as the sum of their children instead of walking their own ngrams.
+ * Children that were skipped are re-enabled as hidden so they are evaluated
+ * without being printed. Must run after the stats are trimmed and cleaned.
+ */
+void define_derived_stats()
+{
+    int max_length = MONO_LENGTH;
+    if (BI_LENGTH > max_length) {max_length = BI_LENGTH;}
+    if (TRI_LENGTH > max_length) {max_length = TRI_LENGTH;}
+    if (QUAD_LENGTH > max_length) {max_length = QUAD_LENGTH;}
+    if (SKIP_LENGTH > max_length) {max_length = SKIP_LENGTH;}
+    stat_view *views = (stat_view *)malloc(sizeof(stat_view) * max_length);
+    if (views == NULL) {error("Failed to allocate memory for derived stat detection.");}
+
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        fill_view(&views[i], stats_mono[i].ngrams, stats_mono[i].length,
+            &stats_mono[i].skip, &stats_mono[i].derived, &stats_mono[i].hidden,
+            &stats_mono[i].child_count, stats_mono[i].children);
+    }
+    derive_type(views, MONO_LENGTH, dim1);
+
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        fill_view(&views[i], stats_bi[i].ngrams, stats_bi[i].length,
+            &stats_bi[i].skip, &stats_bi[i].derived, &stats_bi[i].hidden,
+            &stats_bi[i].child_count, stats_bi[i].children);
+    }
+    derive_type(views, BI_LENGTH, dim2);
+
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        fill_view(&views[i], stats_tri[i].ngrams, stats_tri[i].length,
+            &stats_tri[i].skip, &stats_tri[i].derived, &stats_tri[i].hidden,
+            &stats_tri[i].child_count, stats_tri[i].children);
+    }
+    derive_type(views, TRI_LENGTH, dim3);
+
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        fill_view(&views[i], stats_quad[i].ngrams, stats_quad[i].length,
+            &stats_quad[i].skip, &stats_quad[i].derived, &stats_quad[i].hidden,
+            &stats_quad[i].child_count, stats_quad[i].children);
+    }
+    derive_type(views, QUAD_LENGTH, dim4);
+
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        fill_view(&views[i], stats_skip[i].ngrams, stats_skip[i].length,
+            &stats_skip[i].skip, &stats_skip[i].derived, &stats_skip[i].hidden,
+            &stats_skip[i].child_count, stats_skip[i].children);
+    }
+    derive_type(views, SKIP_LENGTH, dim2);
+
+    free(views);
+}
+
+/*
+ * Returns the number of statistics currently marked as derived, summed
+ * across all ngram types.
+ */
+int count_derived_stats()
+{
+    int total = 0;
+    for (int i = 0; i < MONO_LENGTH; i++) {total += stats_mono[i].derived;}
+    for (int i = 0; i < BI_LENGTH; i++) {total += stats_bi[i].derived;}
+    for (int i = 0; i < TRI_LENGTH; i++) {total += stats_tri[i].derived;}
+    for (int i = 0; i < QUAD_LENGTH; i++) {total += stats_quad[i].derived;}
+    for (int i = 0; i < SKIP_LENGTH; i++) {total += stats_skip[i].derived;}
+    return total;
+}
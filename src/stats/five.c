@@ -0,0 +1,150 @@
+/*
+ * stats/five.c - Five-gram statistic definitions.
+ *
+ * This file contains the implementation for initializing, cleaning, defining,
+ * and freeing five-gram statistics used in the GULAG. Five-gram statistics
+ * track effects that span five keys, like redirects chained across the whole
+ * sequence or rolls that run four keys deep.
+ *
+ * There are dim1^5 (36^5, about 60 million) position sequences, far too many
+ * for the ngrams arrays the other stats keep. Instead each five-gram stat
+ * holds a bitset with one bit per sequence, and it is only built once the
+ * weights show the stat is used. The corpus side is kept sparse as well, see
+ * fivegram.c.
+ *
+ * Adding new stats:
+ *     1. Incease FIVE_LENGTH by as many stats as you are adding.
+ *     2. Define its name, keep it a reasonable length.
+ *     3. Set its weight to 0, and skip to 0 (to be changed later).
+ *     4. Iterate the index.
+ *     5. Add its predicate to define_five_stats() in the same order.
+ *     6. Add the statistic to the weights files in data/weights/ if wanted,
+ *        a five-gram stat missing from the weights is left off.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "five.h"
+#include "util.h"
+#include "stats_util.h"
+#include "global.h"
+#include "structs.h"
+
+/*
+ * Initializes the array of five-gram statistics. The function allocates memory
+ * for the stat array and sets default values. Unlike other stats the weight
+ * defaults to 0, so weights files written before five-grams existed leave them
+ * off instead of failing.
+ */
+void initialize_five_stats()
+{
+    FIVE_LENGTH = 7;
+    stats_five = (five_stat *)malloc(sizeof(five_stat) * FIVE_LENGTH);
+    const char *names[] = {
+        "Five Chained Redirect",
+        "Bad Five Chained Redirect",
+        "Five Roll",
+        "Five Roll In",
+        "Five Roll Out",
+        "Five Chained Alternation",
+        "Five Same Hand",
+    };
+
+    for (int index = 0; index < FIVE_LENGTH; index++)
+    {
+        strcpy(stats_five[index].name, names[index]);
+        stats_five[index].weight = 0;
+        stats_five[index].length = 0;
+        stats_five[index].skip = 0;
+        stats_five[index].bits = NULL;
+    }
+}
+
+/*
+ * Cleans the five-gram statistics array by skipping statistics with zero
+ * weight. Their bitsets are never built.
+ */
+void clean_five_stats()
+{
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        /* bitsets of earlier weights are rebuilt */
+        free(stats_five[i].bits);
+        stats_five[i].bits = NULL;
+        if (stats_five[i].weight == 0) {stats_five[i].skip = 1;}
+    }
+}
+
+/*
+ * Builds the bitset of every five-gram statistic left after cleaning. Each
+ * sequence is checked once against the stat's predicate, and a stat that
+ * matches no sequence at all is skipped like an empty ngram stat.
+ */
+void define_five_stats()
+{
+    /* predicates in the order of initialize_five_stats() */
+    int (*predicates[])(int, int, int, int, int, int, int, int, int, int) = {
+        is_five_chained_redirect,
+        is_five_bad_chained_redirect,
+        is_five_roll,
+        is_five_roll_in,
+        is_five_roll_out,
+        is_five_chained_alt,
+        is_five_same_hand,
+    };
+    long dim5 = (long)DIM4 * DIM1;
+
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        if (stats_five[i].skip) {continue;}
+        stats_five[i].bits = (unsigned char *)calloc(dim5 / 8 + 1, 1);
+        stats_five[i].length = 0;
+
+        long n = 0;
+        for (int p0 = 0; p0 < DIM1; p0++) {
+            for (int p1 = 0; p1 < DIM1; p1++) {
+                for (int p2 = 0; p2 < DIM1; p2++) {
+                    for (int p3 = 0; p3 < DIM1; p3++) {
+                        for (int p4 = 0; p4 < DIM1; p4++, n++) {
+                            if (predicates[i](p0 / COL, p0 % COL, p1 / COL, p1 % COL,
+                                p2 / COL, p2 % COL, p3 / COL, p3 % COL, p4 / COL, p4 % COL))
+                            {
+                                stats_five[i].bits[n >> 3] |= 1 << (n & 7);
+                                stats_five[i].length++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if (stats_five[i].length == 0)
+        {
+            stats_five[i].skip = 1;
+            free(stats_five[i].bits);
+            stats_five[i].bits = NULL;
+        }
+    }
+}
+
+/* Returns the number of five-gram statistics left after cleaning. */
+int count_five_stats()
+{
+    int count = 0;
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        if (!stats_five[i].skip) {count++;}
+    }
+    return count;
+}
+
+/* Frees the memory allocated for the five-gram statistics array. */
+void free_five_stats()
+{
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        free(stats_five[i].bits);
+    }
+    free(stats_five);
+}
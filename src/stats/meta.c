@@ -35,7 +35,7 @@
 void initialize_meta_stats()
 {
     META_LENGTH = 10;
-    stats_meta = (meta_stat *)malloc(sizeof(meta_stat) * META_LENGTH);
+    stats_meta = (meta_stat *)alloc_aligned(sizeof(meta_stat) * META_LENGTH);
     int index = 0;
 
     /* Initialize hand balance. */
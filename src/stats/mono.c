@@ -36,7 +36,7 @@
 void initialize_mono_stats()
 {
     MONO_LENGTH = 53;
-    stats_mono = (mono_stat *)malloc(sizeof(mono_stat) * MONO_LENGTH);
+    stats_mono = (mono_stat *)alloc_aligned(sizeof(mono_stat) * MONO_LENGTH);
     int row0, col0;
     int index = 0;
 
@@ -733,7 +733,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 0)
+        if (finger(row0, col0) == 0 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -828,7 +828,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 5)
+        if (finger(row0, col0) == 3 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -847,7 +847,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 6)
+        if (finger(row0, col0) == 4 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -942,7 +942,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 11)
+        if (finger(row0, col0) == 7 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1001,7 +1001,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (row0 == 0)
+        if (logical_row(row0, col0) == 0)
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1020,7 +1020,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (row0 == 1)
+        if (logical_row(row0, col0) == 1)
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1039,7 +1039,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (row0 == 2)
+        if (logical_row(row0, col0) == 2)
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1057,11 +1057,13 @@ void initialize_mono_stats()
 /*
  * Trims the ngrams in the array to move unused entries to the end.
  * This process ensures memory efficiency by eliminating gaps in the array.
+ * Ngrams touching a position without a key are dropped first.
  */
 void trim_mono_stats()
 {
     for (int i = 0; i < MONO_LENGTH; i++)
     {
+        drop_keyless(stats_mono[i].ngrams, DIM1, 1, &stats_mono[i].length); /* stats_util.c */
         if (stats_mono[i].length != 0)
         {
             int left = 0;
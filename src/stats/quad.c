@@ -36,7 +36,7 @@
 void initialize_quad_stats()
 {
     QUAD_LENGTH = 71;
-    stats_quad = (quad_stat *)malloc(sizeof(quad_stat) * QUAD_LENGTH);
+    stats_quad = (quad_stat *)alloc_aligned(sizeof(quad_stat) * QUAD_LENGTH);
     int row0, col0, row1, col1, row2, col2, row3, col3;
     int index = 0;
 
@@ -1398,11 +1398,13 @@ void initialize_quad_stats()
 /*
  * Trims the ngrams in the array to move unused entries to the end.
  * This process ensures memory efficiency by eliminating gaps in the array.
+ * Ngrams touching a position without a key are dropped first.
  */
 void trim_quad_stats()
 {
     for (int i = 0; i < QUAD_LENGTH; i++)
     {
+        drop_keyless(stats_quad[i].ngrams, DIM4, 4, &stats_quad[i].length); /* stats_util.c */
         if (stats_quad[i].length != 0)
         {
             int left = 0;
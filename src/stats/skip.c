@@ -37,7 +37,7 @@
 void initialize_skip_stats()
 {
     SKIP_LENGTH = 23;
-    stats_skip = (skip_stat *)malloc(sizeof(skip_stat) * SKIP_LENGTH);
+    stats_skip = (skip_stat *)alloc_aligned(sizeof(skip_stat) * SKIP_LENGTH);
     int row0, col0, row1, col1;
     int index = 0;
 
@@ -494,11 +494,13 @@ void initialize_skip_stats()
 /*
  * Trims the ngrams in the array to move unused entries to the end.
  * This process ensures memory efficiency by eliminating gaps in the array.
+ * Ngrams touching a position without a key are dropped first.
  */
 void trim_skip_stats()
 {
     for (int i = 0; i < SKIP_LENGTH; i++)
     {
+        drop_keyless(stats_skip[i].ngrams, DIM2, 2, &stats_skip[i].length); /* stats_util.c */
         if (stats_skip[i].length != 0)
         {
             int left = 0;
@@ -37,7 +37,7 @@
 void initialize_tri_stats()
 {
     TRI_LENGTH = 39;
-    stats_tri = (tri_stat *)malloc(sizeof(tri_stat) * TRI_LENGTH);
+    stats_tri = (tri_stat *)alloc_aligned(sizeof(tri_stat) * TRI_LENGTH);
     int row0, col0, row1, col1, row2, col2;
     int index = 0;
 
@@ -791,11 +791,13 @@ void initialize_tri_stats()
 /*
  * Trims the ngrams in the array to move unused entries to the end.
  * This process ensures memory efficiency by eliminating gaps in the array.
+ * Ngrams touching a position without a key are dropped first.
  */
 void trim_tri_stats()
 {
     for (int i = 0; i < TRI_LENGTH; i++)
     {
+        drop_keyless(stats_tri[i].ngrams, DIM3, 3, &stats_tri[i].length); /* stats_util.c */
         if (stats_tri[i].length != 0)
         {
             int left = 0;
@@ -93,46 +93,67 @@ int find_stat_index(char *stat_name, char type) {
     return -1;
 }
 
-/* 'l' for left hand, 'r' for right hand. */
+/* 'l' for left hand, 'r' for right hand, from the geometry file. */
 char hand(int row0, int col0)
 {
-    if (col0 < COL/2) {return 'l';}
-    else {return 'r';}
+    return geo_hand[row0][col0];
 }
 
-/* An integer representing the finger used (0-7). */
+/* An integer representing the finger used (0-7), from the geometry file. */
 int finger(int row0, int col0)
 {
-    switch(col0)
-    {
-        default:
-        case 0:
-        case 1:
-            return 0;
-        case 2:
-            return 1;
-        case 3:
-            return 2;
-        case 4:
-        case 5:
-            return 3;
-        case 6:
-        case 7:
-            return 4;
-        case 8:
-            return 5;
-        case 9:
-            return 6;
-        case 10:
-        case 11:
-            return 7;
-    }
+    return geo_finger[row0][col0];
+}
+
+/* The logical row used by row based stats, from the geometry file. */
+int logical_row(int row0, int col0)
+{
+    return geo_row[row0][col0];
 }
 
-/* pinky and index stretch */
+/* pinky and index stretch, from the geometry file */
 int is_stretch(int row0, int col0)
 {
-    return col0 == 0 || col0 == 5 || col0 == 6 || col0 == 11;
+    return geo_stretch[row0][col0];
+}
+
+/* 1 if the geometry has a key at the position, 0 for a '-' position. */
+int has_key(int row0, int col0)
+{
+    return geo_hand[row0][col0] != '-';
+}
+
+/*
+ * Marks the ngrams of a stat that touch a position without a key as unused,
+ * so analysis never walks tuples no character can fill. Both hand and finger
+ * of such positions compare equal to each other, so the same hand and same
+ * finger checks would otherwise list them.
+ *
+ * Parameters:
+ *   ngrams: The ngrams of the stat, unused entries -1.
+ *   dim: The number of entries, DIM1 to DIM4.
+ *   order: The number of positions per ngram.
+ *   length: The length of the stat, decreased for every ngram dropped.
+ */
+void drop_keyless(int *ngrams, int dim, int order, int *length)
+{
+    for (int i = 0; i < dim; i++)
+    {
+        if (ngrams[i] == -1) {continue;}
+        /* every position is one base DIM1 digit of the flat index */
+        int rest = ngrams[i];
+        for (int k = 0; k < order; k++)
+        {
+            int p = rest % DIM1;
+            rest /= DIM1;
+            if (!has_key(p / COL, p % COL))
+            {
+                ngrams[i] = -1;
+                (*length)--;
+                break;
+            }
+        }
+    }
 }
 
 int is_same_hand_bi(int row0, int col0, int row1, int col1)
@@ -170,30 +191,32 @@ int is_same_col_quad(int row0, int col0, int row1, int col1, int row2, int col2,
 /* literal same row */
 int is_same_row_bi(int row0, int col0, int row1, int col1)
 {
-    return row0 == row1;
+    return logical_row(row0, col0) == logical_row(row1, col1);
 }
 
 int is_same_row_tri(int row0, int col0, int row1, int col1, int row2, int col2)
 {
-    return row0 == row1 && row1 == row2;
+    return is_same_row_bi(row0, col0, row1, col1)
+        && is_same_row_bi(row1, col1, row2, col2);
 }
 
 int is_same_row_quad(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3)
 {
-    return row0 == row1 && row1 == row2 && row2 == row3;
+    return is_same_row_tri(row0, col0, row1, col1, row2, col2)
+        && is_same_row_bi(row2, col2, row3, col3);
 }
 
 /* same row without stretch columns for stats */
 int is_same_row_mod_bi(int row0, int col0, int row1, int col1)
 {
-    return row0 == row1
+    return is_same_row_bi(row0, col0, row1, col1)
         && !is_stretch(row0, col0)
         && !is_stretch(row1, col1);
 }
 
 int is_same_row_mod_tri(int row0, int col0, int row1, int col1, int row2, int col2)
 {
-    return row0 == row1 && row1 == row2
+    return is_same_row_tri(row0, col0, row1, col1, row2, col2)
         && !is_stretch(row0, col0)
         && !is_stretch(row1, col1)
         && !is_stretch(row2, col2);
@@ -201,7 +224,7 @@ int is_same_row_mod_tri(int row0, int col0, int row1, int col1, int row2, int co
 
 int is_same_row_mod_quad(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3)
 {
-    return row0 == row1 && row1 == row2 && row2 == row3
+    return is_same_row_quad(row0, col0, row1, col1, row2, col2, row3, col3)
         && !is_stretch(row0, col0)
         && !is_stretch(row1, col1)
         && !is_stretch(row2, col2)
@@ -261,8 +284,9 @@ int is_same_pos_quad(int row0, int col0, int row1, int col1, int row2, int col2,
 
 int row_diff(int row0, int col0, int row1, int col1)
 {
-    if (row0 - row1 < 0) {return row1 - row0;}
-    else {return row0 - row1;}
+    int diff = logical_row(row0, col0) - logical_row(row1, col1);
+    if (diff < 0) {return -diff;}
+    else {return diff;}
 }
 
 /* doesn't include repeats for stats */
@@ -293,7 +317,7 @@ int is_same_finger_quad(int row0, int col0, int row1, int col1, int row2, int co
 /* 2u sfb */
 int is_bad_same_finger_bi(int row0, int col0, int row1, int col1)
 {
-    return is_same_finger_bi(row0, col0, row1, col1) && (row0 - row1 == 2 || row1 - row0 == 2);
+    return is_same_finger_bi(row0, col0, row1, col1) && row_diff(row0, col0, row1, col1) == 2;
 }
 
 /* sfb with horizontal movement */
@@ -329,18 +353,18 @@ int is_half_russor(int row0, int col0, int row1, int col1)
 
 int is_index_stretch_bi(int row0, int col0, int row1, int col1)
 {
-    return (finger(row0, col0) == 2 && col1 == 5)
-        || (finger(row1, col1) == 2 && col0 == 5)
-        || (finger(row0, col0) == 5 && col1 == 6)
-        || (finger(row1, col1) == 5 && col0 == 6);
+    return (finger(row0, col0) == 2 && finger(row1, col1) == 3 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 2 && finger(row0, col0) == 3 && is_stretch(row0, col0))
+        || (finger(row0, col0) == 5 && finger(row1, col1) == 4 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 5 && finger(row0, col0) == 4 && is_stretch(row0, col0));
 }
 
 int is_pinky_stretch_bi(int row0, int col0, int row1, int col1)
 {
-    return (finger(row0, col0) == 1 && col1 == 0)
-        || (finger(row1, col1) == 1 && col0 == 0)
-        || (finger(row0, col0) == 6 && col1 == 11)
-        || (finger(row1, col1) == 6 && col0 == 11);
+    return (finger(row0, col0) == 1 && finger(row1, col1) == 0 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 1 && finger(row0, col0) == 0 && is_stretch(row0, col0))
+        || (finger(row0, col0) == 6 && finger(row1, col1) == 7 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 6 && finger(row0, col0) == 7 && is_stretch(row0, col0));
 }
 
 /*                                                   */
@@ -1124,3 +1148,44 @@ int is_same_row_adjacent_finger_chained_roll_mix(int row0, int col0, int row1, i
         && is_adjacent_finger_bi(row2, col2, row3, col3);
 }
 
+int is_five_chained_redirect(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4)
+{
+    return is_chained_redirect(row0, col0, row1, col1, row2, col2, row3, col3)
+        && is_redirect(row2, col2, row3, col3, row4, col4);
+}
+
+int is_five_bad_chained_redirect(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4)
+{
+    return is_bad_chained_redirect(row0, col0, row1, col1, row2, col2, row3, col3)
+        && is_bad_redirect(row2, col2, row3, col3, row4, col4);
+}
+
+int is_five_roll(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4)
+{
+    return (is_onehand_quad(row0, col0, row1, col1, row2, col2, row3, col3) && !is_same_hand_bi(row3, col3, row4, col4))
+        || (!is_same_hand_bi(row0, col0, row1, col1) && is_onehand_quad(row1, col1, row2, col2, row3, col3, row4, col4));
+}
+
+int is_five_roll_in(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4)
+{
+    return (is_onehand_quad_in(row0, col0, row1, col1, row2, col2, row3, col3) && !is_same_hand_bi(row3, col3, row4, col4))
+        || (!is_same_hand_bi(row0, col0, row1, col1) && is_onehand_quad_in(row1, col1, row2, col2, row3, col3, row4, col4));
+}
+
+int is_five_roll_out(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4)
+{
+    return (is_onehand_quad_out(row0, col0, row1, col1, row2, col2, row3, col3) && !is_same_hand_bi(row3, col3, row4, col4))
+        || (!is_same_hand_bi(row0, col0, row1, col1) && is_onehand_quad_out(row1, col1, row2, col2, row3, col3, row4, col4));
+}
+
+int is_five_chained_alt(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4)
+{
+    return is_chained_alt(row0, col0, row1, col1, row2, col2, row3, col3)
+        && is_alt(row2, col2, row3, col3, row4, col4);
+}
+
+int is_five_same_hand(int row0, int col0, int row1, int col1, int row2, int col2, int row3, int col3, int row4, int col4)
+{
+    return is_same_hand_quad(row0, col0, row1, col1, row2, col2, row3, col3)
+        && is_same_hand_bi(row3, col3, row4, col4);
+}
@@ -0,0 +1,158 @@
+/*
+ * stream.c - Streaming text scoring for the GULAG.
+ *
+ * Scoring a layout on many small documents does not need a full set of ngram
+ * tables per document. The text is read once, each character is mapped to
+ * the key it sits on, and each bigram, trigram, quadgram, and skipgram window
+ * is counted straight into the stats walking those keys. Dividing by the
+ * number of windows then gives the same percentages a normalized corpus
+ * would.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "stream.h"
+#include "stat_map.h"
+#include "analyze.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Counts one window towards every stat walking its position ngram. */
+void count_window(stat_map *map, int ngram, long long *counts)
+{
+    for (int k = map->start[ngram]; k < map->start[ngram + 1]; k++)
+    {
+        counts[map->stats[k]]++;
+    }
+}
+
+/* Turns the window counts of walked stats into percentages of the total. */
+void stream_percentages(float *scores, long long *counts, int length, long long total)
+{
+    for (int i = 0; i < length; i++)
+    {
+        scores[i] = total > 0 ? (double)counts[i] * 100 / total : 0;
+    }
+}
+
+/*
+ * Scores a layout on a text by streaming it once, without building ngram
+ * tables. Every window of characters is mapped to the keys it lands on, and
+ * the stats walking those keys are counted through the stat maps, which
+ * build_stat_maps() must have built.
+ *
+ * Parameters:
+ *   text: The open text to read to its end.
+ *   lt: The layout, its stats and score are set from the text.
+ *   first, next: The layout's key positions from map_positions().
+ * Returns: The number of characters read.
+ */
+long stream_document(FILE *text, layout *lt, int *first, int *next)
+{
+    long long mono[MONO_LENGTH + 1], bi[BI_LENGTH + 1], tri[TRI_LENGTH + 1];
+    long long quad[QUAD_LENGTH + 1], skip[10][SKIP_LENGTH + 1];
+    long long total_mono = 0, total_bi = 0, total_tri = 0, total_quad = 0;
+    long long total_skip[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    memset(mono, 0, sizeof(mono));
+    memset(bi, 0, sizeof(bi));
+    memset(tri, 0, sizeof(tri));
+    memset(quad, 0, sizeof(quad));
+    memset(skip, 0, sizeof(skip));
+
+    /* Memory for the last 11 seen characters */
+    int mem[] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+    long chars = 0;
+
+    wchar_t curr;
+    while ((curr = fgetwc(text)) != WEOF) {
+        chars++;
+        /* convert characters based on the lang file */
+        mem[0] = convert_char(curr); /* io_util.c */
+        /* windows are counted like read_corpus() counts ngrams */
+        if (mem[0] > 0 && mem[0] < 51) {
+            total_mono++;
+            for (int p0 = first[mem[0]]; p0 >= 0; p0 = next[p0]) {
+                count_window(&map_mono, p0, mono);
+            }
+
+            if (mem[1] > 0 && mem[1] < 51) {
+                total_bi++;
+                for (int p0 = first[mem[1]]; p0 >= 0; p0 = next[p0]) {
+                    for (int p1 = first[mem[0]]; p1 >= 0; p1 = next[p1]) {
+                        count_window(&map_bi, p0 * DIM1 + p1, bi);
+                    }
+                }
+                if (mem[2] > 0 && mem[2] < 51) {
+                    total_tri++;
+                    for (int p0 = first[mem[2]]; p0 >= 0; p0 = next[p0]) {
+                        for (int p1 = first[mem[1]]; p1 >= 0; p1 = next[p1]) {
+                            for (int p2 = first[mem[0]]; p2 >= 0; p2 = next[p2]) {
+                                count_window(&map_tri, (p0 * DIM1 + p1) * DIM1 + p2, tri);
+                            }
+                        }
+                    }
+                    if (mem[3] > 0 && mem[3] < 51) {
+                        total_quad++;
+                        for (int p0 = first[mem[3]]; p0 >= 0; p0 = next[p0]) {
+                            for (int p1 = first[mem[2]]; p1 >= 0; p1 = next[p1]) {
+                                for (int p2 = first[mem[1]]; p2 >= 0; p2 = next[p2]) {
+                                    for (int p3 = first[mem[0]]; p3 >= 0; p3 = next[p3]) {
+                                        count_window(&map_quad, ((p0 * DIM1 + p1) * DIM1 + p2) * DIM1 + p3, quad);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            /* skipgrams from skip-1 to skip-9 */
+            for (int i = 2; i < 11; i++) {
+                if (mem[i] > 0 && mem[i] < 51) {
+                    total_skip[i-1]++;
+                    for (int p0 = first[mem[i]]; p0 >= 0; p0 = next[p0]) {
+                        for (int p1 = first[mem[0]]; p1 >= 0; p1 = next[p1]) {
+                            count_window(&map_skip, p0 * DIM1 + p1, skip[i-1]);
+                        }
+                    }
+                }
+            }
+        }
+        /* shift over an array one index, dropping the last value */
+        iterate(mem, 11); /* io_util.c */
+    }
+
+    /* only walked stats are counted, skipped ones keep their values */
+    float values[MONO_LENGTH + BI_LENGTH + TRI_LENGTH + QUAD_LENGTH + SKIP_LENGTH + 1];
+    stream_percentages(values, mono, MONO_LENGTH, total_mono);
+    for (int i = 0; i < MONO_LENGTH; i++) {
+        if (!stats_mono[i].skip && !stats_mono[i].derived) {lt->mono_score[i] = values[i];}
+    }
+    stream_percentages(values, bi, BI_LENGTH, total_bi);
+    for (int i = 0; i < BI_LENGTH; i++) {
+        if (!stats_bi[i].skip && !stats_bi[i].derived) {lt->bi_score[i] = values[i];}
+    }
+    stream_percentages(values, tri, TRI_LENGTH, total_tri);
+    for (int i = 0; i < TRI_LENGTH; i++) {
+        if (!stats_tri[i].skip && !stats_tri[i].derived) {lt->tri_score[i] = values[i];}
+    }
+    stream_percentages(values, quad, QUAD_LENGTH, total_quad);
+    for (int i = 0; i < QUAD_LENGTH; i++) {
+        if (!stats_quad[i].skip && !stats_quad[i].derived) {lt->quad_score[i] = values[i];}
+    }
+    for (int k = 1; k <= 9; k++) {
+        stream_percentages(values, skip[k], SKIP_LENGTH, total_skip[k]);
+        for (int i = 0; i < SKIP_LENGTH; i++) {
+            if (!stats_skip[i].skip && !stats_skip[i].derived) {lt->skip_score[k][i] = values[i];}
+        }
+    }
+
+    derive_stats(lt); /* analyze.c */
+    meta_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+    return chars;
+}
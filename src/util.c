@@ -11,22 +11,26 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <signal.h>
 
 #include "util.h"
 #include "global.h"
 #include "structs.h"
 #include "io.h"
 #include "io_util.h"
+#include "logger.h"
 
 /*
- * Error handling function: Shows the cursor, prints an error message to
- * standard error, and terminates the program.
+ * Error handling function: Writes out any queued log output, shows the
+ * cursor, prints an error message to standard error, and terminates the
+ * program.
  * Parameters:
  *   msg: The error message to be displayed.
  * Does not return (terminates program).
  */
 void error(const char *msg)
 {
+    log_flush();
     fflush(stdout);
     /* show cursor */
     wprintf(L"\e[?25h");
@@ -213,6 +217,60 @@ size_t index_skip(int skip_index, int j, int k) {
     return skip_index * LANG_LENGTH * LANG_LENGTH + j * LANG_LENGTH + k;
 }
 
+/*
+ * Allocates zeroed memory aligned to HOST_ALIGN, rounded up to a whole number
+ * of HOST_ALIGN blocks, so that OpenCL devices sharing host memory can use it
+ * without a copy. Freed with free().
+ * Parameters:
+ *   size: The size in bytes.
+ * Returns: The allocation, or NULL on failure.
+ */
+void *alloc_aligned(size_t size)
+{
+    size_t rounded = (size / HOST_ALIGN + 1) * HOST_ALIGN;
+    void *ptr;
+    if (posix_memalign(&ptr, HOST_ALIGN, rounded) != 0) {return NULL;}
+    memset(ptr, 0, rounded);
+    return ptr;
+}
+
+/*
+ * Grows or shrinks an allocation from alloc_aligned(), keeping it aligned.
+ * Parameters:
+ *   ptr: The allocation to resize, freed on success.
+ *   old_size: Its current size in bytes.
+ *   new_size: The new size in bytes.
+ * Returns: The new allocation, or NULL on failure.
+ */
+void *realloc_aligned(void *ptr, size_t old_size, size_t new_size)
+{
+    void *grown = alloc_aligned(new_size);
+    if (grown == NULL) {return NULL;}
+    memcpy(grown, ptr, old_size < new_size ? old_size : new_size);
+    free(ptr);
+    return grown;
+}
+
+/* Zeroes the global corpus count arrays. */
+void clear_corpus()
+{
+    memset(corpus_mono, 0, sizeof(int) * LANG_LENGTH);
+    for (int i = 0; i < LANG_LENGTH; i++) {
+        memset(corpus_bi[i], 0, sizeof(int) * LANG_LENGTH);
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            memset(corpus_tri[i][j], 0, sizeof(int) * LANG_LENGTH);
+            for (int k = 0; k < LANG_LENGTH; k++) {
+                memset(corpus_quad[i][j][k], 0, sizeof(int) * LANG_LENGTH);
+            }
+        }
+    }
+    for (int i = 1; i <= 9; i++) {
+        for (int j = 0; j < LANG_LENGTH; j++) {
+            memset(corpus_skip[i][j], 0, sizeof(int) * LANG_LENGTH);
+        }
+    }
+}
+
 /* Normalizes the corpus data from raw frequencies to percentages. */
 void normalize_corpus()
 {
@@ -315,6 +373,7 @@ void alloc_layout(layout **lt)
         (*lt)->skip_score[i] = (float *)calloc(SKIP_LENGTH, sizeof(float));
     }
     (*lt)->meta_score = (float *)calloc(META_LENGTH, sizeof(float));
+    (*lt)->five_score = (float *)calloc(FIVE_LENGTH, sizeof(float));
 }
 
 /*
@@ -327,6 +386,7 @@ void free_layout(layout *lt)
     for (int i = 1; i < 10; i++) {
         free(lt->skip_score[i]);
     }
+    free(lt->five_score);
     free(lt->meta_score);
     free(lt->skip_score);
     free(lt->quad_score);
@@ -372,6 +432,10 @@ void get_score(layout *lt)
     {
         if(!stats_meta[i].skip) {lt->score += lt->meta_score[i] * stats_meta[i].weight;}
     }
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        if(!stats_five[i].skip) {lt->score += lt->five_score[i] * stats_five[i].weight;}
+    }
 }
 
 /*
@@ -435,6 +499,10 @@ void get_layout_diff(layout *lt, layout *lt2, layout *lt_diff)
     for (int i = 0; i < META_LENGTH; i++) {
         if(!stats_meta[i].skip) {lt_diff->meta_score[i] = lt->meta_score[i] - lt2->meta_score[i];}
     }
+
+    for (int i = 0; i < FIVE_LENGTH; i++) {
+        if(!stats_five[i].skip) {lt_diff->five_score[i] = lt->five_score[i] - lt2->five_score[i];}
+    }
 }
 
 /*
@@ -482,19 +550,26 @@ void free_list() {
 }
 
 /*
- * Randomly shuffles the keys in a layout.
+ * Randomly shuffles the keys in a layout, leaving pinned positions in place.
  * Parameters:
  *   lt: Pointer to the layout to be shuffled.
  */
 void shuffle_layout(layout *lt)
 {
-    for (int i = DIM1 - 1; i > 0; i--) {
+    /* collect the free positions */
+    int free_pos[DIM1];
+    int free_count = 0;
+    for (int i = 0; i < DIM1; i++) {
+        if (!pins[i / COL][i % COL]) {free_pos[free_count++] = i;}
+    }
+
+    for (int i = free_count - 1; i > 0; i--) {
         int j = rand() % (i + 1);
 
-        int i_row = i / COL;
-        int i_col = i % COL;
-        int j_row = j / COL;
-        int j_col = j % COL;
+        int i_row = free_pos[i] / COL;
+        int i_col = free_pos[i] % COL;
+        int j_row = free_pos[j] / COL;
+        int j_col = free_pos[j] % COL;
 
         int temp = lt->matrix[i_row][i_col];
         lt->matrix[i_row][i_col] = lt->matrix[j_row][j_col];
@@ -502,6 +577,47 @@ void shuffle_layout(layout *lt)
     }
 }
 
+/*
+ * Collects the reserve characters of a layout: the characters of the
+ * language, other than space, that are not on any of its keys.
+ * Parameters:
+ *   lt: Pointer to the layout.
+ *   pool: Filled with the reserve characters, needs LANG_LENGTH entries.
+ * Returns: The number of reserve characters.
+ */
+int reserve_pool(layout *lt, int *pool)
+{
+    int on_board[LANG_LENGTH];
+    memset(on_board, 0, sizeof(on_board));
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            if (lt->matrix[i][j] > 0) {on_board[lt->matrix[i][j]] = 1;}
+        }
+    }
+
+    int count = 0;
+    for (int c = 1; c < LANG_LENGTH; c++) {
+        /* unused slots of the language file convert back to '@' */
+        if (!on_board[c] && convert_back(c) != L'@') {pool[count++] = c;} /* io_util.c */
+    }
+    return count;
+}
+
+/*
+ * Sums the monogram frequency of the reserve characters of a layout.
+ * Parameters:
+ *   lt: Pointer to the layout.
+ * Returns: The percentage of corpus characters that are not on the layout.
+ */
+float off_layout_mass(layout *lt)
+{
+    int pool[LANG_LENGTH];
+    int count = reserve_pool(lt, pool);
+    float mass = 0;
+    for (int i = 0; i < count; i++) {mass += linear_mono[pool[i]];}
+    return mass;
+}
+
 /*
  * Copies the contents of one layout to another.
  * Parameters:
@@ -539,6 +655,10 @@ void copy(layout *lt_dest, layout *lt_src)
     {
         lt_dest->meta_score[i] = lt_src->meta_score[i];
     }
+    for (int i = 0; i < FIVE_LENGTH; i++)
+    {
+        lt_dest->five_score[i] = lt_src->five_score[i];
+    }
     for (int j = 1; j <= 9; j++)
     {
         for (int i = 0; i < SKIP_LENGTH; i++)
@@ -572,3 +692,45 @@ float random_float() {
     return (float)rand() / RAND_MAX;
 }
 
+/*
+ * Signal handler for the optimization modes. SIGINT and SIGTERM request a
+ * stop, SIGUSR1 requests a dump of the current best layout. Only sets flags,
+ * the threads poll them and do the actual work.
+ * Parameters:
+ *   sig: The signal number.
+ */
+void signal_handler(int sig)
+{
+    if (sig == SIGUSR1) {
+        atomic_fetch_add(&dump_requested, 1);
+        return;
+    }
+    atomic_store(&stop_requested, 1);
+}
+
+/*
+ * Installs the handlers that let a long optimization be stopped early or
+ * asked for its current best layout. The stop handlers reset themselves, so
+ * a second SIGINT or SIGTERM terminates the program as usual.
+ */
+void catch_signals()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_handler = signal_handler;
+    action.sa_flags = SA_RESTART | SA_RESETHAND;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+}
+
+/* Restores the default signal handling once an optimization is done. */
+void release_signals()
+{
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGUSR1, SIG_DFL);
+}
+